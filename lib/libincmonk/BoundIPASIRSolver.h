@@ -0,0 +1,268 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief IPASIRSolver implementation with statically bound IPASIR functions
+ */
+
+#pragma once
+
+#include <libincmonk/CNF.h>
+#include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/TBool.h>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace incmonk {
+
+/**
+ * \brief IPASIRSolver implementation calling the IPASIR functions provided by `Binding`.
+ *
+ * `Binding` has the IPASIR function pointer members of IPASIRSolverDSO, i.e. `initFn`,
+ * `releaseFn`, `addFn`, `assumeFn`, `solveFn`, `valFn`, `failedFn`, `havocInitFn`,
+ * `havocFn`, `modelFn` and `failedBulkFn`, with the optional `incmonk_*` functions set
+ * to `nullptr` if they are not available.
+ *
+ * IPASIRSolverDSO itself can be used as `Binding`, with the functions being looked up
+ * at runtime. If `Binding` declares the functions as `static constexpr` pointers instead,
+ * calls to BoundIPASIRSolver are bound to the IPASIR functions at compile time. Since
+ * this class is `final`, applyTrace() and executeTrace() calls with a `BoundIPASIRSolver`
+ * argument do not involve any virtual dispatch for adding clauses and assumptions.
+ */
+template <typename Binding>
+class BoundIPASIRSolver final : public IPASIRSolver {
+public:
+  explicit BoundIPASIRSolver(Binding const& binding = Binding{});
+  virtual ~BoundIPASIRSolver();
+
+  void addClause(gsl::span<CNFLit const> clause) override;
+  void assume(gsl::span<CNFLit const> assumptions) override;
+
+  auto solve() -> Result override;
+  auto getLastSolveResult() const noexcept -> Result override;
+  auto getValue(CNFLit lit) const noexcept -> TBool override;
+  auto isFailed(CNFLit lit) const noexcept -> bool override;
+
+  void getModel(gsl::span<TBool> result) const noexcept override;
+  void getFailed(gsl::span<CNFLit const> assumptions,
+                 std::vector<CNFLit>& result) const override;
+
+  void configure(uint64_t value) override;
+  void reinitializeWithHavoc(uint64_t seed) noexcept override;
+  void havoc(uint64_t seed) noexcept override;
+
+  BoundIPASIRSolver(BoundIPASIRSolver const&) = delete;
+  auto operator=(BoundIPASIRSolver const&) -> BoundIPASIRSolver& = delete;
+
+private:
+  Binding m_binding;
+  void* m_ipasirContext = nullptr;
+  Result m_lastResult = Result::UNKNOWN;
+
+  // Transfer buffer for incmonk_model and incmonk_failed
+  mutable std::vector<int8_t> m_valueBuffer;
+};
+
+
+// Implementation
+
+template <typename Binding>
+BoundIPASIRSolver<Binding>::BoundIPASIRSolver(Binding const& binding) : m_binding{binding}
+{
+  m_ipasirContext = m_binding.initFn();
+  // TODO: error handling when m_ipasircontext == nullptr
+}
+
+template <typename Binding>
+BoundIPASIRSolver<Binding>::~BoundIPASIRSolver()
+{
+  if (m_ipasirContext != nullptr) {
+    m_binding.releaseFn(m_ipasirContext);
+    m_ipasirContext = nullptr;
+  }
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::addClause(gsl::span<CNFLit const> clause)
+{
+  for (CNFLit lit : clause) {
+    m_binding.addFn(m_ipasirContext, lit);
+  }
+  m_binding.addFn(m_ipasirContext, 0);
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::assume(gsl::span<CNFLit const> assumptions)
+{
+  for (CNFLit a : assumptions) {
+    m_binding.assumeFn(m_ipasirContext, a);
+  }
+}
+
+template <typename Binding>
+auto BoundIPASIRSolver<Binding>::solve() -> Result
+{
+  int result = m_binding.solveFn(m_ipasirContext);
+  if (result == 0) {
+    m_lastResult = Result::UNKNOWN;
+  }
+  else if (result == 10) {
+    m_lastResult = Result::SAT;
+  }
+  else if (result == 20) {
+    m_lastResult = Result::UNSAT;
+  }
+  else {
+    m_lastResult = Result::ILLEGAL_RESULT;
+  }
+  return m_lastResult;
+}
+
+template <typename Binding>
+auto BoundIPASIRSolver<Binding>::getLastSolveResult() const noexcept -> Result
+{
+  return m_lastResult;
+}
+
+template <typename Binding>
+auto BoundIPASIRSolver<Binding>::getValue(CNFLit lit) const noexcept -> TBool
+{
+  int value = m_binding.valFn(m_ipasirContext, lit);
+
+  if (value == lit) {
+    return t_true;
+  }
+  else if (value == -lit) {
+    return t_false;
+  }
+  else if (value == 0) {
+    return t_indet;
+  }
+  else {
+    abort();
+  }
+}
+
+template <typename Binding>
+auto BoundIPASIRSolver<Binding>::isFailed(CNFLit lit) const noexcept -> bool
+{
+  int result = m_binding.failedFn(m_ipasirContext, lit);
+  switch (result) {
+  case 0:
+    return false;
+  case 1:
+    return true;
+  default:
+    abort();
+  }
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::getModel(gsl::span<TBool> result) const noexcept
+{
+  if (m_binding.modelFn == nullptr) {
+    IPASIRSolver::getModel(result);
+    return;
+  }
+
+  m_valueBuffer.resize(result.size());
+  m_binding.modelFn(m_ipasirContext, static_cast<int32_t>(result.size()), m_valueBuffer.data());
+
+  for (std::size_t idx = 0; idx < m_valueBuffer.size(); ++idx) {
+    switch (m_valueBuffer[idx]) {
+    case 1:
+      result[idx] = t_true;
+      break;
+    case -1:
+      result[idx] = t_false;
+      break;
+    case 0:
+      result[idx] = t_indet;
+      break;
+    default:
+      abort();
+    }
+  }
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::getFailed(gsl::span<CNFLit const> assumptions,
+                                           std::vector<CNFLit>& result) const
+{
+  if (m_binding.failedBulkFn == nullptr) {
+    IPASIRSolver::getFailed(assumptions, result);
+    return;
+  }
+
+  m_valueBuffer.resize(assumptions.size());
+  m_binding.failedBulkFn(
+      m_ipasirContext, assumptions.data(), assumptions.size(), m_valueBuffer.data());
+
+  result.clear();
+  for (std::size_t idx = 0; idx < m_valueBuffer.size(); ++idx) {
+    switch (m_valueBuffer[idx]) {
+    case 0:
+      break;
+    case 1:
+      result.push_back(assumptions[idx]);
+      break;
+    default:
+      abort();
+    }
+  }
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::configure(uint64_t)
+{
+  // Not implemented yet
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::reinitializeWithHavoc(uint64_t seed) noexcept
+{
+  if (m_binding.havocInitFn != nullptr) {
+    m_binding.releaseFn(m_ipasirContext);
+    m_binding.havocInitFn(seed);
+    m_ipasirContext = m_binding.initFn();
+  }
+}
+
+template <typename Binding>
+void BoundIPASIRSolver<Binding>::havoc(uint64_t seed) noexcept
+{
+  if (m_binding.havocFn != nullptr) {
+    m_binding.havocFn(m_ipasirContext, seed);
+  }
+}
+}
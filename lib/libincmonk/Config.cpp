@@ -27,10 +27,12 @@
 #include <libincmonk/Config.h>
 #include <libincmonk/ConfigTomlUtils.h>
 #include <libincmonk/generators/CommunityAttachmentGenerator.h>
+#include <libincmonk/generators/MuxGenerator.h>
 #include <libincmonk/generators/SimplifiersParadiseGenerator.h>
 
 #include <cstdint>
 #include <istream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -81,6 +83,15 @@ assumption_phase_density_interval = [0.5, 0.7]
 assumption_density_interval = [0.0, 0.2]
 havoc_phase_density_interval = [0.0, 1.0]
 havoc_density_interval = [0.0, 0.1]
+
+[[generator_selection]]
+# Generator selection policy:
+#  "fixed": generators are selected at random, with probabilities proportional to their weights
+#  "thompson": generators are selected adaptively, favoring generators whose traces reveal
+#              more failures per second of execution time. The weights serve as priors.
+policy = "fixed"
+community_attachment_weight = 1.0
+simplifiers_paradise_weight = 1.0
 )z";
 
 template <typename T>
@@ -144,6 +155,55 @@ void overrideTraceGenConfig(toml::node const& caConfig, ConfigStruct& target)
   }
 }
 
+auto createSelectionPolicyParser(MuxSelectionPolicy& target) -> TOMLNodeParserFn
+{
+  return [&target](toml::node const& node) {
+    throwingCheckType(node, toml::node_type::string, "value is not a string");
+
+    std::string const& policyName = **node.as_string();
+    if (policyName == "fixed") {
+      target = MuxSelectionPolicy::FIXED_WEIGHTS;
+    }
+    else if (policyName == "thompson") {
+      target = MuxSelectionPolicy::THOMPSON_SAMPLING;
+    }
+    else {
+      throw TOMLConfigParseError{"invalid generator selection policy " + policyName, node};
+    }
+  };
+}
+
+void overrideGeneratorSelectionConfig(toml::node const& selectionConfig,
+                                      GeneratorSelectionParams& target)
+{
+  // clang-format off
+  std::unordered_map<std::string, TOMLNodeParserFn> const parsers = {
+    {"policy", createSelectionPolicyParser(target.policy)},
+    {"community_attachment_weight", createNonNegativeFloatParser(target.communityAttachmentWeight)},
+    {"simplifiers_paradise_weight", createNonNegativeFloatParser(target.simplifiersParadiseWeight)}
+  };
+  // clang-format on
+
+  throwingCheckType(selectionConfig, toml::node_type::array, "invalid document structure");
+
+  for (toml::node const& configTable : *selectionConfig.as_array()) {
+    throwingCheckType(configTable, toml::node_type::table, "invalid document structure");
+
+    for (auto configItem : *configTable.as_table()) {
+      if (auto parser = parsers.find(configItem.first); parser != parsers.end()) {
+        parser->second(configItem.second);
+      }
+      else {
+        throw TOMLConfigParseError{"invalid key " + configItem.first, configItem.second};
+      }
+    }
+  }
+
+  if (target.communityAttachmentWeight + target.simplifiersParadiseWeight <= 0.0) {
+    throw TOMLConfigParseError{"at least one generator weight must be positive", selectionConfig};
+  }
+}
+
 void applyTOMLConfig(toml::table const& config, Config& target)
 {
   try {
@@ -154,6 +214,9 @@ void applyTOMLConfig(toml::table const& config, Config& target)
       else if (toplevelItem.first == "simplifiers_paradise_generator") {
         overrideTraceGenConfig(toplevelItem.second, target.simplifiersParadiseParams);
       }
+      else if (toplevelItem.first == "generator_selection") {
+        overrideGeneratorSelectionConfig(toplevelItem.second, target.generatorSelectionParams);
+      }
       else {
         throw TOMLConfigParseError{"invalid item " + toplevelItem.first, config};
       }
@@ -34,6 +34,7 @@
 #pragma once
 
 #include <libincmonk/generators/CommunityAttachmentGenerator.h>
+#include <libincmonk/generators/MuxGenerator.h>
 #include <libincmonk/generators/SimplifiersParadiseGenerator.h>
 
 #include <istream>
@@ -42,6 +43,16 @@
 
 namespace incmonk {
 
+/// \brief Configuration of the selection of trace generators
+///
+/// With MuxSelectionPolicy::THOMPSON_SAMPLING, the weights are used as priors
+/// for the adaptive selection.
+struct GeneratorSelectionParams {
+  MuxSelectionPolicy policy = MuxSelectionPolicy::FIXED_WEIGHTS;
+  double communityAttachmentWeight = 1.0;
+  double simplifiersParadiseWeight = 1.0;
+};
+
 /// \brief Main Incremental Monkey config structure
 ///
 /// This structure contains configuration for all of monkey's subsystems.
@@ -53,6 +64,7 @@ struct Config {
 
   CommunityAttachmentModelParams communityAttachmentModelParams;
   SimplifiersParadiseParams simplifiersParadiseParams;
+  GeneratorSelectionParams generatorSelectionParams;
 };
 
 class ConfigParseError : public std::runtime_error {
@@ -143,6 +143,21 @@ auto createIntervalParser(ClosedInterval& target) -> TOMLNodeParserFn
 }
 
 
+auto createNonNegativeFloatParser(double& target) -> TOMLNodeParserFn
+{
+  return [&target](toml::node const& node) {
+    throwingCheckType(node, toml::node_type::floating_point, "value is not a floating-point value");
+
+    double const value = **node.as_floating_point();
+    if (value < 0.0) {
+      throw TOMLConfigParseError{"value must not be negative", node};
+    }
+
+    target = value;
+  };
+}
+
+
 auto createPiecewiseLinearDistParser(std::piecewise_linear_distribution<double>& target)
     -> TOMLNodeParserFn
 {
@@ -92,6 +92,14 @@ auto parseZippedFloatArray(toml::node const& node)
 /// The returned function throws TOMLConfigParseError on parse failures.
 auto createIntervalParser(ClosedInterval& target) -> TOMLNodeParserFn;
 
+/// \brief Creates a TOMLNodeParserFn parsing the node as a non-negative
+///   floating-point value
+///
+/// \param target   The variable where the result is stored
+///
+/// The returned function throws TOMLConfigParseError on parse failures.
+auto createNonNegativeFloatParser(double& target) -> TOMLNodeParserFn;
+
 /// \brief Creates a TOMLNodeParserFn parsing the node as piecewise linear
 ///   distribution on `double` values
 ///
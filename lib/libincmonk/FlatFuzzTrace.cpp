@@ -0,0 +1,195 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FlatFuzzTrace.h>
+
+#include <libincmonk/IPASIRSolver.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <variant>
+
+namespace incmonk {
+
+auto FlatFuzzTrace::getSolveOpcode(std::optional<bool> expectedResult) noexcept -> Opcode
+{
+  if (!expectedResult.has_value()) {
+    return Opcode::SOLVE;
+  }
+  return *expectedResult ? Opcode::SOLVE_EXPECTING_SAT : Opcode::SOLVE_EXPECTING_UNSAT;
+}
+
+void FlatFuzzTrace::append(Opcode opcode, gsl::span<CNFLit const> words)
+{
+  if (words.size() > std::numeric_limits<uint32_t>::max() - m_arena.size()) {
+    throw std::length_error{"FlatFuzzTrace: arena size limit exceeded"};
+  }
+
+  m_arena.insert(m_arena.end(), words.begin(), words.end());
+  m_arenaEnds.push_back(static_cast<uint32_t>(m_arena.size()));
+  m_opcodes.push_back(opcode);
+}
+
+void FlatFuzzTrace::addClause(gsl::span<CNFLit const> clause)
+{
+  append(Opcode::ADD_CLAUSE, clause);
+}
+
+void FlatFuzzTrace::assume(gsl::span<CNFLit const> assumptions)
+{
+  append(Opcode::ASSUME, assumptions);
+}
+
+void FlatFuzzTrace::solve(std::optional<bool> expectedResult)
+{
+  append(getSolveOpcode(expectedResult), {});
+}
+
+void FlatFuzzTrace::havoc(uint64_t seed, bool beforeInit)
+{
+  CNFLit const words[2] = {static_cast<CNFLit>(static_cast<uint32_t>(seed >> 32)),
+                           static_cast<CNFLit>(static_cast<uint32_t>(seed))};
+  append(beforeInit ? Opcode::HAVOC_BEFORE_INIT : Opcode::HAVOC, words);
+}
+
+void FlatFuzzTrace::push_back(FuzzCmd const& cmd)
+{
+  std::visit(
+      [this](auto&& x) {
+        using CmdT = std::decay_t<decltype(x)>;
+        if constexpr (std::is_same_v<CmdT, AddClauseCmd>) {
+          addClause(x.clauseToAdd);
+        }
+        else if constexpr (std::is_same_v<CmdT, AssumeCmd>) {
+          assume(x.assumptions);
+        }
+        else if constexpr (std::is_same_v<CmdT, SolveCmd>) {
+          solve(x.expectedResult);
+        }
+        else {
+          havoc(x.seed, x.beforeInit);
+        }
+      },
+      cmd);
+}
+
+void FlatFuzzTrace::push_back(CmdView const& cmd)
+{
+  append(cmd.m_opcode, cmd.m_words);
+}
+
+void FlatFuzzTrace::setExpectedResult(size_type index, std::optional<bool> expectedResult) noexcept
+{
+  assert((*this)[index].getKind() == CmdKind::SOLVE);
+  m_opcodes[index] = getSolveOpcode(expectedResult);
+}
+
+auto FlatFuzzTrace::getArenaSize() const noexcept -> size_type
+{
+  return m_arena.size();
+}
+
+void FlatFuzzTrace::reserve(size_type numCmds, size_type arenaSize)
+{
+  m_opcodes.reserve(numCmds);
+  m_arenaEnds.reserve(numCmds);
+  m_arena.reserve(arenaSize);
+}
+
+void FlatFuzzTrace::clear() noexcept
+{
+  m_opcodes.clear();
+  m_arenaEnds.clear();
+  m_arena.clear();
+}
+
+auto FlatFuzzTrace::operator==(FlatFuzzTrace const& rhs) const noexcept -> bool
+{
+  return this == &rhs || (m_opcodes == rhs.m_opcodes && m_arenaEnds == rhs.m_arenaEnds &&
+                          m_arena == rhs.m_arena);
+}
+
+auto FlatFuzzTrace::operator!=(FlatFuzzTrace const& rhs) const noexcept -> bool
+{
+  return !(*this == rhs);
+}
+
+auto FlatFuzzTrace::CmdView::toFuzzCmd() const -> FuzzCmd
+{
+  return visit([](auto&& x) -> FuzzCmd {
+    using CmdT = std::decay_t<decltype(x)>;
+    if constexpr (std::is_same_v<CmdT, AddClauseView>) {
+      return AddClauseCmd{{x.clauseToAdd.begin(), x.clauseToAdd.end()}};
+    }
+    else if constexpr (std::is_same_v<CmdT, AssumeView>) {
+      return AssumeCmd{{x.assumptions.begin(), x.assumptions.end()}};
+    }
+    else {
+      return x;
+    }
+  });
+}
+
+auto toFlatFuzzTrace(FuzzTrace::const_iterator first, FuzzTrace::const_iterator last)
+    -> FlatFuzzTrace
+{
+  FlatFuzzTrace::size_type arenaSize = 0;
+  for (FuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
+    if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&*cmd); addClause != nullptr) {
+      arenaSize += addClause->clauseToAdd.size();
+    }
+    else if (AssumeCmd const* assume = std::get_if<AssumeCmd>(&*cmd); assume != nullptr) {
+      arenaSize += assume->assumptions.size();
+    }
+    else if (std::holds_alternative<HavocCmd>(*cmd)) {
+      arenaSize += 2;
+    }
+  }
+
+  FlatFuzzTrace result;
+  result.reserve(std::distance(first, last), arenaSize);
+  for (FuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
+    result.push_back(*cmd);
+  }
+  return result;
+}
+
+auto toFuzzTrace(FlatFuzzTrace::const_iterator first, FlatFuzzTrace::const_iterator last)
+    -> FuzzTrace
+{
+  FuzzTrace result;
+  result.reserve(std::distance(first, last));
+  for (FlatFuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
+    result.push_back((*cmd).toFuzzCmd());
+  }
+  return result;
+}
+
+template auto applyTrace<IPASIRSolver>(FlatFuzzTrace::const_iterator first,
+                                       FlatFuzzTrace::const_iterator last,
+                                       IPASIRSolver& target) -> FlatFuzzTrace::const_iterator;
+}
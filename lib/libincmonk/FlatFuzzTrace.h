@@ -0,0 +1,539 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Flat FuzzTrace representation, storing the literals of all commands in
+ *   a single contiguous arena
+ */
+
+#pragma once
+
+#include <libincmonk/CNF.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/TraceFileFormat.h>
+
+#include <gsl/span>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+namespace incmonk {
+
+/**
+ * \brief View of an AddClauseCmd stored in a FlatFuzzTrace
+ */
+struct AddClauseView {
+  gsl::span<CNFLit const> clauseToAdd;
+};
+
+/**
+ * \brief View of an AssumeCmd stored in a FlatFuzzTrace
+ */
+struct AssumeView {
+  gsl::span<CNFLit const> assumptions;
+};
+
+
+/**
+ * \brief A trace of IPASIR commands, stored without per-command heap allocations.
+ *
+ * FlatFuzzTrace is an alternative to FuzzTrace for large traces. The literals of
+ * all commands are stored in a single arena. For each command, its opcode and the
+ * end of its arena range are stored in two compact arrays. Havoc seeds are stored
+ * in the arena as well, occupying two arena words.
+ *
+ * Commands are accessed via CmdView objects, which refer to the trace's storage
+ * and are invalidated when the trace is modified (except via setExpectedResult()).
+ */
+class FlatFuzzTrace {
+public:
+  using size_type = std::size_t;
+
+  enum class CmdKind : uint8_t { ADD_CLAUSE, ASSUME, SOLVE, HAVOC };
+
+  class CmdView;
+  class const_iterator;
+
+  void addClause(gsl::span<CNFLit const> clause);
+  void assume(gsl::span<CNFLit const> assumptions);
+  void solve(std::optional<bool> expectedResult = std::nullopt);
+  void havoc(uint64_t seed, bool beforeInit);
+
+  void push_back(FuzzCmd const& cmd);
+  void push_back(CmdView const& cmd);
+
+  void setExpectedResult(size_type index, std::optional<bool> expectedResult) noexcept;
+
+  auto operator[](size_type index) const noexcept -> CmdView;
+  auto begin() const noexcept -> const_iterator;
+  auto end() const noexcept -> const_iterator;
+
+  auto size() const noexcept -> size_type;
+  auto empty() const noexcept -> bool;
+
+  /// Returns the number of arena words used by the commands in the trace
+  auto getArenaSize() const noexcept -> size_type;
+
+  void reserve(size_type numCmds, size_type arenaSize);
+  void clear() noexcept;
+
+  auto operator==(FlatFuzzTrace const& rhs) const noexcept -> bool;
+  auto operator!=(FlatFuzzTrace const& rhs) const noexcept -> bool;
+
+private:
+  // Opcodes, in the same order as the command IDs of the trace file format
+  enum class Opcode : uint8_t {
+    ADD_CLAUSE,
+    ASSUME,
+    SOLVE,
+    SOLVE_EXPECTING_UNSAT,
+    SOLVE_EXPECTING_SAT,
+    HAVOC_BEFORE_INIT,
+    HAVOC
+  };
+
+  static auto getSolveOpcode(std::optional<bool> expectedResult) noexcept -> Opcode;
+  void append(Opcode opcode, gsl::span<CNFLit const> words);
+
+  std::vector<Opcode> m_opcodes;
+  std::vector<uint32_t> m_arenaEnds;
+  std::vector<CNFLit> m_arena;
+};
+
+
+/**
+ * \brief Lightweight view of a command stored in a FlatFuzzTrace
+ */
+class FlatFuzzTrace::CmdView {
+public:
+  auto getKind() const noexcept -> CmdKind;
+
+  /// Returns the clause rsp. assumptions of ADD_CLAUSE rsp. ASSUME commands
+  auto getLits() const noexcept -> gsl::span<CNFLit const>;
+
+  /// Returns the expected result of SOLVE commands
+  auto getExpectedResult() const noexcept -> std::optional<bool>;
+
+  /// Returns the seed and the pre-init flag of HAVOC commands
+  auto getHavocCmd() const noexcept -> HavocCmd;
+
+  auto toFuzzCmd() const -> FuzzCmd;
+
+  /**
+   * \brief Calls `visitor` with the command, passed as AddClauseView, AssumeView,
+   *   SolveCmd or HavocCmd object.
+   *
+   * \returns the value returned by `visitor`
+   */
+  template <typename Visitor>
+  auto visit(Visitor&& visitor) const -> decltype(auto);
+
+private:
+  friend class FlatFuzzTrace;
+  CmdView(Opcode opcode, gsl::span<CNFLit const> words) noexcept;
+
+  Opcode m_opcode;
+  gsl::span<CNFLit const> m_words;
+};
+
+
+class FlatFuzzTrace::const_iterator {
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = CmdView;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = CmdView;
+
+  const_iterator() = default;
+
+  auto operator*() const noexcept -> CmdView;
+  auto operator[](difference_type offset) const noexcept -> CmdView;
+
+  auto operator++() noexcept -> const_iterator&;
+  auto operator++(int) noexcept -> const_iterator;
+  auto operator--() noexcept -> const_iterator&;
+  auto operator--(int) noexcept -> const_iterator;
+  auto operator+=(difference_type offset) noexcept -> const_iterator&;
+  auto operator-=(difference_type offset) noexcept -> const_iterator&;
+  auto operator+(difference_type offset) const noexcept -> const_iterator;
+  auto operator-(difference_type offset) const noexcept -> const_iterator;
+  auto operator-(const_iterator const& rhs) const noexcept -> difference_type;
+
+  auto operator==(const_iterator const& rhs) const noexcept -> bool;
+  auto operator!=(const_iterator const& rhs) const noexcept -> bool;
+  auto operator<(const_iterator const& rhs) const noexcept -> bool;
+
+  /// Returns the index of the command within its trace
+  auto getIndex() const noexcept -> size_type;
+
+private:
+  friend class FlatFuzzTrace;
+  const_iterator(FlatFuzzTrace const& trace, size_type index) noexcept;
+
+  FlatFuzzTrace const* m_trace = nullptr;
+  size_type m_index = 0;
+};
+
+
+/**
+ * \brief Converts the commands in [first, last) to a FlatFuzzTrace.
+ */
+auto toFlatFuzzTrace(FuzzTrace::const_iterator first, FuzzTrace::const_iterator last)
+    -> FlatFuzzTrace;
+
+/**
+ * \brief Converts the commands in [first, last) to a FuzzTrace.
+ */
+auto toFuzzTrace(FlatFuzzTrace::const_iterator first, FlatFuzzTrace::const_iterator last)
+    -> FuzzTrace;
+
+/**
+ * \brief Stores the given trace in a file, in the format used for FuzzTrace objects
+ *
+ * \throw IOException   on file I/O failures
+ */
+void storeTrace(FlatFuzzTrace const& trace,
+                std::filesystem::path const& filename,
+                TraceFormat format = TraceFormat::V1);
+
+/**
+ * \brief Writes the given trace to a stream, in the format used for FuzzTrace objects
+ *
+ * \throw IOException   on I/O failures
+ */
+void storeTrace(FlatFuzzTrace const& trace,
+                FILE& stream,
+                TraceFormat format = TraceFormat::V1);
+
+/**
+ * \brief Appends the encoding of the given trace to `target`, in the format used
+ *   by storeTrace.
+ */
+void encodeTrace(FlatFuzzTrace const& trace,
+                 std::vector<std::byte>& target,
+                 TraceFormat format = TraceFormat::V1);
+
+/**
+ * \brief Loads a FlatFuzzTrace from the given file. See loadTrace().
+ *
+ * \throw IOException   on file I/O failures and file format errors
+ */
+auto loadFlatTrace(std::filesystem::path const& filename,
+                   LoaderStrictness strictness = LoaderStrictness::STRICT) -> FlatFuzzTrace;
+
+/**
+ * \brief Loads a FlatFuzzTrace from the given C file stream. See loadTrace().
+ *
+ * \throw IOException   on file I/O failures and file format errors
+ */
+auto loadFlatTrace(FILE& stream, LoaderStrictness strictness = LoaderStrictness::STRICT)
+    -> FlatFuzzTrace;
+
+/**
+ * \brief Reads a trace from a C file stream phase by phase
+ *
+ * A phase consists of the commands up to and including the next solve command. Since
+ * only one phase needs to be held in memory at a time, traces can be processed while
+ * they are being read.
+ */
+class FlatFuzzTraceReader {
+public:
+  /**
+   * \brief Reads the magic cookie from `stream`.
+   *
+   * \param stream      The stream from which to read the trace
+   * \param strictness  See loadTrace()
+   *
+   * \throw IOException  with STRICT strictness if the magic cookie could not be read
+   */
+  explicit FlatFuzzTraceReader(FILE& stream,
+                               LoaderStrictness strictness = LoaderStrictness::STRICT);
+
+  /**
+   * \brief Replaces the contents of `target` with the next phase of the trace
+   *
+   * With PERMISSIVE strictness, the trace ends before the first malformed command.
+   *
+   * \returns false iff the end of the trace has been reached before reading any command
+   * \throw IOException   with STRICT strictness on file I/O failures and file format errors
+   */
+  auto readNextPhase(FlatFuzzTrace& target) -> bool;
+
+private:
+  FILE* m_stream;
+  detail::TraceDecoderState m_decoderState;
+  std::vector<CNFLit> m_litBuffer;
+  bool m_endReached = false;
+};
+
+/**
+ * \brief Applies the given trace to an IPASIR SAT solver, like the FuzzTrace variant
+ *   of applyTrace().
+ *
+ * \returns Iterator to the first SolveCmd within [first, last), or `last` if there is none.
+ */
+template <typename SolverT>
+auto applyTrace(FlatFuzzTrace::const_iterator first,
+                FlatFuzzTrace::const_iterator last,
+                SolverT& target) -> FlatFuzzTrace::const_iterator;
+
+extern template auto applyTrace<IPASIRSolver>(FlatFuzzTrace::const_iterator first,
+                                              FlatFuzzTrace::const_iterator last,
+                                              IPASIRSolver& target)
+    -> FlatFuzzTrace::const_iterator;
+
+
+// Implementation
+
+inline FlatFuzzTrace::CmdView::CmdView(Opcode opcode, gsl::span<CNFLit const> words) noexcept
+  : m_opcode{opcode}, m_words{words}
+{
+}
+
+inline auto FlatFuzzTrace::CmdView::getKind() const noexcept -> CmdKind
+{
+  switch (m_opcode) {
+  case Opcode::ADD_CLAUSE:
+    return CmdKind::ADD_CLAUSE;
+  case Opcode::ASSUME:
+    return CmdKind::ASSUME;
+  case Opcode::SOLVE:
+  case Opcode::SOLVE_EXPECTING_UNSAT:
+  case Opcode::SOLVE_EXPECTING_SAT:
+    return CmdKind::SOLVE;
+  default:
+    return CmdKind::HAVOC;
+  }
+}
+
+inline auto FlatFuzzTrace::CmdView::getLits() const noexcept -> gsl::span<CNFLit const>
+{
+  assert(getKind() == CmdKind::ADD_CLAUSE || getKind() == CmdKind::ASSUME);
+  return m_words;
+}
+
+inline auto FlatFuzzTrace::CmdView::getExpectedResult() const noexcept -> std::optional<bool>
+{
+  assert(getKind() == CmdKind::SOLVE);
+  if (m_opcode == Opcode::SOLVE) {
+    return std::nullopt;
+  }
+  return m_opcode == Opcode::SOLVE_EXPECTING_SAT;
+}
+
+inline auto FlatFuzzTrace::CmdView::getHavocCmd() const noexcept -> HavocCmd
+{
+  assert(getKind() == CmdKind::HAVOC && m_words.size() == 2);
+  uint64_t const seed =
+      (uint64_t{static_cast<uint32_t>(m_words[0])} << 32) | static_cast<uint32_t>(m_words[1]);
+  return HavocCmd{seed, m_opcode == Opcode::HAVOC_BEFORE_INIT};
+}
+
+template <typename Visitor>
+auto FlatFuzzTrace::CmdView::visit(Visitor&& visitor) const -> decltype(auto)
+{
+  switch (getKind()) {
+  case CmdKind::ADD_CLAUSE:
+    return visitor(AddClauseView{m_words});
+  case CmdKind::ASSUME:
+    return visitor(AssumeView{m_words});
+  case CmdKind::SOLVE:
+    return visitor(SolveCmd{getExpectedResult()});
+  default:
+    return visitor(getHavocCmd());
+  }
+}
+
+inline auto FlatFuzzTrace::operator[](size_type index) const noexcept -> CmdView
+{
+  assert(index < m_opcodes.size());
+  uint32_t const begin = (index == 0 ? 0 : m_arenaEnds[index - 1]);
+  uint32_t const end = m_arenaEnds[index];
+  return CmdView{m_opcodes[index], gsl::span<CNFLit const>{m_arena.data() + begin, end - begin}};
+}
+
+inline auto FlatFuzzTrace::size() const noexcept -> size_type
+{
+  return m_opcodes.size();
+}
+
+inline auto FlatFuzzTrace::empty() const noexcept -> bool
+{
+  return m_opcodes.empty();
+}
+
+inline FlatFuzzTrace::const_iterator::const_iterator(FlatFuzzTrace const& trace,
+                                                     size_type index) noexcept
+  : m_trace{&trace}, m_index{index}
+{
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator*() const noexcept -> CmdView
+{
+  return (*m_trace)[m_index];
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator[](difference_type offset) const noexcept
+    -> CmdView
+{
+  return (*m_trace)[m_index + offset];
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator++() noexcept -> const_iterator&
+{
+  ++m_index;
+  return *this;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator++(int) noexcept -> const_iterator
+{
+  const_iterator result = *this;
+  ++m_index;
+  return result;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator--() noexcept -> const_iterator&
+{
+  --m_index;
+  return *this;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator--(int) noexcept -> const_iterator
+{
+  const_iterator result = *this;
+  --m_index;
+  return result;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator+=(difference_type offset) noexcept
+    -> const_iterator&
+{
+  m_index += offset;
+  return *this;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator-=(difference_type offset) noexcept
+    -> const_iterator&
+{
+  m_index -= offset;
+  return *this;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator+(difference_type offset) const noexcept
+    -> const_iterator
+{
+  return const_iterator{*m_trace, m_index + offset};
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator-(difference_type offset) const noexcept
+    -> const_iterator
+{
+  return const_iterator{*m_trace, m_index - offset};
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator-(const_iterator const& rhs) const noexcept
+    -> difference_type
+{
+  return static_cast<difference_type>(m_index) - static_cast<difference_type>(rhs.m_index);
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator==(const_iterator const& rhs) const noexcept
+    -> bool
+{
+  return m_trace == rhs.m_trace && m_index == rhs.m_index;
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator!=(const_iterator const& rhs) const noexcept
+    -> bool
+{
+  return !(*this == rhs);
+}
+
+inline auto FlatFuzzTrace::const_iterator::operator<(const_iterator const& rhs) const noexcept
+    -> bool
+{
+  return m_index < rhs.m_index;
+}
+
+inline auto FlatFuzzTrace::const_iterator::getIndex() const noexcept -> size_type
+{
+  return m_index;
+}
+
+inline auto FlatFuzzTrace::begin() const noexcept -> const_iterator
+{
+  return const_iterator{*this, 0};
+}
+
+inline auto FlatFuzzTrace::end() const noexcept -> const_iterator
+{
+  return const_iterator{*this, size()};
+}
+
+
+namespace detail {
+template <typename SolverT>
+auto applyCmd(SolverT& solver, AddClauseView const& cmd) -> bool
+{
+  solver.addClause(cmd.clauseToAdd);
+  return true;
+}
+
+template <typename SolverT>
+auto applyCmd(SolverT& solver, AssumeView const& cmd) -> bool
+{
+  solver.assume(cmd.assumptions);
+  return true;
+}
+}
+
+template <typename SolverT>
+auto applyTrace(FlatFuzzTrace::const_iterator first,
+                FlatFuzzTrace::const_iterator last,
+                SolverT& target) -> FlatFuzzTrace::const_iterator
+{
+  FlatFuzzTrace::const_iterator cmd = first;
+
+  for (; cmd != last; ++cmd) {
+    bool const doContinue =
+        (*cmd).visit([&target](auto&& x) { return detail::applyCmd(target, x); });
+    if (!doContinue) {
+      break;
+    }
+  }
+
+  return cmd;
+}
+}
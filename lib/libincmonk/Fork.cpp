@@ -28,12 +28,16 @@
 #include <libincmonk/Fork.h>
 #include <libincmonk/Stopwatch.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
 #include <errno.h>
+#include <mutex>
 #include <poll.h>
+#include <pthread.h>
 #include <signal.h>
+#include <time.h>
 #include <sys/select.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -108,12 +112,16 @@ public:
 
     int statloc = 0;
     pid_t waitResult = waitpid(m_pid, &statloc, WNOHANG);
+    if (waitResult == 0) {
+      // The child process exists, but has not changed its state yet
+      return true;
+    }
+
     if (waitResult != -1) {
       m_reaped = true;
       m_exitedWithError = (WIFEXITED(statloc) == 0);
-      return false;
     }
-    return true;
+    return false;
   }
 
   void waitOnProcessAndThrowIfExitedWithError()
@@ -164,39 +172,43 @@ auto exceedsReadTimeout(Pipe const& comm,
   signalAction.sa_handler = sigchildHandler;
   sigaction(SIGCHLD, &signalAction, NULL);
 
-  fd_set set;
-  FD_ZERO(&set);
-  FD_SET(comm.getReadFd(), &set);
-
-  struct timeval selectTimeout;
-  selectTimeout.tv_sec = timeout.count() / 1000;
-  selectTimeout.tv_usec = (timeout.count() % 1000) * 1000;
+  // When syncExecInFork is called concurrently from multiple threads, SIGCHLD
+  // is not necessarily delivered to the thread waiting for the child, and
+  // the pipe is not closed on exit since other children may hold copies of
+  // its write end. Therefore, the child's state is also polled regularly.
+  std::chrono::milliseconds const pollInterval{10};
 
   Stopwatch stopwatch;
-  int rv = select(comm.getReadFd() + 1, &set, NULL, NULL, &selectTimeout);
-  while (rv == -1) {
-    assert(errno != EBADF);
+  while (true) {
+    auto elapsedTime = stopwatch.getElapsedTime<std::chrono::milliseconds>();
+    if (elapsedTime >= timeout) {
+      return true;
+    }
+    auto remaining = std::min(timeout - elapsedTime, pollInterval);
+
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(comm.getReadFd(), &set);
 
-    if (errno == EINVAL) {
+    struct timeval selectTimeout;
+    selectTimeout.tv_sec = remaining.count() / 1000;
+    selectTimeout.tv_usec = (remaining.count() % 1000) * 1000;
+
+    int rv = select(comm.getReadFd() + 1, &set, NULL, NULL, &selectTimeout);
+    if (rv > 0) {
+      return false;
+    }
+
+    assert(rv == 0 || errno != EBADF);
+    if (rv == -1 && errno == EINVAL) {
       throw std::runtime_error{"Child process creation failed"};
     }
 
-    // errno is either EAGAIN or EINTR ~> maybe try again
+    // select() timed out, or errno is either EAGAIN or EINTR ~> maybe try again
     if (!childProc.isAlive()) {
       return false;
     }
-
-    auto elapsedTime = stopwatch.getElapsedTime<std::chrono::milliseconds>();
-    if (elapsedTime >= timeout) {
-      return true;
-    }
-    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(timeout - elapsedTime);
-    selectTimeout.tv_sec = remaining.count() / 1000000;
-    selectTimeout.tv_usec = remaining.count() % 1000000;
-    rv = select(comm.getReadFd() + 1, &set, NULL, NULL, &selectTimeout);
   }
-
-  return rv == 0;
 }
 
 
@@ -257,4 +269,316 @@ auto syncExecInFork(std::function<uint64_t()> const& fn,
     throw std::runtime_error{"Child process creation failed"};
   }
 }
+
+namespace {
+auto readFully(int fd, void* buffer, std::size_t size) -> bool
+{
+  char* cursor = reinterpret_cast<char*>(buffer);
+  while (size > 0) {
+    ssize_t numBytesRead = read(fd, cursor, size);
+    if (numBytesRead == 0) {
+      return false;
+    }
+    if (numBytesRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    cursor += numBytesRead;
+    size -= static_cast<std::size_t>(numBytesRead);
+  }
+  return true;
+}
+
+auto writeFully(int fd, void const* buffer, std::size_t size) -> bool
+{
+  char const* cursor = reinterpret_cast<char const*>(buffer);
+  while (size > 0) {
+    ssize_t numBytesWritten = write(fd, cursor, size);
+    if (numBytesWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    cursor += numBytesWritten;
+    size -= static_cast<std::size_t>(numBytesWritten);
+  }
+  return true;
+}
+
+/**
+ * Blocks SIGPIPE for the current thread during its lifetime, such that writing to a
+ * pipe whose reading end has been closed fails with EPIPE instead of terminating the
+ * process. A SIGPIPE raised meanwhile is discarded, unless it was already pending
+ * before. The process-wide signal dispositions remain unchanged.
+ */
+class SigPipeBlocker {
+public:
+  SigPipeBlocker()
+  {
+    sigemptyset(&m_sigPipe);
+    sigaddset(&m_sigPipe, SIGPIPE);
+    m_wasPending = isSigPipePending();
+    pthread_sigmask(SIG_BLOCK, &m_sigPipe, &m_oldMask);
+  }
+
+  ~SigPipeBlocker()
+  {
+    if (!m_wasPending && isSigPipePending()) {
+      timespec const noTimeout{0, 0};
+      while (sigtimedwait(&m_sigPipe, nullptr, &noTimeout) == -1 && errno == EINTR) {
+        // interrupted by another signal, try again
+      }
+    }
+    pthread_sigmask(SIG_SETMASK, &m_oldMask, nullptr);
+  }
+
+  SigPipeBlocker(SigPipeBlocker const&) = delete;
+  auto operator=(SigPipeBlocker const&) -> SigPipeBlocker& = delete;
+
+private:
+  static auto isSigPipePending() -> bool
+  {
+    sigset_t pending;
+    sigemptyset(&pending);
+    sigpending(&pending);
+    return sigismember(&pending, SIGPIPE) == 1;
+  }
+
+  sigset_t m_sigPipe;
+  sigset_t m_oldMask;
+  bool m_wasPending = false;
+};
+
+auto waitForPollIn(int fd, std::chrono::milliseconds timeout) -> bool
+{
+  Stopwatch stopwatch;
+  while (true) {
+    auto elapsedTime = stopwatch.getElapsedTime<std::chrono::milliseconds>();
+    if (elapsedTime >= timeout) {
+      return false;
+    }
+    auto remaining = timeout - elapsedTime;
+
+    pollfd pollFd{fd, /* events */ POLLIN, /* revents */ 0};
+    int numReadyFDs = poll(&pollFd, 1, static_cast<int>(remaining.count()));
+    if (numReadyFDs > 0) {
+      return true;
+    }
+    if (numReadyFDs < 0 && errno != EINTR) {
+      throw std::runtime_error{"Fork server communication failed"};
+    }
+  }
+}
+
+/// Message sent from the zygote to the fork server after a child has terminated
+struct ChildStatusMessage {
+  uint64_t result = 0;
+  uint8_t exitedRegularly = 0;
+  uint8_t hasResult = 0;
+};
+
+__attribute__((noreturn)) void
+zygoteProcess(ForkServerFn const& fn, int childExitVal, int requestFd, int responseFd)
+{
+  // The zygote exits via _exit() to avoid running exit handlers and flushing
+  // output buffers that belong to the process which created the fork server.
+  std::unique_ptr<Pipe> resultPipe;
+  try {
+    resultPipe = std::make_unique<Pipe>();
+  }
+  catch (...) {
+    _exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::byte> request;
+  while (true) {
+    uint64_t requestSize = 0;
+    if (!readFully(requestFd, &requestSize, sizeof(requestSize))) {
+      // The fork server has been closed
+      _exit(EXIT_SUCCESS);
+    }
+
+    request.resize(requestSize);
+    if (!readFully(requestFd, request.data(), requestSize)) {
+      _exit(EXIT_FAILURE);
+    }
+
+    int64_t childPid = fork();
+    if (childPid == 0) {
+      close(requestFd);
+      close(responseFd);
+      childProcess([&fn, &request]() { return fn(request); }, childExitVal, *resultPipe);
+    }
+
+    if (!writeFully(responseFd, &childPid, sizeof(childPid))) {
+      _exit(EXIT_FAILURE);
+    }
+    if (childPid < 0) {
+      continue;
+    }
+
+    int statloc = 0;
+    while (waitpid(static_cast<pid_t>(childPid), &statloc, 0) == -1) {
+      if (errno != EINTR) {
+        _exit(EXIT_FAILURE);
+      }
+    }
+
+    ChildStatusMessage status;
+    status.exitedRegularly = (WIFEXITED(statloc) != 0) ? 1 : 0;
+    if (resultPipe->hasData()) {
+      status.hasResult = readFully(resultPipe->getReadFd(), &status.result, sizeof(uint64_t));
+    }
+
+    if (!writeFully(responseFd, &status, sizeof(status))) {
+      _exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/**
+ * Pipe ends held by the processes creating fork servers.
+ *
+ * Zygotes are forked without exec'ing, so each zygote would inherit the pipe ends
+ * of fork servers created before it (e.g. by other fuzzer jobs) and keep the request
+ * pipes of these fork servers from being closed. Zygotes close these pipe ends on
+ * startup instead.
+ */
+struct ForkServerPipeRegistry {
+  std::mutex mutex;
+  std::vector<int> fds;
+};
+
+auto getForkServerPipeRegistry() -> ForkServerPipeRegistry&
+{
+  static ForkServerPipeRegistry registry;
+  return registry;
+}
+
+class ForkServerImpl : public ForkServer {
+public:
+  ForkServerImpl(ForkServerFn const& fn, int childExitVal)
+  {
+    // Pipes and zygotes must not be created concurrently, so that no zygote
+    // inherits pipe ends that are not yet registered
+    ForkServerPipeRegistry& registry = getForkServerPipeRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.fds.reserve(registry.fds.size() + 2);
+
+    std::array<int, 2> requestPipe = {0, 0};
+    std::array<int, 2> responsePipe = {0, 0};
+    if (pipe(requestPipe.data()) < 0) {
+      perror("pipe");
+      throw std::runtime_error{"Fork server creation failed"};
+    }
+    if (pipe(responsePipe.data()) < 0) {
+      perror("pipe");
+      close(requestPipe[0]);
+      close(requestPipe[1]);
+      throw std::runtime_error{"Fork server creation failed"};
+    }
+
+    m_zygotePid = fork();
+    if (m_zygotePid == 0) {
+      for (int fd : registry.fds) {
+        close(fd);
+      }
+      close(requestPipe[1]);
+      close(responsePipe[0]);
+      zygoteProcess(fn, childExitVal, requestPipe[0], responsePipe[1]);
+    }
+
+    close(requestPipe[0]);
+    close(responsePipe[1]);
+    m_requestFd = requestPipe[1];
+    m_responseFd = responsePipe[0];
+
+    if (m_zygotePid < 0) {
+      close(m_requestFd);
+      close(m_responseFd);
+      throw std::runtime_error{"Fork server creation failed"};
+    }
+
+    registry.fds.push_back(m_requestFd);
+    registry.fds.push_back(m_responseFd);
+  }
+
+  auto execute(std::vector<std::byte> const& request,
+               std::optional<std::chrono::milliseconds> timeout)
+      -> std::optional<uint64_t> override
+  {
+    uint64_t const requestSize = request.size();
+    {
+      // Writing to the request pipe after the zygote has died must not kill this process
+      SigPipeBlocker sigPipeBlocker;
+      if (!writeFully(m_requestFd, &requestSize, sizeof(requestSize)) ||
+          !writeFully(m_requestFd, request.data(), request.size())) {
+        throw std::runtime_error{"Fork server communication failed"};
+      }
+    }
+
+    int64_t childPid = 0;
+    if (!readFully(m_responseFd, &childPid, sizeof(childPid))) {
+      throw std::runtime_error{"Fork server communication failed"};
+    }
+    if (childPid < 0) {
+      throw std::runtime_error{"Child process creation failed"};
+    }
+
+    bool timedOut = false;
+    if (timeout.has_value() && !waitForPollIn(m_responseFd, *timeout)) {
+      kill(static_cast<pid_t>(childPid), SIGKILL);
+      timedOut = true;
+    }
+
+    ChildStatusMessage status;
+    if (!readFully(m_responseFd, &status, sizeof(status))) {
+      throw std::runtime_error{"Fork server communication failed"};
+    }
+
+    if (timedOut) {
+      return std::nullopt;
+    }
+
+    if (status.exitedRegularly == 0 || status.hasResult == 0) {
+      throw ChildExecutionFailure{};
+    }
+    return status.result;
+  }
+
+  virtual ~ForkServerImpl()
+  {
+    {
+      ForkServerPipeRegistry& registry = getForkServerPipeRegistry();
+      std::lock_guard<std::mutex> lock{registry.mutex};
+      auto& fds = registry.fds;
+      fds.erase(std::remove_if(fds.begin(),
+                               fds.end(),
+                               [this](int fd) { return fd == m_requestFd || fd == m_responseFd; }),
+                fds.end());
+      // The zygote exits when reading from the closed request pipe:
+      close(m_requestFd);
+    }
+
+    int statloc = 0;
+    while (waitpid(m_zygotePid, &statloc, 0) == -1 && errno == EINTR) {
+      // waitpid has been interrupted by a signal, wait some more
+    }
+    close(m_responseFd);
+  }
+
+private:
+  pid_t m_zygotePid = 0;
+  int m_requestFd = -1;
+  int m_responseFd = -1;
+};
+}
+
+auto createForkServer(ForkServerFn const& fn, int childExitVal) -> std::unique_ptr<ForkServer>
+{
+  return std::make_unique<ForkServerImpl>(fn, childExitVal);
+}
 }
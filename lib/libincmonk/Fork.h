@@ -33,10 +33,13 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <stdexcept>
+#include <vector>
 
 namespace incmonk {
 class ChildExecutionFailure {
@@ -67,4 +70,60 @@ auto syncExecInFork(std::function<uint64_t()> const& fn,
                     std::optional<std::chrono::milliseconds> timeout = std::nullopt)
     -> std::optional<uint64_t>;
 
+/**
+ * \brief A persistent process forking child processes on request.
+ *
+ * The fork server process (the "zygote") is created once, when the fork
+ * server object is constructed. It inherits the state of the creating
+ * process at that point in time. Each execution request is sent to the
+ * zygote, which forks a child process executing the server's function
+ * on the request data. Since the zygote is typically much smaller than the
+ * process using it, creating child processes is cheaper than with
+ * syncExecInFork.
+ */
+class ForkServer {
+public:
+  /**
+   * \brief Synchronously executes the server's function in a child process
+   *   of the zygote.
+   *
+   * \param request  The argument passed to the server's function.
+   * \param timeout  An optional timeout. If the child process did not complete
+   *   within this time limit, it is killed and nothing is returned.
+   *
+   * \returns The return value of the function's execution in the child process.
+   *
+   * \throws ChildExecutionFailure when the child process exits during the
+   * execution of the function, or if an exception is thrown from the function.
+   *
+   * \throws std::runtime_error when the zygote process is not available anymore.
+   *
+   * SIGPIPE is blocked in the calling thread while the request is sent to the zygote,
+   * so a dead zygote does not terminate the calling process. The signal dispositions
+   * of the calling process are not changed.
+   */
+  virtual auto execute(std::vector<std::byte> const& request,
+                       std::optional<std::chrono::milliseconds> timeout = std::nullopt)
+      -> std::optional<uint64_t> = 0;
+
+  virtual ~ForkServer() = default;
+};
+
+using ForkServerFn = std::function<uint64_t(std::vector<std::byte> const&)>;
+
+/**
+ * \brief Creates a fork server.
+ *
+ * \param fn  The function executed in child processes. Its argument is the
+ *   request data passed to ForkServer::execute.
+ * \param childExitVal  The exit() value returned from the child processes
+ *   on successful termination.
+ *
+ * Note that output buffered in the current process (e.g. via std::cout) is
+ * inherited by the zygote process, so it should be flushed before creating
+ * the fork server.
+ *
+ * \throws std::runtime_error when the zygote process setup failed.
+ */
+auto createForkServer(ForkServerFn const& fn, int childExitVal) -> std::unique_ptr<ForkServer>;
 }
@@ -0,0 +1,150 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FuzzCmdSource.h>
+
+#include <libincmonk/Stopwatch.h>
+
+#include <cstddef>
+
+namespace incmonk {
+
+namespace {
+class TraceFuzzCmdSource final : public FuzzCmdSource {
+public:
+  explicit TraceFuzzCmdSource(FuzzTrace&& trace) : m_trace{std::move(trace)} {}
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    if (m_nextIdx == m_trace.size()) {
+      return false;
+    }
+    target = std::move(m_trace[m_nextIdx]);
+    ++m_nextIdx;
+    return true;
+  }
+
+private:
+  FuzzTrace m_trace;
+  std::size_t m_nextIdx = 0;
+};
+}
+
+auto createFuzzCmdSource(FuzzTrace&& trace) -> std::unique_ptr<FuzzCmdSource>
+{
+  return std::make_unique<TraceFuzzCmdSource>(std::move(trace));
+}
+
+void appendCmds(FuzzCmdSource& source, FuzzTrace& target)
+{
+  FuzzCmd cmd;
+  while (source.readNext(cmd)) {
+    target.push_back(std::move(cmd));
+  }
+}
+
+class FuzzCmdSourceProfiler::ProfiledFuzzCmdSource final : public FuzzCmdSource {
+public:
+  ProfiledFuzzCmdSource(std::unique_ptr<FuzzCmdSource> source,
+                        std::optional<ProfilePhase> phase,
+                        FuzzCmdSourceProfiler& profiler)
+    : m_source{std::move(source)}, m_phase{phase}, m_profiler{profiler}
+  {
+  }
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    bool const isOutermostRead = (m_profiler.m_readDepth == 0);
+    if (isOutermostRead) {
+      m_profiler.m_isSamplingRead = (m_profiler.m_numReads % readSamplingInterval == 0);
+      ++m_profiler.m_numReads;
+      m_profiler.m_numSampledReads += m_profiler.m_isSamplingRead ? 1 : 0;
+    }
+
+    if (!m_profiler.m_isSamplingRead) {
+      ++m_profiler.m_readDepth;
+      bool const result = m_source->readNext(target);
+      --m_profiler.m_readDepth;
+      return result;
+    }
+
+    std::chrono::nanoseconds const outerNestedTime = m_profiler.m_nestedTime;
+    m_profiler.m_nestedTime = std::chrono::nanoseconds{0};
+
+    ++m_profiler.m_readDepth;
+    Stopwatch stopwatch;
+    bool const result = m_source->readNext(target);
+    auto const elapsedTime = stopwatch.getElapsedTime<std::chrono::nanoseconds>();
+    --m_profiler.m_readDepth;
+
+    if (m_phase.has_value()) {
+      std::optional<std::chrono::nanoseconds>& phaseTime =
+          m_profiler.m_phaseTimes[static_cast<std::size_t>(*m_phase)];
+      *phaseTime += elapsedTime - m_profiler.m_nestedTime;
+    }
+    m_profiler.m_nestedTime = outerNestedTime + elapsedTime;
+    return result;
+  }
+
+private:
+  std::unique_ptr<FuzzCmdSource> m_source;
+  std::optional<ProfilePhase> m_phase;
+  FuzzCmdSourceProfiler& m_profiler;
+};
+
+FuzzCmdSourceProfiler::FuzzCmdSourceProfiler() noexcept : m_profile{getThreadProfile()} {}
+
+FuzzCmdSourceProfiler::~FuzzCmdSourceProfiler()
+{
+  if (m_profile == nullptr) {
+    return;
+  }
+  for (std::size_t phaseIdx = 0; phaseIdx < numProfilePhases; ++phaseIdx) {
+    if (m_phaseTimes[phaseIdx].has_value()) {
+      // Extrapolate the time measured in the sampled reads to all reads
+      std::chrono::nanoseconds phaseTime = *m_phaseTimes[phaseIdx];
+      if (m_numSampledReads != 0) {
+        using Rep = std::chrono::nanoseconds::rep;
+        phaseTime = phaseTime * static_cast<Rep>(m_numReads) / static_cast<Rep>(m_numSampledReads);
+      }
+      m_profile->record(static_cast<ProfilePhase>(phaseIdx), phaseTime);
+    }
+  }
+}
+
+auto FuzzCmdSourceProfiler::profile(std::unique_ptr<FuzzCmdSource> source,
+                                    std::optional<ProfilePhase> phase)
+    -> std::unique_ptr<FuzzCmdSource>
+{
+  if (m_profile == nullptr) {
+    return source;
+  }
+  if (phase.has_value()) {
+    m_phaseTimes[static_cast<std::size_t>(*phase)] = std::chrono::nanoseconds{0};
+  }
+  return std::make_unique<ProfiledFuzzCmdSource>(std::move(source), phase, *this);
+}
+}
@@ -0,0 +1,131 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Sources producing fuzz commands one at a time, for building traces lazily
+ */
+
+#pragma once
+
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/Profiling.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace incmonk {
+
+/**
+ * \brief Produces the commands of a trace one at a time.
+ *
+ * Sources can be chained, with each source reading commands from the previous one on
+ * demand (see e.g. createSolveCmdInserter()). This way, traces can be assembled
+ * without materializing intermediate traces.
+ */
+class FuzzCmdSource {
+public:
+  /**
+   * \brief Reads the next command of the trace.
+   *
+   * \param target  Receives the next command. Its value is unspecified if the
+   *                function returns false.
+   *
+   * \returns false iff the trace has no more commands.
+   */
+  virtual auto readNext(FuzzCmd& target) -> bool = 0;
+
+  virtual ~FuzzCmdSource() = default;
+};
+
+/**
+ * \brief Creates a FuzzCmdSource producing the commands of `trace`.
+ *
+ * The commands are moved out of `trace` as they are read.
+ */
+auto createFuzzCmdSource(FuzzTrace&& trace) -> std::unique_ptr<FuzzCmdSource>;
+
+/**
+ * \brief Reads all remaining commands of `source` and appends them to `target`.
+ */
+void appendCmds(FuzzCmdSource& source, FuzzTrace& target);
+
+/**
+ * \brief Measures the time spent in the individual sources of a chain, excluding the time
+ *   spent in the sources they read from.
+ *
+ * For each phase, the total time measured by the sources wrapped via profile() is recorded
+ * once in the current thread's profile when the profiler is destroyed. The profiler must
+ * outlive the wrapped sources.
+ *
+ * Since reading a command is not much more expensive than reading the clock, only every
+ * readSamplingInterval-th read of the outermost wrapped source is timed, including the
+ * reads it causes in the wrapped sources it reads from. The recorded times are
+ * extrapolated from these samples.
+ */
+class FuzzCmdSourceProfiler {
+public:
+  FuzzCmdSourceProfiler() noexcept;
+  ~FuzzCmdSourceProfiler();
+
+  /**
+   * \brief Wraps `source`, attributing the time spent in its readNext() function to
+   *   `phase`, excluding the time spent in wrapped sources read by `source`.
+   *
+   * If `phase` is std::nullopt, the time is not recorded. This is useful for excluding the
+   * time of `source` from the sources reading from it. If no thread profile is set,
+   * `source` is returned unchanged.
+   */
+  auto profile(std::unique_ptr<FuzzCmdSource> source, std::optional<ProfilePhase> phase)
+      -> std::unique_ptr<FuzzCmdSource>;
+
+  static constexpr std::size_t readSamplingInterval = 16;
+
+  FuzzCmdSourceProfiler(FuzzCmdSourceProfiler const&) = delete;
+  auto operator=(FuzzCmdSourceProfiler const&) -> FuzzCmdSourceProfiler& = delete;
+
+private:
+  class ProfiledFuzzCmdSource;
+
+  Profile* m_profile = nullptr;
+  std::array<std::optional<std::chrono::nanoseconds>, numProfilePhases> m_phaseTimes;
+
+  /// The time spent in wrapped sources during the current readNext() call of a wrapped source
+  std::chrono::nanoseconds m_nestedTime{0};
+
+  /// The number of readNext() calls of wrapped sources currently on the stack
+  std::size_t m_readDepth = 0;
+
+  /// The number of reads of the outermost wrapped source, resp. those of them being timed
+  std::size_t m_numReads = 0;
+  std::size_t m_numSampledReads = 0;
+  bool m_isSamplingRead = false;
+};
+}
@@ -0,0 +1,316 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FuzzStats.h>
+
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/TraceDumpWriter.h>
+
+#include <gsl/span>
+
+#include <condition_variable>
+#include <cstddef>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace incmonk {
+
+auto FuzzStats::getNumCorrectnessFailures() const noexcept -> uint64_t
+{
+  return numIncorrectResults + numInvalidModels + numInvalidFailed + numInvalidResults;
+}
+
+auto FuzzStats::getExecsPerSecond() const noexcept -> double
+{
+  double const seconds = elapsedTime.count();
+  return seconds > 0.0 ? static_cast<double>(numRounds) / seconds : 0.0;
+}
+
+auto FuzzStats::getAverageTraceSize() const noexcept -> double
+{
+  return numRounds > 0 ? static_cast<double>(numTraceCommands) / numRounds : 0.0;
+}
+
+auto FuzzStats::getAverageSolveCalls() const noexcept -> double
+{
+  return numRounds > 0 ? static_cast<double>(numSolveCalls) / numRounds : 0.0;
+}
+
+auto getPeakRSS() -> uint64_t
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  // macOS reports ru_maxrss in bytes, Linux in kilobytes
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+namespace {
+/// Escapes `str` for JSON strings resp. Prometheus label values
+auto escape(std::string const& str) -> std::string
+{
+  std::string result;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    }
+    else if (c == '\n') {
+      result += "\\n";
+    }
+    else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+auto getFailuresByReason(FuzzStats const& stats)
+    -> std::vector<std::pair<char const*, uint64_t>>
+{
+  return {{"incorrect_result", stats.numIncorrectResults},
+          {"invalid_model", stats.numInvalidModels},
+          {"invalid_failed", stats.numInvalidFailed},
+          {"invalid_result", stats.numInvalidResults},
+          {"crash", stats.numCrashes},
+          {"timeout", stats.numTimeouts},
+          {"solve_timeout", stats.numSolveTimeouts},
+          {"memout", stats.numMemouts}};
+}
+
+auto getTimesByPhase(FuzzStats const& stats)
+    -> std::vector<std::pair<char const*, std::chrono::duration<double>>>
+{
+  return {{"generator", stats.generatorTime}, {"oracle", stats.oracleTime}, {"sut", stats.sutTime}};
+}
+
+auto formatAsJSON(FuzzStats const& stats, std::string const& fuzzerID) -> std::string
+{
+  std::ostringstream result;
+  result << std::fixed << std::setprecision(3);
+  result << "{\n";
+  result << "  \"fuzzer_id\": \"" << escape(fuzzerID) << "\",\n";
+  result << "  \"elapsed_seconds\": " << stats.elapsedTime.count() << ",\n";
+  result << "  \"rounds\": " << stats.numRounds << ",\n";
+  result << "  \"execs_per_sec\": " << stats.getExecsPerSecond() << ",\n";
+
+  result << "  \"failures\": {";
+  char const* separator = "\n";
+  for (auto const& [reason, count] : getFailuresByReason(stats)) {
+    result << separator << "    \"" << reason << "\": " << count;
+    separator = ",\n";
+  }
+  result << "\n  },\n";
+
+  result << "  \"average_trace_size\": " << stats.getAverageTraceSize() << ",\n";
+  result << "  \"average_solve_calls\": " << stats.getAverageSolveCalls() << ",\n";
+
+  result << "  \"time_seconds\": {";
+  separator = "\n";
+  for (auto const& [phase, time] : getTimesByPhase(stats)) {
+    result << separator << "    \"" << phase << "\": " << time.count();
+    separator = ",\n";
+  }
+  result << "\n  },\n";
+  result << "  \"peak_rss_bytes\": " << stats.peakRSS << "\n";
+  result << "}\n";
+  return result.str();
+}
+
+auto formatAsPrometheus(FuzzStats const& stats, std::string const& fuzzerID) -> std::string
+{
+  std::ostringstream result;
+  result << std::fixed << std::setprecision(3);
+  std::string const fuzzerLabel = "fuzzer=\"" + escape(fuzzerID) + "\"";
+
+  auto const addHeader = [&result](char const* name, char const* type, char const* help) {
+    result << "# HELP incmonk_" << name << " " << help << "\n";
+    result << "# TYPE incmonk_" << name << " " << type << "\n";
+  };
+
+  addHeader("elapsed_seconds", "gauge", "Wall-clock time since the start of fuzzing");
+  result << "incmonk_elapsed_seconds{" << fuzzerLabel << "} " << stats.elapsedTime.count()
+         << "\n";
+
+  addHeader("rounds_total", "counter", "Number of executed rounds");
+  result << "incmonk_rounds_total{" << fuzzerLabel << "} " << stats.numRounds << "\n";
+
+  addHeader("execs_per_second", "gauge", "Average number of rounds per second");
+  result << "incmonk_execs_per_second{" << fuzzerLabel << "} " << stats.getExecsPerSecond()
+         << "\n";
+
+  addHeader("failures_total", "counter", "Number of failed rounds, by reason");
+  for (auto const& [reason, count] : getFailuresByReason(stats)) {
+    result << "incmonk_failures_total{" << fuzzerLabel << ",reason=\"" << reason << "\"} "
+           << count << "\n";
+  }
+
+  addHeader("average_trace_size", "gauge", "Average number of commands per trace");
+  result << "incmonk_average_trace_size{" << fuzzerLabel << "} " << stats.getAverageTraceSize()
+         << "\n";
+
+  addHeader("average_solve_calls", "gauge", "Average number of solve calls per trace");
+  result << "incmonk_average_solve_calls{" << fuzzerLabel << "} "
+         << stats.getAverageSolveCalls() << "\n";
+
+  addHeader("time_seconds_total", "counter", "Time spent per fuzzing phase");
+  for (auto const& [phase, time] : getTimesByPhase(stats)) {
+    result << "incmonk_time_seconds_total{" << fuzzerLabel << ",phase=\"" << phase << "\"} "
+           << time.count() << "\n";
+  }
+
+  addHeader("peak_rss_bytes", "gauge", "Peak resident set size of the fuzzer process");
+  result << "incmonk_peak_rss_bytes{" << fuzzerLabel << "} " << stats.peakRSS << "\n";
+  return result.str();
+}
+}
+
+auto formatStats(FuzzStats const& stats, std::string const& fuzzerID, StatsFormat format)
+    -> std::string
+{
+  if (format == StatsFormat::PROMETHEUS) {
+    return formatAsPrometheus(stats, fuzzerID);
+  }
+  return formatAsJSON(stats, fuzzerID);
+}
+
+void writeStatsFile(std::filesystem::path const& filename, std::string const& content)
+{
+  std::filesystem::path tempFilename = filename;
+  tempFilename += ".tmp";
+
+  gsl::span<std::byte const> const bytes{reinterpret_cast<std::byte const*>(content.data()),
+                                         content.size()};
+  writeTraceFile(tempFilename, bytes, FsyncPolicy::NEVER);
+
+  std::error_code error;
+  std::filesystem::rename(tempFilename, filename, error);
+  if (error) {
+    throw IOException{"Could not replace " + filename.string()};
+  }
+}
+
+namespace {
+class StatsExporterImpl final : public StatsExporter {
+public:
+  StatsExporterImpl(std::filesystem::path const& filename,
+                    StatsFormat format,
+                    std::string const& fuzzerID,
+                    std::chrono::milliseconds interval,
+                    std::function<FuzzStats()> getStats)
+    : m_filename{filename}
+    , m_format{format}
+    , m_fuzzerID{fuzzerID}
+    , m_interval{interval}
+    , m_getStats{std::move(getStats)}
+    , m_thread{[this]() { run(); }}
+  {
+  }
+
+  void flush() override
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    if (m_firstError.has_value()) {
+      std::string error = std::move(*m_firstError);
+      m_firstError.reset();
+      throw IOException{error};
+    }
+    write();
+  }
+
+  ~StatsExporterImpl()
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stopRequested = true;
+    }
+    m_stopCondition.notify_one();
+    m_thread.join();
+  }
+
+  StatsExporterImpl(StatsExporterImpl const&) = delete;
+  auto operator=(StatsExporterImpl const&) -> StatsExporterImpl& = delete;
+
+private:
+  /// Writes the current statistics. Called with m_mutex being locked.
+  void write()
+  {
+    writeStatsFile(m_filename, formatStats(m_getStats(), m_fuzzerID, m_format));
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (!m_stopCondition.wait_for(lock, m_interval, [this]() { return m_stopRequested; })) {
+      try {
+        write();
+      }
+      catch (IOException const& exception) {
+        if (!m_firstError.has_value()) {
+          m_firstError = exception.what();
+        }
+      }
+    }
+  }
+
+  std::filesystem::path m_filename;
+  StatsFormat m_format;
+  std::string m_fuzzerID;
+  std::chrono::milliseconds m_interval;
+  std::function<FuzzStats()> m_getStats;
+
+  std::mutex m_mutex;
+  std::condition_variable m_stopCondition;
+  bool m_stopRequested = false;
+  std::optional<std::string> m_firstError;
+
+  std::thread m_thread;
+};
+}
+
+auto createStatsExporter(std::filesystem::path const& filename,
+                         StatsFormat format,
+                         std::string const& fuzzerID,
+                         std::chrono::milliseconds interval,
+                         std::function<FuzzStats()> getStats) -> std::unique_ptr<StatsExporter>
+{
+  return std::make_unique<StatsExporterImpl>(
+      filename, format, fuzzerID, interval, std::move(getStats));
+}
+}
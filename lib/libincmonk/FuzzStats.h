@@ -0,0 +1,151 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Fuzzing statistics, and exporting them to machine-readable files
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace incmonk {
+
+/**
+ * \brief Statistics of a fuzzing session
+ *
+ * The failure counters are disjoint: each failed run is counted exactly once.
+ */
+struct FuzzStats {
+  /// Wall-clock time since the start of the fuzzing session
+  std::chrono::duration<double> elapsedTime{0};
+
+  uint64_t numRounds = 0;
+
+  /// Correctness failures (see TraceExecutionFailure::Reason)
+  uint64_t numIncorrectResults = 0;
+  uint64_t numInvalidModels = 0;
+  uint64_t numInvalidFailed = 0;
+  uint64_t numInvalidResults = 0;
+
+  uint64_t numCrashes = 0;
+
+  /// Runs exceeding the wall-clock timeout
+  uint64_t numTimeouts = 0;
+
+  /// Runs exceeding the CPU time limit of solve calls
+  uint64_t numSolveTimeouts = 0;
+
+  uint64_t numMemouts = 0;
+
+  /// Total number of commands resp. solve commands of the traces of all rounds
+  uint64_t numTraceCommands = 0;
+  uint64_t numSolveCalls = 0;
+
+  /// Time spent generating traces, computing their expected results via the oracle,
+  /// and executing them in child processes running the solver under test
+  std::chrono::duration<double> generatorTime{0};
+  std::chrono::duration<double> oracleTime{0};
+  std::chrono::duration<double> sutTime{0};
+
+  /// Peak resident set size of the fuzzer process, in bytes (excluding child processes)
+  uint64_t peakRSS = 0;
+
+  auto getNumCorrectnessFailures() const noexcept -> uint64_t;
+  auto getExecsPerSecond() const noexcept -> double;
+  auto getAverageTraceSize() const noexcept -> double;
+  auto getAverageSolveCalls() const noexcept -> double;
+};
+
+/**
+ * \brief Returns the peak resident set size of the current process in bytes.
+ */
+auto getPeakRSS() -> uint64_t;
+
+enum class StatsFormat {
+  /// A single JSON object
+  JSON,
+
+  /// The Prometheus text exposition format, e.g. for the node exporter's textfile collector
+  PROMETHEUS
+};
+
+/**
+ * \brief Formats `stats` of the fuzzer with the given ID in the given format.
+ */
+auto formatStats(FuzzStats const& stats, std::string const& fuzzerID, StatsFormat format)
+    -> std::string;
+
+/**
+ * \brief Replaces the file `filename` with a file having the given content.
+ *
+ * The content is written to a temporary file in the same directory first, which is
+ * then renamed to `filename`. Readers of `filename` see either the old or the new
+ * content, but never a partially written file.
+ *
+ * \throw IOException   on file I/O failures
+ */
+void writeStatsFile(std::filesystem::path const& filename, std::string const& content);
+
+/**
+ * \brief Periodically writes fuzzing statistics to a file in a background thread.
+ */
+class StatsExporter {
+public:
+  /**
+   * \brief Writes the current statistics.
+   *
+   * \throw IOException   if writing the statistics failed, or if writing them failed
+   *   in the background since the last call to flush().
+   */
+  virtual void flush() = 0;
+
+  /**
+   * Stops the background thread without writing the statistics.
+   */
+  virtual ~StatsExporter() = default;
+};
+
+/**
+ * \brief Creates a StatsExporter writing the statistics to `filename` every `interval`
+ *   milliseconds, using writeStatsFile().
+ *
+ * \param getStats  Function returning the current statistics. It is called in the
+ *                  exporter's background thread and needs to be thread-safe.
+ */
+auto createStatsExporter(std::filesystem::path const& filename,
+                         StatsFormat format,
+                         std::string const& fuzzerID,
+                         std::chrono::milliseconds interval,
+                         std::function<FuzzStats()> getStats) -> std::unique_ptr<StatsExporter>;
+}
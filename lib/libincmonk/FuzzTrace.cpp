@@ -25,17 +25,26 @@
 */
 
 #include <libincmonk/FuzzTrace.h>
+
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/IOUtils.h>
 #include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/MappedFuzzTrace.h>
+#include <libincmonk/TraceFileFormat.h>
 
 #include <gsl/gsl_util>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <string>
 #include <type_traits>
 #include <variant>
+#include <vector>
 
 namespace incmonk {
 
@@ -124,131 +133,259 @@ auto operator<<(std::ostream& stream, FuzzCmd const& cmd) -> std::ostream&
   return stream;
 }
 
-namespace {
-auto applyCmd(IPASIRSolver& solver, AddClauseCmd const& cmd) -> bool
+template auto applyTrace<IPASIRSolver>(FuzzTrace::const_iterator first,
+                                       FuzzTrace::const_iterator last,
+                                       IPASIRSolver& target) -> FuzzTrace::const_iterator;
+
+void clearExpectedResults(FuzzTrace::iterator first, FuzzTrace::iterator last)
 {
-  solver.addClause(cmd.clauseToAdd);
-  return true;
+  for (FuzzTrace::iterator cmd = first; cmd != last; ++cmd) {
+    if (SolveCmd* solveCmd = std::get_if<SolveCmd>(&*cmd); solveCmd != nullptr) {
+      solveCmd->expectedResult = std::nullopt;
+    }
+  }
 }
 
-auto applyCmd(IPASIRSolver& solver, AssumeCmd const& cmd) -> bool
+
+IOException::IOException(std::string const& what) : std::runtime_error(what) {}
+
+namespace {
+template <typename I>
+void appendToBuffer(I value, std::vector<std::byte>& target)
 {
-  solver.assume(cmd.assumptions);
-  return true;
+  static_assert(std::is_integral_v<I>);
+  I const valueToWrite = toSmallEndian(value);
+  std::size_t const offset = target.size();
+  target.resize(offset + sizeof(valueToWrite));
+  std::memcpy(target.data() + offset, &valueToWrite, sizeof(valueToWrite));
 }
 
-auto applyCmd(IPASIRSolver& solver, SolveCmd const&) -> bool
+void appendVarintToBuffer(uint64_t value, std::vector<std::byte>& target)
 {
-  solver.solve();
-  return false;
+  while (value >= 0x80) {
+    target.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  target.push_back(static_cast<std::byte>(value));
 }
 
-auto applyCmd(IPASIRSolver& solver, HavocCmd const& cmd) -> bool
+void appendLitsToBuffer(gsl::span<CNFLit const> lits, std::vector<std::byte>& target)
 {
-  if (cmd.beforeInit) {
-    solver.reinitializeWithHavoc(cmd.seed);
-  }
-  else {
-    solver.havoc(cmd.seed);
+  std::size_t offset = target.size();
+  target.resize(offset + (lits.size() + 1) * sizeof(uint32_t));
+  for (CNFLit lit : lits) {
+    uint32_t const binaryLit = toSmallEndian(detail::litAsBinary(lit));
+    std::memcpy(target.data() + offset, &binaryLit, sizeof(binaryLit));
+    offset += sizeof(binaryLit);
   }
-  return true;
+  uint32_t const terminator = 0;
+  std::memcpy(target.data() + offset, &terminator, sizeof(terminator));
 }
+
+auto isSortedByBinaryLit(gsl::span<CNFLit const> lits) -> bool
+{
+  return std::is_sorted(lits.begin(), lits.end(), [](CNFLit lhs, CNFLit rhs) {
+    return detail::litAsBinary(lhs) < detail::litAsBinary(rhs);
+  });
 }
 
-auto applyTrace(FuzzTrace::const_iterator first,
-                FuzzTrace::const_iterator last,
-                IPASIRSolver& target) -> FuzzTrace::const_iterator
+void appendDeltaEncodedLitsToBuffer(gsl::span<CNFLit const> lits,
+                                    bool isSorted,
+                                    std::vector<std::byte>& target)
 {
-  FuzzTrace::const_iterator cmd = first;
+  appendVarintToBuffer(lits.size(), target);
 
-  for (; cmd != last; ++cmd) {
-    bool doContinue = true;
-    std::visit([&target, &doContinue](auto&& x) { doContinue = applyCmd(target, x); }, *cmd);
-    if (!doContinue) {
-      break;
+  int64_t previous = 0;
+  for (CNFLit lit : lits) {
+    int64_t const binaryLit = detail::litAsBinary(lit);
+    int64_t const delta = binaryLit - previous;
+    appendVarintToBuffer(isSorted ? static_cast<uint64_t>(delta) : detail::zigzagEncode(delta),
+                         target);
+    previous = binaryLit;
+  }
+}
+
+/**
+ * Appends the encoding of commands to a buffer
+ */
+class TraceEncoder {
+public:
+  TraceEncoder(TraceFormat format, std::vector<std::byte>& target)
+    : m_format{format}, m_target{target}
+  {
+    uint32_t const cookie =
+        (format == TraceFormat::V2) ? detail::v2::magicCookie : detail::magicCookie;
+    appendToBuffer<uint32_t>(cookie, m_target);
+  }
+
+  void encode(AddClauseCmd const& cmd) { encodeLits(ADD_CLAUSE, cmd.clauseToAdd); }
+  void encode(AddClauseView const& cmd) { encodeLits(ADD_CLAUSE, cmd.clauseToAdd); }
+  void encode(AssumeCmd const& cmd) { encodeLits(ASSUME, cmd.assumptions); }
+  void encode(AssumeView const& cmd) { encodeLits(ASSUME, cmd.assumptions); }
+
+  void encode(SolveCmd const& cmd)
+  {
+    if (m_format == TraceFormat::V1) {
+      if (!cmd.expectedResult.has_value()) {
+        appendToBuffer<uint8_t>(detail::solveWithoutExpectedResultCmdId, m_target);
+      }
+      else {
+        uint8_t const cmdIdWithValue = *(cmd.expectedResult) ? detail::solveWithTrueResultCmdId
+                                                              : detail::solveWithFalseResultCmdId;
+        appendToBuffer<uint8_t>(cmdIdWithValue, m_target);
+      }
+      return;
     }
+
+    uint8_t cmdId = detail::v2::solveWithoutExpectedResultCmdId;
+    if (cmd.expectedResult.has_value()) {
+      cmdId = *(cmd.expectedResult) ? detail::v2::solveWithTrueResultCmdId
+                                    : detail::v2::solveWithFalseResultCmdId;
+    }
+    extendRun(cmdId);
   }
 
-  return cmd;
-}
+  void encode(HavocCmd const& cmd)
+  {
+    if (m_format == TraceFormat::V1) {
+      uint8_t cmdId = cmd.beforeInit ? detail::havocInitCmdId : detail::havocCmdId;
+      appendToBuffer<uint8_t>(cmdId, m_target);
+      appendToBuffer<uint64_t>(cmd.seed, m_target);
+      return;
+    }
 
+    extendRun(cmd.beforeInit ? detail::v2::havocInitCmdId : detail::v2::havocCmdId);
+    m_runSeeds.push_back(cmd.seed);
+  }
 
-IOException::IOException(std::string const& what) : std::runtime_error(what) {}
+  /**
+   * Encodes the commands not yet written to the buffer. Must be called after the
+   * last command has been encoded.
+   */
+  void finish() { flushRun(); }
 
-namespace {
-constexpr uint32_t magicCookie = 0xF2950001; // 0xF2950000 + format version
+private:
+  enum LitsCmdKind { ADD_CLAUSE, ASSUME };
 
-constexpr uint8_t addClauseCmdId = 0;
-constexpr uint8_t assumeCmdId = 1;
-constexpr uint8_t solveWithoutExpectedResultCmdId = 2;
-constexpr uint8_t solveWithFalseResultCmdId = 3;
-constexpr uint8_t solveWithTrueResultCmdId = 4;
-constexpr uint8_t havocInitCmdId = 5;
-constexpr uint8_t havocCmdId = 6;
-constexpr uint8_t maxCmdId = 6;
+  void encodeLits(LitsCmdKind kind, gsl::span<CNFLit const> lits)
+  {
+    if (m_format == TraceFormat::V1) {
+      uint8_t const cmdId = (kind == ADD_CLAUSE) ? detail::addClauseCmdId : detail::assumeCmdId;
+      appendToBuffer<uint8_t>(cmdId, m_target);
+      appendLitsToBuffer(lits, m_target);
+      return;
+    }
+
+    flushRun();
+    bool const isSorted = isSortedByBinaryLit(lits);
+    uint8_t cmdId = 0;
+    if (kind == ADD_CLAUSE) {
+      cmdId = isSorted ? detail::v2::addSortedClauseCmdId : detail::v2::addClauseCmdId;
+    }
+    else {
+      cmdId = isSorted ? detail::v2::assumeSortedCmdId : detail::v2::assumeCmdId;
+    }
+    appendToBuffer<uint8_t>(cmdId, m_target);
+    appendDeltaEncodedLitsToBuffer(lits, isSorted, m_target);
+  }
 
+  void extendRun(uint8_t cmdId)
+  {
+    if (m_runLength > 0 && (m_runCmdId != cmdId || m_runLength == detail::v2::maxRunLength)) {
+      flushRun();
+    }
+    m_runCmdId = cmdId;
+    ++m_runLength;
+  }
 
-template <typename I>
-void appendToTraceFile(I value, FILE* stream)
+  void flushRun()
+  {
+    if (m_runLength == 0) {
+      return;
+    }
+
+    appendToBuffer<uint8_t>(m_runCmdId, m_target);
+    appendVarintToBuffer(m_runLength, m_target);
+    for (uint64_t seed : m_runSeeds) {
+      appendToBuffer<uint64_t>(seed, m_target);
+    }
+
+    m_runLength = 0;
+    m_runSeeds.clear();
+  }
+
+  TraceFormat m_format;
+  std::vector<std::byte>& m_target;
+
+  uint8_t m_runCmdId = 0;
+  uint64_t m_runLength = 0;
+  std::vector<uint64_t> m_runSeeds;
+};
+
+void writeToStream(std::vector<std::byte> const& encodedTrace, FILE& stream)
 {
-  static_assert(std::is_integral_v<I>);
-  I valueToWrite = toSmallEndian(value);
-  size_t const written = fwrite(&valueToWrite, sizeof(valueToWrite), 1, stream);
-  if (written != 1) {
+  if (encodedTrace.empty()) {
+    return;
+  }
+  if (fwrite(encodedTrace.data(), encodedTrace.size(), 1, &stream) != 1) {
     throw IOException{"Write failure"};
   }
 }
-
-uint32_t litAsBinary(CNFLit lit)
-{
-  uint32_t absVal = std::abs(lit) << 1;
-  absVal += (lit < 0 ? 1 : 0);
-  return absVal;
 }
 
-void appendLitsToTraceFile(std::vector<CNFLit> const& lits, FILE* stream)
+void encodeTrace(FuzzTrace::const_iterator first,
+                 FuzzTrace::const_iterator last,
+                 std::vector<std::byte>& target,
+                 TraceFormat format)
 {
-  for (CNFLit lit : lits) {
-    appendToTraceFile<uint32_t>(litAsBinary(lit), stream);
+  TraceEncoder encoder{format, target};
+  for (FuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
+    std::visit([&encoder](auto&& x) { encoder.encode(x); }, *cmd);
   }
-  appendToTraceFile<uint32_t>(0, stream);
+  encoder.finish();
 }
 
-void storeCmd(AddClauseCmd const& cmd, FILE* stream)
+void encodeTrace(FlatFuzzTrace const& trace, std::vector<std::byte>& target, TraceFormat format)
 {
-  appendToTraceFile<uint8_t>(addClauseCmdId, stream);
-  appendLitsToTraceFile(cmd.clauseToAdd, stream);
+  TraceEncoder encoder{format, target};
+  for (FlatFuzzTrace::CmdView cmd : trace) {
+    cmd.visit([&encoder](auto&& x) { encoder.encode(x); });
+  }
+  encoder.finish();
 }
 
-void storeCmd(AssumeCmd const& cmd, FILE* stream)
+void storeTrace(FuzzTrace::const_iterator first,
+                FuzzTrace::const_iterator last,
+                std::filesystem::path const& filename,
+                TraceFormat format)
 {
-  appendToTraceFile<uint8_t>(assumeCmdId, stream);
-  appendLitsToTraceFile(cmd.assumptions, stream);
-}
+  FILE* output = fopen(filename.string().c_str(), "w");
+  if (output == nullptr) {
+    throw IOException{"Could not open file " + filename.string()};
+  }
+  auto closeOutput = gsl::finally([output]() { fclose(output); });
 
-void storeCmd(SolveCmd const& cmd, FILE* stream)
-{
-  if (!cmd.expectedResult.has_value()) {
-    appendToTraceFile<uint8_t>(solveWithoutExpectedResultCmdId, stream);
+  try {
+    storeTrace(first, last, *output, format);
   }
-  else {
-    uint8_t const cmdIdWithValue =
-        *(cmd.expectedResult) ? solveWithTrueResultCmdId : solveWithFalseResultCmdId;
-    appendToTraceFile<uint8_t>(cmdIdWithValue, stream);
+  catch (IOException const&) {
+    throw IOException{"I/O error while writing to " + filename.string()};
   }
 }
 
-void storeCmd(HavocCmd const& cmd, FILE* stream)
+void storeTrace(FuzzTrace::const_iterator first,
+                FuzzTrace::const_iterator last,
+                FILE& stream,
+                TraceFormat format)
 {
-  uint8_t cmdId = cmd.beforeInit ? havocInitCmdId : havocCmdId;
-  appendToTraceFile<uint8_t>(cmdId, stream);
-  appendToTraceFile<uint64_t>(cmd.seed, stream);
-}
+  std::vector<std::byte> encodedTrace;
+  encodeTrace(first, last, encodedTrace, format);
+  writeToStream(encodedTrace, stream);
 }
 
-void storeTrace(FuzzTrace::const_iterator first,
-                FuzzTrace::const_iterator last,
-                std::filesystem::path const& filename)
+void storeTrace(FlatFuzzTrace const& trace,
+                std::filesystem::path const& filename,
+                TraceFormat format)
 {
   FILE* output = fopen(filename.string().c_str(), "w");
   if (output == nullptr) {
@@ -257,125 +394,126 @@ void storeTrace(FuzzTrace::const_iterator first,
   auto closeOutput = gsl::finally([output]() { fclose(output); });
 
   try {
-    appendToTraceFile<uint32_t>(magicCookie, output);
-    for (FuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
-      std::visit([&output](auto&& x) { storeCmd(x, output); }, *cmd);
-    }
+    storeTrace(trace, *output, format);
   }
   catch (IOException const&) {
     throw IOException{"I/O error while writing to " + filename.string()};
   }
 }
 
-namespace {
-std::vector<CNFLit> readCNFLits(FILE* input)
+void storeTrace(FlatFuzzTrace const& trace, FILE& stream, TraceFormat format)
 {
-  std::vector<uint32_t> buffer;
+  std::vector<std::byte> encodedTrace;
+  encodeTrace(trace, encodedTrace, format);
+  writeToStream(encodedTrace, stream);
+}
 
-  bool clauseEndReached = false;
-  while (!clauseEndReached) {
-    uint32_t nextLit = 0;
-    if (fread(&nextLit, sizeof(uint32_t), 1, input) != 1) {
-      throw IOException{"Unexpected end of literal sequence"};
-    }
+namespace {
+class FileReader {
+public:
+  explicit FileReader(FILE& input) : m_input{&input} {}
 
-    clauseEndReached = (nextLit == 0);
-    if (!clauseEndReached > 0) {
-      buffer.push_back(nextLit);
-    }
+  auto read(void* target, std::size_t numBytes) -> bool
+  {
+    return fread(target, numBytes, 1, m_input) == 1;
   }
 
-  std::transform(buffer.begin(), buffer.end(), buffer.begin(), fromSmallEndian<uint32_t>);
+private:
+  FILE* m_input;
+};
 
-  std::vector<CNFLit> result;
-  for (uint32_t i : buffer) {
-    int sign = ((i & 1) == 1 ? -1 : 1);
-    result.push_back(static_cast<int32_t>(i / 2) * sign);
-  }
+/**
+ * Appends commands to a FuzzTrace, with the same interface as FlatFuzzTrace
+ */
+class FuzzTraceBuilder {
+public:
+  explicit FuzzTraceBuilder(FuzzTrace& target) : m_target{target} {}
 
-  return result;
-}
+  void addClause(gsl::span<CNFLit const> clause)
+  {
+    m_target.push_back(AddClauseCmd{{clause.begin(), clause.end()}});
+  }
 
-auto readHavocSeed(FILE* input) -> uint64_t
-{
-  uint64_t result = 0;
-  size_t numRead = fread(&result, sizeof(uint64_t), 1, input);
-  if (numRead != 1) {
-    throw IOException{"Unexpected end of file"};
+  void assume(gsl::span<CNFLit const> assumptions)
+  {
+    m_target.push_back(AssumeCmd{{assumptions.begin(), assumptions.end()}});
   }
-  return fromSmallEndian(result);
-}
 
-auto decodeSolveResult(uint8_t commandID) -> std::optional<bool>
+  void solve(std::optional<bool> expectedResult) { m_target.push_back(SolveCmd{expectedResult}); }
+
+  void havoc(uint64_t seed, bool beforeInit) { m_target.push_back(HavocCmd{seed, beforeInit}); }
+
+private:
+  FuzzTrace& m_target;
+};
+
+template <typename Reader, typename TraceBuilder>
+void loadTraceInto(Reader& input, LoaderStrictness strictness, TraceBuilder& target)
 {
-  if (commandID == solveWithoutExpectedResultCmdId) {
-    return std::nullopt;
+  detail::TraceDecoderState decoderState;
+  decoderState.strictness = strictness;
+  if (!detail::readMagicCookie(input, decoderState) && strictness == LoaderStrictness::STRICT) {
+    throw IOException{"Bad file format: magic cookie not found"};
   }
-  else if (commandID == solveWithFalseResultCmdId) {
-    return false;
+
+  try {
+    std::vector<CNFLit> litBuffer;
+    while (detail::readFuzzCmd(input, decoderState, litBuffer, target)) {
+    }
   }
-  else {
-    assert(commandID == solveWithTrueResultCmdId);
-    return true;
+  catch (IOException const&) {
+    if (strictness == LoaderStrictness::STRICT) {
+      throw;
+    }
   }
 }
+}
 
-std::optional<FuzzCmd> readFuzzCmd(FILE* input, LoaderStrictness strictness)
+auto loadTrace(std::filesystem::path const& filename, LoaderStrictness strictness) -> FuzzTrace
 {
-  uint8_t command = 0;
-  size_t const numRead = fread(&command, 1, 1, input);
-  if (numRead == 0) {
-    return std::nullopt;
+  if (std::filesystem::is_regular_file(filename)) {
+    MappedFuzzTrace mappedTrace{filename, strictness};
+    return toFuzzTrace(mappedTrace.begin(), mappedTrace.end());
   }
 
-  if (strictness == LoaderStrictness::PERMISSIVE) {
-    command = command % (maxCmdId + 1);
+  FILE* input = fopen(filename.string().c_str(), "r");
+  if (input == nullptr) {
+    throw IOException("Could not open file " + filename.string());
   }
+  auto closeInput = gsl::finally([input]() { fclose(input); });
 
-  if (command == addClauseCmdId) {
-    AddClauseCmd result;
-    result.clauseToAdd = readCNFLits(input);
-    return result;
-  }
-  else if (command == assumeCmdId) {
-    AssumeCmd result;
-    result.assumptions = readCNFLits(input);
-    return result;
-  }
-  else if (command == solveWithoutExpectedResultCmdId || command == solveWithFalseResultCmdId ||
-           command == solveWithTrueResultCmdId) {
-    SolveCmd result;
-    result.expectedResult = decodeSolveResult(command);
-    return result;
-  }
-  else if (command == havocInitCmdId || command == havocCmdId) {
-    // command == 6: pre-init havoc cmd
-    // command == 7: regular havoc cmd
-    HavocCmd result;
-    result.seed = readHavocSeed(input);
-    result.beforeInit = (command == havocInitCmdId);
-    return result;
-  }
-  else {
-    throw IOException{"Invalid fuzz command"};
-  }
+  return loadTrace(*input, strictness);
 }
 
-bool readMagicCookie(FILE* input)
+auto loadTrace(FILE& stream, LoaderStrictness strictness) -> FuzzTrace
 {
-  uint32_t cookie;
-  size_t const numRead = fread(&cookie, sizeof(uint32_t), 1, input);
-  if (numRead != 1) {
-    return false;
-  }
-
-  return fromSmallEndian(cookie) == magicCookie;
-}
+  FuzzTrace result;
+  FuzzTraceBuilder builder{result};
+  FileReader input{stream};
+  loadTraceInto(input, strictness, builder);
+  return result;
 }
 
-auto loadTrace(std::filesystem::path const& filename, LoaderStrictness strictness) -> FuzzTrace
+auto loadTrace(gsl::span<std::byte const> data, LoaderStrictness strictness) -> FuzzTrace
 {
   FuzzTrace result;
+  FuzzTraceBuilder builder{result};
+  detail::MemoryReader input{data.data(), data.data() + data.size()};
+  loadTraceInto(input, strictness, builder);
+  return result;
+}
+
+auto loadFlatTrace(std::filesystem::path const& filename, LoaderStrictness strictness)
+    -> FlatFuzzTrace
+{
+  if (std::filesystem::is_regular_file(filename)) {
+    MappedFuzzTrace mappedTrace{filename, strictness};
+    FlatFuzzTrace result;
+    for (FlatFuzzTrace::CmdView cmd : mappedTrace) {
+      result.push_back(cmd);
+    }
+    return result;
+  }
 
   FILE* input = fopen(filename.string().c_str(), "r");
   if (input == nullptr) {
@@ -383,30 +521,50 @@ auto loadTrace(std::filesystem::path const& filename, LoaderStrictness strictnes
   }
   auto closeInput = gsl::finally([input]() { fclose(input); });
 
-  return loadTrace(*input, strictness);
+  return loadFlatTrace(*input, strictness);
 }
 
-auto loadTrace(FILE& stream, LoaderStrictness strictness) -> FuzzTrace
+auto loadFlatTrace(FILE& stream, LoaderStrictness strictness) -> FlatFuzzTrace
 {
-  FuzzTrace result;
+  FlatFuzzTrace result;
+  FileReader input{stream};
+  loadTraceInto(input, strictness, result);
+  return result;
+}
 
-  if (!readMagicCookie(&stream) && strictness == LoaderStrictness::STRICT) {
+FlatFuzzTraceReader::FlatFuzzTraceReader(FILE& stream, LoaderStrictness strictness)
+  : m_stream{&stream}
+{
+  m_decoderState.strictness = strictness;
+  FileReader input{stream};
+  if (!detail::readMagicCookie(input, m_decoderState) && strictness == LoaderStrictness::STRICT) {
     throw IOException{"Bad file format: magic cookie not found"};
   }
+}
+
+auto FlatFuzzTraceReader::readNextPhase(FlatFuzzTrace& target) -> bool
+{
+  target.clear();
+  if (m_endReached) {
+    return false;
+  }
 
+  FileReader input{*m_stream};
   try {
-    std::optional<FuzzCmd> currentCmd = readFuzzCmd(&stream, strictness);
-    while (currentCmd.has_value()) {
-      result.push_back(*currentCmd);
-      currentCmd = readFuzzCmd(&stream, strictness);
+    while (detail::readFuzzCmd(input, m_decoderState, m_litBuffer, target)) {
+      if (target[target.size() - 1].getKind() == FlatFuzzTrace::CmdKind::SOLVE) {
+        return true;
+      }
     }
+    m_endReached = true;
   }
   catch (IOException const&) {
-    if (strictness == LoaderStrictness::STRICT) {
+    m_endReached = true;
+    if (m_decoderState.strictness == LoaderStrictness::STRICT) {
       throw;
     }
   }
 
-  return result;
+  return !target.empty();
 }
 }
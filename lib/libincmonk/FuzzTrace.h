@@ -33,6 +33,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <filesystem>
@@ -41,7 +42,10 @@
 #include <variant>
 #include <vector>
 
+#include <gsl/span>
+
 #include "CNF.h"
+#include "Profiling.h"
 
 namespace incmonk {
 
@@ -111,14 +115,30 @@ using FuzzTrace = std::vector<FuzzCmd>;
 /**
  * \brief Applies the given trace to an IPASIR SAT solver, checking
  *   any expected SolveCmd results if specified.
+ *
+ * `SolverT` is IPASIRSolver or a type derived from it. When `SolverT` is a `final`
+ * class (e.g. BoundIPASIRSolver), the solver's functions are called directly instead
+ * of via virtual dispatch.
  * 
  * \returns Iterator to the first SolveCmd within [first, last) for which
  *   the SAT solver returned an unexpected result or the solve command has
  *   no satisfibility info. Otherwise, `last` is returned.
  */
+template <typename SolverT>
 auto applyTrace(FuzzTrace::const_iterator first,
                 FuzzTrace::const_iterator last,
-                IPASIRSolver& target) -> FuzzTrace::const_iterator;
+                SolverT& target) -> FuzzTrace::const_iterator;
+
+extern template auto applyTrace<IPASIRSolver>(FuzzTrace::const_iterator first,
+                                              FuzzTrace::const_iterator last,
+                                              IPASIRSolver& target)
+    -> FuzzTrace::const_iterator;
+
+
+/**
+ * \brief Removes the expected results from the SolveCmd elements in [first, last).
+ */
+void clearExpectedResults(FuzzTrace::iterator first, FuzzTrace::iterator last);
 
 
 class IOException : public std::runtime_error {
@@ -127,17 +147,53 @@ public:
   virtual ~IOException() = default;
 };
 
+/**
+ * \brief Binary trace file formats
+ *
+ * Traces in all formats can be loaded via loadTrace(), which detects the format
+ * of the trace.
+ */
+enum class TraceFormat {
+  /// Literals are stored as fixed-width 32-bit integers
+  V1,
+
+  /// Literals are stored as delta-encoded varints, and runs of solve and havoc
+  /// commands are compressed. Traces are several times smaller than in format V1.
+  V2
+};
+
 /**
  * \brief Stores the given trace in a file
  * 
- * TODO: describe format
- * 
  * \throw IOException   on file I/O failures
  */
 void storeTrace(FuzzTrace::const_iterator first,
                 FuzzTrace::const_iterator last,
-                std::filesystem::path const& filename);
+                std::filesystem::path const& filename,
+                TraceFormat format = TraceFormat::V1);
+
+/**
+ * \brief Writes the given trace to a stream, in the format used by the
+ *   file-based storeTrace function.
+ *
+ * \throw IOException   on I/O failures
+ */
+void storeTrace(FuzzTrace::const_iterator first,
+                FuzzTrace::const_iterator last,
+                FILE& stream,
+                TraceFormat format = TraceFormat::V1);
 
+/**
+ * \brief Appends the encoding of the given trace to `target`, in the format used by
+ *   storeTrace.
+ *
+ * The whole trace is encoded into a single buffer, which can then be written with
+ * a single write call (see TraceDumpWriter).
+ */
+void encodeTrace(FuzzTrace::const_iterator first,
+                 FuzzTrace::const_iterator last,
+                 std::vector<std::byte>& target,
+                 TraceFormat format = TraceFormat::V1);
 
 enum class LoaderStrictness { STRICT, PERMISSIVE };
 
@@ -146,8 +202,8 @@ enum class LoaderStrictness { STRICT, PERMISSIVE };
  * 
  * \param filename    The file to load
  * \param strictness  If STRICT, only valid traces are parsed. If PERMISSIVE, any byte sequence
- *                    is interpreted as a trace, ignoring the versioning header and wrapping
- *                    command numbers.
+ *                    is interpreted as a trace, wrapping command numbers. Byte sequences not
+ *                    starting with a versioning header are interpreted as traces in format V1.
  * 
  * \throw IOException   on file I/O failures and file format errors
  */
@@ -159,10 +215,83 @@ auto loadTrace(std::filesystem::path const& filename,
  * 
  * \param stream      The stream from which to load the trace
  * \param strictness  If STRICT, only valid traces are parsed. If PERMISSIVE, any byte sequence
- *                    is interpreted as a trace, ignoring the versioning header and wrapping
- *                    command numbers.
+ *                    is interpreted as a trace, wrapping command numbers. Byte sequences not
+ *                    starting with a versioning header are interpreted as traces in format V1.
  * 
  * \throw IOException   on file I/O failures and file format errors
  */
 auto loadTrace(FILE& stream, LoaderStrictness strictness = LoaderStrictness::STRICT) -> FuzzTrace;
+
+/**
+ * \brief Loads the trace from the given buffer, in the format used by storeTrace
+ *
+ * \param data        The encoded trace
+ * \param strictness  If STRICT, only valid traces are parsed. If PERMISSIVE, any byte sequence
+ *                    is interpreted as a trace, wrapping command numbers. Byte sequences not
+ *                    starting with a versioning header are interpreted as traces in format V1.
+ *
+ * \throw IOException   on file format errors
+ */
+auto loadTrace(gsl::span<std::byte const> data,
+               LoaderStrictness strictness = LoaderStrictness::STRICT) -> FuzzTrace;
+
+
+// Implementation
+
+namespace detail {
+template <typename SolverT>
+auto applyCmd(SolverT& solver, AddClauseCmd const& cmd) -> bool
+{
+  ProfileScope profileScope{ProfilePhase::SUT_ADD};
+  solver.addClause(cmd.clauseToAdd);
+  return true;
+}
+
+template <typename SolverT>
+auto applyCmd(SolverT& solver, AssumeCmd const& cmd) -> bool
+{
+  ProfileScope profileScope{ProfilePhase::SUT_ADD};
+  solver.assume(cmd.assumptions);
+  return true;
+}
+
+template <typename SolverT>
+auto applyCmd(SolverT& solver, SolveCmd const&) -> bool
+{
+  ProfileScope profileScope{ProfilePhase::SUT_SOLVE};
+  solver.solve();
+  return false;
+}
+
+template <typename SolverT>
+auto applyCmd(SolverT& solver, HavocCmd const& cmd) -> bool
+{
+  if (cmd.beforeInit) {
+    solver.reinitializeWithHavoc(cmd.seed);
+  }
+  else {
+    solver.havoc(cmd.seed);
+  }
+  return true;
+}
+}
+
+template <typename SolverT>
+auto applyTrace(FuzzTrace::const_iterator first,
+                FuzzTrace::const_iterator last,
+                SolverT& target) -> FuzzTrace::const_iterator
+{
+  FuzzTrace::const_iterator cmd = first;
+
+  for (; cmd != last; ++cmd) {
+    bool doContinue = true;
+    std::visit([&target, &doContinue](auto&& x) { doContinue = detail::applyCmd(target, x); },
+               *cmd);
+    if (!doContinue) {
+      break;
+    }
+  }
+
+  return cmd;
+}
 }
@@ -26,14 +26,22 @@
 
 #include <libincmonk/FuzzTraceExec.h>
 
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/Oracle.h>
 
+#include <gsl/span>
+
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <iomanip>
 #include <sstream>
 #include <unordered_set>
+#include <vector>
 
 namespace incmonk {
 
@@ -41,146 +49,413 @@ namespace {
 
 using Analysis = std::optional<TraceExecutionFailure::Reason>;
 
-auto analyzeSatResult(FuzzTrace::iterator phaseStop, IPASIRSolver& sut, Oracle& oracle) -> Analysis
-{
-  std::vector<CNFLit> assumptions = oracle.getCurrentAssumptions();
-
-  // Check if all assumptions are heeded:
-  bool assumptionFailure = false;
-  for (auto assumption : assumptions) {
-    TBool const assumptionVal = sut.getValue(assumption);
-    if (assumptionVal != t_true) {
-      assumptionFailure = true;
-      break;
-    }
-  }
-
-  SolveCmd& solveCmd = std::get<SolveCmd>(*phaseStop);
-  if (!assumptionFailure) {
-    // Check if the solver actually computed a model:
-    CNFLit maxLit = oracle.getMaxSeenLit();
-    std::vector<CNFLit> model;
-    model.reserve(maxLit);
-    for (CNFLit lit = 1; lit <= maxLit; ++lit) {
-      TBool val = sut.getValue(lit);
-      if (val != t_indet) {
-        model.push_back(lit * (val == t_true ? 1 : -1));
-      }
+/**
+ * Flat store of the clauses added to the SUT, used for checking models
+ * without involving the oracle.
+ */
+class ClauseStore {
+public:
+  enum class CheckResult { SATISFIED, FALSIFIED, INDETERMINATE };
+
+  void add(gsl::span<CNFLit const> clause)
+  {
+    for (CNFLit lit : clause) {
+      m_lits.push_back(getLitIndex(lit));
     }
+    m_clauseEnds.push_back(m_lits.size());
+  }
 
-    // TODO: check the clauses occurring in the trace
-    //   when there are variables without assignment
-    TBool probeResult = oracle.probe(model);
-    if (probeResult != t_false) {
-      solveCmd.expectedResult = true;
-      oracle.clearAssumptions();
-      return std::nullopt;
+  static auto getLitIndex(CNFLit lit) noexcept -> uint32_t
+  {
+    return 2 * static_cast<uint32_t>(std::abs(lit)) + (lit < 0 ? 1 : 0);
+  }
+
+  /**
+   * Checks if the assignment satisfies all clauses in the store.
+   *
+   * \param litIsTrue  Maps each literal index (see getLitIndex()) to 1 if the
+   *   literal is assigned true, and to 0 otherwise. Contains all literals
+   *   occurring in the store.
+   *
+   * \returns SATISFIED if the assignment satisfies all clauses, FALSIFIED if it
+   *   falsifies a clause, and INDETERMINATE if no clause is falsified, but some
+   *   clauses are not satisfied due to unassigned literals.
+   */
+  auto check(std::vector<uint8_t> const& litIsTrue) const noexcept -> CheckResult
+  {
+    CheckResult result = CheckResult::SATISFIED;
+
+    uint8_t const* values = litIsTrue.data();
+    uint32_t const* lits = m_lits.data();
+    std::size_t clauseBegin = 0;
+    for (std::size_t clauseEnd : m_clauseEnds) {
+      uint8_t satisfied = 0;
+      for (std::size_t idx = clauseBegin; idx < clauseEnd; ++idx) {
+        satisfied |= values[lits[idx]];
+      }
+
+      if (satisfied == 0) {
+        bool const hasUnassignedLit =
+            std::any_of(lits + clauseBegin, lits + clauseEnd, [values](uint32_t lit) {
+              return values[lit ^ 1] == 0;
+            });
+        if (!hasUnassignedLit) {
+          return CheckResult::FALSIFIED;
+        }
+        result = CheckResult::INDETERMINATE;
+      }
+
+      clauseBegin = clauseEnd;
     }
+
+    return result;
   }
 
-  // The model is invalid. Check if this is actually a SAT/UNSAT flip:
-  oracle.solve(phaseStop, phaseStop + 1);
-  if (!solveCmd.expectedResult.has_value()) {
-    return std::nullopt;
+private:
+  std::vector<uint32_t> m_lits;
+  std::vector<std::size_t> m_clauseEnds;
+};
+
+/**
+ * Checks the results of the SUT's solve calls, given the commands executed since the
+ * previous solve call. The oracle is only consulted when needed, i.e. for checking
+ * partial models and failed assumptions, deciding SAT/UNSAT flips and for solve commands
+ * without an expected result. Access to the oracle is provided by subclasses.
+ */
+class SolveResultChecker {
+public:
+  explicit SolveResultChecker(IPASIRSolver& sut) : m_sut{sut} {}
+
+  virtual ~SolveResultChecker() = default;
+
+protected:
+  void beginPhase() { m_assumptions.clear(); }
+
+  void addClause(gsl::span<CNFLit const> clause)
+  {
+    updateMaxVar(clause);
+    m_clauses.add(clause);
   }
 
-  if (*(solveCmd.expectedResult)) {
-    return TraceExecutionFailure::Reason::INVALID_MODEL;
+  void addAssumptions(gsl::span<CNFLit const> assumptions)
+  {
+    updateMaxVar(assumptions);
+    m_assumptions.insert(m_assumptions.end(), assumptions.begin(), assumptions.end());
   }
-  else {
-    return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+
+  /**
+   * Checks the result of the SUT's last solve call. `expectedResult` is the
+   * expected result of the corresponding solve command, and is updated if the
+   * result has been determined during the check.
+   */
+  auto checkResult(std::optional<bool>& expectedResult) -> Analysis
+  {
+    IPASIRSolver::Result lastResult = m_sut.getLastSolveResult();
+    if (lastResult == IPASIRSolver::Result::UNKNOWN ||
+        lastResult == IPASIRSolver::Result::ILLEGAL_RESULT) {
+      return std::make_optional(TraceExecutionFailure::Reason::INVALID_RESULT);
+    }
+
+    if (lastResult == IPASIRSolver::Result::SAT) {
+      return analyzeSatResult(expectedResult);
+    }
+    else {
+      assert(lastResult == IPASIRSolver::Result::UNSAT);
+      return analyzeUnsatResult(expectedResult);
+    }
   }
-}
 
-auto analyzeUnsatResult(FuzzTrace::iterator phaseStop, IPASIRSolver& sut, Oracle& oracle)
-    -> Analysis
-{
-  std::vector<CNFLit> assumptions = oracle.getCurrentAssumptions();
+  /**
+   * Returns the oracle, containing all clauses and assumptions added before the
+   * current solve command.
+   */
+  virtual auto getOracleBeforeSolve() -> Oracle& = 0;
+
+  /**
+   * Determines the expected result of the current solve command via the oracle.
+   */
+  virtual auto determineExpectedResult() -> std::optional<bool> = 0;
+
+private:
+  void updateMaxVar(gsl::span<CNFLit const> lits)
+  {
+    for (CNFLit lit : lits) {
+      m_maxVar = std::max(m_maxVar, std::abs(lit));
+    }
+  }
+
+  auto getExpectedResult(std::optional<bool>& expectedResult) -> std::optional<bool>
+  {
+    if (!expectedResult.has_value()) {
+      expectedResult = determineExpectedResult();
+    }
+    return expectedResult;
+  }
+
+  /**
+   * Checks if the SUT's current assignment (as stored in `m_model`) satisfies the
+   * clauses added so far.
+   */
+  auto isModelValid() -> bool
+  {
+    m_litIsTrue.assign(2 * (static_cast<std::size_t>(m_maxVar) + 1), 0);
+    for (CNFLit var = 1; var <= m_maxVar; ++var) {
+      TBool const val = m_model[var - 1];
+      if (val == t_true) {
+        m_litIsTrue[ClauseStore::getLitIndex(var)] = 1;
+      }
+      else if (val == t_false) {
+        m_litIsTrue[ClauseStore::getLitIndex(-var)] = 1;
+      }
+    }
+
+    ClauseStore::CheckResult const checkResult = m_clauses.check(m_litIsTrue);
+    if (checkResult != ClauseStore::CheckResult::INDETERMINATE) {
+      return checkResult == ClauseStore::CheckResult::SATISFIED;
+    }
 
-  std::vector<CNFLit> failed;
-  for (CNFLit assumption : assumptions) {
-    if (sut.isFailed(assumption)) {
-      failed.push_back(assumption);
+    // The assignment is partial. Check if it can be extended to a model:
+    std::vector<CNFLit> partialModel;
+    for (CNFLit var = 1; var <= m_maxVar; ++var) {
+      if (m_litIsTrue[ClauseStore::getLitIndex(var)] != 0) {
+        partialModel.push_back(var);
+      }
+      else if (m_litIsTrue[ClauseStore::getLitIndex(-var)] != 0) {
+        partialModel.push_back(-var);
+      }
     }
+    return getOracleBeforeSolve().probe(partialModel) != t_false;
   }
 
-  SolveCmd& solveCmd = std::get<SolveCmd>(*phaseStop);
-  TBool probeResult = oracle.probe(failed);
-  if (probeResult != t_true) {
-    solveCmd.expectedResult = false;
-    oracle.clearAssumptions();
-    return std::nullopt;
+  auto analyzeSatResult(std::optional<bool>& expectedResult) -> Analysis
+  {
+    if (expectedResult == false) {
+      return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+    }
+
+    m_model.resize(m_maxVar);
+    m_sut.getModel(m_model);
+
+    // Check if all assumptions are heeded:
+    bool assumptionFailure = false;
+    for (auto assumption : m_assumptions) {
+      TBool const varVal = m_model[std::abs(assumption) - 1];
+      TBool const assumptionVal = assumption > 0 ? varVal : !varVal;
+      if (assumptionVal != t_true) {
+        assumptionFailure = true;
+        break;
+      }
+    }
+
+    if (!assumptionFailure && isModelValid()) {
+      expectedResult = true;
+      return std::nullopt;
+    }
+
+    // The model is invalid. Check if this is actually a SAT/UNSAT flip:
+    if (!getExpectedResult(expectedResult).has_value()) {
+      return std::nullopt;
+    }
+
+    if (*expectedResult) {
+      return TraceExecutionFailure::Reason::INVALID_MODEL;
+    }
+    else {
+      return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+    }
   }
 
-  oracle.solve(phaseStop, phaseStop + 1);
-  if (!solveCmd.expectedResult.has_value()) {
-    return std::nullopt;
+  auto analyzeUnsatResult(std::optional<bool>& expectedResult) -> Analysis
+  {
+    if (expectedResult == true) {
+      return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+    }
+
+    std::vector<CNFLit> failed;
+    m_sut.getFailed(m_assumptions, failed);
+
+    if (expectedResult == false && failed.size() == m_assumptions.size()) {
+      // The problem is known to be unsatisfiable under all assumptions
+      return std::nullopt;
+    }
+
+    TBool probeResult = getOracleBeforeSolve().probe(failed);
+    if (probeResult != t_true) {
+      expectedResult = false;
+      return std::nullopt;
+    }
+
+    if (!getExpectedResult(expectedResult).has_value()) {
+      return std::nullopt;
+    }
+
+    if (*expectedResult == false) {
+      return TraceExecutionFailure::Reason::INVALID_FAILED;
+    }
+    else {
+      return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+    }
   }
 
-  if (*(solveCmd.expectedResult) == false) {
-    return TraceExecutionFailure::Reason::INVALID_FAILED;
+  IPASIRSolver& m_sut;
+
+  CNFLit m_maxVar = 0;
+  std::vector<CNFLit> m_assumptions;
+
+  ClauseStore m_clauses;
+  std::vector<TBool> m_model;
+  std::vector<uint8_t> m_litIsTrue;
+};
+
+/**
+ * Result analyzer for traces stored in a FuzzTrace. The oracle is created and fed
+ * with the trace lazily, when it is needed for the first time.
+ */
+class ResultAnalyzerImpl final : public detail::ResultAnalyzer, private SolveResultChecker {
+public:
+  explicit ResultAnalyzerImpl(FuzzTrace::iterator traceStart, IPASIRSolver& sut)
+    : SolveResultChecker{sut}, m_oracleCursor{traceStart}
+  {
   }
-  else {
-    return TraceExecutionFailure::Reason::INCORRECT_RESULT;
+
+  auto analyzeResult(FuzzTrace::iterator phaseStart, FuzzTrace::iterator phaseStop)
+      -> Analysis override
+  {
+    assert(std::get_if<SolveCmd>(&*phaseStop) != nullptr);
+    collectPhaseData(phaseStart, phaseStop);
+
+    m_solveCmd = phaseStop;
+    return checkResult(std::get<SolveCmd>(*phaseStop).expectedResult);
   }
-}
 
-auto analyzeResult(FuzzTrace::iterator phaseStart,
-                   FuzzTrace::iterator phaseStop,
-                   IPASIRSolver& sut,
-                   Oracle& oracle) -> Analysis
-{
-  assert(std::get_if<SolveCmd>(&*phaseStop) != nullptr);
+private:
+  void collectPhaseData(FuzzTrace::iterator phaseStart, FuzzTrace::iterator phaseStop)
+  {
+    beginPhase();
+    for (FuzzTrace::iterator cmd = phaseStart; cmd != phaseStop; ++cmd) {
+      if (AddClauseCmd const* addClauseCmd = std::get_if<AddClauseCmd>(&*cmd);
+          addClauseCmd != nullptr) {
+        addClause(addClauseCmd->clauseToAdd);
+      }
+      else if (AssumeCmd const* assumeCmd = std::get_if<AssumeCmd>(&*cmd); assumeCmd != nullptr) {
+        addAssumptions(assumeCmd->assumptions);
+      }
+    }
+  }
 
-  IPASIRSolver::Result lastResult = sut.getLastSolveResult();
-  if (lastResult == IPASIRSolver::Result::UNKNOWN ||
-      lastResult == IPASIRSolver::Result::ILLEGAL_RESULT) {
-    return std::make_optional(TraceExecutionFailure::Reason::INVALID_RESULT);
+  /**
+   * Returns the oracle, containing all clauses and assumptions added before `stop`.
+   */
+  auto getOracleAt(FuzzTrace::iterator stop) -> Oracle&
+  {
+    if (m_oracle == nullptr) {
+      m_oracle = createOracle();
+    }
+    m_oracle->solve(m_oracleCursor, stop);
+    m_oracleCursor = stop;
+    return *m_oracle;
   }
 
-  // stop just before the solve call
-  oracle.solve(phaseStart, phaseStop);
+  auto getOracleBeforeSolve() -> Oracle& override { return getOracleAt(m_solveCmd); }
 
-  if (lastResult == IPASIRSolver::Result::SAT) {
-    return analyzeSatResult(phaseStop, sut, oracle);
+  auto determineExpectedResult() -> std::optional<bool> override
+  {
+    getOracleAt(m_solveCmd + 1);
+    return std::get<SolveCmd>(*m_solveCmd).expectedResult;
   }
-  else {
-    assert(lastResult == IPASIRSolver::Result::UNSAT);
-    return analyzeUnsatResult(phaseStop, sut, oracle);
+
+  std::unique_ptr<Oracle> m_oracle;
+  FuzzTrace::iterator m_oracleCursor;
+  FuzzTrace::iterator m_solveCmd;
+};
+
+/**
+ * Result analyzer for traces executed phase by phase. Since phases are discarded
+ * after their execution, the oracle is fed with each phase after it has been
+ * analyzed.
+ */
+class PhaseResultAnalyzerImpl final : public detail::PhaseResultAnalyzer,
+                                      private SolveResultChecker {
+public:
+  explicit PhaseResultAnalyzerImpl(IPASIRSolver& sut)
+    : SolveResultChecker{sut}, m_oracle{createOracle()}
+  {
   }
-}
-}
 
-auto executeTrace(FuzzTrace::iterator start, FuzzTrace::iterator stop, IPASIRSolver& sut)
-    -> std::optional<TraceExecutionFailure>
-{
-  std::unique_ptr<Oracle> oracle = createOracle();
-  FuzzTrace::iterator cursor = start;
+  auto analyzePhase(FlatFuzzTrace& phase) -> Analysis override
+  {
+    m_phase = &phase;
+    m_oracleCursor = 0;
 
-  while (cursor != stop) {
-    auto newCursor = applyTrace(cursor, stop, sut);
+    Analysis result;
+    if (!phase.empty() && phase[phase.size() - 1].getKind() == FlatFuzzTrace::CmdKind::SOLVE) {
+      m_solveCmdIdx = phase.size() - 1;
+      collectPhaseData(phase);
 
-    FuzzTrace::iterator prevCursor = cursor;
-    cursor = start + std::distance(FuzzTrace::const_iterator{start}, newCursor);
+      std::optional<bool> expectedResult = phase[m_solveCmdIdx].getExpectedResult();
+      result = checkResult(expectedResult);
+      phase.setExpectedResult(m_solveCmdIdx, expectedResult);
+    }
 
-    if (cursor != stop) {
-      assert(std::get_if<SolveCmd>(&*cursor) != nullptr);
+    if (!result.has_value()) {
+      m_oracle->solve(phase, m_oracleCursor, phase.size());
+    }
+    m_phase = nullptr;
+    return result;
+  }
 
-      Analysis analysis = analyzeResult(prevCursor, cursor, sut, *oracle);
-      if (analysis.has_value()) {
-        return TraceExecutionFailure{*analysis, cursor};
+private:
+  void collectPhaseData(FlatFuzzTrace const& phase)
+  {
+    beginPhase();
+    for (FlatFuzzTrace::CmdView cmd : phase) {
+      if (cmd.getKind() == FlatFuzzTrace::CmdKind::ADD_CLAUSE) {
+        addClause(cmd.getLits());
+      }
+      else if (cmd.getKind() == FlatFuzzTrace::CmdKind::ASSUME) {
+        addAssumptions(cmd.getLits());
       }
-
-      // Skip current solve cmd on next applyTrace
-      ++cursor;
     }
   }
 
-  return std::nullopt;
+  auto getOracleBeforeSolve() -> Oracle& override
+  {
+    m_oracle->solve(*m_phase, m_oracleCursor, m_solveCmdIdx);
+    m_oracleCursor = m_solveCmdIdx;
+    return *m_oracle;
+  }
+
+  auto determineExpectedResult() -> std::optional<bool> override
+  {
+    getOracleBeforeSolve();
+    m_oracle->solve(*m_phase, m_solveCmdIdx, m_solveCmdIdx + 1);
+    m_oracleCursor = m_solveCmdIdx + 1;
+    return (*m_phase)[m_solveCmdIdx].getExpectedResult();
+  }
+
+  std::unique_ptr<Oracle> m_oracle;
+  FlatFuzzTrace* m_phase = nullptr;
+  FlatFuzzTrace::size_type m_oracleCursor = 0;
+  FlatFuzzTrace::size_type m_solveCmdIdx = 0;
+};
 }
 
+namespace detail {
+auto createResultAnalyzer(FuzzTrace::iterator traceStart, IPASIRSolver& sut)
+    -> std::unique_ptr<ResultAnalyzer>
+{
+  return std::make_unique<ResultAnalyzerImpl>(traceStart, sut);
+}
+
+auto createPhaseResultAnalyzer(IPASIRSolver& sut) -> std::unique_ptr<PhaseResultAnalyzer>
+{
+  return std::make_unique<PhaseResultAnalyzerImpl>(sut);
+}
+}
 
-auto createTraceFilename(std::string const& fuzzerID, int run, TraceExecutionFailure::Reason kind)
+auto createTraceFilename(std::string const& fuzzerID,
+                         uint64_t run,
+                         TraceExecutionFailure::Reason kind)
     -> std::filesystem::path
 {
   std::stringstream formatter;
@@ -207,20 +482,29 @@ auto createTraceFilename(std::string const& fuzzerID, int run, TraceExecutionFai
   return formatter.str();
 }
 
-auto executeTraceWithDump(FuzzTrace::iterator start,
-                          FuzzTrace::iterator stop,
-                          IPASIRSolver& target,
-                          std::string const& fuzzerID,
-                          uint32_t runID) -> std::optional<TraceExecutionFailure>
+namespace detail {
+void storeFailureTrace(FuzzTrace::iterator start,
+                       TraceExecutionFailure const& failure,
+                       std::string const& filenamePrefix,
+                       uint64_t runID,
+                       TraceDumpOptions const& dumpOptions)
 {
-  auto failure = executeTrace(start, stop, target);
-
-  if (failure.has_value()) {
-    std::filesystem::path traceFilename = createTraceFilename(fuzzerID, runID, failure->reason);
-    auto iterBeyondFailingSolveCmd = ++(failure->solveCmd);
-    storeTrace(start, iterBeyondFailingSolveCmd, traceFilename);
-  }
-
-  return failure;
+  std::filesystem::path traceFilename = createTraceFilename(filenamePrefix, runID, failure.reason);
+  std::vector<std::byte> encodedTrace;
+  encodeTrace(start, std::next(failure.solveCmd), encodedTrace, dumpOptions.format);
+  writeTraceFile(traceFilename, encodedTrace, dumpOptions.fsyncPolicy);
 }
 }
+
+template auto executeTrace<IPASIRSolver>(FuzzTrace::iterator start,
+                                         FuzzTrace::iterator stop,
+                                         IPASIRSolver& sut) -> std::optional<TraceExecutionFailure>;
+
+template auto executeTraceWithDump<IPASIRSolver>(FuzzTrace::iterator start,
+                                                 FuzzTrace::iterator stop,
+                                                 IPASIRSolver& sut,
+                                                 std::string const& filenamePrefix,
+                                                 uint64_t runID,
+                                                 TraceDumpOptions const& dumpOptions)
+    -> std::optional<TraceExecutionFailure>;
+}
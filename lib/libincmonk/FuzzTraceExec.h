@@ -33,11 +33,20 @@
 
 #pragma once
 
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/Profiling.h>
+#include <libincmonk/TraceDumpWriter.h>
 
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <optional>
 #include <string>
+#include <type_traits>
+#include <variant>
 
 namespace incmonk {
 
@@ -67,12 +76,29 @@ struct TraceExecutionFailure {
  * \brief Executes the given trace `[start, stop)` on the solver under test, checking
  *   the results with the test oracle.
  * 
+ * Expected results of solve commands contained in the trace are assumed to be
+ * correct, e.g. computed in advance via Oracle::solve(). For solve commands without
+ * expected results, the result is determined via the test oracle if needed.
+ *
+ * `SolverT` is IPASIRSolver or a type derived from it. Instantiating this function
+ * with a `final` solver class (e.g. BoundIPASIRSolver) lets the compiler bind the
+ * IPASIR calls made while applying the trace statically.
+ *
  * \returns on failure: TraceExecutionFailure pointing to the failed solve command,
  *   otherwise nothing. Intedeterminate results are counted as incorrect results.
  */
-auto executeTrace(FuzzTrace::iterator start, FuzzTrace::iterator stop, IPASIRSolver& sut)
+template <typename SolverT>
+auto executeTrace(FuzzTrace::iterator start, FuzzTrace::iterator stop, SolverT& sut)
     -> std::optional<TraceExecutionFailure>;
 
+/**
+ * \brief Options for writing failure traces
+ */
+struct TraceDumpOptions {
+  TraceFormat format = TraceFormat::V1;
+  FsyncPolicy fsyncPolicy = FsyncPolicy::NEVER;
+};
+
 /**
  * \brief Executes the given trace using `executeTrace()`, writing the trace to disk
  *   on failure.
@@ -82,16 +108,174 @@ auto executeTrace(FuzzTrace::iterator start, FuzzTrace::iterator stop, IPASIRSol
  * \param sut             The solver under test
  * \param filenamePrefix  Arbitrary prefix for the trace filename
  * \param runID           The (arbitrary) ID of the execution.
+ * \param dumpOptions     The format of the trace file, and whether it is synced with the
+ *                        storage device
  * 
  * On failure, a file named `filenamePrefix`-`runID`-<X>.mtr is written to the current
  * working directory, with <X> being one of `satflip`, `invalidmodel`, `invalidfailed`,
- * `invalidresult` or `unknown`.
+ * `invalidresult` or `unknown`. The trace is encoded in memory and written with a
+ * single write call.
  * 
  * \returns see `executeTrace()`
  */
+template <typename SolverT>
+auto executeTraceWithDump(FuzzTrace::iterator start,
+                          FuzzTrace::iterator stop,
+                          SolverT& sut,
+                          std::string const& filenamePrefix,
+                          uint64_t runID,
+                          TraceDumpOptions const& dumpOptions = {})
+    -> std::optional<TraceExecutionFailure>;
+
+/**
+ * \brief Executes the trace read phase by phase from `source` on the solver under test,
+ *   checking the results with the test oracle.
+ *
+ * `PhaseSource` is a type with a member function `readNextPhase(FlatFuzzTrace&) -> bool`
+ * with the semantics of FlatFuzzTraceReader::readNextPhase(). Each phase is executed as
+ * soon as it has been read, and only the current phase is kept in memory. Since earlier
+ * phases are not available anymore when the oracle is needed, the oracle is fed with
+ * each phase after its execution.
+ *
+ * \returns on failure: the reason of the failure, otherwise nothing.
+ */
+template <typename PhaseSource, typename SolverT>
+auto executeTraceFromStream(PhaseSource& source, SolverT& sut)
+    -> std::optional<TraceExecutionFailure::Reason>;
+
+extern template auto executeTrace<IPASIRSolver>(FuzzTrace::iterator start,
+                                                FuzzTrace::iterator stop,
+                                                IPASIRSolver& sut)
+    -> std::optional<TraceExecutionFailure>;
+
+extern template auto executeTraceWithDump<IPASIRSolver>(FuzzTrace::iterator start,
+                                                        FuzzTrace::iterator stop,
+                                                        IPASIRSolver& sut,
+                                                        std::string const& filenamePrefix,
+                                                        uint64_t runID,
+                                                        TraceDumpOptions const& dumpOptions)
+    -> std::optional<TraceExecutionFailure>;
+
+
+// Implementation
+
+namespace detail {
+/**
+ * \brief Checker for the results of the solver under test, used by executeTrace().
+ */
+class ResultAnalyzer {
+public:
+  /**
+   * Checks the result of the SUT's solve call `phaseStop`. [phaseStart, phaseStop)
+   * are the commands executed since the previous solve call.
+   */
+  virtual auto analyzeResult(FuzzTrace::iterator phaseStart, FuzzTrace::iterator phaseStop)
+      -> std::optional<TraceExecutionFailure::Reason> = 0;
+
+  virtual ~ResultAnalyzer() = default;
+};
+
+auto createResultAnalyzer(FuzzTrace::iterator traceStart, IPASIRSolver& sut)
+    -> std::unique_ptr<ResultAnalyzer>;
+
+/**
+ * \brief Checker for the results of the solver under test, used by executeTraceFromStream().
+ */
+class PhaseResultAnalyzer {
+public:
+  /**
+   * Checks the result of the SUT's solve call if the last command of `phase` is a solve
+   * command, and stores the expected result in that command if it has been determined.
+   * `phase` contains the commands executed since the previous solve call. Afterwards,
+   * the phase may be discarded.
+   */
+  virtual auto analyzePhase(FlatFuzzTrace& phase)
+      -> std::optional<TraceExecutionFailure::Reason> = 0;
+
+  virtual ~PhaseResultAnalyzer() = default;
+};
+
+auto createPhaseResultAnalyzer(IPASIRSolver& sut) -> std::unique_ptr<PhaseResultAnalyzer>;
+
+void storeFailureTrace(FuzzTrace::iterator start,
+                       TraceExecutionFailure const& failure,
+                       std::string const& filenamePrefix,
+                       uint64_t runID,
+                       TraceDumpOptions const& dumpOptions);
+}
+
+template <typename SolverT>
+auto executeTrace(FuzzTrace::iterator start, FuzzTrace::iterator stop, SolverT& sut)
+    -> std::optional<TraceExecutionFailure>
+{
+  static_assert(std::is_base_of_v<IPASIRSolver, SolverT>);
+
+  std::unique_ptr<detail::ResultAnalyzer> analyzer = detail::createResultAnalyzer(start, sut);
+  FuzzTrace::iterator cursor = start;
+
+  while (cursor != stop) {
+    auto newCursor = applyTrace(cursor, stop, sut);
+
+    FuzzTrace::iterator prevCursor = cursor;
+    cursor = start + std::distance(FuzzTrace::const_iterator{start}, newCursor);
+
+    if (cursor != stop) {
+      assert(std::get_if<SolveCmd>(&*cursor) != nullptr);
+
+      std::optional<TraceExecutionFailure::Reason> analysis;
+      {
+        ProfileScope profileScope{ProfilePhase::SUT_CHECK};
+        analysis = analyzer->analyzeResult(prevCursor, cursor);
+      }
+      if (analysis.has_value()) {
+        return TraceExecutionFailure{*analysis, cursor};
+      }
+
+      // Skip current solve cmd on next applyTrace
+      ++cursor;
+    }
+  }
+
+  return std::nullopt;
+}
+
+template <typename SolverT>
 auto executeTraceWithDump(FuzzTrace::iterator start,
                           FuzzTrace::iterator stop,
-                          IPASIRSolver& sut,
+                          SolverT& sut,
                           std::string const& filenamePrefix,
-                          uint32_t runID) -> std::optional<TraceExecutionFailure>;
+                          uint64_t runID,
+                          TraceDumpOptions const& dumpOptions)
+    -> std::optional<TraceExecutionFailure>
+{
+  auto failure = executeTrace(start, stop, sut);
+
+  if (failure.has_value()) {
+    ProfileScope profileScope{ProfilePhase::TRACE_DUMP};
+    detail::storeFailureTrace(start, *failure, filenamePrefix, runID, dumpOptions);
+  }
+
+  return failure;
+}
+
+template <typename PhaseSource, typename SolverT>
+auto executeTraceFromStream(PhaseSource& source, SolverT& sut)
+    -> std::optional<TraceExecutionFailure::Reason>
+{
+  static_assert(std::is_base_of_v<IPASIRSolver, SolverT>);
+
+  std::unique_ptr<detail::PhaseResultAnalyzer> analyzer = detail::createPhaseResultAnalyzer(sut);
+  FlatFuzzTrace phase;
+
+  while (source.readNextPhase(phase)) {
+    applyTrace(phase.begin(), phase.end(), sut);
+
+    auto analysis = analyzer->analyzePhase(phase);
+    if (analysis.has_value()) {
+      return analysis;
+    }
+  }
+
+  return std::nullopt;
+}
 }
@@ -26,17 +26,33 @@
 
 #include <libincmonk/FuzzTracePrinters.h>
 
+#include <gsl/span>
+
 #include <algorithm>
 #include <optional>
+#include <sstream>
+#include <type_traits>
 #include <variant>
 
 namespace incmonk {
 namespace {
-auto toCommaSeparatedStr(std::vector<int> vec)
+template <typename Fn>
+auto visitCmd(FuzzCmd const& cmd, Fn&& fn)
+{
+  return std::visit(fn, cmd);
+}
+
+template <typename Fn>
+auto visitCmd(FlatFuzzTrace::CmdView const& cmd, Fn&& fn)
+{
+  return cmd.visit(fn);
+}
+
+auto toCommaSeparatedStr(gsl::span<CNFLit const> lits)
 {
   std::string result;
   bool first = true;
-  for (CNFLit lit : vec) {
+  for (CNFLit lit : lits) {
     if (!first) {
       result += ",";
     }
@@ -46,7 +62,7 @@ auto toCommaSeparatedStr(std::vector<int> vec)
   return result;
 }
 
-auto toString(std::string const& solverVarName, AddClauseCmd const& cmd) -> std::string
+auto toString(std::string const& solverVarName, AddClauseView const& cmd) -> std::string
 {
   if (cmd.clauseToAdd.empty()) {
     return "ipasir_add(" + solverVarName + ", 0);\n";
@@ -58,7 +74,12 @@ auto toString(std::string const& solverVarName, AddClauseCmd const& cmd) -> std:
   return result;
 }
 
-auto toString(std::string const& solverVarName, AssumeCmd const& cmd) -> std::string
+auto toString(std::string const& solverVarName, AddClauseCmd const& cmd) -> std::string
+{
+  return toString(solverVarName, AddClauseView{cmd.clauseToAdd});
+}
+
+auto toString(std::string const& solverVarName, AssumeView const& cmd) -> std::string
 {
   if (cmd.assumptions.empty()) {
     return "";
@@ -70,6 +91,11 @@ auto toString(std::string const& solverVarName, AssumeCmd const& cmd) -> std::st
   return result;
 }
 
+auto toString(std::string const& solverVarName, AssumeCmd const& cmd) -> std::string
+{
+  return toString(solverVarName, AssumeView{cmd.assumptions});
+}
+
 auto toString(std::string const& solverVarName, SolveCmd const& cmd) -> std::string
 {
   if (cmd.expectedResult.has_value()) {
@@ -93,59 +119,80 @@ auto toString(std::string const& solverVarName, HavocCmd const& cmd) -> std::str
     return "// havoc " + solverVarName + " with seed " + std::to_string(cmd.seed);
   }
 }
+
+template <typename CmdIter>
+void printCxxFunctionBody(CmdIter first,
+                          CmdIter last,
+                          std::string const& solverVarName,
+                          std::ostream& targetStream)
+{
+  for (CmdIter cmd = first; cmd != last; ++cmd) {
+    visitCmd(*cmd, [&](auto&& x) { targetStream << toString(solverVarName, x) << "\n"; });
+  }
+}
 }
 
 auto toCxxFunctionBody(FuzzTrace::const_iterator first,
                        FuzzTrace::const_iterator last,
                        std::string const& argName) -> std::string
 {
-  std::string result;
-  for (FuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
-    std::visit([&result, &argName](auto&& x) { result += toString(argName, x) + "\n"; }, *cmd);
-  }
-  return result;
+  std::ostringstream result;
+  printCxxFunctionBody(first, last, argName, result);
+  return result.str();
 }
 
-
-namespace {
-auto getMaxVar(CNFClause const& clause) -> std::optional<CNFLit>
+void toCxxFunctionBody(FuzzTrace::const_iterator first,
+                       FuzzTrace::const_iterator last,
+                       std::string const& solverName,
+                       std::ostream& targetStream)
 {
-  if (clause.empty()) {
-    return std::nullopt;
-  }
+  printCxxFunctionBody(first, last, solverName, targetStream);
+}
 
-  CNFClause tmp = clause;
-  std::transform(tmp.begin(), tmp.end(), tmp.begin(), [](CNFLit lit) { return std::abs(lit); });
-  return *(std::max_element(tmp.begin(), tmp.end()));
+void toCxxFunctionBody(MappedFuzzTrace::const_iterator first,
+                       MappedFuzzTrace::const_iterator last,
+                       std::string const& solverName,
+                       std::ostream& targetStream)
+{
+  printCxxFunctionBody(first, last, solverName, targetStream);
 }
 
-auto getMaxVar(FuzzTrace::const_iterator first, FuzzTrace::const_iterator last) -> CNFLit
+
+namespace {
+auto getMaxVar(gsl::span<CNFLit const> lits) -> CNFLit
 {
-  CNFLit maxVar = 0;
-  for (auto it = first; it != last; ++it) {
-    if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&*it); addClause != nullptr) {
-      maxVar = std::max(maxVar, getMaxVar(addClause->clauseToAdd).value_or(0));
-    }
-    else if (AssumeCmd const* assumeCmd = std::get_if<AssumeCmd>(&*it); assumeCmd != nullptr) {
-      maxVar = std::max(maxVar, getMaxVar(assumeCmd->assumptions).value_or(0));
-    }
+  CNFLit result = 0;
+  for (CNFLit lit : lits) {
+    result = std::max(result, std::abs(lit));
   }
-  return maxVar;
+  return result;
 }
 
-auto getNumClauses(FuzzTrace::const_iterator first, FuzzTrace::const_iterator last)
-    -> FuzzTrace::size_type
+struct ICNFHeader {
+  CNFLit maxVar = 0;
+  std::size_t numClauses = 0;
+};
+
+template <typename CmdIter>
+auto getICNFHeader(CmdIter first, CmdIter last) -> ICNFHeader
 {
-  FuzzTrace::size_type result = 0;
-  for (auto it = first; it != last; ++it) {
-    if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&*it); addClause != nullptr) {
-      ++result;
-    }
+  ICNFHeader result;
+  for (CmdIter it = first; it != last; ++it) {
+    visitCmd(*it, [&result](auto&& cmd) {
+      using CmdT = std::decay_t<decltype(cmd)>;
+      if constexpr (std::is_same_v<CmdT, AddClauseCmd> || std::is_same_v<CmdT, AddClauseView>) {
+        result.maxVar = std::max(result.maxVar, getMaxVar(cmd.clauseToAdd));
+        ++result.numClauses;
+      }
+      else if constexpr (std::is_same_v<CmdT, AssumeCmd> || std::is_same_v<CmdT, AssumeView>) {
+        result.maxVar = std::max(result.maxVar, getMaxVar(cmd.assumptions));
+      }
+    });
   }
   return result;
 }
 
-void printICNFClause(std::vector<CNFLit> const& clause, std::ostream& target)
+void printICNFClause(gsl::span<CNFLit const> clause, std::ostream& target)
 {
   for (CNFLit lit : clause) {
     target << lit << " ";
@@ -163,12 +210,24 @@ void printICNFFuzzCmd(SolveCmd const&,
   currentAssumptions.clear();
 }
 
-void printICNFFuzzCmd(AssumeCmd const& cmd, std::vector<CNFLit>& currentAssumptions, std::ostream&)
+void printICNFFuzzCmd(AssumeView const& cmd, std::vector<CNFLit>& currentAssumptions, std::ostream&)
 {
   currentAssumptions.insert(
       currentAssumptions.end(), cmd.assumptions.begin(), cmd.assumptions.end());
 }
 
+void printICNFFuzzCmd(AssumeCmd const& cmd,
+                      std::vector<CNFLit>& currentAssumptions,
+                      std::ostream& target)
+{
+  printICNFFuzzCmd(AssumeView{cmd.assumptions}, currentAssumptions, target);
+}
+
+void printICNFFuzzCmd(AddClauseView const& cmd, std::vector<CNFLit>&, std::ostream& target)
+{
+  printICNFClause(cmd.clauseToAdd, target);
+}
+
 void printICNFFuzzCmd(AddClauseCmd const& cmd, std::vector<CNFLit>&, std::ostream& target)
 {
   printICNFClause(cmd.clauseToAdd, target);
@@ -184,12 +243,18 @@ void printICNFFuzzCmd(HavocCmd const& cmd, std::vector<CNFLit>&, std::ostream& t
   }
 }
 
-void printICNFFuzzCmd(FuzzCmd const& cmd,
-                      std::vector<CNFLit>& currentAssumptions,
-                      std::ostream& target)
+template <typename CmdIter>
+void printICNF(CmdIter first, CmdIter last, std::ostream& targetStream)
 {
-  std::visit([&](auto&& concreteCmd) { printICNFFuzzCmd(concreteCmd, currentAssumptions, target); },
-             cmd);
+  ICNFHeader const header = getICNFHeader(first, last);
+  targetStream << "p inccnf " << header.maxVar << " " << header.numClauses << "\n";
+
+  std::vector<CNFLit> currentAssumptions;
+  for (CmdIter it = first; it != last; ++it) {
+    visitCmd(*it, [&](auto&& concreteCmd) {
+      printICNFFuzzCmd(concreteCmd, currentAssumptions, targetStream);
+    });
+  }
 }
 }
 
@@ -197,11 +262,13 @@ void toICNF(FuzzTrace::const_iterator first,
             FuzzTrace::const_iterator last,
             std::ostream& targetStream)
 {
-  targetStream << "p inccnf " << getMaxVar(first, last) << " " << getNumClauses(first, last)
-               << "\n";
-  std::vector<CNFLit> currentAssumptions;
-  for (auto it = first; it != last; ++it) {
-    printICNFFuzzCmd(*it, currentAssumptions, targetStream);
-  }
+  printICNF(first, last, targetStream);
+}
+
+void toICNF(MappedFuzzTrace::const_iterator first,
+            MappedFuzzTrace::const_iterator last,
+            std::ostream& targetStream)
+{
+  printICNF(first, last, targetStream);
+}
 }
-}
\ No newline at end of file
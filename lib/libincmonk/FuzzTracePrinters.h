@@ -27,12 +27,13 @@
 /**
  * \file
  * 
- * \brief Functions for printing FuzzTrace objects as C++ or ICNF
+ * \brief Functions for printing traces as C++ or ICNF
  */
 
 #pragma once
 
 #include <libincmonk/FuzzTrace.h>
+#include <libincmonk/MappedFuzzTrace.h>
 
 #include <ostream>
 #include <string>
@@ -55,6 +56,26 @@ auto toCxxFunctionBody(FuzzTrace::const_iterator first,
                        FuzzTrace::const_iterator last,
                        std::string const& solverName) -> std::string;
 
+/**
+ * \brief Translates the given trace to a corresponding C++11 function body, printing
+ *   it to `targetStream`
+ *
+ * See the string-returning variant of toCxxFunctionBody() for details.
+ */
+void toCxxFunctionBody(FuzzTrace::const_iterator first,
+                       FuzzTrace::const_iterator last,
+                       std::string const& solverName,
+                       std::ostream& targetStream);
+
+/**
+ * \brief Translates the given trace to a corresponding C++11 function body, printing
+ *   it to `targetStream` while decoding the trace
+ */
+void toCxxFunctionBody(MappedFuzzTrace::const_iterator first,
+                       MappedFuzzTrace::const_iterator last,
+                       std::string const& solverName,
+                       std::ostream& targetStream);
+
 
 /**
  * \brief Translates the given trace to a corresponding ICNF instance
@@ -67,4 +88,14 @@ auto toCxxFunctionBody(FuzzTrace::const_iterator first,
 void toICNF(FuzzTrace::const_iterator first,
             FuzzTrace::const_iterator last,
             std::ostream& targetStream);
+
+/**
+ * \brief Translates the given trace to a corresponding ICNF instance
+ *
+ * This function decodes the trace twice: once for computing the ICNF header, and once
+ * for printing the commands.
+ */
+void toICNF(MappedFuzzTrace::const_iterator first,
+            MappedFuzzTrace::const_iterator last,
+            std::ostream& targetStream);
 }
\ No newline at end of file
@@ -26,10 +26,12 @@
 
 #include "IPASIRSolver.h"
 
+#include "BoundIPASIRSolver.h"
 #include "CNF.h"
 
 #include <dlfcn.h>
 #include <filesystem>
+#include <vector>
 
 
 namespace incmonk {
@@ -64,117 +66,6 @@ void* checkedOpenDSO(std::filesystem::path const& path)
   }
   return result;
 }
-
-class IPASIRSolverImpl : public IPASIRSolver {
-
-public:
-  IPASIRSolverImpl(IPASIRSolverDSO const& dso) : m_dso{dso}
-  {
-    m_ipasirContext = m_dso.initFn();
-    // TODO: error handling when m_ipasircontext == nullptr
-  }
-
-  virtual ~IPASIRSolverImpl()
-  {
-    if (m_ipasirContext != nullptr) {
-      m_dso.releaseFn(m_ipasirContext);
-      m_ipasirContext = nullptr;
-    }
-  }
-
-  void addClause(CNFClause const& clause) override
-  {
-    for (CNFLit lit : clause) {
-      m_dso.addFn(m_ipasirContext, lit);
-    }
-    m_dso.addFn(m_ipasirContext, 0);
-  }
-
-  void assume(std::vector<CNFLit> const& assumptions) override
-  {
-    for (CNFLit a : assumptions) {
-      m_dso.assumeFn(m_ipasirContext, a);
-    }
-  }
-
-  auto solve() -> Result override
-  {
-    int result = m_dso.solveFn(m_ipasirContext);
-    if (result == 0) {
-      m_lastResult = Result::UNKNOWN;
-    }
-    else if (result == 10) {
-      m_lastResult = Result::SAT;
-    }
-    else if (result == 20) {
-      m_lastResult = Result::UNSAT;
-    }
-    else {
-      m_lastResult = Result::ILLEGAL_RESULT;
-    }
-    return m_lastResult;
-  }
-
-  auto getLastSolveResult() const noexcept -> Result override { return m_lastResult; }
-
-  auto getValue(CNFLit lit) const noexcept -> TBool override
-  {
-    int value = m_dso.valFn(m_ipasirContext, lit);
-
-    if (value == lit) {
-      return t_true;
-    }
-    else if (value == -lit) {
-      return t_false;
-    }
-    else if (value == 0) {
-      return t_indet;
-    }
-    else {
-      abort();
-    }
-  }
-
-  auto isFailed(CNFLit lit) const noexcept -> bool override
-  {
-    int result = m_dso.failedFn(m_ipasirContext, lit);
-    switch (result) {
-    case 0:
-      return false;
-    case 1:
-      return true;
-    default:
-      abort();
-    }
-  }
-
-  void configure(uint64_t) override
-  {
-    // Not implemented yet
-  }
-
-  void reinitializeWithHavoc(uint64_t seed) noexcept override
-  {
-    if (m_dso.havocInitFn != nullptr) {
-      m_dso.releaseFn(m_ipasirContext);
-      m_dso.havocInitFn(seed);
-      m_ipasirContext = m_dso.initFn();
-    }
-  }
-
-  void havoc(uint64_t seed) noexcept override
-  {
-    if (m_dso.havocFn != nullptr) {
-      m_dso.havocFn(m_ipasirContext, seed);
-    }
-  }
-
-
-private:
-  IPASIRSolverDSO m_dso;
-  void* m_ipasirContext = nullptr;
-  Result m_lastResult = Result::UNKNOWN;
-};
 }
 
 IPASIRSolverDSO::IPASIRSolverDSO(std::filesystem::path const& path)
@@ -193,11 +84,31 @@ IPASIRSolverDSO::IPASIRSolverDSO(std::filesystem::path const& path)
   , failedFn{checkedGetFn<IPASIRFailedFn>(m_dsoContext.get(), "ipasir_failed")}
   , havocInitFn{uncheckedGetFn<IncMonkIPASIRHavocInitFn>(m_dsoContext.get(), "incmonk_havoc_init")}
   , havocFn{uncheckedGetFn<IncMonkIPASIRHavocFn>(m_dsoContext.get(), "incmonk_havoc")}
+  , modelFn{uncheckedGetFn<IncMonkIPASIRModelFn>(m_dsoContext.get(), "incmonk_model")}
+  , failedBulkFn{uncheckedGetFn<IncMonkIPASIRFailedFn>(m_dsoContext.get(), "incmonk_failed")}
+{
+}
+
+void IPASIRSolver::getModel(gsl::span<TBool> result) const noexcept
 {
+  for (std::size_t idx = 0; idx < result.size(); ++idx) {
+    result[idx] = getValue(static_cast<CNFLit>(idx + 1));
+  }
+}
+
+void IPASIRSolver::getFailed(gsl::span<CNFLit const> assumptions,
+                             std::vector<CNFLit>& result) const
+{
+  result.clear();
+  for (CNFLit assumption : assumptions) {
+    if (isFailed(assumption)) {
+      result.push_back(assumption);
+    }
+  }
 }
 
 auto createIPASIRSolver(IPASIRSolverDSO const& dso) -> std::unique_ptr<IPASIRSolver>
 {
-  return std::make_unique<IPASIRSolverImpl>(dso);
+  return std::make_unique<BoundIPASIRSolver<IPASIRSolverDSO>>(dso);
 }
 }
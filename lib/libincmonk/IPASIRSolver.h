@@ -35,6 +35,10 @@
 #include <libincmonk/CNF.h>
 #include <libincmonk/TBool.h>
 
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
 #include <functional>
@@ -55,6 +59,8 @@ using IPASIRFailedFn = std::add_pointer_t<int(void*, int)>;
 
 using IncMonkIPASIRHavocInitFn = std::add_pointer_t<void(uint64_t)>;
 using IncMonkIPASIRHavocFn = std::add_pointer_t<void(void*, uint64_t)>;
+using IncMonkIPASIRModelFn = std::add_pointer_t<void(void*, int32_t, int8_t*)>;
+using IncMonkIPASIRFailedFn = std::add_pointer_t<void(void*, int32_t const*, size_t, int8_t*)>;
 
 class DSOLoadError : public std::runtime_error {
 public:
@@ -94,6 +100,8 @@ public:
 
   IncMonkIPASIRHavocInitFn const havocInitFn = nullptr;
   IncMonkIPASIRHavocFn const havocFn = nullptr;
+  IncMonkIPASIRModelFn const modelFn = nullptr;
+  IncMonkIPASIRFailedFn const failedBulkFn = nullptr;
 };
 
 
@@ -105,8 +113,8 @@ public:
   IPASIRSolver() = default;
   virtual ~IPASIRSolver() = default;
 
-  virtual void addClause(CNFClause const& clause) = 0;
-  virtual void assume(std::vector<CNFLit> const& assumptions) = 0;
+  virtual void addClause(gsl::span<CNFLit const> clause) = 0;
+  virtual void assume(gsl::span<CNFLit const> assumptions) = 0;
 
   enum class Result { SAT, UNSAT, UNKNOWN, ILLEGAL_RESULT };
 
@@ -115,6 +123,23 @@ public:
   virtual auto getValue(CNFLit lit) const noexcept -> TBool = 0;
   virtual auto isFailed(CNFLit lit) const noexcept -> bool = 0;
 
+  /**
+   * \brief Retrieves the values of the variables 1, ..., `result.size()`.
+   *
+   * After this function returns, `result[i]` contains the value of variable `i+1`.
+   * The default implementation calls `getValue()` for each variable.
+   */
+  virtual void getModel(gsl::span<TBool> result) const noexcept;
+
+  /**
+   * \brief Determines which of the given assumptions have failed.
+   *
+   * `result` is cleared and filled with the failed assumptions, in the order
+   * of `assumptions`. The default implementation calls `isFailed()` for each
+   * assumption.
+   */
+  virtual void getFailed(gsl::span<CNFLit const> assumptions, std::vector<CNFLit>& result) const;
+
   virtual void configure(uint64_t value) = 0;
   virtual void reinitializeWithHavoc(uint64_t seed) noexcept = 0;
   virtual void havoc(uint64_t seed) noexcept = 0;
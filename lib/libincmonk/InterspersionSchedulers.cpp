@@ -28,8 +28,16 @@
 
 #include <libincmonk/CNF.h>
 #include <libincmonk/FastRand.h>
+#include <libincmonk/FlatFuzzTrace.h>
+#include <libincmonk/FuzzCmdSource.h>
 #include <libincmonk/FuzzTrace.h>
+#include <libincmonk/Profiling.h>
 
+#include <gsl/span>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <random>
 
 
@@ -40,6 +48,204 @@ auto isBeginOfPhase(FuzzCmd const& cmd)
 {
   return std::get_if<SolveCmd>(&cmd) != nullptr;
 }
+
+auto isBeginOfPhase(FlatFuzzTrace::CmdView const& cmd)
+{
+  return cmd.getKind() == FlatFuzzTrace::CmdKind::SOLVE;
+}
+
+void reserveForInsertion(FlatFuzzTrace& result,
+                         FlatFuzzTrace const& input,
+                         std::size_t numExtraWordsPerCmd)
+{
+  result.reserve(input.size() + input.size() / 8,
+                 input.getArenaSize() + (input.size() / 8) * numExtraWordsPerCmd);
+}
+
+
+// Decides which commands to insert after each command of the input trace,
+// shared by the lazy and the FlatFuzzTrace implementations of insertSolveCmds()
+class SolveCmdSchedule {
+public:
+  struct Insertions {
+    std::optional<CNFLit> assumption;
+    bool solve = false;
+  };
+
+  SolveCmdSchedule(SolveCmdScheduleParams const& stochParams, CNFLit maxLit, uint64_t seed)
+    : m_rng{seed}
+    , m_assumptionVarDist{1, std::abs(maxLit)}
+    , m_solveCmds{seed + 1, stochParams.density}
+    , m_assumeCmds{seed + 2, stochParams.assumptionDensity}
+    , m_phasesWithAssumptions{seed + 2, stochParams.assumptionPhaseDensity}
+  {
+    m_assumptionInsertionActive = m_phasesWithAssumptions.next();
+  }
+
+  auto next(bool cmdBeginsPhase) -> Insertions
+  {
+    if (cmdBeginsPhase) {
+      m_assumptionInsertionActive = m_phasesWithAssumptions.next();
+    }
+
+    Insertions result;
+    if (m_assumptionInsertionActive && m_assumeCmds.next()) {
+      int32_t sign = 1 - m_assumptionSignDist(m_rng) * 2;
+      result.assumption = sign * m_assumptionVarDist(m_rng);
+    }
+    result.solve = m_solveCmds.next();
+    return result;
+  }
+
+private:
+  XorShiftRandomBitGenerator m_rng;
+  std::uniform_int_distribution<int> m_assumptionSignDist{0, 1};
+  std::uniform_int_distribution<CNFLit> m_assumptionVarDist;
+
+  RandomDensityEventSchedule m_solveCmds;
+  RandomDensityEventSchedule m_assumeCmds;
+  RandomDensityEventSchedule m_phasesWithAssumptions;
+  bool m_assumptionInsertionActive = false;
+};
+
+
+// Decides which havoc commands to insert after each command of the input trace,
+// shared by the lazy and the FlatFuzzTrace implementations of insertHavocCmds()
+class HavocCmdSchedule {
+public:
+  HavocCmdSchedule(HavocCmdScheduleParams const& stochParams, uint64_t seed)
+    : m_rng{seed}
+    , m_havocsWithinPhases{seed + 1, stochParams.density}
+    , m_phasesWithHavocs{seed + 2, stochParams.phaseDensity}
+    , m_preInitHavocCmd{m_havocValueDist(m_rng), true}
+  {
+    m_havocActive = m_phasesWithHavocs.next();
+  }
+
+  auto getPreInitHavocCmd() const noexcept -> HavocCmd { return m_preInitHavocCmd; }
+
+  auto next(bool cmdBeginsPhase) -> std::optional<HavocCmd>
+  {
+    if (cmdBeginsPhase) {
+      m_havocActive = m_phasesWithHavocs.next();
+    }
+
+    if (m_havocActive && m_havocsWithinPhases.next()) {
+      return HavocCmd{m_havocValueDist(m_rng), false};
+    }
+    return std::nullopt;
+  }
+
+private:
+  XorShiftRandomBitGenerator m_rng;
+  std::uniform_int_distribution<uint64_t> m_havocValueDist;
+  RandomDensityEventSchedule m_havocsWithinPhases;
+  RandomDensityEventSchedule m_phasesWithHavocs;
+  HavocCmd m_preInitHavocCmd;
+  bool m_havocActive = false;
+};
+
+
+class SolveCmdInserter final : public FuzzCmdSource {
+public:
+  SolveCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                   SolveCmdScheduleParams const& stochParams,
+                   CNFLit maxLit,
+                   uint64_t seed)
+    : m_source{std::move(source)}, m_schedule{stochParams, maxLit, seed}
+  {
+  }
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    if (m_pending.assumption.has_value()) {
+      target = AssumeCmd{{*m_pending.assumption}};
+      m_pending.assumption.reset();
+      return true;
+    }
+
+    if (m_pending.solve) {
+      target = SolveCmd{};
+      m_pending.solve = false;
+      return true;
+    }
+
+    if (m_sourceExhausted) {
+      return false;
+    }
+
+    if (m_source->readNext(target)) {
+      m_pending = m_schedule.next(isBeginOfPhase(target));
+      return true;
+    }
+
+    // The trace is terminated by a solve command
+    m_sourceExhausted = true;
+    target = SolveCmd{};
+    return true;
+  }
+
+private:
+  std::unique_ptr<FuzzCmdSource> m_source;
+  SolveCmdSchedule m_schedule;
+  SolveCmdSchedule::Insertions m_pending;
+  bool m_sourceExhausted = false;
+};
+
+
+class HavocCmdInserter final : public FuzzCmdSource {
+public:
+  HavocCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                   HavocCmdScheduleParams const& stochParams,
+                   uint64_t seed)
+    : m_source{std::move(source)}
+    , m_schedule{stochParams, seed}
+    , m_pendingHavocCmd{m_schedule.getPreInitHavocCmd()}
+  {
+  }
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    if (m_pendingHavocCmd.has_value()) {
+      target = *m_pendingHavocCmd;
+      m_pendingHavocCmd.reset();
+      return true;
+    }
+
+    if (m_sourceExhausted) {
+      return false;
+    }
+
+    if (m_source->readNext(target)) {
+      m_pendingHavocCmd = m_schedule.next(isBeginOfPhase(target));
+      return true;
+    }
+
+    m_sourceExhausted = true;
+    return false;
+  }
+
+private:
+  std::unique_ptr<FuzzCmdSource> m_source;
+  HavocCmdSchedule m_schedule;
+  std::optional<HavocCmd> m_pendingHavocCmd;
+  bool m_sourceExhausted = false;
+};
+}
+
+auto createSolveCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                            SolveCmdScheduleParams const& stochParams,
+                            CNFLit maxLit,
+                            uint64_t seed) -> std::unique_ptr<FuzzCmdSource>
+{
+  return std::make_unique<SolveCmdInserter>(std::move(source), stochParams, maxLit, seed);
+}
+
+auto createHavocCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                            HavocCmdScheduleParams const& stochParams,
+                            uint64_t seed) -> std::unique_ptr<FuzzCmdSource>
+{
+  return std::make_unique<HavocCmdInserter>(std::move(source), stochParams, seed);
 }
 
 auto insertSolveCmds(FuzzTrace&& trace,
@@ -47,62 +253,75 @@ auto insertSolveCmds(FuzzTrace&& trace,
                      CNFLit maxLit,
                      uint64_t seed) -> FuzzTrace
 {
-  XorShiftRandomBitGenerator rng{seed};
-  std::uniform_int_distribution<int> assumptionSignDist{0, 1};
-  std::uniform_int_distribution<CNFLit> assumptionVarDist{1, std::abs(maxLit)};
-
-  RandomDensityEventSchedule solveCmds{seed + 1, stochParams.density};
-  RandomDensityEventSchedule assumeCmds{seed + 2, stochParams.assumptionDensity};
-  RandomDensityEventSchedule phasesWithAssumptions{seed + 2, stochParams.assumptionPhaseDensity};
+  ProfileScope profileScope{ProfilePhase::INSERT_SOLVE_CMDS};
 
   FuzzTrace result;
+  result.reserve(trace.size() + trace.size() / 8);
+  std::unique_ptr<FuzzCmdSource> source =
+      createSolveCmdInserter(createFuzzCmdSource(std::move(trace)), stochParams, maxLit, seed);
+  appendCmds(*source, result);
+  return result;
+}
 
-  bool assumptionInsertionActive = phasesWithAssumptions.next();
-  for (FuzzTrace::size_type idx = 0, end = trace.size(); idx < end; ++idx) {
-    if (isBeginOfPhase(trace[idx])) {
-      assumptionInsertionActive = phasesWithAssumptions.next();
-    }
+auto insertSolveCmds(FlatFuzzTrace const& trace,
+                     SolveCmdScheduleParams const& stochParams,
+                     CNFLit maxLit,
+                     uint64_t seed) -> FlatFuzzTrace
+{
+  ProfileScope profileScope{ProfilePhase::INSERT_SOLVE_CMDS};
 
-    result.push_back(std::move(trace[idx]));
-    if (assumptionInsertionActive && assumeCmds.next()) {
-      int32_t sign = 1 - assumptionSignDist(rng) * 2;
-      CNFLit assumption = sign * assumptionVarDist(rng);
-      result.push_back(AssumeCmd{{assumption}});
+  SolveCmdSchedule schedule{stochParams, maxLit, seed};
+  FlatFuzzTrace result;
+  reserveForInsertion(result, trace, 1);
+
+  for (FlatFuzzTrace::CmdView const& cmd : trace) {
+    SolveCmdSchedule::Insertions const insertions = schedule.next(isBeginOfPhase(cmd));
+    result.push_back(cmd);
+    if (insertions.assumption.has_value()) {
+      CNFLit const assumption = *insertions.assumption;
+      result.assume(gsl::span<CNFLit const>{&assumption, 1});
     }
-    if (solveCmds.next()) {
-      result.push_back(SolveCmd{});
+    if (insertions.solve) {
+      result.solve();
     }
   }
 
-  result.push_back(SolveCmd{});
+  result.solve();
   return result;
 }
 
-
 auto insertHavocCmds(FuzzTrace&& trace, HavocCmdScheduleParams const& stochParams, uint64_t seed)
     -> FuzzTrace
 {
-  XorShiftRandomBitGenerator rng{seed};
-  std::uniform_int_distribution<uint64_t> havocValueDist;
-  RandomDensityEventSchedule havocsWithinPhases{seed + 1, stochParams.density};
-  RandomDensityEventSchedule phasesWithHavocs{seed + 2, stochParams.phaseDensity};
+  ProfileScope profileScope{ProfilePhase::INSERT_HAVOC_CMDS};
 
   FuzzTrace result;
-  result.push_back(HavocCmd{havocValueDist(rng), true});
+  result.reserve(trace.size() + trace.size() / 8);
+  std::unique_ptr<FuzzCmdSource> source =
+      createHavocCmdInserter(createFuzzCmdSource(std::move(trace)), stochParams, seed);
+  appendCmds(*source, result);
+  return result;
+}
 
-  bool havocActive = phasesWithHavocs.next();
-  for (FuzzTrace::size_type idx = 0, end = trace.size(); idx < end; ++idx) {
-    if (isBeginOfPhase(trace[idx])) {
-      havocActive = phasesWithHavocs.next();
-    }
+auto insertHavocCmds(FlatFuzzTrace const& trace,
+                     HavocCmdScheduleParams const& stochParams,
+                     uint64_t seed) -> FlatFuzzTrace
+{
+  ProfileScope profileScope{ProfilePhase::INSERT_HAVOC_CMDS};
+
+  HavocCmdSchedule schedule{stochParams, seed};
+  FlatFuzzTrace result;
+  reserveForInsertion(result, trace, 2);
+  result.push_back(schedule.getPreInitHavocCmd());
 
-    result.push_back(std::move(trace[idx]));
-    if (havocActive && havocsWithinPhases.next()) {
-      result.push_back(HavocCmd{havocValueDist(rng), false});
+  for (FlatFuzzTrace::CmdView const& cmd : trace) {
+    std::optional<HavocCmd> const havocCmd = schedule.next(isBeginOfPhase(cmd));
+    result.push_back(cmd);
+    if (havocCmd.has_value()) {
+      result.push_back(*havocCmd);
     }
   }
 
   return result;
 }
-
-}
\ No newline at end of file
+}
@@ -29,14 +29,21 @@
  * 
  * \brief Functions for adding solve, assume and havoc commands to FuzzTrace objects,
  *   used by FuzzTrace generators
+ *
+ * The commands can be inserted into complete traces (insertSolveCmds(), insertHavocCmds()),
+ * or lazily into traces produced by a FuzzCmdSource (createSolveCmdInserter(),
+ * createHavocCmdInserter()). Both variants insert the same commands for equal arguments.
  */
 
 #pragma once
 
+#include <libincmonk/FlatFuzzTrace.h>
+#include <libincmonk/FuzzCmdSource.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/StochasticsUtils.h>
 
 #include <cstdint>
+#include <memory>
 
 namespace incmonk {
 
@@ -69,6 +76,27 @@ auto insertSolveCmds(FuzzTrace&& trace,
                      CNFLit maxLit,
                      uint64_t seed) -> FuzzTrace;
 
+/**
+ * \brief FlatFuzzTrace variant of insertSolveCmds(), inserting the same commands as
+ *   the FuzzTrace variant for equal arguments
+ */
+auto insertSolveCmds(FlatFuzzTrace const& trace,
+                     SolveCmdScheduleParams const& stochParams,
+                     CNFLit maxLit,
+                     uint64_t seed) -> FlatFuzzTrace;
+
+/**
+ * \brief Creates a FuzzCmdSource producing the commands of `source` interspersed
+ *   with random assume and solve commands.
+ *
+ * Commands are read from `source` on demand. The produced trace is equal to the result
+ * of insertSolveCmds() for the trace produced by `source`, given equal parameters.
+ */
+auto createSolveCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                            SolveCmdScheduleParams const& stochParams,
+                            CNFLit maxLit,
+                            uint64_t seed) -> std::unique_ptr<FuzzCmdSource>;
+
 
 struct HavocCmdScheduleParams {
   /// Density of havoc commands within phases (solve-to-solve regions
@@ -92,4 +120,23 @@ struct HavocCmdScheduleParams {
  */
 auto insertHavocCmds(FuzzTrace&& trace, HavocCmdScheduleParams const& stochParams, uint64_t seed)
     -> FuzzTrace;
-}
\ No newline at end of file
+
+/**
+ * \brief FlatFuzzTrace variant of insertHavocCmds(), inserting the same commands as
+ *   the FuzzTrace variant for equal arguments
+ */
+auto insertHavocCmds(FlatFuzzTrace const& trace,
+                     HavocCmdScheduleParams const& stochParams,
+                     uint64_t seed) -> FlatFuzzTrace;
+
+/**
+ * \brief Creates a FuzzCmdSource producing the commands of `source` interspersed
+ *   with random havoc commands, starting with a pre-init havoc command.
+ *
+ * Commands are read from `source` on demand. The produced trace is equal to the result
+ * of insertHavocCmds() for the trace produced by `source`, given equal parameters.
+ */
+auto createHavocCmdInserter(std::unique_ptr<FuzzCmdSource> source,
+                            HavocCmdScheduleParams const& stochParams,
+                            uint64_t seed) -> std::unique_ptr<FuzzCmdSource>;
+}
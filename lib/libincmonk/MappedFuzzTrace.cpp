@@ -0,0 +1,202 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/MappedFuzzTrace.h>
+
+#include <libincmonk/TraceFileFormat.h>
+
+#include <gsl/gsl_util>
+
+#include <cassert>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace incmonk {
+MappedFuzzTrace::MappedFuzzTrace(std::filesystem::path const& filename,
+                                 LoaderStrictness strictness)
+  : m_strictness{strictness}
+{
+  int const fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw IOException{"Could not open file " + filename.string()};
+  }
+  auto closeFd = gsl::finally([fd]() { close(fd); });
+
+  struct stat fileStatus;
+  if (fstat(fd, &fileStatus) != 0 || !S_ISREG(fileStatus.st_mode)) {
+    throw IOException{"Could not map file " + filename.string()};
+  }
+
+  m_size = static_cast<std::size_t>(fileStatus.st_size);
+  if (m_size > 0) {
+    void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      throw IOException{"Could not map file " + filename.string()};
+    }
+    madvise(mapping, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<std::byte const*>(mapping);
+  }
+
+  detail::MemoryReader input{m_data, m_data + m_size};
+  detail::TraceDecoderState decoderState;
+  decoderState.strictness = strictness;
+  if (!detail::readMagicCookie(input, decoderState) && strictness == LoaderStrictness::STRICT) {
+    unmap();
+    throw IOException{"Bad file format: magic cookie not found"};
+  }
+  m_firstCmdOffset = input.getCursor() - m_data;
+  m_format = decoderState.format;
+}
+
+MappedFuzzTrace::~MappedFuzzTrace()
+{
+  unmap();
+}
+
+MappedFuzzTrace::MappedFuzzTrace(MappedFuzzTrace&& rhs) noexcept
+  : m_data{rhs.m_data}
+  , m_size{rhs.m_size}
+  , m_firstCmdOffset{rhs.m_firstCmdOffset}
+  , m_strictness{rhs.m_strictness}
+  , m_format{rhs.m_format}
+{
+  rhs.m_data = nullptr;
+  rhs.m_size = 0;
+  rhs.m_firstCmdOffset = 0;
+}
+
+auto MappedFuzzTrace::operator=(MappedFuzzTrace&& rhs) noexcept -> MappedFuzzTrace&
+{
+  if (this != &rhs) {
+    unmap();
+    m_data = rhs.m_data;
+    m_size = rhs.m_size;
+    m_firstCmdOffset = rhs.m_firstCmdOffset;
+    m_strictness = rhs.m_strictness;
+    m_format = rhs.m_format;
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+    rhs.m_firstCmdOffset = 0;
+  }
+  return *this;
+}
+
+void MappedFuzzTrace::unmap() noexcept
+{
+  if (m_data != nullptr) {
+    munmap(const_cast<std::byte*>(m_data), m_size);
+    m_data = nullptr;
+  }
+}
+
+auto MappedFuzzTrace::begin() const -> const_iterator
+{
+  detail::TraceDecoderState decoderState;
+  decoderState.strictness = m_strictness;
+  decoderState.format = m_format;
+  return const_iterator{m_data + m_firstCmdOffset, m_data + m_size, decoderState};
+}
+
+auto MappedFuzzTrace::end() const noexcept -> const_iterator
+{
+  return const_iterator{};
+}
+
+
+MappedFuzzTrace::const_iterator::const_iterator(std::byte const* cursor,
+                                                std::byte const* end,
+                                                detail::TraceDecoderState decoderState)
+  : m_cmdBegin{cursor}, m_cursor{cursor}, m_end{end}, m_decoderState{decoderState}
+{
+  decodeNextCmd();
+}
+
+void MappedFuzzTrace::const_iterator::decodeNextCmd()
+{
+  m_currentCmd.clear();
+  m_cmdBegin = m_cursor;
+
+  detail::MemoryReader input{m_cursor, m_end};
+  try {
+    detail::readFuzzCmd(input, m_decoderState, m_litBuffer, m_currentCmd);
+    m_cursor = input.getCursor();
+  }
+  catch (IOException const&) {
+    m_cursor = m_end;
+    if (m_decoderState.strictness == LoaderStrictness::STRICT) {
+      throw;
+    }
+  }
+}
+
+auto MappedFuzzTrace::const_iterator::operator*() const noexcept -> FlatFuzzTrace::CmdView
+{
+  assert(!m_currentCmd.empty());
+  return m_currentCmd[0];
+}
+
+auto MappedFuzzTrace::const_iterator::operator++() -> const_iterator&
+{
+  assert(!m_currentCmd.empty());
+  decodeNextCmd();
+  return *this;
+}
+
+auto MappedFuzzTrace::const_iterator::operator++(int) -> const_iterator
+{
+  const_iterator result = *this;
+  ++(*this);
+  return result;
+}
+
+auto MappedFuzzTrace::const_iterator::operator==(const_iterator const& rhs) const noexcept -> bool
+{
+  if (m_currentCmd.empty() || rhs.m_currentCmd.empty()) {
+    return m_currentCmd.empty() && rhs.m_currentCmd.empty();
+  }
+  // Commands in runs of solve commands share their encoding:
+  return m_cmdBegin == rhs.m_cmdBegin &&
+         m_decoderState.remainingRunLength == rhs.m_decoderState.remainingRunLength;
+}
+
+auto MappedFuzzTrace::const_iterator::operator!=(const_iterator const& rhs) const noexcept -> bool
+{
+  return !(*this == rhs);
+}
+
+
+auto toFuzzTrace(MappedFuzzTrace::const_iterator first, MappedFuzzTrace::const_iterator last)
+    -> FuzzTrace
+{
+  FuzzTrace result;
+  for (MappedFuzzTrace::const_iterator cmd = first; cmd != last; ++cmd) {
+    result.push_back((*cmd).toFuzzCmd());
+  }
+  return result;
+}
+}
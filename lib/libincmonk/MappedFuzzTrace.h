@@ -0,0 +1,145 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ * 
+ * \brief Lazily decoded traces backed by memory-mapped trace files
+ */
+
+#pragma once
+
+#include <libincmonk/FlatFuzzTrace.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/TraceFileFormat.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+
+namespace incmonk {
+
+/**
+ * \brief Read-only view of a trace file, decoding the commands on demand.
+ *
+ * The trace file is mapped into memory, and commands are decoded directly from the
+ * mapped bytes while iterating over the trace. Thus, large traces can be processed
+ * without reading them into a FuzzTrace.
+ *
+ * With STRICT loader strictness, the magic cookie is checked when the object is
+ * constructed, and malformed commands are reported by the iterators when they reach
+ * them. With PERMISSIVE strictness, any byte sequence is interpreted as a trace,
+ * ending at the first malformed command (see loadTrace()).
+ */
+class MappedFuzzTrace {
+public:
+  class const_iterator;
+
+  /**
+   * \brief Maps the given trace file into memory.
+   *
+   * \throws IOException if the file cannot be mapped, or with STRICT strictness, if
+   *   the file does not start with a valid magic cookie.
+   */
+  explicit MappedFuzzTrace(std::filesystem::path const& filename,
+                           LoaderStrictness strictness = LoaderStrictness::STRICT);
+  ~MappedFuzzTrace();
+
+  /**
+   * \throws IOException with STRICT strictness if the first command is malformed
+   */
+  auto begin() const -> const_iterator;
+  auto end() const noexcept -> const_iterator;
+
+  MappedFuzzTrace(MappedFuzzTrace&& rhs) noexcept;
+  auto operator=(MappedFuzzTrace&& rhs) noexcept -> MappedFuzzTrace&;
+  MappedFuzzTrace(MappedFuzzTrace const&) = delete;
+  auto operator=(MappedFuzzTrace const&) -> MappedFuzzTrace& = delete;
+
+private:
+  void unmap() noexcept;
+
+  std::byte const* m_data = nullptr;
+  std::size_t m_size = 0;
+  std::size_t m_firstCmdOffset = 0;
+  LoaderStrictness m_strictness;
+  TraceFormat m_format = TraceFormat::V1;
+};
+
+
+/**
+ * \brief Iterator over the commands of a MappedFuzzTrace
+ *
+ * The command views obtained via operator* remain valid until the iterator is
+ * modified or destroyed. Each iterator holds a decoding buffer, which is reused
+ * for all commands it passes, so advancing an iterator does not allocate memory
+ * after a few steps.
+ */
+class MappedFuzzTrace::const_iterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = FlatFuzzTrace::CmdView;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = FlatFuzzTrace::CmdView;
+
+  const_iterator() = default;
+
+  auto operator*() const noexcept -> FlatFuzzTrace::CmdView;
+
+  /**
+   * \throws IOException with STRICT strictness if the next command is malformed
+   */
+  auto operator++() -> const_iterator&;
+  auto operator++(int) -> const_iterator;
+
+  auto operator==(const_iterator const& rhs) const noexcept -> bool;
+  auto operator!=(const_iterator const& rhs) const noexcept -> bool;
+
+private:
+  friend class MappedFuzzTrace;
+  const_iterator(std::byte const* cursor,
+                 std::byte const* end,
+                 detail::TraceDecoderState decoderState);
+
+  void decodeNextCmd();
+
+  std::byte const* m_cmdBegin = nullptr;
+  std::byte const* m_cursor = nullptr;
+  std::byte const* m_end = nullptr;
+  detail::TraceDecoderState m_decoderState;
+
+  // Contains the current command, or is empty if the iterator is a past-the-end iterator
+  FlatFuzzTrace m_currentCmd;
+  std::vector<CNFLit> m_litBuffer;
+};
+
+/**
+ * \brief Decodes the trace [first, last) into a FuzzTrace
+ */
+auto toFuzzTrace(MappedFuzzTrace::const_iterator first, MappedFuzzTrace::const_iterator last)
+    -> FuzzTrace;
+}
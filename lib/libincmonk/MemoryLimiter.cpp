@@ -0,0 +1,191 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/MemoryLimiter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace incmonk {
+
+struct MemoryLimiter::SharedState {
+  std::atomic<uint32_t> exhausted{0};
+  std::atomic<uint64_t> traceIdx{0};
+};
+
+namespace {
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Memory limiter state must be accessible from signal handlers");
+
+/// The memory limiter state of the current child process, accessed by the handlers
+std::atomic<MemoryLimiter::SharedState*> activeState{nullptr};
+
+/// The address space limit of the current child process
+std::atomic<uint64_t> addressSpaceLimit{0};
+
+/// The amount of address space left below which failed allocations are attributed to the limit
+std::atomic<uint64_t> exhaustionHeadroom{0};
+
+std::atomic<uint64_t> pageSize{0};
+
+/**
+ * Returns the size of the current process's address space. Only async-signal-safe
+ * functions are used, since this function is called from signal handlers.
+ */
+auto getAddressSpaceSize() noexcept -> std::optional<uint64_t>
+{
+  int fd = open("/proc/self/statm", O_RDONLY);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  char buffer[64];
+  ssize_t const numBytesRead = read(fd, buffer, sizeof(buffer));
+  close(fd);
+
+  // The first field of statm is the address space size in pages
+  uint64_t numPages = 0;
+  ssize_t idx = 0;
+  for (; idx < numBytesRead && buffer[idx] >= '0' && buffer[idx] <= '9'; ++idx) {
+    numPages = 10 * numPages + static_cast<uint64_t>(buffer[idx] - '0');
+  }
+
+  if (idx == 0) {
+    return std::nullopt;
+  }
+  return numPages * pageSize.load();
+}
+
+void markExhausted() noexcept
+{
+  MemoryLimiter::SharedState* state = activeState.load();
+  if (state != nullptr) {
+    state->exhausted.store(1);
+  }
+}
+
+void handleAllocationFailure()
+{
+  markExhausted();
+  _exit(EXIT_FAILURE);
+}
+
+/**
+ * Returns true iff the current crash is most likely caused by an allocation failing due to
+ * the address space limit: malloc() and mmap() set errno to ENOMEM when they fail, with the
+ * crash typically following immediately. Since ENOMEM may also stem from an earlier handled
+ * failure, the address space additionally needs to be close to the limit.
+ */
+auto isCrashDueToExhaustion(int crashErrno) noexcept -> bool
+{
+  if (crashErrno != ENOMEM) {
+    return false;
+  }
+  std::optional<uint64_t> const size = getAddressSpaceSize();
+  return size.has_value() && *size + exhaustionHeadroom.load() >= addressSpaceLimit.load();
+}
+
+extern "C" void handleCrash(int signalNumber)
+{
+  if (isCrashDueToExhaustion(errno)) {
+    markExhausted();
+  }
+
+  // The handler has been reset to the default action, which is now taken:
+  raise(signalNumber);
+}
+}
+
+MemoryLimiter::MemoryLimiter(uint64_t limit) : m_limit{limit}
+{
+}
+
+MemoryLimiter::~MemoryLimiter() = default;
+
+void MemoryLimiter::reset() noexcept
+{
+  m_state.get().exhausted.store(0);
+  m_state.get().traceIdx.store(0);
+}
+
+auto MemoryLimiter::getExhaustingTraceIdx() const noexcept -> std::optional<std::size_t>
+{
+  if (m_state.get().exhausted.load() == 0) {
+    return std::nullopt;
+  }
+  return m_state.get().traceIdx.load();
+}
+
+auto MemoryLimiter::getLimit() const noexcept -> uint64_t
+{
+  return m_limit;
+}
+
+void MemoryLimiter::enforce() noexcept
+{
+  activeState.store(&m_state.get());
+  pageSize.store(static_cast<uint64_t>(sysconf(_SC_PAGESIZE)));
+
+  uint64_t limit = getAddressSpaceSize().value_or(0) + m_limit;
+  rlimit currentLimit;
+  if (getrlimit(RLIMIT_AS, &currentLimit) == 0 && currentLimit.rlim_max != RLIM_INFINITY) {
+    limit = std::min(limit, static_cast<uint64_t>(currentLimit.rlim_max));
+  }
+  rlimit newLimit;
+  newLimit.rlim_cur = limit;
+  newLimit.rlim_max = limit;
+  setrlimit(RLIMIT_AS, &newLimit);
+
+  addressSpaceLimit.store(limit);
+  exhaustionHeadroom.store(m_limit / 4);
+
+  std::set_new_handler(handleAllocationFailure);
+
+  struct sigaction signalAction;
+  memset(&signalAction, 0, sizeof(signalAction));
+  signalAction.sa_handler = handleCrash;
+  signalAction.sa_flags = SA_RESETHAND;
+  for (int signalNumber : {SIGSEGV, SIGBUS, SIGABRT}) {
+    sigaction(signalNumber, &signalAction, nullptr);
+  }
+}
+
+void MemoryLimiter::beginTrace(std::size_t traceIdx) noexcept
+{
+  // Allocation failures that occurred before this trace must not be attributed to it
+  errno = 0;
+  m_state.get().traceIdx.store(traceIdx);
+}
+}
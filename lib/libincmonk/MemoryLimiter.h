@@ -0,0 +1,102 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Memory limits for child processes, with detection of memory exhaustion
+ */
+
+#pragma once
+
+#include <libincmonk/SharedObject.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace incmonk {
+
+/**
+ * \brief Limits the address space of child processes and detects when it is exhausted.
+ *
+ * The limiter's state is kept in memory shared with the child processes, so the
+ * limiter must be created before the child processes (or a fork server) are created.
+ * Child processes call enforce() once before executing traces, and beginTrace()
+ * before executing each trace.
+ *
+ * Memory exhaustion is detected when an allocation via `new` fails, in which case the
+ * child process is terminated with EXIT_FAILURE. Allocation failures of `malloc` cannot
+ * be intercepted, but typically cause the process to crash: when a child process
+ * receives SIGSEGV, SIGBUS or SIGABRT while `errno` is ENOMEM (as set by a failing
+ * `malloc` or `mmap`) in the crashing thread and less than a quarter of the limit is
+ * left, the crash is attributed to memory exhaustion as well. All other crashes are
+ * regular crashes.
+ */
+class MemoryLimiter {
+public:
+  /**
+   * \param limit   The number of bytes by which the address space of a child process may
+   *                grow beyond its size at the time enforce() is called.
+   *
+   * \throws std::runtime_error when the shared memory could not be created.
+   */
+  explicit MemoryLimiter(uint64_t limit);
+  ~MemoryLimiter();
+
+  /**
+   * \brief Resets the memory exhaustion information. Called in the parent process before
+   *   each child process execution.
+   */
+  void reset() noexcept;
+
+  /**
+   * \brief Returns the index of the trace (as passed to beginTrace()) which exhausted the
+   *   memory in the last child process, if any.
+   */
+  auto getExhaustingTraceIdx() const noexcept -> std::optional<std::size_t>;
+
+  auto getLimit() const noexcept -> uint64_t;
+
+  /**
+   * \brief Limits the address space of the current process and installs the handlers
+   *   detecting memory exhaustion. Only to be called in child processes.
+   */
+  void enforce() noexcept;
+
+  /// \brief Begins the execution of the trace with index `traceIdx` in a child process.
+  void beginTrace(std::size_t traceIdx) noexcept;
+
+  MemoryLimiter(MemoryLimiter const&) = delete;
+  auto operator=(MemoryLimiter const&) -> MemoryLimiter& = delete;
+
+  struct SharedState;
+
+private:
+  SharedObject<SharedState> m_state;
+  uint64_t m_limit = 0;
+};
+}
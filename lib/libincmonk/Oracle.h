@@ -33,6 +33,7 @@
 
 #pragma once
 
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/TBool.h>
 
@@ -54,6 +55,14 @@ public:
    */
   virtual void solve(FuzzTrace::iterator start, FuzzTrace::iterator stop) = 0;
 
+  /**
+   * \brief Fills in the expected results in the solve commands of `trace` with
+   *   indices in [start, stop)
+   */
+  virtual void solve(FlatFuzzTrace& trace,
+                     FlatFuzzTrace::size_type start,
+                     FlatFuzzTrace::size_type stop) = 0;
+
   /**
    * \brief Checks whether the problem so far added to the oracle is satisfiable
    *        under the assumptions `assumptions`.
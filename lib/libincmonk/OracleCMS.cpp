@@ -31,11 +31,14 @@
  */
 
 #include <libincmonk/Oracle.h>
+#include <libincmonk/Profiling.h>
 
 #include <cryptominisat5/cryptominisat.h>
 
 #include <algorithm>
 #include <map>
+#include <optional>
+#include <vector>
 
 namespace incmonk {
 namespace {
@@ -64,37 +67,43 @@ public:
     }
   }
 
-  void executeTraceCommand(AddClauseCmd const& cmd)
+  void addClauseToSolver(gsl::span<CNFLit const> clause)
   {
-    std::vector<CMSat::Lit> clause;
-
-    for (CNFLit lit : cmd.clauseToAdd) {
+    m_clauseBuffer.clear();
+    for (CNFLit lit : clause) {
       ensureSolverHasEnoughVars(lit);
-      clause.push_back(cmLit(lit));
+      m_clauseBuffer.push_back(cmLit(lit));
     }
 
-    m_solver.add_clause(clause);
+    m_solver.add_clause(m_clauseBuffer);
   }
 
-  void executeTraceCommand(AssumeCmd const& cmd)
+  void addAssumptions(gsl::span<CNFLit const> assumptions)
   {
-    for (CNFLit lit : cmd.assumptions) {
+    for (CNFLit lit : assumptions) {
       ensureSolverHasEnoughVars(lit);
       m_assumptions.push_back(cmLit(lit));
     }
   }
 
-  void executeTraceCommand(SolveCmd& cmd)
+  void determineExpectedResult(std::optional<bool>& expectedResult)
   {
-    if (!cmd.expectedResult.has_value()) {
+    if (!expectedResult.has_value()) {
+      ProfileScope profileScope{ProfilePhase::ORACLE_SOLVE};
       CMSat::lbool oracleResult = m_solver.solve(&m_assumptions);
       if (oracleResult != CMSat::l_Undef) {
-        cmd.expectedResult = (oracleResult == CMSat::l_True);
+        expectedResult = (oracleResult == CMSat::l_True);
       }
     }
     m_assumptions.clear();
   }
 
+  void executeTraceCommand(AddClauseCmd const& cmd) { addClauseToSolver(cmd.clauseToAdd); }
+
+  void executeTraceCommand(AssumeCmd const& cmd) { addAssumptions(cmd.assumptions); }
+
+  void executeTraceCommand(SolveCmd& cmd) { determineExpectedResult(cmd.expectedResult); }
+
   void executeTraceCommand(HavocCmd&)
   {
     // ignored by the oracle
@@ -107,8 +116,35 @@ public:
     }
   }
 
+  void solve(FlatFuzzTrace& trace,
+             FlatFuzzTrace::size_type start,
+             FlatFuzzTrace::size_type stop) override
+  {
+    for (FlatFuzzTrace::size_type idx = start; idx < stop; ++idx) {
+      FlatFuzzTrace::CmdView const cmd = trace[idx];
+      switch (cmd.getKind()) {
+      case FlatFuzzTrace::CmdKind::ADD_CLAUSE:
+        addClauseToSolver(cmd.getLits());
+        break;
+      case FlatFuzzTrace::CmdKind::ASSUME:
+        addAssumptions(cmd.getLits());
+        break;
+      case FlatFuzzTrace::CmdKind::SOLVE: {
+        std::optional<bool> expectedResult = cmd.getExpectedResult();
+        determineExpectedResult(expectedResult);
+        trace.setExpectedResult(idx, expectedResult);
+        break;
+      }
+      default:
+        // havoc commands are ignored by the oracle
+        break;
+      }
+    }
+  }
+
   auto probe(std::vector<CNFLit> const& assumptions) -> TBool override
   {
+    ProfileScope profileScope{ProfilePhase::ORACLE_PROBE};
     for (CNFLit lit : assumptions) {
       ensureSolverHasEnoughVars(lit);
     }
@@ -144,6 +180,7 @@ private:
   CMSat::SATSolver m_solver;
   size_t m_numVars = 0;
   std::vector<CMSat::Lit> m_assumptions;
+  std::vector<CMSat::Lit> m_clauseBuffer;
 };
 }
 
@@ -0,0 +1,246 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/Profiling.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace incmonk {
+
+auto getProfilePhaseName(ProfilePhase phase) noexcept -> char const*
+{
+  switch (phase) {
+  case ProfilePhase::GENERATE:
+    return "generate";
+  case ProfilePhase::INSERT_SOLVE_CMDS:
+    return "insert_solve_cmds";
+  case ProfilePhase::INSERT_HAVOC_CMDS:
+    return "insert_havoc_cmds";
+  case ProfilePhase::ORACLE_SOLVE:
+    return "oracle_solve";
+  case ProfilePhase::ORACLE_PROBE:
+    return "oracle_probe";
+  case ProfilePhase::FORK_EXEC:
+    return "fork_exec";
+  case ProfilePhase::CHILD_DECODE:
+    return "child_decode";
+  case ProfilePhase::SUT_ADD:
+    return "sut_add";
+  case ProfilePhase::SUT_SOLVE:
+    return "sut_solve";
+  case ProfilePhase::SUT_CHECK:
+    return "sut_check";
+  case ProfilePhase::TRACE_DUMP:
+    return "trace_dump";
+  }
+  return "unknown";
+}
+
+namespace {
+constexpr uint64_t subBucketBits = 3;
+constexpr uint64_t numSubBuckets = uint64_t{1} << subBucketBits;
+
+auto getMostSignificantBit(uint64_t value) noexcept -> uint64_t
+{
+  return 63 - static_cast<uint64_t>(__builtin_clzll(value));
+}
+}
+
+auto LatencyHistogram::getBucketIdx(std::chrono::nanoseconds latency) noexcept -> std::size_t
+{
+  uint64_t const value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+  if (value < numSubBuckets) {
+    return value;
+  }
+
+  uint64_t const msb = getMostSignificantBit(value);
+  uint64_t const subBucket = (value >> (msb - subBucketBits)) & (numSubBuckets - 1);
+  return (msb - subBucketBits + 1) * numSubBuckets + subBucket;
+}
+
+auto LatencyHistogram::getBucketUpperBound(std::size_t bucketIdx) noexcept
+    -> std::chrono::nanoseconds
+{
+  if (bucketIdx < numSubBuckets) {
+    return std::chrono::nanoseconds{bucketIdx};
+  }
+
+  uint64_t const shift = bucketIdx / numSubBuckets - 1;
+  uint64_t const subBucket = bucketIdx % numSubBuckets;
+  uint64_t const lowerBound = (numSubBuckets + subBucket) << shift;
+  uint64_t const upperBound = lowerBound + ((uint64_t{1} << shift) - 1);
+  return std::chrono::nanoseconds{static_cast<std::chrono::nanoseconds::rep>(
+      std::min(upperBound, uint64_t{std::numeric_limits<int64_t>::max()}))};
+}
+
+void LatencyHistogram::add(std::chrono::nanoseconds latency, uint64_t count) noexcept
+{
+  m_counts[getBucketIdx(latency)] += count;
+}
+
+void LatencyHistogram::addToBucket(std::size_t bucketIdx, uint64_t count) noexcept
+{
+  m_counts[bucketIdx] += count;
+}
+
+auto LatencyHistogram::getCount() const noexcept -> uint64_t
+{
+  uint64_t result = 0;
+  for (uint64_t count : m_counts) {
+    result += count;
+  }
+  return result;
+}
+
+auto LatencyHistogram::getQuantile(double quantile) const noexcept -> std::chrono::nanoseconds
+{
+  uint64_t const totalCount = getCount();
+  if (totalCount == 0) {
+    return std::chrono::nanoseconds{0};
+  }
+
+  // The rank of the quantile, counting from 1
+  uint64_t const rank = std::max(
+      uint64_t{1}, static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(totalCount))));
+
+  uint64_t seen = 0;
+  for (std::size_t idx = 0; idx < numBuckets; ++idx) {
+    seen += m_counts[idx];
+    if (seen >= rank) {
+      return getBucketUpperBound(idx);
+    }
+  }
+  return getBucketUpperBound(numBuckets - 1);
+}
+
+void Profile::record(ProfilePhase phase, std::chrono::nanoseconds latency) noexcept
+{
+  AtomicPhaseProfile& target = m_phases[static_cast<std::size_t>(phase)];
+  target.count.fetch_add(1, std::memory_order_relaxed);
+  target.totalNanos.fetch_add(latency.count(), std::memory_order_relaxed);
+  target.buckets[LatencyHistogram::getBucketIdx(latency)].fetch_add(1, std::memory_order_relaxed);
+}
+
+auto Profile::getPhaseProfile(ProfilePhase phase) const noexcept -> PhaseProfile
+{
+  AtomicPhaseProfile const& source = m_phases[static_cast<std::size_t>(phase)];
+
+  PhaseProfile result;
+  result.count = source.count.load(std::memory_order_relaxed);
+  result.totalTime = std::chrono::nanoseconds{source.totalNanos.load(std::memory_order_relaxed)};
+  for (std::size_t idx = 0; idx < LatencyHistogram::numBuckets; ++idx) {
+    result.latencies.addToBucket(idx, source.buckets[idx].load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+void Profile::merge(Profile const& other) noexcept
+{
+  for (std::size_t phaseIdx = 0; phaseIdx < numProfilePhases; ++phaseIdx) {
+    AtomicPhaseProfile const& source = other.m_phases[phaseIdx];
+    AtomicPhaseProfile& target = m_phases[phaseIdx];
+
+    target.count.fetch_add(source.count.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+    target.totalNanos.fetch_add(source.totalNanos.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+    for (std::size_t idx = 0; idx < LatencyHistogram::numBuckets; ++idx) {
+      uint64_t const count = source.buckets[idx].load(std::memory_order_relaxed);
+      if (count != 0) {
+        target.buckets[idx].fetch_add(count, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+void Profile::reset() noexcept
+{
+  for (AtomicPhaseProfile& phase : m_phases) {
+    phase.count.store(0, std::memory_order_relaxed);
+    phase.totalNanos.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>& bucket : phase.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+namespace {
+auto toMillis(std::chrono::nanoseconds time) -> double
+{
+  return static_cast<double>(time.count()) / 1.0e6;
+}
+
+auto toMicros(std::chrono::nanoseconds time) -> double
+{
+  return static_cast<double>(time.count()) / 1.0e3;
+}
+}
+
+auto formatProfile(Profile const& profile) -> std::string
+{
+  std::ostringstream result;
+  result << std::fixed << std::setprecision(1);
+  result << std::left << std::setw(20) << "Phase" << std::right << std::setw(12) << "Count"
+         << std::setw(14) << "Total (ms)" << std::setw(12) << "Mean (us)" << std::setw(12)
+         << "p50 (us)" << std::setw(12) << "p90 (us)" << std::setw(12) << "p99 (us)" << "\n";
+
+  for (std::size_t phaseIdx = 0; phaseIdx < numProfilePhases; ++phaseIdx) {
+    ProfilePhase const phase = static_cast<ProfilePhase>(phaseIdx);
+    PhaseProfile const phaseProfile = profile.getPhaseProfile(phase);
+    if (phaseProfile.count == 0) {
+      continue;
+    }
+
+    LatencyHistogram const& latencies = phaseProfile.latencies;
+    result << std::left << std::setw(20) << getProfilePhaseName(phase) << std::right
+           << std::setw(12) << phaseProfile.count << std::setw(14)
+           << toMillis(phaseProfile.totalTime) << std::setw(12)
+           << toMicros(phaseProfile.totalTime) / static_cast<double>(phaseProfile.count)
+           << std::setw(12) << toMicros(latencies.getQuantile(0.5)) << std::setw(12)
+           << toMicros(latencies.getQuantile(0.9)) << std::setw(12)
+           << toMicros(latencies.getQuantile(0.99)) << "\n";
+  }
+  return result.str();
+}
+
+auto formatProfileSummary(Profile const& profile) -> std::string
+{
+  std::ostringstream result;
+  result << std::fixed << std::setprecision(1) << "total ms:";
+  for (std::size_t phaseIdx = 0; phaseIdx < numProfilePhases; ++phaseIdx) {
+    ProfilePhase const phase = static_cast<ProfilePhase>(phaseIdx);
+    PhaseProfile const phaseProfile = profile.getPhaseProfile(phase);
+    if (phaseProfile.count > 0) {
+      result << " " << getProfilePhaseName(phase) << "=" << toMillis(phaseProfile.totalTime);
+    }
+  }
+  return result.str();
+}
+}
@@ -0,0 +1,214 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Lightweight profiling of the phases of fuzzing rounds
+ */
+
+#pragma once
+
+#include <libincmonk/Stopwatch.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace incmonk {
+
+/**
+ * \brief Phases of fuzzing rounds. Phases may be nested, e.g. oracle probes are executed
+ *   while checking the results of the solver under test.
+ */
+enum class ProfilePhase : uint8_t {
+  /// Generating traces via MuxGenerator::generate() (including the interspersion phases)
+  GENERATE,
+
+  /// insertSolveCmds() resp. insertHavocCmds(), or the lazy inserters of a generator
+  /// timed via FuzzCmdSourceProfiler
+  INSERT_SOLVE_CMDS,
+  INSERT_HAVOC_CMDS,
+
+  /// Solve calls of the oracle, computing the expected results of traces
+  ORACLE_SOLVE,
+  ORACLE_PROBE,
+
+  /// Executing a batch of traces in a child process, as seen from the fuzzer
+  FORK_EXEC,
+
+  /// Decoding the traces of a batch in the child process
+  CHILD_DECODE,
+
+  /// Adding clauses and assumptions to the solver under test
+  SUT_ADD,
+  SUT_SOLVE,
+
+  /// Checking the results of the solver under test, e.g. extracting and checking models
+  SUT_CHECK,
+
+  /// Encoding and writing traces
+  TRACE_DUMP
+};
+
+constexpr std::size_t numProfilePhases = 11;
+
+auto getProfilePhaseName(ProfilePhase phase) noexcept -> char const*;
+
+/**
+ * \brief Histogram of latencies with logarithmically sized buckets, in the style of
+ *   HDR histograms.
+ *
+ * Each power of two is divided into 8 buckets, so the bucket boundaries deviate from
+ * recorded values by less than 12.5%. Values below 8ns are recorded exactly.
+ */
+class LatencyHistogram {
+public:
+  static constexpr std::size_t numBuckets = 496;
+
+  static auto getBucketIdx(std::chrono::nanoseconds latency) noexcept -> std::size_t;
+
+  /// Returns the largest latency contained in the bucket with index `bucketIdx`
+  static auto getBucketUpperBound(std::size_t bucketIdx) noexcept -> std::chrono::nanoseconds;
+
+  void add(std::chrono::nanoseconds latency, uint64_t count = 1) noexcept;
+  void addToBucket(std::size_t bucketIdx, uint64_t count) noexcept;
+
+  auto getCount() const noexcept -> uint64_t;
+
+  /**
+   * \brief Returns an upper bound of the latency below which the fraction `quantile` of
+   *   the recorded latencies lie.
+   *
+   * \param quantile  A value in [0, 1]
+   *
+   * \returns the upper bound of the bucket containing the quantile, or 0 if the histogram
+   *   is empty.
+   */
+  auto getQuantile(double quantile) const noexcept -> std::chrono::nanoseconds;
+
+private:
+  std::array<uint64_t, numBuckets> m_counts{};
+};
+
+struct PhaseProfile {
+  uint64_t count = 0;
+  std::chrono::nanoseconds totalTime{0};
+  LatencyHistogram latencies;
+};
+
+/**
+ * \brief Cumulative times and latency histograms of the profiled phases.
+ *
+ * Measurements may be recorded concurrently by multiple threads, and may be read while
+ * being recorded. Profile objects may be placed in memory shared with child processes.
+ */
+class Profile {
+public:
+  void record(ProfilePhase phase, std::chrono::nanoseconds latency) noexcept;
+
+  auto getPhaseProfile(ProfilePhase phase) const noexcept -> PhaseProfile;
+
+  /// Adds the measurements of `other` to this profile
+  void merge(Profile const& other) noexcept;
+
+  void reset() noexcept;
+
+private:
+  struct AtomicPhaseProfile {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNanos{0};
+    std::array<std::atomic<uint64_t>, LatencyHistogram::numBuckets> buckets{};
+  };
+
+  std::array<AtomicPhaseProfile, numProfilePhases> m_phases;
+};
+
+/**
+ * \brief Formats the per-phase profile as a table, with the number of measurements,
+ *   the total time and latency quantiles of each phase.
+ */
+auto formatProfile(Profile const& profile) -> std::string;
+
+/**
+ * \brief Formats the total times of the phases in a single line.
+ */
+auto formatProfileSummary(Profile const& profile) -> std::string;
+
+namespace detail {
+inline thread_local Profile* threadProfile = nullptr;
+}
+
+/**
+ * \brief Sets the profile to which ProfileScope objects created by the current thread
+ *   record their measurements. If it is nullptr, profiling is disabled.
+ */
+inline void setThreadProfile(Profile* profile) noexcept
+{
+  detail::threadProfile = profile;
+}
+
+inline auto getThreadProfile() noexcept -> Profile*
+{
+  return detail::threadProfile;
+}
+
+/**
+ * \brief Records the time between its construction and its destruction in the current
+ *   thread's profile.
+ *
+ * When no thread profile is set, this only costs a check of the thread profile pointer.
+ */
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfilePhase phase) noexcept
+    : m_profile{detail::threadProfile}, m_phase{phase}
+  {
+    if (m_profile != nullptr) {
+      m_stopwatch.emplace();
+    }
+  }
+
+  ~ProfileScope()
+  {
+    if (m_profile != nullptr) {
+      m_profile->record(m_phase, m_stopwatch->getElapsedTime<std::chrono::nanoseconds>());
+    }
+  }
+
+  ProfileScope(ProfileScope const&) = delete;
+  auto operator=(ProfileScope const&) -> ProfileScope& = delete;
+
+private:
+  Profile* m_profile;
+  ProfilePhase m_phase;
+  std::optional<Stopwatch> m_stopwatch;
+};
+}
@@ -0,0 +1,161 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief A lock-free bounded single-producer/single-consumer queue
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace incmonk {
+
+/**
+ * \brief A bounded, lock-free single-producer/single-consumer FIFO queue.
+ *
+ * tryPush() may only be called by a single producer thread, and tryPop()
+ * may only be called by a single consumer thread. Both may run concurrently.
+ *
+ * \tparam T   The element type. T must be default-constructible and
+ *             move-assignable.
+ */
+template <typename T>
+class SPSCQueue {
+public:
+  using size_type = std::size_t;
+
+  /**
+   * \brief Constructs an empty queue.
+   *
+   * \param minCapacity  The minimum number of elements the queue can hold.
+   *   The capacity is rounded up to the next power of two.
+   */
+  explicit SPSCQueue(size_type minCapacity);
+
+  /**
+   * \brief Appends `item` to the queue if it is not full.
+   *
+   * \returns true iff `item` has been moved into the queue.
+   */
+  auto tryPush(T&& item) -> bool;
+
+  /**
+   * \brief Removes the first element from the queue if it is not empty.
+   *
+   * \returns The removed element, or nothing if the queue is empty.
+   */
+  auto tryPop() -> std::optional<T>;
+
+  /**
+   * \brief Returns the number of elements in the queue.
+   *
+   * When called concurrently to tryPush() or tryPop(), the result is
+   * only an approximation.
+   */
+  auto size() const noexcept -> size_type;
+
+  auto capacity() const noexcept -> size_type;
+
+private:
+  // Avoids false sharing between the producer and the consumer
+  static constexpr size_type cacheLineSize = 64;
+
+  std::vector<T> m_elements;
+  size_type m_mask;
+
+  // Index of the next element to be popped. Only modified by the consumer.
+  alignas(cacheLineSize) std::atomic<size_type> m_head = 0;
+
+  // Index of the next element to be pushed. Only modified by the producer.
+  alignas(cacheLineSize) std::atomic<size_type> m_tail = 0;
+};
+
+
+// Implementation
+
+namespace detail {
+inline auto roundUpToPowerOf2(std::size_t value) -> std::size_t
+{
+  std::size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+}
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(size_type minCapacity)
+  : m_elements(detail::roundUpToPowerOf2(minCapacity)), m_mask{m_elements.size() - 1}
+{
+}
+
+template <typename T>
+auto SPSCQueue<T>::tryPush(T&& item) -> bool
+{
+  size_type const tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == m_elements.size()) {
+    return false;
+  }
+
+  m_elements[tail & m_mask] = std::move(item);
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+auto SPSCQueue<T>::tryPop() -> std::optional<T>
+{
+  size_type const head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire)) {
+    return std::nullopt;
+  }
+
+  std::optional<T> result{std::move(m_elements[head & m_mask])};
+  m_head.store(head + 1, std::memory_order_release);
+  return result;
+}
+
+template <typename T>
+auto SPSCQueue<T>::size() const noexcept -> size_type
+{
+  size_type const head = m_head.load(std::memory_order_acquire);
+  size_type const tail = m_tail.load(std::memory_order_acquire);
+  return tail >= head ? tail - head : 0;
+}
+
+template <typename T>
+auto SPSCQueue<T>::capacity() const noexcept -> size_type
+{
+  return m_elements.size();
+}
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Objects placed in memory shared with child processes
+ */
+
+#pragma once
+
+#include <new>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+namespace incmonk {
+
+/**
+ * \brief An object of type T placed in anonymous memory shared with child processes.
+ *
+ * The memory is shared with all processes forked after the construction of the
+ * SharedObject, so it needs to be created before the child processes (or a fork
+ * server) are created. T needs to be default-constructible and must not contain
+ * pointers to memory that is not shared.
+ */
+template <typename T>
+class SharedObject {
+public:
+  /**
+   * \throws std::runtime_error when the shared memory could not be created.
+   */
+  SharedObject();
+  ~SharedObject();
+
+  auto get() noexcept -> T&;
+  auto get() const noexcept -> T const&;
+
+  SharedObject(SharedObject const&) = delete;
+  auto operator=(SharedObject const&) -> SharedObject& = delete;
+
+private:
+  T* m_object = nullptr;
+};
+
+template <typename T>
+SharedObject<T>::SharedObject()
+{
+  void* memory =
+      mmap(nullptr, sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error{"Could not create shared memory"};
+  }
+  m_object = new (memory) T{};
+}
+
+template <typename T>
+SharedObject<T>::~SharedObject()
+{
+  m_object->~T();
+  munmap(m_object, sizeof(T));
+}
+
+template <typename T>
+auto SharedObject<T>::get() noexcept -> T&
+{
+  return *m_object;
+}
+
+template <typename T>
+auto SharedObject<T>::get() const noexcept -> T const&
+{
+  return *m_object;
+}
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/SolveWatchdog.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace incmonk {
+
+struct SolveWatchdog::SharedState {
+  std::atomic<uint32_t> limitExceeded{0};
+  std::atomic<uint64_t> traceIdx{0};
+  std::atomic<uint64_t> numSolveCalls{0};
+  std::array<std::atomic<uint64_t>, maxRecordedSolveCalls> solveTimesMicros{};
+};
+
+namespace {
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Watchdog state must be accessible from signal handlers");
+
+/// The watchdog state of the current child process, accessed by the signal handler
+std::atomic<SolveWatchdog::SharedState*> activeState{nullptr};
+
+extern "C" void handleCPUTimeLimitExceeded(int)
+{
+  SolveWatchdog::SharedState* state = activeState.load();
+  if (state != nullptr) {
+    state->limitExceeded.store(1);
+  }
+  _exit(EXIT_FAILURE);
+}
+
+auto getProcessCPUTime() noexcept -> std::chrono::nanoseconds
+{
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+}
+
+void setCPUTimer(std::chrono::microseconds duration) noexcept
+{
+  itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  timer.it_value.tv_sec = duration.count() / 1000000;
+  timer.it_value.tv_usec = duration.count() % 1000000;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+}
+
+SolveWatchdog::SolveWatchdog(std::chrono::milliseconds cpuTimeLimit)
+  : m_cpuTimeLimit{cpuTimeLimit}
+{
+}
+
+SolveWatchdog::~SolveWatchdog() = default;
+
+void SolveWatchdog::reset() noexcept
+{
+  m_state.get().limitExceeded.store(0);
+  m_state.get().traceIdx.store(0);
+  m_state.get().numSolveCalls.store(0);
+}
+
+auto SolveWatchdog::getTimeout() const -> std::optional<SolveTimeout>
+{
+  if (m_state.get().limitExceeded.load() == 0) {
+    return std::nullopt;
+  }
+
+  SolveTimeout result;
+  result.traceIdx = m_state.get().traceIdx.load();
+  result.solveCallIdx = m_state.get().numSolveCalls.load();
+
+  std::size_t const numRecorded = std::min(result.solveCallIdx, maxRecordedSolveCalls);
+  for (std::size_t idx = 0; idx < numRecorded; ++idx) {
+    result.previousSolveTimes.emplace_back(m_state.get().solveTimesMicros[idx].load());
+  }
+  return result;
+}
+
+auto SolveWatchdog::getCPUTimeLimit() const noexcept -> std::chrono::milliseconds
+{
+  return m_cpuTimeLimit;
+}
+
+void SolveWatchdog::beginTrace(std::size_t traceIdx) noexcept
+{
+  if (activeState.exchange(&m_state.get()) != &m_state.get()) {
+    struct sigaction signalAction;
+    memset(&signalAction, 0, sizeof(signalAction));
+    signalAction.sa_handler = handleCPUTimeLimitExceeded;
+    sigaction(SIGPROF, &signalAction, nullptr);
+  }
+
+  m_state.get().traceIdx.store(traceIdx);
+  m_state.get().numSolveCalls.store(0);
+}
+
+void SolveWatchdog::beginSolve() noexcept
+{
+  m_solveStartTime = getProcessCPUTime();
+  // Zero-valued timers are disarmed, so the timer is set to at least 1us:
+  setCPUTimer(std::max(std::chrono::microseconds{m_cpuTimeLimit}, std::chrono::microseconds{1}));
+}
+
+void SolveWatchdog::endSolve() noexcept
+{
+  setCPUTimer(std::chrono::microseconds{0});
+
+  auto const solveTime =
+      std::chrono::duration_cast<std::chrono::microseconds>(getProcessCPUTime() - m_solveStartTime);
+  uint64_t const solveCallIdx = m_state.get().numSolveCalls.load();
+  if (solveCallIdx < maxRecordedSolveCalls) {
+    m_state.get().solveTimesMicros[solveCallIdx].store(solveTime.count());
+  }
+  m_state.get().numSolveCalls.store(solveCallIdx + 1);
+}
+}
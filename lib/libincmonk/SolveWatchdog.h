@@ -0,0 +1,178 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief CPU time limits for individual solve calls, enforced in child processes
+ */
+
+#pragma once
+
+#include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/SharedObject.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace incmonk {
+
+/**
+ * \brief Description of a solve call which exceeded its CPU time limit
+ */
+struct SolveTimeout {
+  /// The index of the trace (as passed to SolveWatchdog::beginTrace()) containing the solve call
+  std::size_t traceIdx = 0;
+
+  /// The index of the solve call within its trace, with 0 denoting the first solve call
+  std::size_t solveCallIdx = 0;
+
+  /// The CPU times of the solve calls preceding the offending call within its trace.
+  /// At most SolveWatchdog::maxRecordedSolveCalls times are recorded.
+  std::vector<std::chrono::microseconds> previousSolveTimes;
+};
+
+/**
+ * \brief Enforces a CPU time limit on each solve call executed in child processes.
+ *
+ * The watchdog's state is kept in memory shared with the child processes, so
+ * the watchdog must be created before the child processes (or a fork server) are
+ * created. In the child processes, solve calls are executed between beginSolve()
+ * and endSolve(), e.g. via WatchedIPASIRSolver. When a solve call exceeds the CPU
+ * time limit, the child process is terminated with EXIT_FAILURE, and the offending
+ * solve call can be obtained in the parent process via getTimeout().
+ *
+ * The limit is enforced via a CPU-time interval timer (ITIMER_PROF), so a child
+ * process must not execute multiple solve calls concurrently.
+ */
+class SolveWatchdog {
+public:
+  /**
+   * \throws std::runtime_error when the shared memory could not be created.
+   */
+  explicit SolveWatchdog(std::chrono::milliseconds cpuTimeLimit);
+  ~SolveWatchdog();
+
+  /**
+   * \brief Resets the recorded solve calls and the timeout information. Called in the
+   *   parent process before each child process execution.
+   */
+  void reset() noexcept;
+
+  /**
+   * \brief Returns the solve call which exceeded the CPU time limit in the last child
+   *   process, if any.
+   */
+  auto getTimeout() const -> std::optional<SolveTimeout>;
+
+  auto getCPUTimeLimit() const noexcept -> std::chrono::milliseconds;
+
+  /**
+   * \brief Begins the execution of the trace with index `traceIdx` in a child process,
+   *   resetting the recorded solve calls.
+   */
+  void beginTrace(std::size_t traceIdx) noexcept;
+
+  /// \brief Starts the CPU timer of a solve call. Only to be called in child processes.
+  void beginSolve() noexcept;
+
+  /// \brief Stops the CPU timer of a solve call. Only to be called in child processes.
+  void endSolve() noexcept;
+
+  static constexpr std::size_t maxRecordedSolveCalls = 1024;
+
+  SolveWatchdog(SolveWatchdog const&) = delete;
+  auto operator=(SolveWatchdog const&) -> SolveWatchdog& = delete;
+
+  struct SharedState;
+
+private:
+  SharedObject<SharedState> m_state;
+  std::chrono::milliseconds m_cpuTimeLimit;
+  std::chrono::nanoseconds m_solveStartTime{0};
+};
+
+/**
+ * \brief IPASIRSolver executing the solve calls of a wrapped solver under the
+ *   supervision of a SolveWatchdog. All other calls are forwarded directly.
+ *
+ * `SolverT` is IPASIRSolver or a type derived from it.
+ */
+template <typename SolverT>
+class WatchedIPASIRSolver final : public IPASIRSolver {
+public:
+  WatchedIPASIRSolver(SolverT& solver, SolveWatchdog& watchdog)
+    : m_solver{solver}, m_watchdog{watchdog}
+  {
+  }
+
+  void addClause(gsl::span<CNFLit const> clause) override { m_solver.addClause(clause); }
+  void assume(gsl::span<CNFLit const> assumptions) override { m_solver.assume(assumptions); }
+
+  auto solve() -> Result override
+  {
+    m_watchdog.beginSolve();
+    Result const result = m_solver.solve();
+    m_watchdog.endSolve();
+    return result;
+  }
+
+  auto getLastSolveResult() const noexcept -> Result override
+  {
+    return m_solver.getLastSolveResult();
+  }
+
+  auto getValue(CNFLit lit) const noexcept -> TBool override { return m_solver.getValue(lit); }
+  auto isFailed(CNFLit lit) const noexcept -> bool override { return m_solver.isFailed(lit); }
+
+  void getModel(gsl::span<TBool> result) const noexcept override { m_solver.getModel(result); }
+
+  void getFailed(gsl::span<CNFLit const> assumptions,
+                 std::vector<CNFLit>& result) const override
+  {
+    m_solver.getFailed(assumptions, result);
+  }
+
+  void configure(uint64_t value) override { m_solver.configure(value); }
+
+  void reinitializeWithHavoc(uint64_t seed) noexcept override
+  {
+    m_solver.reinitializeWithHavoc(seed);
+  }
+
+  void havoc(uint64_t seed) noexcept override { m_solver.havoc(seed); }
+
+  WatchedIPASIRSolver(WatchedIPASIRSolver const&) = delete;
+  auto operator=(WatchedIPASIRSolver const&) -> WatchedIPASIRSolver& = delete;
+
+private:
+  SolverT& m_solver;
+  SolveWatchdog& m_watchdog;
+};
+}
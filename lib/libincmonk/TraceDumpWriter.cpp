@@ -0,0 +1,184 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/TraceDumpWriter.h>
+
+#include <libincmonk/FuzzTrace.h>
+
+#include <gsl/gsl_util>
+
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace incmonk {
+
+void writeTraceFile(std::filesystem::path const& filename,
+                    gsl::span<std::byte const> encodedTrace,
+                    FsyncPolicy fsyncPolicy)
+{
+  int const fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    throw IOException{"Could not open file " + filename.string()};
+  }
+  auto closeFd = gsl::finally([fd]() { close(fd); });
+
+  std::byte const* cursor = encodedTrace.data();
+  std::size_t remaining = encodedTrace.size();
+  while (remaining > 0) {
+    ssize_t const numBytesWritten = ::write(fd, cursor, remaining);
+    if (numBytesWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IOException{"I/O error while writing to " + filename.string()};
+    }
+    cursor += numBytesWritten;
+    remaining -= static_cast<std::size_t>(numBytesWritten);
+  }
+
+  if (fsyncPolicy == FsyncPolicy::EACH_TRACE && fsync(fd) != 0) {
+    throw IOException{"Could not sync " + filename.string()};
+  }
+}
+
+namespace {
+class TraceDumpWriterImpl final : public TraceDumpWriter {
+public:
+  explicit TraceDumpWriterImpl(FsyncPolicy fsyncPolicy)
+    : m_fsyncPolicy{fsyncPolicy}, m_thread{[this]() { run(); }}
+  {
+  }
+
+  void write(std::filesystem::path const& filename,
+             std::vector<std::byte>&& encodedTrace) override
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+
+    // Only block the caller when the writer thread is lagging behind far enough
+    // to cause significant memory use:
+    m_progressCondition.wait(lock, [this]() {
+      return m_numPendingBytes < maxPendingBytes || m_pendingDumps.empty();
+    });
+
+    m_numPendingBytes += encodedTrace.size();
+    m_pendingDumps.push_back(Dump{filename, std::move(encodedTrace)});
+    m_workCondition.notify_one();
+  }
+
+  void flush() override
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_progressCondition.wait(lock, [this]() { return m_pendingDumps.empty() && !m_busy; });
+
+    if (m_firstError.has_value()) {
+      std::string error = std::move(*m_firstError);
+      m_firstError.reset();
+      throw IOException{error};
+    }
+  }
+
+  ~TraceDumpWriterImpl()
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stopRequested = true;
+    }
+    m_workCondition.notify_one();
+    m_thread.join();
+  }
+
+  TraceDumpWriterImpl(TraceDumpWriterImpl const&) = delete;
+  auto operator=(TraceDumpWriterImpl const&) -> TraceDumpWriterImpl& = delete;
+
+private:
+  struct Dump {
+    std::filesystem::path filename;
+    std::vector<std::byte> encodedTrace;
+  };
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+      m_workCondition.wait(lock, [this]() { return m_stopRequested || !m_pendingDumps.empty(); });
+      if (m_pendingDumps.empty()) {
+        // Stop only after all pending dumps have been written
+        return;
+      }
+
+      Dump dump = std::move(m_pendingDumps.front());
+      m_pendingDumps.pop_front();
+      m_busy = true;
+
+      lock.unlock();
+      std::optional<std::string> error;
+      try {
+        writeTraceFile(dump.filename, dump.encodedTrace, m_fsyncPolicy);
+      }
+      catch (IOException const& exception) {
+        error = exception.what();
+      }
+      lock.lock();
+
+      m_busy = false;
+      m_numPendingBytes -= dump.encodedTrace.size();
+      if (error.has_value() && !m_firstError.has_value()) {
+        m_firstError = std::move(error);
+      }
+      m_progressCondition.notify_all();
+    }
+  }
+
+  static constexpr std::size_t maxPendingBytes = 256 * 1024 * 1024;
+
+  FsyncPolicy m_fsyncPolicy;
+
+  std::mutex m_mutex;
+  std::condition_variable m_workCondition;
+  std::condition_variable m_progressCondition;
+
+  std::deque<Dump> m_pendingDumps;
+  std::size_t m_numPendingBytes = 0;
+  bool m_busy = false;
+  bool m_stopRequested = false;
+  std::optional<std::string> m_firstError;
+
+  std::thread m_thread;
+};
+}
+
+auto createTraceDumpWriter(FsyncPolicy fsyncPolicy) -> std::unique_ptr<TraceDumpWriter>
+{
+  return std::make_unique<TraceDumpWriterImpl>(fsyncPolicy);
+}
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Writing encoded traces to files, in background threads
+ */
+
+#pragma once
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace incmonk {
+
+enum class FsyncPolicy {
+  /// Trace files are not explicitly synced with the storage device
+  NEVER,
+
+  /// Each trace file is synced with the storage device after it has been written
+  EACH_TRACE
+};
+
+/**
+ * \brief Writes the given encoded trace to a file with a single write call
+ *
+ * Partial writes are continued until all data has been written.
+ *
+ * \throw IOException   on file I/O failures
+ */
+void writeTraceFile(std::filesystem::path const& filename,
+                    gsl::span<std::byte const> encodedTrace,
+                    FsyncPolicy fsyncPolicy);
+
+/**
+ * \brief Writes encoded traces (see encodeTrace()) to files in a background thread.
+ *
+ * Dumping a large trace does not block the execution of the dumping thread, except
+ * when the data not yet written exceeds a limit of a few hundred megabytes.
+ */
+class TraceDumpWriter {
+public:
+  /**
+   * \brief Schedules writing `encodedTrace` to the file `filename`.
+   *
+   * Dumps are written in the order in which they have been scheduled.
+   */
+  virtual void write(std::filesystem::path const& filename,
+                     std::vector<std::byte>&& encodedTrace) = 0;
+
+  /**
+   * \brief Waits until all scheduled dumps have been written.
+   *
+   * \throw IOException   if writing a dump failed since the last call to flush().
+   *   All other dumps are written nevertheless.
+   */
+  virtual void flush() = 0;
+
+  /**
+   * Writes the remaining scheduled dumps, ignoring I/O errors.
+   */
+  virtual ~TraceDumpWriter() = default;
+};
+
+auto createTraceDumpWriter(FsyncPolicy fsyncPolicy) -> std::unique_ptr<TraceDumpWriter>;
+}
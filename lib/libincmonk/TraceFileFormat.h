@@ -0,0 +1,417 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ * 
+ * \brief Encoding of the binary trace file format (internal header)
+ */
+
+#pragma once
+
+#include <libincmonk/CNF.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/IOUtils.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace incmonk {
+namespace detail {
+// Format version 1: fixed-width literals, each literal list terminated by 0
+
+constexpr uint32_t magicCookie = 0xF2950001; // 0xF2950000 + format version
+
+constexpr uint8_t addClauseCmdId = 0;
+constexpr uint8_t assumeCmdId = 1;
+constexpr uint8_t solveWithoutExpectedResultCmdId = 2;
+constexpr uint8_t solveWithFalseResultCmdId = 3;
+constexpr uint8_t solveWithTrueResultCmdId = 4;
+constexpr uint8_t havocInitCmdId = 5;
+constexpr uint8_t havocCmdId = 6;
+constexpr uint8_t maxCmdId = 6;
+
+// Format version 2: literal lists are stored as a LEB128 varint length, followed by
+// the LEB128 varint deltas of the binary literals (see litAsBinary()). In lists with
+// non-decreasing binary literals, the deltas are unsigned. Otherwise, they are
+// zigzag-encoded. Consecutive solve commands with the same expected result and
+// consecutive havoc commands of the same kind are stored as a single command with a
+// varint run length. Havoc seeds are stored as fixed-width 64-bit integers.
+namespace v2 {
+constexpr uint32_t magicCookie = 0xF2950002;
+
+constexpr uint8_t addClauseCmdId = 0;
+constexpr uint8_t assumeCmdId = 1;
+constexpr uint8_t addSortedClauseCmdId = 2;
+constexpr uint8_t assumeSortedCmdId = 3;
+constexpr uint8_t solveWithoutExpectedResultCmdId = 4;
+constexpr uint8_t solveWithFalseResultCmdId = 5;
+constexpr uint8_t solveWithTrueResultCmdId = 6;
+constexpr uint8_t havocInitCmdId = 7;
+constexpr uint8_t havocCmdId = 8;
+constexpr uint8_t maxCmdId = 8;
+
+/// Longer runs are split into several commands
+constexpr uint64_t maxRunLength = 0xFFFF;
+}
+
+inline auto litAsBinary(CNFLit lit) noexcept -> uint32_t
+{
+  uint32_t absVal = std::abs(lit) << 1;
+  absVal += (lit < 0 ? 1 : 0);
+  return absVal;
+}
+
+inline auto binaryAsLit(uint32_t binary) noexcept -> CNFLit
+{
+  int sign = ((binary & 1) == 1 ? -1 : 1);
+  return static_cast<int32_t>(binary / 2) * sign;
+}
+
+inline auto zigzagEncode(int64_t value) noexcept -> uint64_t
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline auto zigzagDecode(uint64_t value) noexcept -> int64_t
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * State of a trace decoder, determining how the next command is read.
+ */
+struct TraceDecoderState {
+  LoaderStrictness strictness = LoaderStrictness::STRICT;
+  TraceFormat format = TraceFormat::V1;
+
+  /// The command ID of the current run of commands (only used for TraceFormat::V2)
+  uint8_t runCmdId = 0;
+
+  /// The number of commands of the current run not yet decoded
+  uint64_t remainingRunLength = 0;
+};
+
+/**
+ * Reader for in-memory traces, see readInteger()
+ */
+class MemoryReader {
+public:
+  MemoryReader(std::byte const* cursor, std::byte const* end) noexcept
+    : m_cursor{cursor}, m_end{end}
+  {
+  }
+
+  auto read(void* target, std::size_t numBytes) noexcept -> bool
+  {
+    if (static_cast<std::size_t>(m_end - m_cursor) < numBytes) {
+      m_cursor = m_end;
+      return false;
+    }
+
+    std::memcpy(target, m_cursor, numBytes);
+    m_cursor += numBytes;
+    return true;
+  }
+
+  auto getCursor() const noexcept -> std::byte const* { return m_cursor; }
+
+private:
+  std::byte const* m_cursor;
+  std::byte const* m_end;
+};
+
+/**
+ * Reads a little-endian integer from `input`. `Reader` is a type with a member
+ * function `read(void* target, std::size_t numBytes) -> bool`, returning false if
+ * fewer than `numBytes` bytes could be read.
+ *
+ * \returns the integer, or nothing if the end of the input has been reached
+ */
+template <typename I, typename Reader>
+auto readInteger(Reader& input) -> std::optional<I>
+{
+  I result = 0;
+  if (!input.read(&result, sizeof(I))) {
+    return std::nullopt;
+  }
+  return fromSmallEndian(result);
+}
+
+/**
+ * Reads an unsigned LEB128 varint from `input`.
+ *
+ * \returns the integer, or nothing if the end of the input has been reached
+ * \throws IOException if the varint is truncated or exceeds 64 bits
+ */
+template <typename Reader>
+auto readVarint(Reader& input) -> std::optional<uint64_t>
+{
+  uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = 0;
+    if (!input.read(&byte, 1)) {
+      if (shift == 0) {
+        return std::nullopt;
+      }
+      throw IOException{"Unexpected end of varint"};
+    }
+
+    uint64_t const payload = byte & 0x7F;
+    if (shift == 63 && payload > 1) {
+      throw IOException{"Varint too large"};
+    }
+    result |= payload << shift;
+
+    if ((byte & 0x80) == 0) {
+      return result;
+    }
+  }
+  throw IOException{"Varint too large"};
+}
+
+template <typename Reader>
+void readCNFLits(Reader& input, std::vector<CNFLit>& result)
+{
+  result.clear();
+
+  while (true) {
+    std::optional<uint32_t> nextLit = readInteger<uint32_t>(input);
+    if (!nextLit.has_value()) {
+      throw IOException{"Unexpected end of literal sequence"};
+    }
+    if (*nextLit == 0) {
+      return;
+    }
+    result.push_back(binaryAsLit(*nextLit));
+  }
+}
+
+template <typename Reader>
+void readDeltaEncodedCNFLits(Reader& input, bool isSorted, std::vector<CNFLit>& result)
+{
+  result.clear();
+
+  std::optional<uint64_t> const numLits = readVarint(input);
+  if (!numLits.has_value()) {
+    throw IOException{"Unexpected end of literal sequence"};
+  }
+
+  int64_t binaryLit = 0;
+  for (uint64_t i = 0; i < *numLits; ++i) {
+    std::optional<uint64_t> const delta = readVarint(input);
+    if (!delta.has_value()) {
+      throw IOException{"Unexpected end of literal sequence"};
+    }
+    if (*delta > std::numeric_limits<uint32_t>::max() * uint64_t{2}) {
+      throw IOException{"Invalid literal"};
+    }
+
+    binaryLit += isSorted ? static_cast<int64_t>(*delta) : zigzagDecode(*delta);
+    if (binaryLit < 2 || binaryLit > std::numeric_limits<uint32_t>::max()) {
+      throw IOException{"Invalid literal"};
+    }
+    result.push_back(binaryAsLit(static_cast<uint32_t>(binaryLit)));
+  }
+}
+
+inline auto decodeSolveResult(uint8_t commandID) -> std::optional<bool>
+{
+  if (commandID == solveWithoutExpectedResultCmdId) {
+    return std::nullopt;
+  }
+  else if (commandID == solveWithFalseResultCmdId) {
+    return false;
+  }
+  else {
+    return true;
+  }
+}
+
+inline auto decodeSolveResultV2(uint8_t commandID) -> std::optional<bool>
+{
+  if (commandID == v2::solveWithoutExpectedResultCmdId) {
+    return std::nullopt;
+  }
+  else if (commandID == v2::solveWithFalseResultCmdId) {
+    return false;
+  }
+  else {
+    return true;
+  }
+}
+
+/**
+ * Reads the magic cookie from `input`, and sets the format of `state` accordingly.
+ * If no magic cookie has been found, the format is set to TraceFormat::V1.
+ *
+ * \returns true iff a magic cookie has been read
+ */
+template <typename Reader>
+auto readMagicCookie(Reader& input, TraceDecoderState& state) -> bool
+{
+  state.format = TraceFormat::V1;
+  state.remainingRunLength = 0;
+
+  std::optional<uint32_t> cookie = readInteger<uint32_t>(input);
+  if (!cookie.has_value()) {
+    return false;
+  }
+
+  if (*cookie == v2::magicCookie) {
+    state.format = TraceFormat::V2;
+    return true;
+  }
+  return *cookie == magicCookie;
+}
+
+template <typename Reader, typename TraceBuilder>
+auto readFuzzCmdV1(Reader& input,
+                   LoaderStrictness strictness,
+                   std::vector<CNFLit>& litBuffer,
+                   TraceBuilder& target) -> bool
+{
+  std::optional<uint8_t> maybeCommand = readInteger<uint8_t>(input);
+  if (!maybeCommand.has_value()) {
+    return false;
+  }
+
+  uint8_t command = *maybeCommand;
+  if (strictness == LoaderStrictness::PERMISSIVE) {
+    command = command % (maxCmdId + 1);
+  }
+
+  if (command == addClauseCmdId) {
+    readCNFLits(input, litBuffer);
+    target.addClause(litBuffer);
+  }
+  else if (command == assumeCmdId) {
+    readCNFLits(input, litBuffer);
+    target.assume(litBuffer);
+  }
+  else if (command == solveWithoutExpectedResultCmdId || command == solveWithFalseResultCmdId ||
+           command == solveWithTrueResultCmdId) {
+    target.solve(decodeSolveResult(command));
+  }
+  else if (command == havocInitCmdId || command == havocCmdId) {
+    std::optional<uint64_t> seed = readInteger<uint64_t>(input);
+    if (!seed.has_value()) {
+      throw IOException{"Unexpected end of file"};
+    }
+    target.havoc(*seed, command == havocInitCmdId);
+  }
+  else {
+    throw IOException{"Invalid fuzz command"};
+  }
+  return true;
+}
+
+template <typename Reader, typename TraceBuilder>
+void readRunCmdV2(Reader& input, uint8_t command, TraceBuilder& target)
+{
+  if (command == v2::havocInitCmdId || command == v2::havocCmdId) {
+    std::optional<uint64_t> seed = readInteger<uint64_t>(input);
+    if (!seed.has_value()) {
+      throw IOException{"Unexpected end of file"};
+    }
+    target.havoc(*seed, command == v2::havocInitCmdId);
+  }
+  else {
+    target.solve(decodeSolveResultV2(command));
+  }
+}
+
+template <typename Reader, typename TraceBuilder>
+auto readFuzzCmdV2(Reader& input,
+                   TraceDecoderState& state,
+                   std::vector<CNFLit>& litBuffer,
+                   TraceBuilder& target) -> bool
+{
+  if (state.remainingRunLength > 0) {
+    --state.remainingRunLength;
+    readRunCmdV2(input, state.runCmdId, target);
+    return true;
+  }
+
+  std::optional<uint8_t> maybeCommand = readInteger<uint8_t>(input);
+  if (!maybeCommand.has_value()) {
+    return false;
+  }
+
+  uint8_t command = *maybeCommand;
+  if (state.strictness == LoaderStrictness::PERMISSIVE) {
+    command = command % (v2::maxCmdId + 1);
+  }
+
+  if (command == v2::addClauseCmdId || command == v2::addSortedClauseCmdId) {
+    readDeltaEncodedCNFLits(input, command == v2::addSortedClauseCmdId, litBuffer);
+    target.addClause(litBuffer);
+  }
+  else if (command == v2::assumeCmdId || command == v2::assumeSortedCmdId) {
+    readDeltaEncodedCNFLits(input, command == v2::assumeSortedCmdId, litBuffer);
+    target.assume(litBuffer);
+  }
+  else if (command <= v2::maxCmdId) {
+    std::optional<uint64_t> runLength = readVarint(input);
+    if (!runLength.has_value() || *runLength == 0 || *runLength > v2::maxRunLength) {
+      throw IOException{"Invalid run length"};
+    }
+    state.runCmdId = command;
+    state.remainingRunLength = *runLength - 1;
+    readRunCmdV2(input, command, target);
+  }
+  else {
+    throw IOException{"Invalid fuzz command"};
+  }
+  return true;
+}
+
+/**
+ * Reads the next command from `input` and appends it to `target`. `Reader` is a type
+ * as required by readInteger(), and `TraceBuilder` is a type with the command-appending
+ * functions of FlatFuzzTrace. Exactly one command is appended per call.
+ *
+ * \returns false iff the end of the input has been reached
+ * \throws IOException if the command is malformed
+ */
+template <typename Reader, typename TraceBuilder>
+auto readFuzzCmd(Reader& input,
+                 TraceDecoderState& state,
+                 std::vector<CNFLit>& litBuffer,
+                 TraceBuilder& target) -> bool
+{
+  if (state.format == TraceFormat::V2) {
+    return readFuzzCmdV2(input, state, litBuffer, target);
+  }
+  return readFuzzCmdV1(input, state.strictness, litBuffer, target);
+}
+}
+}
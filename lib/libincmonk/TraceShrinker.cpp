@@ -0,0 +1,260 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/TraceShrinker.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace incmonk {
+namespace {
+using Units = std::vector<std::size_t>;
+using CandidateBuilder = std::function<FuzzTrace(Units const& keptUnits)>;
+
+/**
+ * Checks candidate traces concurrently, in batches of at most `numThreads` candidates
+ */
+class CandidateChecker {
+public:
+  CandidateChecker(ShrinkPredicate const& isFailing, uint32_t numThreads)
+    : m_isFailing{isFailing}, m_numThreads{std::max(numThreads, uint32_t{1})}
+  {
+  }
+
+  /**
+   * \returns the index of the first candidate reproducing the failure, or nothing
+   *   if no candidate reproduces the failure
+   */
+  auto findFirstFailing(std::vector<Units> const& candidates, CandidateBuilder const& build)
+      -> std::optional<std::size_t>
+  {
+    for (std::size_t batchStart = 0; batchStart < candidates.size();
+         batchStart += m_numThreads) {
+      std::size_t const batchEnd = std::min(batchStart + m_numThreads, candidates.size());
+
+      std::vector<FuzzTrace> traces;
+      for (std::size_t idx = batchStart; idx < batchEnd; ++idx) {
+        traces.push_back(build(candidates[idx]));
+      }
+
+      // Not using std::vector<bool>, since its elements are written concurrently
+      std::vector<char> results(traces.size(), 0);
+      if (traces.size() == 1) {
+        results[0] = m_isFailing(traces[0]);
+      }
+      else {
+        std::vector<std::thread> threads;
+        for (std::size_t idx = 0; idx < traces.size(); ++idx) {
+          threads.emplace_back([this, &traces, &results, idx]() {
+            results[idx] = m_isFailing(traces[idx]);
+          });
+        }
+        for (std::thread& thread : threads) {
+          thread.join();
+        }
+      }
+
+      auto firstFailing = std::find(results.begin(), results.end(), 1);
+      if (firstFailing != results.end()) {
+        return batchStart + std::distance(results.begin(), firstFailing);
+      }
+    }
+    return std::nullopt;
+  }
+
+private:
+  ShrinkPredicate const& m_isFailing;
+  uint32_t m_numThreads;
+};
+
+auto split(Units const& units, std::size_t numChunks) -> std::vector<Units>
+{
+  std::vector<Units> result;
+  std::size_t start = 0;
+  for (std::size_t chunk = 0; chunk < numChunks; ++chunk) {
+    std::size_t const end = start + (units.size() - start) / (numChunks - chunk);
+    result.emplace_back(units.begin() + start, units.begin() + end);
+    start = end;
+  }
+  return result;
+}
+
+auto complementOf(std::vector<Units> const& chunks, std::size_t excludedChunk) -> Units
+{
+  Units result;
+  for (std::size_t idx = 0; idx < chunks.size(); ++idx) {
+    if (idx != excludedChunk) {
+      result.insert(result.end(), chunks[idx].begin(), chunks[idx].end());
+    }
+  }
+  return result;
+}
+
+/**
+ * Computes a 1-minimal subset of the units [0, numUnits) reproducing the failure,
+ * assuming that the full set reproduces it
+ */
+auto ddmin(std::size_t numUnits, CandidateBuilder const& build, CandidateChecker& checker)
+    -> Units
+{
+  Units units(numUnits);
+  for (std::size_t idx = 0; idx < numUnits; ++idx) {
+    units[idx] = idx;
+  }
+
+  std::size_t granularity = 2;
+  while (units.size() >= 2) {
+    std::vector<Units> const chunks = split(units, granularity);
+
+    // With two chunks, the subsets are equal to the complements
+    std::vector<Units> candidates;
+    if (granularity > 2) {
+      candidates = chunks;
+    }
+    std::size_t const numSubsets = candidates.size();
+    for (std::size_t idx = 0; idx < chunks.size(); ++idx) {
+      candidates.push_back(complementOf(chunks, idx));
+    }
+
+    std::optional<std::size_t> failing = checker.findFirstFailing(candidates, build);
+    if (failing.has_value()) {
+      units = std::move(candidates[*failing]);
+      granularity = (*failing < numSubsets) ? 2 : std::max(granularity - 1, std::size_t{2});
+    }
+    else if (granularity < units.size()) {
+      granularity = std::min(2 * granularity, units.size());
+    }
+    else {
+      break;
+    }
+  }
+
+  return units;
+}
+
+/**
+ * Splits the trace into blocks of commands, with each sequence of consecutive
+ * AddClauseCmd elements forming a single block
+ *
+ * \returns the start indices of the blocks
+ */
+auto getCmdBlockStarts(FuzzTrace const& trace) -> std::vector<std::size_t>
+{
+  std::vector<std::size_t> result;
+  for (std::size_t idx = 0; idx < trace.size(); ++idx) {
+    bool const continuesBlock = idx > 0 && std::holds_alternative<AddClauseCmd>(trace[idx]) &&
+                                std::holds_alternative<AddClauseCmd>(trace[idx - 1]);
+    if (!continuesBlock) {
+      result.push_back(idx);
+    }
+  }
+  return result;
+}
+
+auto shrinkCmdBlocks(FuzzTrace const& trace, CandidateChecker& checker) -> FuzzTrace
+{
+  std::vector<std::size_t> blockStarts = getCmdBlockStarts(trace);
+  blockStarts.push_back(trace.size());
+
+  auto build = [&trace, &blockStarts](Units const& keptBlocks) {
+    FuzzTrace result;
+    for (std::size_t block : keptBlocks) {
+      result.insert(result.end(),
+                    trace.begin() + blockStarts[block],
+                    trace.begin() + blockStarts[block + 1]);
+    }
+    return result;
+  };
+
+  return build(ddmin(blockStarts.size() - 1, build, checker));
+}
+
+auto shrinkCmds(FuzzTrace const& trace, CandidateChecker& checker) -> FuzzTrace
+{
+  auto build = [&trace](Units const& keptCmds) {
+    FuzzTrace result;
+    for (std::size_t cmd : keptCmds) {
+      result.push_back(trace[cmd]);
+    }
+    return result;
+  };
+
+  return build(ddmin(trace.size(), build, checker));
+}
+
+auto getLits(FuzzCmd& cmd) -> std::vector<CNFLit>*
+{
+  if (AddClauseCmd* addClause = std::get_if<AddClauseCmd>(&cmd); addClause != nullptr) {
+    return &addClause->clauseToAdd;
+  }
+  if (AssumeCmd* assume = std::get_if<AssumeCmd>(&cmd); assume != nullptr) {
+    return &assume->assumptions;
+  }
+  return nullptr;
+}
+
+auto shrinkLits(FuzzTrace const& trace, CandidateChecker& checker) -> FuzzTrace
+{
+  FuzzTrace result = trace;
+  for (std::size_t cmdIdx = 0; cmdIdx < result.size(); ++cmdIdx) {
+    std::vector<CNFLit> const* lits = getLits(result[cmdIdx]);
+    if (lits == nullptr || lits->size() < 2) {
+      continue;
+    }
+
+    std::vector<CNFLit> const originalLits = *lits;
+    auto build = [&result, &originalLits, cmdIdx](Units const& keptLits) {
+      FuzzTrace candidate = result;
+      std::vector<CNFLit>& candidateLits = *getLits(candidate[cmdIdx]);
+      candidateLits.clear();
+      for (std::size_t lit : keptLits) {
+        candidateLits.push_back(originalLits[lit]);
+      }
+      return candidate;
+    };
+
+    result = build(ddmin(originalLits.size(), build, checker));
+  }
+  return result;
+}
+}
+
+auto shrinkTrace(FuzzTrace const& trace, ShrinkPredicate const& isFailing, uint32_t numThreads)
+    -> FuzzTrace
+{
+  CandidateChecker checker{isFailing, numThreads};
+
+  FuzzTrace result = shrinkCmdBlocks(trace, checker);
+  result = shrinkCmds(result, checker);
+  return shrinkLits(result, checker);
+}
+}
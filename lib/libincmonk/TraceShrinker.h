@@ -0,0 +1,70 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Delta-debugging minimization of failure traces
+ */
+
+#pragma once
+
+#include <libincmonk/FuzzTrace.h>
+
+#include <cstdint>
+#include <functional>
+
+namespace incmonk {
+/**
+ * \brief Predicate determining whether a candidate trace still exhibits the failure
+ *   to be reproduced.
+ *
+ * The predicate is called concurrently from multiple threads.
+ */
+using ShrinkPredicate = std::function<bool(FuzzTrace const&)>;
+
+/**
+ * \brief Minimizes the given trace via delta debugging (ddmin).
+ *
+ * The trace is reduced in three passes: first over blocks of commands, with each
+ * sequence of consecutive AddClauseCmd elements forming a single block, then over
+ * single commands, and finally over the literals of each clause and assumption
+ * command. Each pass yields a trace from which no single block, command rsp. literal
+ * can be removed without losing the failure.
+ *
+ * The candidate traces of each ddmin step are checked concurrently. Among the
+ * candidates reproducing the failure, the one occurring first in the ddmin candidate
+ * order is chosen, so the result does not depend on `numThreads`.
+ *
+ * \param trace       A trace for which `isFailing` returns true
+ * \param isFailing   Predicate determining whether a trace reproduces the failure
+ * \param numThreads  Maximum number of candidates checked concurrently
+ *
+ * \returns the minimized trace
+ */
+auto shrinkTrace(FuzzTrace const& trace, ShrinkPredicate const& isFailing, uint32_t numThreads)
+    -> FuzzTrace;
+}
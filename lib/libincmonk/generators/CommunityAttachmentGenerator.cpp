@@ -27,15 +27,68 @@
 #include <libincmonk/generators/CommunityAttachmentGenerator.h>
 
 #include <libincmonk/CNF.h>
+#include <libincmonk/FastRand.h>
+#include <libincmonk/FuzzCmdSource.h>
 #include <libincmonk/InterspersionSchedulers.h>
 
+#include <gsl/span>
+
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <random>
+#include <variant>
+#include <vector>
 
 
 namespace incmonk {
 namespace {
+
+/**
+ * \brief Set of integers in [0, size), which can be cleared in constant time.
+ *
+ * Membership is tracked by stamping each element with the value of a counter which
+ * is incremented on clear().
+ */
+class StampSet {
+public:
+  /// Enlarges the set's domain to [0, size) if it is smaller
+  void reserve(std::size_t size)
+  {
+    if (m_stamps.size() < size) {
+      m_stamps.resize(size, 0);
+    }
+  }
+
+  /// Returns false iff `value` already is an element of the set
+  auto insert(std::size_t value) noexcept -> bool
+  {
+    assert(value < m_stamps.size());
+    if (m_stamps[value] == m_currentStamp) {
+      return false;
+    }
+    m_stamps[value] = m_currentStamp;
+    return true;
+  }
+
+  void clear() noexcept
+  {
+    ++m_currentStamp;
+    if (m_currentStamp == 0) {
+      std::fill(m_stamps.begin(), m_stamps.end(), 0);
+      m_currentStamp = 1;
+    }
+  }
+
+private:
+  std::vector<uint32_t> m_stamps;
+  uint32_t m_currentStamp = 1;
+};
+
+
 class CommunityAttachmentGen final : public FuzzTraceGenerator {
 public:
   CommunityAttachmentGen(CommunityAttachmentModelParams params) : m_params{std::move(params)}
@@ -44,114 +97,181 @@ public:
   }
 
 
-  // Fills communityIndices with the index for each literal of the clause
-  // under construction. Afterwards, communityIndices[i] = x means that
-  // clauseUnderConstruction[i] will get a variable in community x.
-  void selectCommunities(std::vector<int32_t>& communityIndices,
-                         int32_t numCommunities,
-                         double modularity)
+  // Fills m_communityIndices with the index for each literal of the clause
+  // under construction. Afterwards, m_communityIndices[i] = x means that
+  // the i'th literal of the clause will get a variable in community x.
+  void selectCommunities()
   {
-    std::uniform_real_distribution<> sameCommunityDistr{0.0, 1.0};
-    std::uniform_int_distribution<int32_t> communityIdDistr{0, numCommunities - 1};
-
-    double p = modularity + 1.0 / static_cast<double>(numCommunities);
-
-    if (sameCommunityDistr(m_rng) <= p) {
+    if (m_unitDist(m_clauseRng) <= m_sameCommunityProbability) {
       // All literals of the clause will belong to the same community
-      int32_t community = communityIdDistr(m_rng);
-      std::fill(communityIndices.begin(), communityIndices.end(), community);
+      std::fill(
+          m_communityIndices.begin(), m_communityIndices.end(), m_communityDist(m_clauseRng));
     }
     else {
       // Communities of literals will be pairwise distinct
-      for (int32_t& c : communityIndices) {
+      m_usedCommunities.clear();
+      for (uint32_t& c : m_communityIndices) {
         do {
-          c = communityIdDistr(m_rng);
-        } while (m_communityStampBuffer[c] != 0);
-        m_communityStampBuffer[c] = 1;
-      }
-
-      for (int32_t c : communityIndices) {
-        m_communityStampBuffer[c] = 0;
+          c = m_communityDist(m_clauseRng);
+        } while (!m_usedCommunities.insert(c));
       }
     }
   }
 
-  bool hasDuplicates(std::vector<CNFLit>& vec)
+  // Fills `target` with the next clause of the trace under construction (see
+  // beginClauses()): literals over pairwise distinct variables, with the variables
+  // being in the communities chosen by selectCommunities().
+  //
+  // Variables are drawn without replacement, so only literals clashing with
+  // previously drawn ones are redrawn. Like rejecting whole clauses containing
+  // duplicates, this yields each clause of distinct variables with equal
+  // probability.
+  void generateClause(gsl::span<CNFLit> target)
   {
-    if (vec.size() < 4) {
-      std::sort(vec.begin(), vec.end());
-      return std::adjacent_find(vec.begin(), vec.end()) != vec.end();
+    assert(target.size() == m_communityIndices.size());
+
+    selectCommunities();
+    m_usedVariables.clear();
+    for (std::size_t i = 0; i < target.size(); ++i) {
+      uint32_t const community = m_communityIndices[i];
+      VarDist::param_type const bounds{m_communityBounds[community] + 1,
+                                       m_communityBounds[community + 1]};
+      CNFLit var = 0;
+      do {
+        var = m_varDist(m_clauseRng, bounds);
+      } while (!m_usedVariables.insert(var));
+      target[i] = var;
     }
-    else {
-      bool result = false;
-      for (CNFLit lit : vec) {
-        assert(lit > 0);
-        if (m_variableStampBuffer[lit] == 1) {
-          result = false;
-          break;
-        }
-      }
 
-      for (CNFLit lit : vec) {
-        assert(lit > 0);
-        m_variableStampBuffer[lit] = 0;
+    uint64_t signs = 0;
+    for (std::size_t i = 0; i < target.size(); ++i) {
+      if (i % 64 == 0) {
+        signs = m_clauseRng();
       }
-
-      return result;
+      target[i] = (signs & 1) != 0 ? target[i] : -target[i];
+      signs >>= 1;
     }
   }
 
-  void generateClause(std::vector<CNFLit>& targetBuffer,
-                      std::vector<int32_t> const& communityIndices,
-                      int32_t numVariables,
-                      int32_t numCommunities)
+  // Prepares generating the clauses of a trace via generateClause()
+  void beginClauses(uint32_t numVariables,     // n > 0
+                    uint32_t numCommunities,   // c > 0
+                    uint32_t numLitsPerClause, // k > 0
+                    double modularity,         // Q
+                    uint64_t seed)
   {
-    do {
-      for (std::vector<int32_t>::size_type i = 0; i < targetBuffer.size(); ++i) {
-        double nc = static_cast<double>(numVariables) / static_cast<double>(numCommunities);
-
-        // community indices {0, ..., c-1}, while in the paper they are {1, ..., c}
-        uint32_t lowerBound = std::floor(communityIndices[i] * nc) + 1;
-        uint32_t upperBound = std::floor((communityIndices[i] + 1) * nc);
-        std::uniform_int_distribution<int32_t> varDist(lowerBound, upperBound);
-        targetBuffer[i] = varDist(m_rng);
-      }
-    } while (hasDuplicates(targetBuffer));
+    assert(numCommunities >= numLitsPerClause);
+    assert(numVariables / numCommunities >= numLitsPerClause);
 
-    std::uniform_int_distribution<int32_t> signDistr{0, 1};
-    for (CNFLit& lit : targetBuffer) {
-      lit = signDistr(m_rng) == 1 ? lit : -lit;
+    m_clauseRng = XorShiftRandomBitGenerator{seed};
+
+    // Community x consists of the variables m_communityBounds[x] + 1, ..., m_communityBounds[x+1].
+    // (Community indices are {0, ..., c-1}, while in the paper they are {1, ..., c})
+    m_communityBounds.resize(numCommunities + 1);
+    for (uint32_t x = 0; x <= numCommunities; ++x) {
+      m_communityBounds[x] =
+          static_cast<CNFLit>(static_cast<uint64_t>(x) * numVariables / numCommunities);
     }
+
+    m_communityIndices.resize(numLitsPerClause);
+    m_communityDist = std::uniform_int_distribution<uint32_t>{0, numCommunities - 1};
+    m_usedCommunities.reserve(numCommunities);
+    m_usedVariables.reserve(static_cast<std::size_t>(numVariables) + 1);
+
+    m_sameCommunityProbability = modularity + 1.0 / static_cast<double>(numCommunities);
   }
 
-  auto generate(uint32_t numClauses,       // m > 0
-                uint32_t numVariables,     // n > 0
-                uint32_t numCommunities,   // c > 0
-                uint32_t numLitsPerClause, // k > 0
-                double modularity          // Q
-                ) -> FuzzTrace
+  // Streams the clauses into the solve and havoc command inserters, so only the
+  // final trace is materialized
+  auto generate() -> FuzzTrace override
   {
+    TraceParams const params = beginTrace();
+
+    // The inserters are timed excluding the time spent generating the clauses
+    FuzzCmdSourceProfiler profiler;
+    std::unique_ptr<FuzzCmdSource> source = profiler.profile(
+        std::make_unique<ClauseSource>(*this, params.numClauses, params.clauseSize),
+        std::nullopt);
+    source = profiler.profile(
+        createSolveCmdInserter(
+            std::move(source), m_params.solveCmdSchedule, params.numClauses, params.solveCmdSeed),
+        ProfilePhase::INSERT_SOLVE_CMDS);
+    if (params.havocCmdSeed.has_value()) {
+      source = profiler.profile(createHavocCmdInserter(std::move(source),
+                                                       *m_params.havocSchedule,
+                                                       *params.havocCmdSeed),
+                                ProfilePhase::INSERT_HAVOC_CMDS);
+    }
+
     FuzzTrace result;
+    result.reserve(params.numClauses + params.numClauses / 8);
+    appendCmds(*source, result);
+    return result;
+  }
 
-    std::vector<int32_t> communityIndices, clauseBuffer;
-    communityIndices.resize(numLitsPerClause);
-    clauseBuffer.resize(numLitsPerClause);
+  auto generateFlat() -> FlatFuzzTrace override
+  {
+    TraceParams const params = beginTrace();
+
+    FlatFuzzTrace problem;
+    problem.reserve(params.numClauses,
+                    static_cast<std::size_t>(params.numClauses) * params.clauseSize);
+    m_clauseBuffer.resize(params.clauseSize);
+    for (uint32_t j = 1; j <= params.numClauses; ++j) {
+      generateClause(m_clauseBuffer);
+      problem.addClause(m_clauseBuffer);
+    }
+
+    FlatFuzzTrace result =
+        insertSolveCmds(problem, m_params.solveCmdSchedule, params.numClauses, params.solveCmdSeed);
+    if (params.havocCmdSeed.has_value()) {
+      return insertHavocCmds(result, *m_params.havocSchedule, *params.havocCmdSeed);
+    }
+    else {
+      return result;
+    }
+  }
 
-    m_communityStampBuffer.clear();
-    m_communityStampBuffer.resize(numCommunities);
-    m_variableStampBuffer.clear();
-    m_variableStampBuffer.resize(numVariables + 1);
+  virtual ~CommunityAttachmentGen() = default;
 
-    for (uint32_t j = 1; j <= numClauses; ++j) {
-      selectCommunities(communityIndices, numCommunities, modularity);
-      generateClause(clauseBuffer, communityIndices, numVariables, numCommunities);
-      result.push_back(AddClauseCmd{clauseBuffer});
+private:
+  // Produces the clauses of the trace under construction on demand
+  class ClauseSource final : public FuzzCmdSource {
+  public:
+    ClauseSource(CommunityAttachmentGen& generator, uint32_t numClauses, uint32_t clauseSize)
+      : m_generator{generator}, m_numRemainingClauses{numClauses}, m_clauseSize{clauseSize}
+    {
     }
 
-    return result;
-  }
+    auto readNext(FuzzCmd& target) -> bool override
+    {
+      if (m_numRemainingClauses == 0) {
+        return false;
+      }
+      --m_numRemainingClauses;
 
-  auto generate() -> FuzzTrace override
+      target = AddClauseCmd{};
+      CNFClause& clause = std::get<AddClauseCmd>(target).clauseToAdd;
+      clause.resize(m_clauseSize);
+      m_generator.generateClause(clause);
+      return true;
+    }
+
+  private:
+    CommunityAttachmentGen& m_generator;
+    uint32_t m_numRemainingClauses;
+    uint32_t m_clauseSize;
+  };
+
+  struct TraceParams {
+    uint32_t numClauses = 0;
+    uint32_t clauseSize = 0;
+    uint64_t solveCmdSeed = 0;
+    std::optional<uint64_t> havocCmdSeed;
+  };
+
+  // Draws the parameters of the next trace and prepares generating its clauses
+  auto beginTrace() -> TraceParams
   {
     uint32_t numClauses = std::max(0.0, std::round(m_params.numClausesDistribution(m_rng)));
     double variableQuot = m_params.numVariablesPerClauseDistribution(m_rng);
@@ -171,24 +291,39 @@ public:
 
 
     std::uniform_int_distribution<int32_t> solveCmdSeedDistr;
+    std::uniform_int_distribution<uint64_t> clauseSeedDistr{1};
 
-    FuzzTrace problem = generate(numClauses, numVariables, numCommunities, clauseSize, modularity);
-    FuzzTrace result = insertSolveCmds(
-        std::move(problem), m_params.solveCmdSchedule, numClauses, solveCmdSeedDistr(m_rng));
+    beginClauses(numVariables, numCommunities, clauseSize, modularity, clauseSeedDistr(m_rng));
+
+    TraceParams result;
+    result.numClauses = numClauses;
+    result.clauseSize = clauseSize;
+    result.solveCmdSeed = solveCmdSeedDistr(m_rng);
     if (m_params.havocSchedule.has_value()) {
-      return insertHavocCmds(std::move(result), *m_params.havocSchedule, solveCmdSeedDistr(m_rng));
-    }
-    else {
-      return result;
+      result.havocCmdSeed = solveCmdSeedDistr(m_rng);
     }
+    return result;
   }
 
-  virtual ~CommunityAttachmentGen() = default;
+  using VarDist = std::uniform_int_distribution<CNFLit>;
 
-private:
   std::mt19937 m_rng;
-  std::vector<int32_t> m_communityStampBuffer;
-  std::vector<int32_t> m_variableStampBuffer;
+
+  // Generator of the clauses of the trace under construction
+  XorShiftRandomBitGenerator m_clauseRng{1};
+  double m_sameCommunityProbability = 0.0;
+
+  // Scratch buffers of the clause generator, reused across traces
+  std::vector<CNFLit> m_communityBounds;
+  std::vector<uint32_t> m_communityIndices;
+  std::vector<CNFLit> m_clauseBuffer;
+  StampSet m_usedCommunities;
+  StampSet m_usedVariables;
+
+  std::uniform_real_distribution<> m_unitDist{0.0, 1.0};
+  std::uniform_int_distribution<uint32_t> m_communityDist;
+  VarDist m_varDist;
+
   CommunityAttachmentModelParams m_params;
 };
 }
@@ -32,12 +32,25 @@
 
 #pragma once
 
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 
 namespace incmonk {
 class FuzzTraceGenerator {
 public:
   virtual auto generate() -> FuzzTrace = 0;
+
+  /**
+   * \brief Generates a trace in the flat representation.
+   *
+   * Generators should override this function to avoid building a FuzzTrace first.
+   */
+  virtual auto generateFlat() -> FlatFuzzTrace
+  {
+    FuzzTrace const trace = generate();
+    return toFlatFuzzTrace(trace.begin(), trace.end());
+  }
+
   virtual ~FuzzTraceGenerator() = default;
 };
 }
\ No newline at end of file
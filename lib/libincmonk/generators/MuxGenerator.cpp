@@ -28,6 +28,7 @@
 #include <libincmonk/generators/MuxGenerator.h>
 
 #include <cassert>
+#include <mutex>
 #include <random>
 
 namespace incmonk {
@@ -43,10 +44,30 @@ auto getTotalOfWeights(std::vector<MuxGeneratorSpec> const& specs) -> double
   return result;
 }
 
-class MuxGenerator final : public FuzzTraceGenerator {
+/**
+ * Returns the factor by which weights are scaled to obtain the prior pseudo-counts
+ * of failures, such that the average prior pseudo-count of the used generators is 1
+ */
+auto getPriorScale(std::vector<MuxGeneratorSpec> const& specs) -> double
+{
+  double numUsedGenerators = 0.0;
+  for (MuxGeneratorSpec const& spec : specs) {
+    if (spec.weight > 0.0) {
+      numUsedGenerators += 1.0;
+    }
+  }
+  return numUsedGenerators / getTotalOfWeights(specs);
+}
+
+class MuxGeneratorImpl final : public MuxGenerator {
 public:
-  MuxGenerator(std::vector<MuxGeneratorSpec>&& specs, uint64_t seed)
-    : m_rng{seed}, m_selectionDist{0.0, getTotalOfWeights(specs)}, m_specs{std::move(specs)}
+  MuxGeneratorImpl(std::vector<MuxGeneratorSpec>&& specs, uint64_t seed, MuxSelectionPolicy policy)
+    : m_rng{seed}
+    , m_selectionDist{0.0, getTotalOfWeights(specs)}
+    , m_priorScale{getPriorScale(specs)}
+    , m_policy{policy}
+    , m_specs{std::move(specs)}
+    , m_stats(m_specs.size())
   {
   }
 
@@ -56,38 +77,146 @@ public:
       return {};
     }
 
-    double selectingWeight = m_selectionDist(m_rng);
-    return getGenerator(selectingWeight).generate();
+    return selectGenerator().generate();
+  }
+
+  auto generateFlat() -> FlatFuzzTrace override
+  {
+    if (m_specs.empty()) {
+      return {};
+    }
+
+    return selectGenerator().generateFlat();
   }
 
-  virtual ~MuxGenerator() = default;
+  auto getLastGeneratorIndex() const noexcept -> std::size_t override
+  {
+    return m_lastGeneratorIdx;
+  }
+
+  void reportExecution(std::size_t generatorIdx,
+                       bool foundFailure,
+                       std::chrono::duration<double> executionTime) override
+  {
+    if (m_policy != MuxSelectionPolicy::THOMPSON_SAMPLING) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock{m_statsMutex};
+    GeneratorStats& stats = m_stats[generatorIdx];
+    ++stats.numExecutions;
+    stats.numFailures += foundFailure ? 1 : 0;
+    stats.totalExecutionTime += executionTime.count();
+  }
+
+  virtual ~MuxGeneratorImpl() = default;
 
 private:
-  auto getGenerator(double selectionWeight) -> FuzzTraceGenerator&
+  struct GeneratorStats {
+    uint64_t numExecutions = 0;
+    uint64_t numFailures = 0;
+    double totalExecutionTime = 0.0;
+  };
+
+  auto selectGenerator() -> FuzzTraceGenerator&
+  {
+    if (m_policy == MuxSelectionPolicy::THOMPSON_SAMPLING) {
+      m_lastGeneratorIdx = sampleGeneratorIndex();
+    }
+    else {
+      m_lastGeneratorIdx = getGeneratorIndex(m_selectionDist(m_rng));
+    }
+    return *(m_specs[m_lastGeneratorIdx].generator);
+  }
+
+  auto getGeneratorIndex(double selectionWeight) -> std::size_t
   {
     double currentWeight = 0.0;
-    for (MuxGeneratorSpec& spec : m_specs) {
-      currentWeight += spec.weight;
+    for (std::size_t idx = 0; idx < m_specs.size(); ++idx) {
+      currentWeight += m_specs[idx].weight;
       if (selectionWeight <= currentWeight) {
-        return *(spec.generator);
+        return idx;
       }
     }
 
     assert(false && "Error: failed to look up generator");
-    return *(m_specs[0].generator);
+    return 0;
+  }
+
+  /**
+   * Samples a failure probability for each generator from its posterior beta
+   * distribution, and selects the generator with the highest sampled number of
+   * failures per second of execution time.
+   */
+  auto sampleGeneratorIndex() -> std::size_t
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_statsMutex};
+      m_statsSnapshot = m_stats;
+    }
+
+    // Generators whose traces have not been executed yet are assumed to be as fast
+    // as the average generator
+    double totalExecutionTime = 0.0;
+    uint64_t totalExecutions = 0;
+    for (GeneratorStats const& stats : m_statsSnapshot) {
+      totalExecutionTime += stats.totalExecutionTime;
+      totalExecutions += stats.numExecutions;
+    }
+    double const defaultMeanTime =
+        (totalExecutions > 0 && totalExecutionTime > 0.0) ? totalExecutionTime / totalExecutions
+                                                          : 1.0;
+
+    std::size_t result = 0;
+    double bestScore = -1.0;
+    for (std::size_t idx = 0; idx < m_specs.size(); ++idx) {
+      if (m_specs[idx].weight <= 0.0) {
+        continue;
+      }
+
+      GeneratorStats const& stats = m_statsSnapshot[idx];
+      double const alpha = m_priorScale * m_specs[idx].weight + stats.numFailures;
+      double const beta = 1.0 + (stats.numExecutions - stats.numFailures);
+      double meanTime = defaultMeanTime;
+      if (stats.numExecutions > 0 && stats.totalExecutionTime > 0.0) {
+        meanTime = stats.totalExecutionTime / stats.numExecutions;
+      }
+
+      double const score = sampleBeta(alpha, beta) / meanTime;
+      if (score > bestScore) {
+        bestScore = score;
+        result = idx;
+      }
+    }
+    return result;
+  }
+
+  auto sampleBeta(double alpha, double beta) -> double
+  {
+    double const x = std::gamma_distribution<double>{alpha, 1.0}(m_rng);
+    double const y = std::gamma_distribution<double>{beta, 1.0}(m_rng);
+    return (x + y > 0.0) ? x / (x + y) : 0.0;
   }
 
   XorShiftRandomBitGenerator m_rng;
   std::uniform_real_distribution<double> m_selectionDist;
+  double m_priorScale;
+  MuxSelectionPolicy m_policy;
   std::vector<MuxGeneratorSpec> m_specs;
+  std::size_t m_lastGeneratorIdx = 0;
+
+  std::mutex m_statsMutex;
+  std::vector<GeneratorStats> m_stats;
+  std::vector<GeneratorStats> m_statsSnapshot;
 };
 }
 
 
-auto createMuxGenerator(std::vector<MuxGeneratorSpec>&& specs, uint64_t seed)
-    -> std::unique_ptr<FuzzTraceGenerator>
+auto createMuxGenerator(std::vector<MuxGeneratorSpec>&& specs,
+                        uint64_t seed,
+                        MuxSelectionPolicy policy) -> std::unique_ptr<MuxGenerator>
 {
   assert(!specs.empty());
-  return std::make_unique<MuxGenerator>(std::move(specs), seed);
+  return std::make_unique<MuxGeneratorImpl>(std::move(specs), seed, policy);
+}
 }
-}
\ No newline at end of file
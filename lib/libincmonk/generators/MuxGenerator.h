@@ -34,6 +34,9 @@
 
 #include <libincmonk/generators/FuzzTraceGenerator.h>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -50,6 +53,46 @@ struct MuxGeneratorSpec {
   std::unique_ptr<FuzzTraceGenerator> generator;
 };
 
+/**
+ * Policies for selecting the generator producing the next trace
+ */
+enum class MuxSelectionPolicy {
+  /// Generators are selected at random, with probabilities proportional to their weights
+  FIXED_WEIGHTS,
+
+  /// Generators are selected via Thompson sampling, favoring generators whose traces
+  /// reveal more failures per second of execution time. The probability of finding a
+  /// failure is modeled per generator via a beta distribution, with the generators'
+  /// weights as prior pseudo-counts of failures. Generators with weight 0 are not used.
+  THOMPSON_SAMPLING
+};
+
+/**
+ * A FuzzTraceGenerator using other generators for trace generation, optionally adapting
+ * the selection of generators to the results of executing their traces.
+ */
+class MuxGenerator : public FuzzTraceGenerator {
+public:
+  /**
+   * Returns the index of the generator (within the `specs` passed to createMuxGenerator())
+   * which produced the most recently generated trace.
+   */
+  virtual auto getLastGeneratorIndex() const noexcept -> std::size_t = 0;
+
+  /**
+   * Reports the result of executing a trace produced by the generator with index
+   * `generatorIdx`. With MuxSelectionPolicy::THOMPSON_SAMPLING, the result is used for
+   * selecting the generators of subsequent traces. Otherwise, it is ignored.
+   *
+   * This function may be called concurrently with the other member functions.
+   */
+  virtual void reportExecution(std::size_t generatorIdx,
+                               bool foundFailure,
+                               std::chrono::duration<double> executionTime) = 0;
+
+  virtual ~MuxGenerator() = default;
+};
+
 /**
  * Creates a FuzzTraceGenerator using provided fuzz trace generators for trace generation,
  * selecting generators at random using weights.
@@ -58,9 +101,12 @@ struct MuxGeneratorSpec {
  *                `specs` must contain at least one element. The total of weights must be
  *                greater than 0.
  * \param seed    the random seed used for generator selection.
+ * \param policy  the generator selection policy.
  * 
  * \returns       The multiplexing generator.
  */
-auto createMuxGenerator(std::vector<MuxGeneratorSpec>&& specs, uint64_t seed)
-    -> std::unique_ptr<FuzzTraceGenerator>;
-}
\ No newline at end of file
+auto createMuxGenerator(std::vector<MuxGeneratorSpec>&& specs,
+                        uint64_t seed,
+                        MuxSelectionPolicy policy = MuxSelectionPolicy::FIXED_WEIGHTS)
+    -> std::unique_ptr<MuxGenerator>;
+}
@@ -26,6 +26,7 @@
 
 #include <libincmonk/CNF.h>
 #include <libincmonk/FastRand.h>
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/generators/SimplifiersParadiseGenerator.h>
 
@@ -33,6 +34,7 @@
 #include <cassert>
 #include <cmath>
 #include <random>
+#include <type_traits>
 #include <vector>
 
 namespace incmonk {
@@ -218,17 +220,28 @@ public:
   {
   }
 
-  auto generate() -> FuzzTrace override
+  auto generate() -> FuzzTrace override { return generateTrace<FuzzTrace>(); }
+
+  auto generateFlat() -> FlatFuzzTrace override { return generateTrace<FlatFuzzTrace>(); }
+
+private:
+  template <typename TraceT>
+  auto generateTrace() -> TraceT
   {
     size_t const size = std::floor(m_params.numClausesDistribution(m_rng));
     LiteralFactory litFactory;
 
-    FuzzTrace problem;
+    TraceT problem;
     for (CNFClause& clause : createSimplifiersParadiseProblem(m_rng(), size, litFactory)) {
-      problem.push_back(AddClauseCmd{std::move(clause)});
+      if constexpr (std::is_same_v<TraceT, FlatFuzzTrace>) {
+        problem.addClause(clause);
+      }
+      else {
+        problem.push_back(AddClauseCmd{std::move(clause)});
+      }
     }
 
-    FuzzTrace result = insertSolveCmds(
+    TraceT result = insertSolveCmds(
         std::move(problem), m_params.solveCmdSchedule, litFactory.currentMaxLit(), m_rng());
     if (m_params.havocSchedule.has_value()) {
       return insertHavocCmds(std::move(result), *m_params.havocSchedule, m_rng());
@@ -238,7 +251,6 @@ public:
     }
   }
 
-private:
   XorShiftRandomBitGenerator m_rng;
   SimplifiersParadiseParams m_params;
 };
@@ -0,0 +1,236 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include "BenchmarkHarness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <thread>
+
+#include <time.h>
+
+namespace incmonk::bench {
+
+namespace {
+auto getProcessCPUTime() -> std::chrono::nanoseconds
+{
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+}
+}
+
+BenchmarkState::BenchmarkState(uint64_t numIterations) : m_numIterations{numIterations} {}
+
+auto BenchmarkState::keepRunning() -> bool
+{
+  if (!m_started) {
+    m_started = true;
+    startTimers();
+  }
+
+  if (m_iteration == m_numIterations) {
+    if (m_running) {
+      stopTimers();
+    }
+    return false;
+  }
+
+  ++m_iteration;
+  return true;
+}
+
+void BenchmarkState::pauseTiming()
+{
+  stopTimers();
+}
+
+void BenchmarkState::resumeTiming()
+{
+  startTimers();
+}
+
+void BenchmarkState::setItemsProcessed(uint64_t numItems) noexcept
+{
+  m_itemsProcessed = numItems;
+}
+
+auto BenchmarkState::getNumIterations() const noexcept -> uint64_t
+{
+  return m_numIterations;
+}
+
+auto BenchmarkState::getRealTime() const noexcept -> std::chrono::duration<double>
+{
+  return m_realTime;
+}
+
+auto BenchmarkState::getCPUTime() const noexcept -> std::chrono::duration<double>
+{
+  return m_cpuTime;
+}
+
+auto BenchmarkState::getItemsProcessed() const noexcept -> std::optional<uint64_t>
+{
+  return m_itemsProcessed;
+}
+
+void BenchmarkState::startTimers()
+{
+  m_running = true;
+  m_cpuStart = getProcessCPUTime();
+  m_realStart = std::chrono::steady_clock::now();
+}
+
+void BenchmarkState::stopTimers()
+{
+  m_realTime += std::chrono::steady_clock::now() - m_realStart;
+  m_cpuTime += getProcessCPUTime() - m_cpuStart;
+  m_running = false;
+}
+
+auto runBenchmark(Benchmark const& benchmark, std::chrono::duration<double> minTime)
+    -> BenchmarkResult
+{
+  constexpr uint64_t maxIterations = 1'000'000'000;
+
+  uint64_t numIterations = 1;
+  while (true) {
+    BenchmarkState state{numIterations};
+    benchmark.fn(state);
+
+    double const seconds = state.getRealTime().count();
+    if (seconds >= minTime.count() || numIterations >= maxIterations) {
+      BenchmarkResult result;
+      result.name = benchmark.name;
+      result.numIterations = numIterations;
+      result.realTime = state.getRealTime() / numIterations;
+      result.cpuTime = state.getCPUTime() / numIterations;
+      if (state.getItemsProcessed().has_value() && seconds > 0.0) {
+        result.itemsPerSecond = static_cast<double>(*state.getItemsProcessed()) / seconds;
+      }
+      return result;
+    }
+
+    // Like Google Benchmark, aim for 1.4 times the minimum time, growing by at most
+    // a factor of 10 per run
+    double const estimate = seconds > 0.0 ? 1.4 * minTime.count() / seconds * numIterations
+                                          : 10.0 * numIterations;
+    double const next = std::clamp(
+        estimate, static_cast<double>(numIterations + 1), 10.0 * numIterations);
+    numIterations = std::min(static_cast<uint64_t>(std::ceil(next)), maxIterations);
+  }
+}
+
+namespace {
+auto escapeJSON(std::string const& str) -> std::string
+{
+  std::string result;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+auto getCurrentDate() -> std::string
+{
+  std::time_t const now = std::time(nullptr);
+  std::tm localNow;
+  localtime_r(&now, &localNow);
+  char buffer[64];
+  std::strftime(buffer, sizeof(buffer), "%FT%T%z", &localNow);
+  return buffer;
+}
+
+auto toNanos(std::chrono::duration<double> time) -> double
+{
+  return time.count() * 1.0e9;
+}
+}
+
+void writeJSONReport(std::vector<BenchmarkResult> const& results,
+                     std::string const& executableName,
+                     std::ostream& stream)
+{
+#if defined(NDEBUG)
+  char const* buildType = "release";
+#else
+  char const* buildType = "debug";
+#endif
+
+  stream << "{\n";
+  stream << "  \"context\": {\n";
+  stream << "    \"date\": \"" << getCurrentDate() << "\",\n";
+  stream << "    \"executable\": \"" << escapeJSON(executableName) << "\",\n";
+  stream << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+  stream << "    \"library_build_type\": \"" << buildType << "\"\n";
+  stream << "  },\n";
+  stream << "  \"benchmarks\": [";
+
+  char const* separator = "\n";
+  for (BenchmarkResult const& result : results) {
+    stream << separator;
+    separator = ",\n";
+    stream << "    {\n";
+    stream << "      \"name\": \"" << escapeJSON(result.name) << "\",\n";
+    stream << "      \"run_name\": \"" << escapeJSON(result.name) << "\",\n";
+    stream << "      \"run_type\": \"iteration\",\n";
+    stream << "      \"iterations\": " << result.numIterations << ",\n";
+    stream << "      \"real_time\": " << toNanos(result.realTime) << ",\n";
+    stream << "      \"cpu_time\": " << toNanos(result.cpuTime) << ",\n";
+    if (result.itemsPerSecond.has_value()) {
+      stream << "      \"items_per_second\": " << *result.itemsPerSecond << ",\n";
+    }
+    stream << "      \"time_unit\": \"ns\"\n";
+    stream << "    }";
+  }
+  stream << "\n  ]\n";
+  stream << "}\n";
+}
+
+void writeConsoleReport(std::vector<BenchmarkResult> const& results, std::ostream& stream)
+{
+  stream << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(16)
+         << "Time (ns)" << std::setw(16) << "CPU (ns)" << std::setw(14) << "Iterations"
+         << std::setw(16) << "Items/s"
+         << "\n";
+  stream << std::fixed << std::setprecision(0);
+  for (BenchmarkResult const& result : results) {
+    stream << std::left << std::setw(40) << result.name << std::right << std::setw(16)
+           << toNanos(result.realTime) << std::setw(16) << toNanos(result.cpuTime)
+           << std::setw(14) << result.numIterations;
+    if (result.itemsPerSecond.has_value()) {
+      stream << std::setw(16) << *result.itemsPerSecond;
+    }
+    stream << "\n";
+  }
+}
+}
@@ -0,0 +1,142 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief A minimal benchmark harness, writing results in the JSON format of
+ *   Google Benchmark
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace incmonk::bench {
+
+/**
+ * \brief The state of a benchmark run, controlling the benchmark loop:
+ *
+ * ```
+ * void benchmarkFoo(BenchmarkState& state)
+ * {
+ *   Foo foo = setUpFoo();
+ *   while (state.keepRunning()) {
+ *     doNotOptimize(foo.bar());
+ *   }
+ * }
+ * ```
+ *
+ * Only the time spent within the loop is measured.
+ */
+class BenchmarkState {
+public:
+  explicit BenchmarkState(uint64_t numIterations);
+
+  /**
+   * \brief Returns true iff another iteration needs to be executed. Starts the timers
+   *   when called the first time, and stops them after the last iteration.
+   */
+  auto keepRunning() -> bool;
+
+  /// Stops the timers, e.g. for excluding per-iteration setup work
+  void pauseTiming();
+  void resumeTiming();
+
+  /// Sets the number of items (e.g. clauses, commands) processed by all iterations
+  void setItemsProcessed(uint64_t numItems) noexcept;
+
+  auto getNumIterations() const noexcept -> uint64_t;
+  auto getRealTime() const noexcept -> std::chrono::duration<double>;
+  auto getCPUTime() const noexcept -> std::chrono::duration<double>;
+  auto getItemsProcessed() const noexcept -> std::optional<uint64_t>;
+
+private:
+  void startTimers();
+  void stopTimers();
+
+  uint64_t m_numIterations;
+  uint64_t m_iteration = 0;
+  bool m_started = false;
+  bool m_running = false;
+
+  std::chrono::steady_clock::time_point m_realStart;
+  std::chrono::nanoseconds m_cpuStart{0};
+  std::chrono::duration<double> m_realTime{0};
+  std::chrono::duration<double> m_cpuTime{0};
+  std::optional<uint64_t> m_itemsProcessed;
+};
+
+using BenchmarkFn = std::function<void(BenchmarkState&)>;
+
+struct Benchmark {
+  std::string name;
+  BenchmarkFn fn;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  uint64_t numIterations = 0;
+
+  /// Times per iteration
+  std::chrono::duration<double> realTime{0};
+  std::chrono::duration<double> cpuTime{0};
+
+  std::optional<double> itemsPerSecond;
+};
+
+/**
+ * \brief Runs the benchmark, increasing the number of iterations until the measured
+ *   time of a run is at least `minTime`.
+ */
+auto runBenchmark(Benchmark const& benchmark, std::chrono::duration<double> minTime)
+    -> BenchmarkResult;
+
+/**
+ * \brief Writes the results in the JSON format of Google Benchmark, so that they can be
+ *   compared using Google Benchmark's tools (e.g. compare.py)
+ */
+void writeJSONReport(std::vector<BenchmarkResult> const& results,
+                     std::string const& executableName,
+                     std::ostream& stream);
+
+void writeConsoleReport(std::vector<BenchmarkResult> const& results, std::ostream& stream);
+
+/**
+ * \brief Keeps the compiler from optimizing away the computation of `value`.
+ */
+template <typename T>
+void doNotOptimize(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+}
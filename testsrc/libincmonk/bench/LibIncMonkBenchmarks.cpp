@@ -0,0 +1,424 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include "BenchmarkHarness.h"
+
+#include <libincmonk/Config.h>
+#include <libincmonk/Fork.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/InterspersionSchedulers.h>
+#include <libincmonk/Oracle.h>
+#include <libincmonk/generators/CommunityAttachmentGenerator.h>
+#include <libincmonk/generators/SimplifiersParadiseGenerator.h>
+#include <libincmonk/verifier/Clause.h>
+#include <libincmonk/verifier/RUPChecker.h>
+
+#include <CLI/CLI.hpp>
+
+#include <gsl/span>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <unistd.h>
+
+namespace incmonk::bench {
+
+namespace {
+constexpr uint64_t benchmarkSeed = 42;
+
+auto generateCommunityAttachmentTrace() -> FuzzTrace
+{
+  return createCommunityAttachmentGen(
+             getDefaultConfig(benchmarkSeed).communityAttachmentModelParams)
+      ->generate();
+}
+
+auto countTraceLits(FuzzTrace const& trace) -> uint64_t
+{
+  uint64_t result = 0;
+  for (FuzzCmd const& cmd : trace) {
+    if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&cmd); addClause != nullptr) {
+      result += addClause->clauseToAdd.size();
+    }
+    else if (AssumeCmd const* assume = std::get_if<AssumeCmd>(&cmd); assume != nullptr) {
+      result += assume->assumptions.size();
+    }
+  }
+  return result;
+}
+
+/// Returns the AddClauseCmd commands of `trace`
+auto getClauses(FuzzTrace const& trace) -> FuzzTrace
+{
+  FuzzTrace result;
+  std::copy_if(trace.begin(), trace.end(), std::back_inserter(result), [](FuzzCmd const& cmd) {
+    return std::holds_alternative<AddClauseCmd>(cmd);
+  });
+  return result;
+}
+
+/**
+ * Returns uniform random 3-SAT clauses with distinct variables in each clause.
+ */
+auto createRandom3SAT(uint32_t numVars, uint32_t numClauses) -> std::vector<std::vector<CNFLit>>
+{
+  std::mt19937 rng{benchmarkSeed};
+  std::uniform_int_distribution<CNFLit> varDist{1, static_cast<CNFLit>(numVars)};
+  std::bernoulli_distribution signDist;
+
+  std::vector<std::vector<CNFLit>> result;
+  while (result.size() < numClauses) {
+    std::vector<CNFLit> clause;
+    while (clause.size() < 3) {
+      CNFLit const var = varDist(rng);
+      auto const hasVar = [var](CNFLit lit) { return std::abs(lit) == var; };
+      if (std::none_of(clause.begin(), clause.end(), hasVar)) {
+        clause.push_back(signDist(rng) ? var : -var);
+      }
+    }
+    result.push_back(std::move(clause));
+  }
+  return result;
+}
+
+auto toVerifierLit(CNFLit lit) -> verifier::Lit
+{
+  return verifier::Lit{verifier::Var{static_cast<uint32_t>(std::abs(lit))}, lit > 0};
+}
+
+auto createRandom3SATClauses(uint32_t numVars, uint32_t numClauses)
+    -> std::vector<std::vector<verifier::Lit>>
+{
+  std::vector<std::vector<verifier::Lit>> result;
+  for (std::vector<CNFLit> const& clause : createRandom3SAT(numVars, numClauses)) {
+    std::vector<verifier::Lit> verifierClause;
+    std::transform(
+        clause.begin(), clause.end(), std::back_inserter(verifierClause), toVerifierLit);
+    result.push_back(std::move(verifierClause));
+  }
+  return result;
+}
+
+
+void benchmarkCommunityAttachmentGen(BenchmarkState& state)
+{
+  auto generator =
+      createCommunityAttachmentGen(getDefaultConfig(benchmarkSeed).communityAttachmentModelParams);
+  uint64_t numCmds = 0;
+  while (state.keepRunning()) {
+    FuzzTrace trace = generator->generate();
+    numCmds += trace.size();
+    doNotOptimize(trace);
+  }
+  state.setItemsProcessed(numCmds);
+}
+
+void benchmarkSimplifiersParadiseGen(BenchmarkState& state)
+{
+  auto generator =
+      createSimplifiersParadiseGen(getDefaultConfig(benchmarkSeed).simplifiersParadiseParams);
+  uint64_t numCmds = 0;
+  while (state.keepRunning()) {
+    FuzzTrace trace = generator->generate();
+    numCmds += trace.size();
+    doNotOptimize(trace);
+  }
+  state.setItemsProcessed(numCmds);
+}
+
+void benchmarkInsertSolveCmds(BenchmarkState& state)
+{
+  FuzzTrace const clauses = getClauses(generateCommunityAttachmentTrace());
+  CNFLit maxLit = 0;
+  for (FuzzCmd const& cmd : clauses) {
+    for (CNFLit lit : std::get<AddClauseCmd>(cmd).clauseToAdd) {
+      maxLit = std::max(maxLit, std::abs(lit));
+    }
+  }
+
+  SolveCmdScheduleParams const params;
+  uint64_t seed = benchmarkSeed;
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    FuzzTrace input = clauses;
+    state.resumeTiming();
+
+    FuzzTrace result = insertSolveCmds(std::move(input), params, maxLit, ++seed);
+    doNotOptimize(result);
+  }
+  state.setItemsProcessed(state.getNumIterations() * clauses.size());
+}
+
+void benchmarkTraceRoundTrip(BenchmarkState& state, TraceFormat format)
+{
+  FuzzTrace const trace = generateCommunityAttachmentTrace();
+  std::vector<std::byte> buffer;
+  while (state.keepRunning()) {
+    buffer.clear();
+    encodeTrace(trace.begin(), trace.end(), buffer, format);
+    FuzzTrace loaded = loadTrace(buffer);
+    doNotOptimize(loaded);
+  }
+  state.setItemsProcessed(state.getNumIterations() * countTraceLits(trace));
+}
+
+void benchmarkTraceFileRoundTrip(BenchmarkState& state)
+{
+  FuzzTrace const trace = generateCommunityAttachmentTrace();
+  std::filesystem::path const filename = std::filesystem::temp_directory_path() /
+                                         ("libincmonk-bench-" + std::to_string(getpid()) + ".mtr");
+  while (state.keepRunning()) {
+    storeTrace(trace.begin(), trace.end(), filename);
+    FuzzTrace loaded = loadTrace(filename);
+    doNotOptimize(loaded);
+  }
+  std::filesystem::remove(filename);
+  state.setItemsProcessed(state.getNumIterations() * countTraceLits(trace));
+}
+
+void benchmarkClauseCollectionAdd(BenchmarkState& state)
+{
+  auto const clauses = createRandom3SATClauses(2000, 20000);
+  while (state.keepRunning()) {
+    verifier::ClauseCollection collection;
+    verifier::ProofSequenceIdx idx = 0;
+    for (auto const& clause : clauses) {
+      collection.add(clause, verifier::ClauseVerificationState::Irredundant, idx++);
+    }
+    doNotOptimize(collection);
+  }
+  state.setItemsProcessed(state.getNumIterations() * clauses.size());
+}
+
+void benchmarkClauseCollectionFind(BenchmarkState& state)
+{
+  auto const clauses = createRandom3SATClauses(2000, 20000);
+  verifier::ClauseCollection collection;
+  verifier::ProofSequenceIdx idx = 0;
+  for (auto const& clause : clauses) {
+    collection.add(clause, verifier::ClauseVerificationState::Irredundant, idx++);
+  }
+  // Build the index outside of the measurement:
+  collection.find(clauses[0]);
+
+  while (state.keepRunning()) {
+    for (auto const& clause : clauses) {
+      doNotOptimize(collection.find(clause));
+    }
+  }
+  state.setItemsProcessed(state.getNumIterations() * clauses.size());
+}
+
+void benchmarkClauseCollectionGetOccurrences(BenchmarkState& state)
+{
+  uint32_t const numVars = 2000;
+  auto const clauses = createRandom3SATClauses(numVars, 20000);
+  verifier::ClauseCollection collection;
+  verifier::ProofSequenceIdx idx = 0;
+  for (auto const& clause : clauses) {
+    collection.add(clause, verifier::ClauseVerificationState::Irredundant, idx++);
+  }
+  collection.getOccurrences(clauses[0][0]);
+
+  while (state.keepRunning()) {
+    std::size_t numOccurrences = 0;
+    for (uint32_t var = 1; var <= numVars; ++var) {
+      numOccurrences += collection.getOccurrences(verifier::Lit{verifier::Var{var}, true}).size();
+      numOccurrences += collection.getOccurrences(verifier::Lit{verifier::Var{var}, false}).size();
+    }
+    doNotOptimize(numOccurrences);
+  }
+  state.setItemsProcessed(state.getNumIterations() * 2 * numVars);
+}
+
+void benchmarkRUPCheckerIsRUP(BenchmarkState& state)
+{
+  // An implication chain x_1 -> x_2 -> ... -> x_n, hidden in random clauses over
+  // other variables. (-x_1 x_n) is RUP, requiring propagation along the chain.
+  uint32_t const chainLength = 1000;
+  verifier::ClauseCollection collection;
+  verifier::ProofSequenceIdx idx = 0;
+  for (uint32_t var = 1; var < chainLength; ++var) {
+    std::vector<verifier::Lit> const implication{verifier::Lit{verifier::Var{var}, false},
+                                                 verifier::Lit{verifier::Var{var + 1}, true}};
+    collection.add(implication, verifier::ClauseVerificationState::Irredundant, idx++);
+  }
+  for (auto clause : createRandom3SATClauses(2000, 6000)) {
+    for (verifier::Lit& lit : clause) {
+      lit = verifier::Lit{verifier::Var{lit.getVar().getRawValue() + chainLength},
+                          lit.isPositive()};
+    }
+    collection.add(clause, verifier::ClauseVerificationState::Irredundant, idx++);
+  }
+
+  std::vector<verifier::Lit> const lemma{verifier::Lit{verifier::Var{1}, false},
+                                         verifier::Lit{verifier::Var{chainLength}, true}};
+  verifier::RUPChecker checker{collection, {}};
+  while (state.keepRunning()) {
+    checker.reset({});
+    bool const result = checker.isRUP(lemma, idx);
+    if (!result) {
+      std::cerr << "RUPChecker benchmark: unexpected result\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  state.setItemsProcessed(state.getNumIterations() * chainLength);
+}
+
+void benchmarkOracleSolve(BenchmarkState& state)
+{
+  FuzzTrace const trace = generateCommunityAttachmentTrace();
+  uint64_t numSolveCalls = 0;
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    FuzzTrace input = trace;
+    clearExpectedResults(input.begin(), input.end());
+    state.resumeTiming();
+
+    createOracle()->solve(input.begin(), input.end());
+    numSolveCalls += std::count_if(input.begin(), input.end(), [](FuzzCmd const& cmd) {
+      return std::holds_alternative<SolveCmd>(cmd);
+    });
+  }
+  state.setItemsProcessed(numSolveCalls);
+}
+
+void benchmarkOracleProbe(BenchmarkState& state)
+{
+  uint32_t const numVars = 500;
+  FuzzTrace problem;
+  for (std::vector<CNFLit>& clause : createRandom3SAT(numVars, 3 * numVars)) {
+    problem.push_back(AddClauseCmd{std::move(clause)});
+  }
+  std::unique_ptr<Oracle> oracle = createOracle();
+  oracle->solve(problem.begin(), problem.end());
+
+  std::vector<std::vector<CNFLit>> const assumptions = createRandom3SAT(numVars, 1024);
+  std::size_t assumptionIdx = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(oracle->probe(assumptions[assumptionIdx]));
+    assumptionIdx = (assumptionIdx + 1) % assumptions.size();
+  }
+  state.setItemsProcessed(state.getNumIterations());
+}
+
+void benchmarkSyncExecInFork(BenchmarkState& state)
+{
+  while (state.keepRunning()) {
+    doNotOptimize(syncExecInFork([]() -> uint64_t { return 1; }, EXIT_SUCCESS));
+  }
+  state.setItemsProcessed(state.getNumIterations());
+}
+
+void benchmarkForkServerExecute(BenchmarkState& state)
+{
+  std::unique_ptr<ForkServer> forkServer = createForkServer(
+      [](std::vector<std::byte> const& request) -> uint64_t { return request.size(); },
+      EXIT_SUCCESS);
+  std::vector<std::byte> const request(1024);
+  while (state.keepRunning()) {
+    doNotOptimize(forkServer->execute(request));
+  }
+  state.setItemsProcessed(state.getNumIterations());
+}
+
+auto getBenchmarks() -> std::vector<Benchmark>
+{
+  // clang-format off
+  return {
+    {"generate/CommunityAttachmentGen", benchmarkCommunityAttachmentGen},
+    {"generate/SimplifiersParadiseGen", benchmarkSimplifiersParadiseGen},
+    {"generate/insertSolveCmds", benchmarkInsertSolveCmds},
+    {"traceIO/roundTrip/v1", [](BenchmarkState& state) { benchmarkTraceRoundTrip(state, TraceFormat::V1); }},
+    {"traceIO/roundTrip/v2", [](BenchmarkState& state) { benchmarkTraceRoundTrip(state, TraceFormat::V2); }},
+    {"traceIO/fileRoundTrip", benchmarkTraceFileRoundTrip},
+    {"verifier/ClauseCollection/add", benchmarkClauseCollectionAdd},
+    {"verifier/ClauseCollection/find", benchmarkClauseCollectionFind},
+    {"verifier/ClauseCollection/getOccurrences", benchmarkClauseCollectionGetOccurrences},
+    {"verifier/RUPChecker/isRUP", benchmarkRUPCheckerIsRUP},
+    {"oracle/solve", benchmarkOracleSolve},
+    {"oracle/probe", benchmarkOracleProbe},
+    {"fork/syncExecInFork", benchmarkSyncExecInFork},
+    {"fork/ForkServer/execute", benchmarkForkServerExecute}
+  };
+  // clang-format on
+}
+}
+}
+
+auto main(int argc, char** argv) -> int
+{
+  using namespace incmonk::bench;
+
+  CLI::App app{"Microbenchmarks of libincmonk"};
+
+  std::string filter = ".*";
+  std::string format = "console";
+  double minTime = 0.5;
+  bool listOnly = false;
+  app.add_option("--filter", filter, "Regular expression selecting the benchmarks to run");
+  app.add_option("--format", format, "Output format: console or json (default: console)")
+      ->transform(CLI::IsMember({"console", "json"}));
+  app.add_option("--min-time", minTime, "Minimum measured time per benchmark, in seconds")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--list", listOnly, "List the benchmarks without running them");
+  CLI11_PARSE(app, argc, argv);
+
+  std::regex const filterRegex{filter};
+  std::vector<BenchmarkResult> results;
+  for (Benchmark const& benchmark : getBenchmarks()) {
+    if (!std::regex_search(benchmark.name, filterRegex)) {
+      continue;
+    }
+    if (listOnly) {
+      std::cout << benchmark.name << "\n";
+      continue;
+    }
+    results.push_back(runBenchmark(benchmark, std::chrono::duration<double>{minTime}));
+  }
+
+  if (listOnly) {
+    return EXIT_SUCCESS;
+  }
+
+  if (format == "json") {
+    writeJSONReport(results, argv[0], std::cout);
+  }
+  else {
+    writeConsoleReport(results, std::cout);
+  }
+  return EXIT_SUCCESS;
+}
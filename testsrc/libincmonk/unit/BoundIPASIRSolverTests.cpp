@@ -0,0 +1,218 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/BoundIPASIRSolver.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+
+namespace incmonk {
+namespace {
+
+/// IPASIR "library" state for the fake binding
+struct FakeIPASIRLib {
+  std::vector<int> added;
+  std::vector<int> assumed;
+  int solveResult = 0;
+  std::vector<int> trueLits;
+  std::vector<int> failedLits;
+  int numValCalls = 0;
+  int numFailedCalls = 0;
+  std::vector<uint64_t> havocSeeds;
+  int numInits = 0;
+  int numReleases = 0;
+};
+
+FakeIPASIRLib fakeLib;
+
+auto contains(std::vector<int> const& lits, int lit) -> bool
+{
+  return std::find(lits.begin(), lits.end(), lit) != lits.end();
+}
+
+struct FakeBinding {
+  IPASIRInitFn initFn = []() -> void* {
+    ++fakeLib.numInits;
+    return &fakeLib;
+  };
+  IPASIRReleaseFn releaseFn = [](void*) { ++fakeLib.numReleases; };
+  IPASIRAddFn addFn = [](void*, int lit) { fakeLib.added.push_back(lit); };
+  IPASIRAssumeFn assumeFn = [](void*, int lit) { fakeLib.assumed.push_back(lit); };
+  IPASIRSolveFn solveFn = [](void*) { return fakeLib.solveResult; };
+  IPASIRValFn valFn = [](void*, int lit) {
+    ++fakeLib.numValCalls;
+    if (contains(fakeLib.trueLits, lit)) {
+      return lit;
+    }
+    return contains(fakeLib.trueLits, -lit) ? -lit : 0;
+  };
+  IPASIRFailedFn failedFn = [](void*, int lit) {
+    ++fakeLib.numFailedCalls;
+    return contains(fakeLib.failedLits, lit) ? 1 : 0;
+  };
+
+  IncMonkIPASIRHavocInitFn havocInitFn = nullptr;
+  IncMonkIPASIRHavocFn havocFn = nullptr;
+  IncMonkIPASIRModelFn modelFn = nullptr;
+  IncMonkIPASIRFailedFn failedBulkFn = nullptr;
+};
+
+auto createBindingWithExtensions() -> FakeBinding
+{
+  FakeBinding result;
+  result.havocFn = [](void*, uint64_t seed) { fakeLib.havocSeeds.push_back(seed); };
+  result.modelFn = [](void*, int32_t maxVar, int8_t* values) {
+    for (int var = 1; var <= maxVar; ++var) {
+      values[var - 1] =
+          contains(fakeLib.trueLits, var) ? 1 : (contains(fakeLib.trueLits, -var) ? -1 : 0);
+    }
+  };
+  result.failedBulkFn = [](void*, int32_t const* lits, size_t numLits, int8_t* failed) {
+    for (size_t idx = 0; idx < numLits; ++idx) {
+      failed[idx] = contains(fakeLib.failedLits, lits[idx]) ? 1 : 0;
+    }
+  };
+  return result;
+}
+
+class BoundIPASIRSolverTests : public ::testing::Test {
+public:
+  BoundIPASIRSolverTests() { fakeLib = FakeIPASIRLib{}; }
+  virtual ~BoundIPASIRSolverTests() = default;
+};
+}
+
+TEST_F(BoundIPASIRSolverTests, SolverIsCreatedAndReleased)
+{
+  {
+    BoundIPASIRSolver<FakeBinding> underTest;
+    EXPECT_THAT(fakeLib.numInits, Eq(1));
+    EXPECT_THAT(fakeLib.numReleases, Eq(0));
+  }
+  EXPECT_THAT(fakeLib.numReleases, Eq(1));
+}
+
+TEST_F(BoundIPASIRSolverTests, ClausesAndAssumptionsArePassedToSolver)
+{
+  BoundIPASIRSolver<FakeBinding> underTest;
+  underTest.addClause(CNFClause{1, -2});
+  underTest.addClause(CNFClause{3});
+  underTest.assume(std::vector<CNFLit>{-4, 5});
+
+  EXPECT_THAT(fakeLib.added, ElementsAre(1, -2, 0, 3, 0));
+  EXPECT_THAT(fakeLib.assumed, ElementsAre(-4, 5));
+}
+
+TEST_F(BoundIPASIRSolverTests, SolveResultsAreTranslated)
+{
+  BoundIPASIRSolver<FakeBinding> underTest;
+
+  fakeLib.solveResult = 10;
+  EXPECT_THAT(underTest.solve(), Eq(IPASIRSolver::Result::SAT));
+  EXPECT_THAT(underTest.getLastSolveResult(), Eq(IPASIRSolver::Result::SAT));
+
+  fakeLib.solveResult = 20;
+  EXPECT_THAT(underTest.solve(), Eq(IPASIRSolver::Result::UNSAT));
+
+  fakeLib.solveResult = 0;
+  EXPECT_THAT(underTest.solve(), Eq(IPASIRSolver::Result::UNKNOWN));
+
+  fakeLib.solveResult = 5;
+  EXPECT_THAT(underTest.solve(), Eq(IPASIRSolver::Result::ILLEGAL_RESULT));
+}
+
+TEST_F(BoundIPASIRSolverTests, WhenModelExtensionIsMissing_ModelIsObtainedViaVal)
+{
+  BoundIPASIRSolver<FakeBinding> underTest;
+  fakeLib.trueLits = {1, -3};
+
+  EXPECT_THAT(underTest.getValue(1), Eq(t_true));
+  EXPECT_THAT(underTest.getValue(-1), Eq(t_false));
+
+  std::vector<TBool> model(3);
+  underTest.getModel(model);
+  EXPECT_THAT(model, ElementsAre(t_true, t_indet, t_false));
+  EXPECT_THAT(fakeLib.numValCalls, Eq(5));
+}
+
+TEST_F(BoundIPASIRSolverTests, WhenModelExtensionIsPresent_ModelIsObtainedViaExtension)
+{
+  BoundIPASIRSolver<FakeBinding> underTest{createBindingWithExtensions()};
+  fakeLib.trueLits = {1, -3};
+
+  std::vector<TBool> model(4);
+  underTest.getModel(model);
+  EXPECT_THAT(model, ElementsAre(t_true, t_indet, t_false, t_indet));
+  EXPECT_THAT(fakeLib.numValCalls, Eq(0));
+}
+
+TEST_F(BoundIPASIRSolverTests, WhenFailedExtensionIsMissing_FailedAssumptionsAreObtainedViaFailed)
+{
+  BoundIPASIRSolver<FakeBinding> underTest;
+  fakeLib.failedLits = {2, -4};
+
+  std::vector<CNFLit> const assumptions = {1, 2, 3, -4};
+  std::vector<CNFLit> failed = {10};
+  underTest.getFailed(assumptions, failed);
+  EXPECT_THAT(failed, ElementsAre(2, -4));
+  EXPECT_THAT(fakeLib.numFailedCalls, Eq(4));
+}
+
+TEST_F(BoundIPASIRSolverTests, WhenFailedExtensionIsPresent_FailedAssumptionsAreObtainedViaExtension)
+{
+  BoundIPASIRSolver<FakeBinding> underTest{createBindingWithExtensions()};
+  fakeLib.failedLits = {2, -4};
+
+  std::vector<CNFLit> const assumptions = {1, 2, 3, -4};
+  std::vector<CNFLit> failed = {10};
+  underTest.getFailed(assumptions, failed);
+  EXPECT_THAT(failed, ElementsAre(2, -4));
+  EXPECT_THAT(fakeLib.numFailedCalls, Eq(0));
+}
+
+TEST_F(BoundIPASIRSolverTests, HavocIsOnlyCalledWhenSupported)
+{
+  {
+    BoundIPASIRSolver<FakeBinding> underTest;
+    underTest.havoc(1);
+    underTest.reinitializeWithHavoc(2);
+    EXPECT_THAT(fakeLib.havocSeeds, IsEmpty());
+    EXPECT_THAT(fakeLib.numInits, Eq(1));
+  }
+
+  BoundIPASIRSolver<FakeBinding> underTest{createBindingWithExtensions()};
+  underTest.havoc(3);
+  EXPECT_THAT(fakeLib.havocSeeds, ElementsAre(3));
+}
+}
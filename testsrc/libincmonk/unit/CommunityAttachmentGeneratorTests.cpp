@@ -0,0 +1,108 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FlatFuzzTrace.h>
+#include <libincmonk/generators/CommunityAttachmentGenerator.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <random>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+namespace incmonk {
+
+using ::testing::Eq;
+using ::testing::Gt;
+
+namespace {
+auto createUniformDist(double min, double max) -> std::piecewise_linear_distribution<double>
+{
+  std::vector<double> const intervals{min, max};
+  std::vector<double> const weights{1.0, 1.0};
+  return std::piecewise_linear_distribution<double>{
+      intervals.begin(), intervals.end(), weights.begin()};
+}
+
+// Parameters for traces with long clauses, most of them having all variables
+// in the same community
+auto createLongClauseParams(uint64_t seed) -> CommunityAttachmentModelParams
+{
+  CommunityAttachmentModelParams result;
+  result.numClausesDistribution = createUniformDist(200.0, 400.0);
+  result.clauseSizeDistribution = createUniformDist(4.0, 12.0);
+  result.numVariablesPerClauseDistribution = createUniformDist(0.05, 0.1);
+  result.modularityDistribution = createUniformDist(0.9, 1.0);
+  result.seed = seed;
+  return result;
+}
+}
+
+TEST(CommunityAttachmentGeneratorTests, ClausesContainNoDuplicateVariables)
+{
+  auto underTest = createCommunityAttachmentGen(createLongClauseParams(5));
+
+  uint64_t numClauses = 0;
+  for (int i = 0; i < 20; ++i) {
+    for (FuzzCmd const& cmd : underTest->generate()) {
+      if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&cmd); addClause != nullptr) {
+        std::unordered_set<CNFLit> vars;
+        for (CNFLit lit : addClause->clauseToAdd) {
+          EXPECT_TRUE(vars.insert(std::abs(lit)).second)
+              << "Duplicate variable " << std::abs(lit) << " in clause " << numClauses;
+        }
+        ++numClauses;
+      }
+    }
+  }
+
+  EXPECT_THAT(numClauses, Gt(0));
+}
+
+TEST(CommunityAttachmentGeneratorTests, TracesAreDeterminedBySeed)
+{
+  auto underTest = createCommunityAttachmentGen(createLongClauseParams(7));
+  auto reference = createCommunityAttachmentGen(createLongClauseParams(7));
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_THAT(underTest->generate(), Eq(reference->generate()));
+  }
+}
+
+TEST(CommunityAttachmentGeneratorTests, FlatTracesEqualRegularTraces)
+{
+  auto underTest = createCommunityAttachmentGen(createLongClauseParams(9));
+  auto reference = createCommunityAttachmentGen(createLongClauseParams(9));
+
+  for (int i = 0; i < 5; ++i) {
+    FuzzTrace const expected = reference->generate();
+    EXPECT_THAT(underTest->generateFlat(), Eq(toFlatFuzzTrace(expected.begin(), expected.end())));
+  }
+}
+}
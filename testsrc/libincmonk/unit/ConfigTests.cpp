@@ -76,6 +76,11 @@ TEST(ConfigTests_getDefaultConfig, DefaultConfigContainsExpectedValues)
   ASSERT_TRUE(spParams.havocSchedule.has_value());
   EXPECT_THAT(spParams.havocSchedule->density, Eq(ClosedInterval{0.0, 0.1}));
   EXPECT_THAT(spParams.havocSchedule->phaseDensity, Eq(ClosedInterval{0.0, 1.0}));
+
+  GeneratorSelectionParams const& selectionParams = result.generatorSelectionParams;
+  EXPECT_THAT(selectionParams.policy, Eq(MuxSelectionPolicy::FIXED_WEIGHTS));
+  EXPECT_THAT(selectionParams.communityAttachmentWeight, Eq(1.0));
+  EXPECT_THAT(selectionParams.simplifiersParadiseWeight, Eq(1.0));
 }
 
 TEST(ConfigTests_extendConfigViaTOML, WhenTOMLIsInvalid_ThenErrorIsThrown)
@@ -120,4 +125,31 @@ TEST(ConfigTests_extendConfigViaTOML, WhenTOMLContainsValidSPSetting_ThenItIsApp
   EXPECT_THAT(result.simplifiersParadiseParams.solveCmdSchedule.density,
               ::testing::Eq(ClosedInterval{0.3, 0.5}));
 }
+
+TEST(ConfigTests_extendConfigViaTOML, WhenTOMLContainsValidSelectionSetting_ThenItIsApplied)
+{
+  Config config;
+  std::stringstream input{
+      "[[generator_selection]]\npolicy=\"thompson\"\nsimplifiers_paradise_weight=0.0"};
+
+  Config result = extendConfigViaTOML(config, input);
+  EXPECT_THAT(result.generatorSelectionParams.policy, Eq(MuxSelectionPolicy::THOMPSON_SAMPLING));
+  EXPECT_THAT(result.generatorSelectionParams.communityAttachmentWeight, Eq(1.0));
+  EXPECT_THAT(result.generatorSelectionParams.simplifiersParadiseWeight, Eq(0.0));
+}
+
+TEST(ConfigTests_extendConfigViaTOML, WhenTOMLContainsInvalidSelectionPolicy_ThenErrorIsThrown)
+{
+  Config dummyConfig;
+  std::stringstream input{"[[generator_selection]]\npolicy=\"foo\""};
+  EXPECT_THROW(extendConfigViaTOML(dummyConfig, input), ConfigParseError);
+}
+
+TEST(ConfigTests_extendConfigViaTOML, WhenTOMLContainsNoPositiveGeneratorWeight_ThenErrorIsThrown)
+{
+  Config dummyConfig;
+  std::stringstream input{"[[generator_selection]]\ncommunity_attachment_weight=0.0\n"
+                          "simplifiers_paradise_weight=0.0"};
+  EXPECT_THROW(extendConfigViaTOML(dummyConfig, input), ConfigParseError);
+}
 }
\ No newline at end of file
@@ -163,6 +163,34 @@ TEST(ConfigTomlUtilsTests_createIntervalParser, WhenNodeContainsExactly2Values_T
   EXPECT_THAT(target, ::testing::Eq(ClosedInterval{-2.5, 3.5}));
 }
 
+TEST(ConfigTomlUtilsTests_createNonNegativeFloatParser, WhenNodeIsNotFloat_ThenErrorIsThrown)
+{
+  double dummyTarget = 0.0;
+  auto parserUnderTest = createNonNegativeFloatParser(dummyTarget);
+  EXPECT_THROW(parserUnderTest(toml::array{1.0}), TOMLConfigParseError);
+  EXPECT_THROW(parserUnderTest(toml::value<std::string>{"foo"}), TOMLConfigParseError);
+}
+
+TEST(ConfigTomlUtilsTests_createNonNegativeFloatParser, WhenNodeIsNegative_ThenErrorIsThrown)
+{
+  double dummyTarget = 0.0;
+  auto parserUnderTest = createNonNegativeFloatParser(dummyTarget);
+  EXPECT_THROW(parserUnderTest(toml::value<double>{-1.0}), TOMLConfigParseError);
+}
+
+TEST(ConfigTomlUtilsTests_createNonNegativeFloatParser,
+     WhenNodeIsNonNegativeFloat_ThenTargetIsFilled)
+{
+  double target = 1.0;
+  auto parserUnderTest = createNonNegativeFloatParser(target);
+
+  parserUnderTest(toml::value<double>{0.0});
+  EXPECT_THAT(target, ::testing::Eq(0.0));
+
+  parserUnderTest(toml::value<double>{2.5});
+  EXPECT_THAT(target, ::testing::Eq(2.5));
+}
+
 TEST(ConfigTomlUtilsTests_createPiecewiseLinearDistParser, WhenNodeIsNotArray_ThenErrorIsThrown)
 {
   std::piecewise_linear_distribution<double> target;
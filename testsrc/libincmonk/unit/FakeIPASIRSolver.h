@@ -72,8 +72,8 @@ public:
 
   auto getLastSolveResult() const noexcept -> Result override { return m_lastResult; }
 
-  void addClause(CNFClause const&) override {}
-  void assume(std::vector<CNFLit> const&) override {}
+  void addClause(gsl::span<CNFLit const>) override {}
+  void assume(gsl::span<CNFLit const>) override {}
   void configure(uint64_t) override {}
 
   auto getValue(CNFLit lit) const noexcept -> TBool override
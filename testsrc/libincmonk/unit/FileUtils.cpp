@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <random>
@@ -153,4 +154,20 @@ void writeBinaryTrace(std::filesystem::path const& path, BinaryTrace const& trac
         intVariant);
   }
 }
+
+auto toBytes(BinaryTrace const& trace) -> std::vector<std::byte>
+{
+  std::vector<std::byte> result;
+  for (auto const& intVariant : trace) {
+    std::visit(
+        [&result](auto value) {
+          decltype(value) leValue = toSmallEndian(value);
+          std::size_t const offset = result.size();
+          result.resize(offset + sizeof(leValue));
+          std::memcpy(result.data() + offset, &leValue, sizeof(leValue));
+        },
+        intVariant);
+  }
+  return result;
+}
 }
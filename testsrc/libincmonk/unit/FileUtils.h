@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <optional>
@@ -62,6 +63,7 @@ using BinaryTrace = std::vector<std::variant<uint8_t, uint16_t, uint32_t, uint64
 
 void assertFileContains(std::filesystem::path const& path, BinaryTrace const& expected);
 void writeBinaryTrace(std::filesystem::path const& path, BinaryTrace const& trace);
+auto toBytes(BinaryTrace const& trace) -> std::vector<std::byte>;
 
 //auto slurpUInt32File(std::filesystem::path const& path) -> std::optional<std::vector<uint32_t>>;
 //void writeUInt32VecToFile(std::vector<uint32_t> const& data, std::filesystem::path const& path);
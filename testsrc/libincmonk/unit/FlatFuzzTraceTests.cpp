@@ -0,0 +1,385 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FlatFuzzTrace.h>
+
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/InterspersionSchedulers.h>
+#include <libincmonk/generators/CommunityAttachmentGenerator.h>
+#include <libincmonk/generators/SimplifiersParadiseGenerator.h>
+
+#include "FileUtils.h"
+#include "RecordingIPASIRSolver.h"
+
+#include <gmock/gmock.h>
+#include <gsl/gsl_util>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using ::testing::Eq;
+
+namespace incmonk {
+
+namespace {
+auto slurpFile(std::filesystem::path const& path) -> std::vector<char>
+{
+  std::ifstream input{path, std::ios::binary};
+  return std::vector<char>{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+}
+}
+
+class FlatFuzzTraceTests_conversion : public ::testing::TestWithParam<FuzzTrace> {
+public:
+  virtual ~FlatFuzzTraceTests_conversion() = default;
+};
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_roundTrip)
+{
+  FuzzTrace const& input = GetParam();
+  FlatFuzzTrace flat = toFlatFuzzTrace(input.begin(), input.end());
+
+  ASSERT_THAT(flat.size(), Eq(input.size()));
+  for (FlatFuzzTrace::size_type idx = 0; idx < flat.size(); ++idx) {
+    EXPECT_THAT(flat[idx].toFuzzCmd(), Eq(input[idx])) << "Mismatch at index " << idx;
+  }
+
+  EXPECT_THAT(toFuzzTrace(flat.begin(), flat.end()), Eq(input));
+}
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_storesSameBytesAsFuzzTrace)
+{
+  FuzzTrace const& input = GetParam();
+  FlatFuzzTrace flat = toFlatFuzzTrace(input.begin(), input.end());
+
+  PathWithDeleter expectedFile = createTempFile();
+  PathWithDeleter flatFile = createTempFile();
+  storeTrace(input.begin(), input.end(), expectedFile.getPath());
+  storeTrace(flat, flatFile.getPath());
+
+  EXPECT_THAT(slurpFile(flatFile.getPath()), Eq(slurpFile(expectedFile.getPath())));
+}
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_loadsSameTraceAsFuzzTrace)
+{
+  FuzzTrace const& input = GetParam();
+
+  PathWithDeleter tempFile = createTempFile();
+  storeTrace(input.begin(), input.end(), tempFile.getPath());
+
+  FlatFuzzTrace result = loadFlatTrace(tempFile.getPath());
+  EXPECT_THAT(result, Eq(toFlatFuzzTrace(input.begin(), input.end())));
+}
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_applyTraceStopsAtSolveCmd)
+{
+  FuzzTrace const& input = GetParam();
+  FlatFuzzTrace flat = toFlatFuzzTrace(input.begin(), input.end());
+
+  RecordingIPASIRSolver flatRecorder{getSolveResults(input)};
+  RecordingIPASIRSolver expectedRecorder{getSolveResults(input)};
+
+  auto resultIter = applyTrace(flat.begin(), flat.end(), flatRecorder);
+  auto expectedIter = applyTrace(input.begin(), input.end(), expectedRecorder);
+
+  EXPECT_THAT(resultIter.getIndex(), Eq(std::distance(input.cbegin(), expectedIter)));
+  EXPECT_THAT(flatRecorder.getTrace(), Eq(expectedRecorder.getTrace()));
+}
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_readerSplitsTraceAtSolveCmds)
+{
+  FuzzTrace const& input = GetParam();
+  PathWithDeleter tempFile = createTempFile();
+  storeTrace(input.begin(), input.end(), tempFile.getPath());
+
+  FILE* stream = fopen(tempFile.getPath().string().c_str(), "rb");
+  ASSERT_THAT(stream, ::testing::NotNull());
+  auto closeStream = gsl::finally([stream]() { fclose(stream); });
+
+  FlatFuzzTraceReader underTest{*stream};
+  FuzzTrace result;
+  FlatFuzzTrace phase;
+  while (underTest.readNextPhase(phase)) {
+    ASSERT_FALSE(phase.empty());
+    for (FlatFuzzTrace::size_type idx = 0; idx + 1 < phase.size(); ++idx) {
+      EXPECT_THAT(phase[idx].getKind(), ::testing::Ne(FlatFuzzTrace::CmdKind::SOLVE));
+    }
+
+    FuzzTrace phaseCmds = toFuzzTrace(phase.begin(), phase.end());
+    result.insert(result.end(), phaseCmds.begin(), phaseCmds.end());
+  }
+
+  EXPECT_TRUE(phase.empty());
+  EXPECT_FALSE(underTest.readNextPhase(phase));
+  EXPECT_THAT(result, Eq(input));
+}
+
+TEST_P(FlatFuzzTraceTests_conversion, TestSuite_readerSplitsTraceInFormatV2AtSolveCmds)
+{
+  FuzzTrace const& input = GetParam();
+  PathWithDeleter tempFile = createTempFile();
+  storeTrace(input.begin(), input.end(), tempFile.getPath(), TraceFormat::V2);
+
+  FILE* stream = fopen(tempFile.getPath().string().c_str(), "rb");
+  ASSERT_THAT(stream, ::testing::NotNull());
+  auto closeStream = gsl::finally([stream]() { fclose(stream); });
+
+  FlatFuzzTraceReader underTest{*stream};
+  FuzzTrace result;
+  FlatFuzzTrace phase;
+  while (underTest.readNextPhase(phase)) {
+    ASSERT_FALSE(phase.empty());
+    for (FlatFuzzTrace::size_type idx = 0; idx + 1 < phase.size(); ++idx) {
+      EXPECT_THAT(phase[idx].getKind(), ::testing::Ne(FlatFuzzTrace::CmdKind::SOLVE));
+    }
+
+    FuzzTrace phaseCmds = toFuzzTrace(phase.begin(), phase.end());
+    result.insert(result.end(), phaseCmds.begin(), phaseCmds.end());
+  }
+
+  EXPECT_TRUE(phase.empty());
+  EXPECT_FALSE(underTest.readNextPhase(phase));
+  EXPECT_THAT(result, Eq(input));
+}
+
+// clang-format off
+INSTANTIATE_TEST_SUITE_P(, FlatFuzzTraceTests_conversion,
+  ::testing::Values(
+    FuzzTrace{},
+    FuzzTrace{AddClauseCmd{}},
+    FuzzTrace{AddClauseCmd{{1, -2, -3}}},
+    FuzzTrace{AssumeCmd{{1, -2, -3}}},
+    FuzzTrace{SolveCmd{}},
+    FuzzTrace{SolveCmd{false}},
+    FuzzTrace{SolveCmd{true}},
+    FuzzTrace{HavocCmd{15, true}},
+    FuzzTrace{HavocCmd{0xFFFF'FFFF'8000'0001ull, false}},
+    FuzzTrace{SolveCmd{true}, SolveCmd{true}, AddClauseCmd{{3}}, SolveCmd{true}},
+    FuzzTrace{
+      HavocCmd{(uint64_t{2} << 32) + 16, true},
+      AddClauseCmd{{1, -2}},
+      AddClauseCmd{{-2, 4}},
+      AssumeCmd{{1}},
+      SolveCmd{true},
+      SolveCmd{},
+      HavocCmd{(uint64_t{2} << 32) + 16, false},
+      AddClauseCmd{},
+      AddClauseCmd{{2}},
+      AssumeCmd{},
+      AddClauseCmd{{-4}},
+      SolveCmd{false},
+      AddClauseCmd{{1, 2, 3, 4, 5}}
+    }
+  )
+);
+// clang-format on
+
+TEST(FlatFuzzTraceTests, BuilderFunctionsCreateViewableCommands)
+{
+  std::vector<CNFLit> const clause{1, -2, 3};
+  std::vector<CNFLit> const assumptions{-4};
+
+  FlatFuzzTrace underTest;
+  underTest.havoc(0x1234'5678'9ABC'DEF0ull, true);
+  underTest.addClause(clause);
+  underTest.assume(assumptions);
+  underTest.solve();
+  underTest.solve(false);
+  underTest.havoc(7, false);
+
+  ASSERT_THAT(underTest.size(), Eq(6));
+  EXPECT_THAT(underTest.getArenaSize(), Eq(8));
+
+  EXPECT_THAT(underTest[0].getKind(), Eq(FlatFuzzTrace::CmdKind::HAVOC));
+  EXPECT_THAT(underTest[0].getHavocCmd(), Eq(HavocCmd{0x1234'5678'9ABC'DEF0ull, true}));
+
+  EXPECT_THAT(underTest[1].getKind(), Eq(FlatFuzzTrace::CmdKind::ADD_CLAUSE));
+  EXPECT_TRUE(std::equal(underTest[1].getLits().begin(),
+                         underTest[1].getLits().end(),
+                         clause.begin(),
+                         clause.end()));
+
+  EXPECT_THAT(underTest[2].getKind(), Eq(FlatFuzzTrace::CmdKind::ASSUME));
+  EXPECT_TRUE(std::equal(underTest[2].getLits().begin(),
+                         underTest[2].getLits().end(),
+                         assumptions.begin(),
+                         assumptions.end()));
+
+  EXPECT_THAT(underTest[3].getKind(), Eq(FlatFuzzTrace::CmdKind::SOLVE));
+  EXPECT_THAT(underTest[3].getExpectedResult(), Eq(std::nullopt));
+  EXPECT_THAT(underTest[4].getExpectedResult(), Eq(false));
+
+  EXPECT_THAT(underTest[5].getHavocCmd(), Eq(HavocCmd{7, false}));
+}
+
+TEST(FlatFuzzTraceTests, VisitPassesCommandViews)
+{
+  std::vector<CNFLit> const clause{1, -2, 3};
+
+  FlatFuzzTrace underTest;
+  underTest.addClause(clause);
+  underTest.assume(clause);
+  underTest.solve(true);
+  underTest.havoc(9, false);
+
+  struct Visitor {
+    auto operator()(AddClauseView const& cmd) -> int { return 1 + 10 * cmd.clauseToAdd.size(); }
+    auto operator()(AssumeView const& cmd) -> int { return 2 + 10 * cmd.assumptions.size(); }
+    auto operator()(SolveCmd const& cmd) -> int { return cmd.expectedResult == true ? 3 : -1; }
+    auto operator()(HavocCmd const& cmd) -> int { return 4 + 10 * cmd.seed; }
+  };
+
+  std::vector<int> result;
+  for (FlatFuzzTrace::CmdView cmd : underTest) {
+    result.push_back(cmd.visit(Visitor{}));
+  }
+
+  EXPECT_THAT(result, Eq(std::vector<int>{31, 32, 3, 94}));
+}
+
+TEST(FlatFuzzTraceTests, SetExpectedResultChangesOnlyTargetCommand)
+{
+  FuzzTrace input{AddClauseCmd{{1, 2}}, SolveCmd{}, AssumeCmd{{-1}}, SolveCmd{}};
+  FlatFuzzTrace underTest = toFlatFuzzTrace(input.begin(), input.end());
+
+  underTest.setExpectedResult(3, false);
+  underTest.setExpectedResult(1, true);
+  underTest.setExpectedResult(1, std::nullopt);
+
+  FuzzTrace expected{AddClauseCmd{{1, 2}}, SolveCmd{}, AssumeCmd{{-1}}, SolveCmd{false}};
+  EXPECT_THAT(toFuzzTrace(underTest.begin(), underTest.end()), Eq(expected));
+}
+
+TEST(FlatFuzzTraceTests, SchedulersInsertSameCommandsAsForFuzzTrace)
+{
+  FuzzTrace input;
+  for (CNFLit lit = 1; lit < 500; ++lit) {
+    input.push_back(AddClauseCmd{{lit, -(lit + 1), lit + 2}});
+  }
+  FlatFuzzTrace flatInput = toFlatFuzzTrace(input.begin(), input.end());
+
+  SolveCmdScheduleParams solveParams;
+  solveParams.density = ClosedInterval{0.05, 0.1};
+  solveParams.assumptionDensity = ClosedInterval{0.1, 0.3};
+  HavocCmdScheduleParams havocParams;
+  havocParams.density = ClosedInterval{0.05, 0.1};
+
+  FuzzTrace expected =
+      insertHavocCmds(insertSolveCmds(std::move(input), solveParams, 502, 17), havocParams, 23);
+  FlatFuzzTrace result =
+      insertHavocCmds(insertSolveCmds(flatInput, solveParams, 502, 17), havocParams, 23);
+
+  EXPECT_THAT(toFuzzTrace(result.begin(), result.end()), Eq(expected));
+}
+
+TEST(FlatFuzzTraceTests, GeneratorsProduceSameTracesInBothRepresentations)
+{
+  CommunityAttachmentModelParams camParams;
+  camParams.numClausesDistribution = std::piecewise_linear_distribution<double>{
+      {100.0, 200.0}, [](double) { return 1.0; }};
+  camParams.clauseSizeDistribution = std::piecewise_linear_distribution<double>{
+      {3.0, 4.0}, [](double) { return 1.0; }};
+  camParams.numVariablesPerClauseDistribution = std::piecewise_linear_distribution<double>{
+      {0.2, 0.4}, [](double) { return 1.0; }};
+  camParams.modularityDistribution = std::piecewise_linear_distribution<double>{
+      {0.5, 0.9}, [](double) { return 1.0; }};
+  camParams.seed = 5;
+  camParams.havocSchedule = HavocCmdScheduleParams{};
+
+  SimplifiersParadiseParams spParams;
+  spParams.numClausesDistribution = std::piecewise_linear_distribution<double>{
+      {50.0, 100.0}, [](double) { return 1.0; }};
+  spParams.seed = 5;
+  spParams.havocSchedule = HavocCmdScheduleParams{};
+
+  std::vector<std::pair<std::unique_ptr<FuzzTraceGenerator>, std::unique_ptr<FuzzTraceGenerator>>>
+      generatorPairs;
+  generatorPairs.emplace_back(createCommunityAttachmentGen(camParams),
+                              createCommunityAttachmentGen(camParams));
+  generatorPairs.emplace_back(createSimplifiersParadiseGen(spParams),
+                              createSimplifiersParadiseGen(spParams));
+
+  for (auto& [generator, flatGenerator] : generatorPairs) {
+    for (int i = 0; i < 5; ++i) {
+      FuzzTrace expected = generator->generate();
+      FlatFuzzTrace result = flatGenerator->generateFlat();
+      EXPECT_THAT(toFuzzTrace(result.begin(), result.end()), Eq(expected));
+    }
+  }
+}
+
+namespace {
+auto readPhasesOfBinaryTrace(BinaryTrace const& trace, LoaderStrictness strictness)
+    -> std::vector<FuzzTrace>
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), trace);
+
+  FILE* stream = fopen(tempFile.getPath().string().c_str(), "rb");
+  if (stream == nullptr) {
+    throw TestIOException{"could not open " + tempFile.getPath().string()};
+  }
+  auto closeStream = gsl::finally([stream]() { fclose(stream); });
+
+  FlatFuzzTraceReader underTest{*stream, strictness};
+  std::vector<FuzzTrace> result;
+  FlatFuzzTrace phase;
+  while (underTest.readNextPhase(phase)) {
+    result.push_back(toFuzzTrace(phase.begin(), phase.end()));
+  }
+  return result;
+}
+}
+
+TEST(FlatFuzzTraceTests, ReaderThrowsAtTruncatedCommandInStrictMode)
+{
+  BinaryTrace const input{
+      uint32_t{0xF2950001}, uint8_t{2}, uint8_t{0}, uint32_t{2}, uint32_t{5}};
+  EXPECT_THROW(readPhasesOfBinaryTrace(input, LoaderStrictness::STRICT), IOException);
+}
+
+TEST(FlatFuzzTraceTests, ReaderStopsAtTruncatedCommandInPermissiveMode)
+{
+  // clang-format off
+  BinaryTrace const input{
+    uint32_t{0xF2950001},
+    uint8_t{0}, uint32_t{2}, uint32_t{0},
+    uint8_t{2},
+    uint8_t{1}, uint32_t{0},
+    uint8_t{0}, uint32_t{2}
+  };
+  // clang-format on
+  std::vector<FuzzTrace> const expected{FuzzTrace{AddClauseCmd{{1}}, SolveCmd{}},
+                                        FuzzTrace{AssumeCmd{}}};
+  EXPECT_THAT(readPhasesOfBinaryTrace(input, LoaderStrictness::PERMISSIVE), Eq(expected));
+}
+}
@@ -29,8 +29,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <vector>
+
 #include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 namespace incmonk {
 
@@ -141,4 +145,124 @@ TEST(ForkTests, WhenFnThrowsBeforeTimeout_ChildExecutionFailureIsThrown)
                    std::chrono::milliseconds{100000}),
                ChildExecutionFailure);
 }
-}
\ No newline at end of file
+
+namespace {
+auto toRequest(uint64_t value) -> std::vector<std::byte>
+{
+  std::vector<std::byte> result(sizeof(value));
+  memcpy(result.data(), &value, sizeof(value));
+  return result;
+}
+
+auto fromRequest(std::vector<std::byte> const& request) -> uint64_t
+{
+  uint64_t result = 0;
+  memcpy(&result, request.data(), sizeof(result));
+  return result;
+}
+}
+
+TEST(ForkServerTests, WhenFunctionExecutionSucceeds_ReturnValueIsPassedBack)
+{
+  auto underTest = createForkServer(
+      [](std::vector<std::byte> const& request) { return fromRequest(request) + 1; },
+      childProcessRetVal);
+
+  for (uint64_t i = 0; i < 10; ++i) {
+    std::optional<uint64_t> result = underTest->execute(toRequest(i));
+    ASSERT_TRUE(result.has_value());
+    EXPECT_THAT(*result, ::testing::Eq(i + 1));
+  }
+}
+
+TEST(ForkServerTests, WhenRequestIsEmpty_FunctionIsExecuted)
+{
+  auto underTest = createForkServer(
+      [](std::vector<std::byte> const& request) -> uint64_t { return request.size() + 5; },
+      childProcessRetVal);
+  std::optional<uint64_t> result = underTest->execute({});
+  ASSERT_TRUE(result.has_value());
+  EXPECT_THAT(*result, ::testing::Eq(5));
+}
+
+TEST(ForkServerTests, WhenChildCrashes_ChildExecutionFailureIsThrownAndServerRemainsUsable)
+{
+  auto underTest = createForkServer(
+      [](std::vector<std::byte> const& request) -> uint64_t {
+        uint64_t const arg = fromRequest(request);
+        if (arg == 1) {
+          raise(SIGSEGV);
+        }
+        else if (arg == 2) {
+          exit(1);
+        }
+        return arg;
+      },
+      childProcessRetVal);
+
+  EXPECT_THROW(underTest->execute(toRequest(1)), ChildExecutionFailure);
+  EXPECT_THAT(underTest->execute(toRequest(3)), ::testing::Optional(3));
+  EXPECT_THROW(underTest->execute(toRequest(2)), ChildExecutionFailure);
+  EXPECT_THAT(underTest->execute(toRequest(4)), ::testing::Optional(4));
+}
+
+TEST(ForkServerTests, WhenFnExceedsTimeout_NothingIsReturnedAndServerRemainsUsable)
+{
+  auto underTest = createForkServer(
+      [](std::vector<std::byte> const& request) -> uint64_t {
+        uint64_t const arg = fromRequest(request);
+        if (arg == 1) {
+          sleep(100);
+        }
+        return arg;
+      },
+      childProcessRetVal);
+
+  EXPECT_THAT(underTest->execute(toRequest(1), std::chrono::milliseconds{100}),
+              ::testing::Eq(std::nullopt));
+  EXPECT_THAT(underTest->execute(toRequest(3), std::chrono::milliseconds{100000}),
+              ::testing::Optional(3));
+}
+
+TEST(ForkServerTests, ChildProcessesInheritStateOfZygote)
+{
+  uint64_t state = 10;
+  auto underTest = createForkServer(
+      [&state](std::vector<std::byte> const&) -> uint64_t { return state++; },
+      childProcessRetVal);
+  state = 20;
+
+  EXPECT_THAT(underTest->execute({}), ::testing::Optional(10));
+  EXPECT_THAT(underTest->execute({}), ::testing::Optional(10));
+}
+
+TEST(ForkServerTests, WhenOlderServerIsDestroyedBeforeNewerServer_DestructionDoesNotBlock)
+{
+  auto identity = [](std::vector<std::byte> const& request) -> uint64_t {
+    return fromRequest(request);
+  };
+  auto older = createForkServer(identity, childProcessRetVal);
+  auto newer = createForkServer(identity, childProcessRetVal);
+
+  EXPECT_THAT(older->execute(toRequest(1)), ::testing::Optional(1));
+  older.reset();
+  EXPECT_THAT(newer->execute(toRequest(2)), ::testing::Optional(2));
+}
+
+TEST(ForkServerTests, WhenZygoteHasDied_RuntimeErrorIsThrownAndSigPipeIsNotRaised)
+{
+  auto underTest = createForkServer(
+      [](std::vector<std::byte> const&) -> uint64_t {
+        kill(getppid(), SIGKILL);
+        return 0;
+      },
+      childProcessRetVal);
+
+  EXPECT_THROW(underTest->execute(toRequest(1)), std::runtime_error);
+  EXPECT_THROW(underTest->execute(toRequest(2)), std::runtime_error);
+
+  struct sigaction sigPipeAction;
+  sigaction(SIGPIPE, nullptr, &sigPipeAction);
+  EXPECT_THAT(sigPipeAction.sa_handler, ::testing::Eq(SIG_DFL));
+}
+}
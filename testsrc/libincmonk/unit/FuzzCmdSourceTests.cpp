@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FuzzCmdSource.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/Profiling.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace incmonk {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Lt;
+
+namespace {
+// Passes through the commands of another source, sleeping before each read
+class SleepingFuzzCmdSource final : public FuzzCmdSource {
+public:
+  SleepingFuzzCmdSource(std::unique_ptr<FuzzCmdSource> source, std::chrono::milliseconds delay)
+    : m_source{std::move(source)}, m_delay{delay}
+  {
+  }
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    std::this_thread::sleep_for(m_delay);
+    return m_source->readNext(target);
+  }
+
+private:
+  std::unique_ptr<FuzzCmdSource> m_source;
+  std::chrono::milliseconds m_delay;
+};
+
+auto createTestInput() -> FuzzTrace
+{
+  return FuzzTrace{AddClauseCmd{{1, 2}}, AssumeCmd{{3}}, SolveCmd{}};
+}
+}
+
+TEST(FuzzCmdSourceProfilerTests, WhenThreadProfileIsNotSet_SourceIsNotWrapped)
+{
+  FuzzCmdSourceProfiler underTest;
+  auto source = createFuzzCmdSource(createTestInput());
+  FuzzCmdSource* const sourcePtr = source.get();
+  EXPECT_THAT(underTest.profile(std::move(source), ProfilePhase::INSERT_SOLVE_CMDS).get(),
+              Eq(sourcePtr));
+}
+
+TEST(FuzzCmdSourceProfilerTests, TimeOfWrappedSourcesIsRecordedExclusively)
+{
+  Profile profile;
+  setThreadProfile(&profile);
+
+  std::chrono::milliseconds const delay{5};
+  {
+    FuzzCmdSourceProfiler underTest;
+    std::unique_ptr<FuzzCmdSource> source = std::make_unique<SleepingFuzzCmdSource>(
+        createFuzzCmdSource(createTestInput()), 4 * delay);
+    source = underTest.profile(std::move(source), std::nullopt);
+    source = underTest.profile(std::make_unique<SleepingFuzzCmdSource>(std::move(source), delay),
+                               ProfilePhase::INSERT_SOLVE_CMDS);
+    source = underTest.profile(std::move(source), ProfilePhase::INSERT_HAVOC_CMDS);
+
+    FuzzTrace result;
+    appendCmds(*source, result);
+    EXPECT_THAT(result, Eq(createTestInput()));
+  }
+
+  setThreadProfile(nullptr);
+
+  // 4 reads, including the one signalling the end of the trace. Only the first one is timed,
+  // with its time being extrapolated to all 4 reads
+  PhaseProfile const solveProfile = profile.getPhaseProfile(ProfilePhase::INSERT_SOLVE_CMDS);
+  EXPECT_THAT(solveProfile.count, Eq(1));
+  EXPECT_THAT(solveProfile.totalTime, Ge(4 * delay));
+  EXPECT_THAT(solveProfile.totalTime, Lt(16 * delay));
+
+  PhaseProfile const havocProfile = profile.getPhaseProfile(ProfilePhase::INSERT_HAVOC_CMDS);
+  EXPECT_THAT(havocProfile.count, Eq(1));
+  EXPECT_THAT(havocProfile.totalTime, Lt(4 * delay));
+
+  EXPECT_THAT(profile.getPhaseProfile(ProfilePhase::GENERATE).count, Eq(0));
+}
+}
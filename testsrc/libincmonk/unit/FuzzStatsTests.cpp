@@ -0,0 +1,195 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FuzzStats.h>
+
+#include <libincmonk/FuzzTrace.h>
+
+#include "FileUtils.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using ::testing::DoubleEq;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+
+namespace incmonk {
+
+namespace {
+auto createTestStats() -> FuzzStats
+{
+  FuzzStats result;
+  result.elapsedTime = std::chrono::seconds{4};
+  result.numRounds = 10;
+  result.numIncorrectResults = 1;
+  result.numInvalidModels = 2;
+  result.numCrashes = 3;
+  result.numSolveTimeouts = 4;
+  result.numTraceCommands = 250;
+  result.numSolveCalls = 30;
+  result.oracleTime = std::chrono::milliseconds{1500};
+  result.sutTime = std::chrono::milliseconds{2000};
+  result.peakRSS = 1 << 20;
+  return result;
+}
+
+auto readFile(std::filesystem::path const& path) -> std::string
+{
+  std::ifstream file{path};
+  std::stringstream result;
+  result << file.rdbuf();
+  return result.str();
+}
+}
+
+TEST(FuzzStatsTests, DerivedValuesAreComputedFromCounters)
+{
+  FuzzStats const underTest = createTestStats();
+  EXPECT_THAT(underTest.getNumCorrectnessFailures(), Eq(3));
+  EXPECT_THAT(underTest.getExecsPerSecond(), DoubleEq(2.5));
+  EXPECT_THAT(underTest.getAverageTraceSize(), DoubleEq(25.0));
+  EXPECT_THAT(underTest.getAverageSolveCalls(), DoubleEq(3.0));
+}
+
+TEST(FuzzStatsTests, DerivedValuesOfEmptyStatsAreZero)
+{
+  FuzzStats const underTest;
+  EXPECT_THAT(underTest.getExecsPerSecond(), DoubleEq(0.0));
+  EXPECT_THAT(underTest.getAverageTraceSize(), DoubleEq(0.0));
+  EXPECT_THAT(underTest.getAverageSolveCalls(), DoubleEq(0.0));
+}
+
+TEST(FuzzStatsTests, JSONFormatContainsAllFields)
+{
+  std::string const result = formatStats(createTestStats(), "monkey-\"x\"", StatsFormat::JSON);
+  EXPECT_THAT(result, HasSubstr("\"fuzzer_id\": \"monkey-\\\"x\\\"\""));
+  EXPECT_THAT(result, HasSubstr("\"rounds\": 10,"));
+  EXPECT_THAT(result, HasSubstr("\"execs_per_sec\": 2.500,"));
+  EXPECT_THAT(result, HasSubstr("\"incorrect_result\": 1,"));
+  EXPECT_THAT(result, HasSubstr("\"invalid_model\": 2,"));
+  EXPECT_THAT(result, HasSubstr("\"crash\": 3,"));
+  EXPECT_THAT(result, HasSubstr("\"solve_timeout\": 4,"));
+  EXPECT_THAT(result, HasSubstr("\"memout\": 0\n"));
+  EXPECT_THAT(result, HasSubstr("\"average_trace_size\": 25.000,"));
+  EXPECT_THAT(result, HasSubstr("\"average_solve_calls\": 3.000,"));
+  EXPECT_THAT(result, HasSubstr("\"oracle\": 1.500,"));
+  EXPECT_THAT(result, HasSubstr("\"sut\": 2.000\n"));
+  EXPECT_THAT(result, HasSubstr("\"peak_rss_bytes\": 1048576\n"));
+}
+
+TEST(FuzzStatsTests, PrometheusFormatContainsLabeledSamples)
+{
+  std::string const result = formatStats(createTestStats(), "m01", StatsFormat::PROMETHEUS);
+  EXPECT_THAT(result, HasSubstr("# TYPE incmonk_rounds_total counter\n"));
+  EXPECT_THAT(result, HasSubstr("incmonk_rounds_total{fuzzer=\"m01\"} 10\n"));
+  EXPECT_THAT(result, HasSubstr("incmonk_execs_per_second{fuzzer=\"m01\"} 2.500\n"));
+  EXPECT_THAT(result,
+              HasSubstr("incmonk_failures_total{fuzzer=\"m01\",reason=\"invalid_model\"} 2\n"));
+  EXPECT_THAT(result,
+              HasSubstr("incmonk_time_seconds_total{fuzzer=\"m01\",phase=\"sut\"} 2.000\n"));
+  EXPECT_THAT(result, HasSubstr("incmonk_peak_rss_bytes{fuzzer=\"m01\"} 1048576\n"));
+}
+
+TEST(FuzzStatsTests, PeakRSSOfCurrentProcessIsPositive)
+{
+  EXPECT_THAT(getPeakRSS(), Gt(0));
+}
+
+TEST(FuzzStatsTests, WhenStatsFileIsWritten_PreviousContentIsReplaced)
+{
+  PathWithDeleter tempDir = createTempDir();
+  std::filesystem::path const statsFile = tempDir.getPath() / "stats.json";
+
+  writeStatsFile(statsFile, "first content, which is longer");
+  writeStatsFile(statsFile, "second");
+  EXPECT_THAT(readFile(statsFile), Eq("second"));
+  EXPECT_FALSE(std::filesystem::exists(tempDir.getPath() / "stats.json.tmp"));
+}
+
+TEST(FuzzStatsTests, WhenStatsFileCannotBeWritten_IOExceptionIsThrown)
+{
+  PathWithDeleter tempDir = createTempDir();
+  EXPECT_THROW(writeStatsFile(tempDir.getPath() / "nonexistent" / "stats.json", "x"),
+               IOException);
+}
+
+TEST(FuzzStatsTests, ExporterWritesStatsPeriodically)
+{
+  PathWithDeleter tempDir = createTempDir();
+  std::filesystem::path const statsFile = tempDir.getPath() / "stats.prom";
+
+  std::atomic<uint64_t> numCalls = 0;
+  std::unique_ptr<StatsExporter> underTest =
+      createStatsExporter(statsFile,
+                          StatsFormat::PROMETHEUS,
+                          "m01",
+                          std::chrono::milliseconds{1},
+                          [&numCalls]() {
+                            FuzzStats result;
+                            result.numRounds = ++numCalls;
+                            return result;
+                          });
+
+  while (numCalls < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  underTest.reset();
+
+  std::string const expected =
+      "incmonk_rounds_total{fuzzer=\"m01\"} " + std::to_string(numCalls.load()) + "\n";
+  EXPECT_THAT(readFile(statsFile), HasSubstr(expected));
+}
+
+TEST(FuzzStatsTests, WhenExporterIsFlushed_CurrentStatsAreWritten)
+{
+  PathWithDeleter tempDir = createTempDir();
+  std::filesystem::path const statsFile = tempDir.getPath() / "stats.json";
+
+  std::unique_ptr<StatsExporter> underTest = createStatsExporter(
+      statsFile, StatsFormat::JSON, "m01", std::chrono::hours{1}, []() { return FuzzStats{}; });
+  underTest->flush();
+  EXPECT_THAT(readFile(statsFile), HasSubstr("\"rounds\": 0,"));
+}
+
+TEST(FuzzStatsTests, WhenExporterCannotWrite_FlushThrows)
+{
+  PathWithDeleter tempDir = createTempDir();
+  std::filesystem::path const statsFile = tempDir.getPath() / "nonexistent" / "stats.json";
+
+  std::unique_ptr<StatsExporter> underTest = createStatsExporter(
+      statsFile, StatsFormat::JSON, "m01", std::chrono::hours{1}, []() { return FuzzStats{}; });
+  EXPECT_THROW(underTest->flush(), IOException);
+}
+}
@@ -36,6 +36,7 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <variant>
 #include <vector>
 
 using ::testing::Eq;
@@ -93,6 +94,54 @@ TEST_P(FuzzTraceExecTests_executeTrace, TestSuite)
   }
 }
 
+namespace {
+/**
+ * Phase source for executeTraceFromStream(), splitting a FuzzTrace after each solve command
+ */
+class FuzzTracePhaseSource {
+public:
+  explicit FuzzTracePhaseSource(FuzzTrace const& trace)
+    : m_cursor{trace.begin()}, m_end{trace.end()}
+  {
+  }
+
+  auto readNextPhase(FlatFuzzTrace& target) -> bool
+  {
+    target.clear();
+    while (m_cursor != m_end) {
+      bool const isSolveCmd = std::holds_alternative<SolveCmd>(*m_cursor);
+      target.push_back(*m_cursor);
+      ++m_cursor;
+      if (isSolveCmd) {
+        break;
+      }
+    }
+    return !target.empty();
+  }
+
+private:
+  FuzzTrace::const_iterator m_cursor;
+  FuzzTrace::const_iterator m_end;
+};
+}
+
+TEST_P(FuzzTraceExecTests_executeTrace, TestSuite_executeTraceFromStream)
+{
+  FuzzTrace const inputTrace = getInputTrace();
+  FakeIPASIRSolver fakeSut{getIPASIRResults()};
+  FuzzTracePhaseSource source{inputTrace};
+
+  std::optional<TraceExecutionFailure::Reason> result = executeTraceFromStream(source, fakeSut);
+
+  if (getFailureIndex().has_value()) {
+    ASSERT_TRUE(result.has_value());
+    EXPECT_THAT(*result, Eq(*getFailureReason()));
+  }
+  else {
+    EXPECT_FALSE(result.has_value());
+  }
+}
+
 using SolveResults = std::vector<FakeIPASIRResult>;
 
 // clang-format off
@@ -290,6 +339,136 @@ INSTANTIATE_TEST_SUITE_P(, FuzzTraceExecTests_executeTrace,
         {IPASIRSolver::Result::ILLEGAL_RESULT, {}}
       },
       4, TraceExecutionFailure::Reason::INVALID_RESULT
+    ),
+
+    // Traces with expected results:
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1, -2}},
+        {IPASIRSolver::Result::UNSAT, {1, 2}}
+      },
+      std::nullopt, std::nullopt
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2, 3}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1, -2}},
+        {IPASIRSolver::Result::UNSAT, {1, 2}}
+      },
+      std::nullopt, std::nullopt
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::UNSAT, {}},
+        {IPASIRSolver::Result::UNSAT, {1, 2}}
+      },
+      2, TraceExecutionFailure::Reason::INCORRECT_RESULT
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1, -2}},
+        {IPASIRSolver::Result::SAT, {1, -2}}
+      },
+      4, TraceExecutionFailure::Reason::INCORRECT_RESULT
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1, 2}},
+        {IPASIRSolver::Result::UNSAT, {1, 2}}
+      },
+      2, TraceExecutionFailure::Reason::INVALID_MODEL
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-2, -1}},
+        SolveCmd{true},
+        AssumeCmd{{1, 2}},
+        SolveCmd{false}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1, -2}},
+        {IPASIRSolver::Result::UNSAT, {-1, 2}}
+      },
+      4, TraceExecutionFailure::Reason::INVALID_FAILED
+    ),
+
+    // Partial models:
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{3, 4}},
+        SolveCmd{}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1}}
+      },
+      std::nullopt, std::nullopt
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-1, 3}},
+        AddClauseCmd{{-3}},
+        SolveCmd{}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {1}}
+      },
+      3, TraceExecutionFailure::Reason::INVALID_MODEL
+    ),
+
+    std::make_tuple(
+      FuzzTrace {
+        AddClauseCmd{{1, 2}},
+        AddClauseCmd{{-1, 3}},
+        AddClauseCmd{{-3}},
+        SolveCmd{true}
+      },
+      SolveResults {
+        {IPASIRSolver::Result::SAT, {-1, 2}}
+      },
+      std::nullopt, std::nullopt
     )
 
   )
@@ -26,100 +26,27 @@
 
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/TraceDumpWriter.h>
 
 #include "FileUtils.h"
+#include "RecordingIPASIRSolver.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+
+#include <cstddef>
+#include <filesystem>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace incmonk {
 
-class RecordingIPASIRSolver : public IPASIRSolver {
-public:
-  RecordingIPASIRSolver(std::vector<IPASIRSolver::Result> const& solveResults)
-  {
-    m_solveResults.assign(solveResults.rbegin(), solveResults.rend());
-  }
-
-  void addClause(CNFClause const& clause) override
-  {
-    m_recordedTrace.push_back(AddClauseCmd{clause});
-  }
-
-  void assume(std::vector<CNFLit> const& assumptions) override
-  {
-    m_recordedTrace.push_back(AssumeCmd{assumptions});
-  }
-
-  void reinitializeWithHavoc(uint64_t seed) noexcept override
-  {
-    m_recordedTrace.push_back(HavocCmd{seed, true});
-  }
-
-  void havoc(uint64_t seed) noexcept override { m_recordedTrace.push_back(HavocCmd{seed, false}); }
-
-  auto solve() -> IPASIRSolver::Result override
-  {
-    assert(!m_solveResults.empty());
-    IPASIRSolver::Result const result = m_solveResults.back();
-    m_solveResults.pop_back();
-
-    std::optional<bool> traceResult;
-    if (result == IPASIRSolver::Result::SAT || result == IPASIRSolver::Result::UNSAT) {
-      traceResult = (result == IPASIRSolver::Result::SAT);
-    }
-
-    m_recordedTrace.push_back(SolveCmd{traceResult});
-    m_lastResult = result;
-    return result;
-  }
-
-  auto getLastSolveResult() const noexcept -> IPASIRSolver::Result override { return m_lastResult; }
-
-  virtual void configure(uint64_t) override { m_calledConfigure = true; }
-
-  auto getTrace() const noexcept -> FuzzTrace const& { return m_recordedTrace; }
-
-  auto hasConfigureBeenCalled() const noexcept -> bool { return m_calledConfigure; }
-
-  auto getValue(CNFLit) const noexcept -> TBool override { return t_indet; }
-
-  auto isFailed(CNFLit) const noexcept -> bool override { return false; }
-
-private:
-  std::vector<IPASIRSolver::Result> m_solveResults;
-  FuzzTrace m_recordedTrace;
-  bool m_calledConfigure = false;
-  Result m_lastResult = Result::UNKNOWN;
-};
-
-
 class FuzzTraceTests_applyTrace : public ::testing::TestWithParam<FuzzTrace> {
 public:
   virtual ~FuzzTraceTests_applyTrace() = default;
 };
 
-namespace {
-std::vector<IPASIRSolver::Result> getSolveResults(FuzzTrace const& trace)
-{
-  std::vector<IPASIRSolver::Result> result;
-  for (FuzzCmd const& cmd : trace) {
-    if (SolveCmd const* solveCmd = std::get_if<SolveCmd>(&cmd); solveCmd != nullptr) {
-      if (solveCmd->expectedResult.has_value()) {
-        result.push_back(*(solveCmd->expectedResult) ? IPASIRSolver::Result::SAT
-                                                     : IPASIRSolver::Result::UNSAT);
-      }
-      else {
-        result.push_back(IPASIRSolver::Result::UNKNOWN);
-      }
-    }
-  }
-  return result;
-}
-}
-
 TEST_P(FuzzTraceTests_applyTrace, TestSuite_stopsAtSolveCmd)
 {
   FuzzTrace input = GetParam();
@@ -183,6 +110,18 @@ INSTANTIATE_TEST_SUITE_P(, FuzzTraceTests_applyTrace,
 // clang-format on
 
 
+TEST(FuzzTraceTests_clearExpectedResults, ExpectedResultsAreRemovedOnlyWithinRange)
+{
+  FuzzTrace underTest{
+      AddClauseCmd{{1, -2}}, SolveCmd{true}, AssumeCmd{{1}}, SolveCmd{false}, SolveCmd{true}};
+  clearExpectedResults(underTest.begin(), underTest.begin() + 4);
+
+  FuzzTrace expected{
+      AddClauseCmd{{1, -2}}, SolveCmd{}, AssumeCmd{{1}}, SolveCmd{}, SolveCmd{true}};
+  EXPECT_THAT(underTest, ::testing::Eq(expected));
+}
+
+
 class FuzzTraceTests_loadStoreTrace
   : public ::testing::TestWithParam<std::tuple<FuzzTrace, BinaryTrace>> {
 public:
@@ -200,6 +139,33 @@ TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_store)
   assertFileContains(tempFile.getPath(), expectedBinary);
 }
 
+TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_storeToStream)
+{
+  PathWithDeleter tempFile = createTempFile();
+  FuzzTrace input = std::get<0>(GetParam());
+
+  FILE* output = fopen(tempFile.getPath().string().c_str(), "w");
+  ASSERT_THAT(output, ::testing::NotNull());
+  storeTrace(input.begin(), input.end(), *output);
+  fclose(output);
+
+  BinaryTrace const& expectedBinary = std::get<1>(GetParam());
+  assertFileContains(tempFile.getPath(), expectedBinary);
+}
+
+TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_encodeAndWriteTraceFile)
+{
+  PathWithDeleter tempFile = createTempFile();
+  FuzzTrace input = std::get<0>(GetParam());
+
+  std::vector<std::byte> encodedTrace;
+  encodeTrace(input.begin(), input.end(), encodedTrace);
+  writeTraceFile(tempFile.getPath(), encodedTrace, FsyncPolicy::NEVER);
+
+  BinaryTrace const& expectedBinary = std::get<1>(GetParam());
+  assertFileContains(tempFile.getPath(), expectedBinary);
+}
+
 TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_loadCorrectlyFormattedFile)
 {
   PathWithDeleter tempFile = createTempFile();
@@ -213,6 +179,26 @@ TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_loadCorrectlyFormattedFile)
   EXPECT_THAT(result, ::testing::Eq(expected));
 }
 
+TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_loadFromBuffer)
+{
+  std::vector<std::byte> const input = toBytes(std::get<1>(GetParam()));
+
+  FuzzTrace expected = std::get<0>(GetParam());
+  EXPECT_THAT(loadTrace(input), ::testing::Eq(expected));
+  EXPECT_THAT(loadTrace(input, LoaderStrictness::PERMISSIVE), ::testing::Eq(expected));
+}
+
+TEST_P(FuzzTraceTests_loadStoreTrace, TestSuite_roundTripInFormatV2)
+{
+  PathWithDeleter tempFile = createTempFile();
+  FuzzTrace input = std::get<0>(GetParam());
+
+  storeTrace(input.begin(), input.end(), tempFile.getPath(), TraceFormat::V2);
+
+  EXPECT_THAT(loadTrace(tempFile.getPath()), ::testing::Eq(input));
+  EXPECT_THAT(loadTrace(tempFile.getPath(), LoaderStrictness::PERMISSIVE), ::testing::Eq(input));
+}
+
 
 namespace {
 constexpr static uint32_t magicCookie = 0xF2950001;
@@ -277,4 +263,176 @@ INSTANTIATE_TEST_SUITE_P(, FuzzTraceTests_loadStoreTrace,
 // clang-format on
 
 // TODO: negative parsing tests
-}
\ No newline at end of file
+
+namespace {
+auto getBinaryTraceSize(BinaryTrace const& trace) -> std::size_t
+{
+  std::size_t result = 0;
+  for (auto const& intVariant : trace) {
+    result += std::visit([](auto value) { return sizeof(value); }, intVariant);
+  }
+  return result;
+}
+}
+
+class FuzzTraceTests_loadStoreTraceV2
+  : public ::testing::TestWithParam<std::tuple<FuzzTrace, BinaryTrace>> {
+public:
+  virtual ~FuzzTraceTests_loadStoreTraceV2() = default;
+};
+
+TEST_P(FuzzTraceTests_loadStoreTraceV2, TestSuite_store)
+{
+  PathWithDeleter tempFile = createTempFile();
+  FuzzTrace input = std::get<0>(GetParam());
+
+  storeTrace(input.begin(), input.end(), tempFile.getPath(), TraceFormat::V2);
+
+  BinaryTrace const& expectedBinary = std::get<1>(GetParam());
+  assertFileContains(tempFile.getPath(), expectedBinary);
+  EXPECT_THAT(std::filesystem::file_size(tempFile.getPath()),
+              ::testing::Eq(getBinaryTraceSize(expectedBinary)));
+}
+
+TEST_P(FuzzTraceTests_loadStoreTraceV2, TestSuite_loadCorrectlyFormattedFile)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), std::get<1>(GetParam()));
+
+  FuzzTrace expected = std::get<0>(GetParam());
+  EXPECT_THAT(loadTrace(tempFile.getPath()), ::testing::Eq(expected));
+}
+
+TEST_P(FuzzTraceTests_loadStoreTraceV2, TestSuite_loadFromBuffer)
+{
+  std::vector<std::byte> const input = toBytes(std::get<1>(GetParam()));
+  EXPECT_THAT(loadTrace(input), ::testing::Eq(std::get<0>(GetParam())));
+}
+
+namespace {
+constexpr static uint32_t magicCookieV2 = 0xF2950002;
+}
+
+// clang-format off
+INSTANTIATE_TEST_SUITE_P(, FuzzTraceTests_loadStoreTraceV2,
+  ::testing::Values(
+    std::make_tuple(FuzzTrace{}, BinaryTrace{magicCookieV2}),
+
+    // Sorted literals are stored with unsigned deltas:
+    std::make_tuple(
+      FuzzTrace{AddClauseCmd{{1, -2, 70}}},
+      BinaryTrace{magicCookieV2, uint8_t{2}, uint8_t{3}, uint8_t{2}, uint8_t{3}, uint8_t{135}, uint8_t{1}}
+    ),
+
+    // Unsorted literals are stored with zigzag-encoded deltas:
+    std::make_tuple(
+      FuzzTrace{AssumeCmd{{3, 1}}},
+      BinaryTrace{magicCookieV2, uint8_t{1}, uint8_t{2}, uint8_t{12}, uint8_t{7}}
+    ),
+
+    std::make_tuple(FuzzTrace{AssumeCmd{}}, BinaryTrace{magicCookieV2, uint8_t{3}, uint8_t{0}}),
+
+    // Runs of solve and havoc commands are stored as single commands:
+    std::make_tuple(
+      FuzzTrace{SolveCmd{true}, SolveCmd{true}, SolveCmd{true}, SolveCmd{}, SolveCmd{false}},
+      BinaryTrace{magicCookieV2, uint8_t{6}, uint8_t{3}, uint8_t{4}, uint8_t{1}, uint8_t{5}, uint8_t{1}}
+    ),
+    std::make_tuple(
+      FuzzTrace{HavocCmd{15, true}, HavocCmd{16, true}, HavocCmd{17, false}},
+      BinaryTrace{magicCookieV2,
+        uint8_t{7}, uint8_t{2}, uint64_t{15}, uint64_t{16},
+        uint8_t{8}, uint8_t{1}, uint64_t{17}
+      }
+    ),
+
+    std::make_tuple(
+      FuzzTrace{
+        HavocCmd{15, true},
+        AddClauseCmd{{2, -1}},
+        SolveCmd{},
+        AddClauseCmd{{2}},
+        SolveCmd{}
+      },
+      BinaryTrace{magicCookieV2,
+        uint8_t{7}, uint8_t{1}, uint64_t{15},
+        uint8_t{0}, uint8_t{2}, uint8_t{8}, uint8_t{1},
+        uint8_t{4}, uint8_t{1},
+        uint8_t{2}, uint8_t{1}, uint8_t{4},
+        uint8_t{4}, uint8_t{1}
+      }
+    )
+  )
+);
+// clang-format on
+
+TEST(FuzzTraceTests, LongRunsOfSolveCommandsAreSplitInFormatV2)
+{
+  FuzzTrace const input(0x10001, SolveCmd{false});
+  PathWithDeleter tempFile = createTempFile();
+  storeTrace(input.begin(), input.end(), tempFile.getPath(), TraceFormat::V2);
+
+  assertFileContains(
+      tempFile.getPath(),
+      BinaryTrace{magicCookieV2, uint8_t{5}, uint8_t{0xFF}, uint8_t{0xFF}, uint8_t{3}, uint8_t{5}, uint8_t{2}});
+  EXPECT_THAT(loadTrace(tempFile.getPath()), ::testing::Eq(input));
+}
+
+class FuzzTraceTests_loadMalformedTraceV2 : public ::testing::TestWithParam<BinaryTrace> {
+public:
+  virtual ~FuzzTraceTests_loadMalformedTraceV2() = default;
+};
+
+TEST_P(FuzzTraceTests_loadMalformedTraceV2, TestSuite_throwsInStrictMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), GetParam());
+  EXPECT_THROW(loadTrace(tempFile.getPath()), IOException);
+}
+
+TEST_P(FuzzTraceTests_loadMalformedTraceV2, TestSuite_stopsBeforeMalformedCmdInPermissiveMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), GetParam());
+  EXPECT_THAT(loadTrace(tempFile.getPath(), LoaderStrictness::PERMISSIVE),
+              ::testing::Eq(FuzzTrace{SolveCmd{}}));
+}
+
+TEST_P(FuzzTraceTests_loadMalformedTraceV2, TestSuite_loadingFromBufferThrowsInStrictMode)
+{
+  std::vector<std::byte> const input = toBytes(GetParam());
+  EXPECT_THROW(loadTrace(input), IOException);
+}
+
+TEST_P(FuzzTraceTests_loadMalformedTraceV2,
+       TestSuite_loadingFromBufferStopsBeforeMalformedCmdInPermissiveMode)
+{
+  std::vector<std::byte> const input = toBytes(GetParam());
+  EXPECT_THAT(loadTrace(input, LoaderStrictness::PERMISSIVE),
+              ::testing::Eq(FuzzTrace{SolveCmd{}}));
+}
+
+// clang-format off
+INSTANTIATE_TEST_SUITE_P(, FuzzTraceTests_loadMalformedTraceV2,
+  ::testing::Values(
+    // Truncated literal list
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{0}, uint8_t{2}, uint8_t{2}},
+    // Truncated varint
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{0}, uint8_t{1}, uint8_t{0x82}},
+    // Literal 0
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{2}, uint8_t{1}, uint8_t{0}},
+    // Literal exceeding 32 bits
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{2}, uint8_t{1},
+      uint8_t{0x80}, uint8_t{0x80}, uint8_t{0x80}, uint8_t{0x80}, uint8_t{0x10}},
+    // Varint exceeding 64 bits
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{2}, uint8_t{1},
+      uint64_t{0xFFFF'FFFF'FFFF'FFFF}, uint8_t{0xFF}, uint8_t{0x02}},
+    // Empty run
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{4}, uint8_t{0}},
+    // Run exceeding the maximum run length
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{4}, uint8_t{0x80}, uint8_t{0x80}, uint8_t{0x04}},
+    // Truncated havoc seed
+    BinaryTrace{magicCookieV2, uint8_t{4}, uint8_t{1}, uint8_t{8}, uint8_t{1}, uint32_t{1}}
+  )
+);
+// clang-format on
+}
@@ -0,0 +1,163 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/FlatFuzzTrace.h>
+#include <libincmonk/FuzzCmdSource.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/InterspersionSchedulers.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <memory>
+#include <variant>
+
+namespace incmonk {
+
+using ::testing::Eq;
+using ::testing::Le;
+
+namespace {
+// Produces clauses on demand, counting the commands read from it
+class CountingClauseSource final : public FuzzCmdSource {
+public:
+  CountingClauseSource(std::size_t numClauses, std::size_t& numReadCmds)
+    : m_numClauses{numClauses}, m_numReadCmds{numReadCmds}
+  {
+  }
+
+  auto readNext(FuzzCmd& target) -> bool override
+  {
+    if (m_numReadCmds == m_numClauses) {
+      return false;
+    }
+    ++m_numReadCmds;
+    CNFLit const lit = static_cast<CNFLit>(m_numReadCmds);
+    target = AddClauseCmd{{lit, -(lit + 1)}};
+    return true;
+  }
+
+private:
+  std::size_t m_numClauses;
+  std::size_t& m_numReadCmds;
+};
+
+auto createTestInput() -> FuzzTrace
+{
+  FuzzTrace result;
+  for (CNFLit lit = 1; lit < 500; ++lit) {
+    result.push_back(AddClauseCmd{{lit, -(lit + 1), lit + 2}});
+  }
+  return result;
+}
+
+auto createDenseSolveParams() -> SolveCmdScheduleParams
+{
+  SolveCmdScheduleParams result;
+  result.density = ClosedInterval{0.05, 0.1};
+  result.assumptionDensity = ClosedInterval{0.1, 0.3};
+  return result;
+}
+
+auto createDenseHavocParams() -> HavocCmdScheduleParams
+{
+  HavocCmdScheduleParams result;
+  result.density = ClosedInterval{0.05, 0.1};
+  return result;
+}
+
+auto readAll(FuzzCmdSource& source) -> FuzzTrace
+{
+  FuzzTrace result;
+  appendCmds(source, result);
+  return result;
+}
+}
+
+TEST(InterspersionSchedulersTests, FuzzCmdSourceProducesCommandsOfTrace)
+{
+  FuzzTrace const input{AddClauseCmd{{1, 2}}, AssumeCmd{{-1}}, SolveCmd{}, HavocCmd{3, false}};
+  auto underTest = createFuzzCmdSource(FuzzTrace{input});
+  EXPECT_THAT(readAll(*underTest), Eq(input));
+
+  FuzzCmd cmd;
+  EXPECT_FALSE(underTest->readNext(cmd));
+}
+
+TEST(InterspersionSchedulersTests, LazyInsertersProduceSameTracesAsFlatTraceInsertion)
+{
+  FuzzTrace input = createTestInput();
+  FlatFuzzTrace const flatInput = toFlatFuzzTrace(input.begin(), input.end());
+
+  FlatFuzzTrace const expected = insertHavocCmds(
+      insertSolveCmds(flatInput, createDenseSolveParams(), 502, 17), createDenseHavocParams(), 23);
+
+  auto solveCmdInserter = createSolveCmdInserter(
+      createFuzzCmdSource(std::move(input)), createDenseSolveParams(), 502, 17);
+  auto underTest =
+      createHavocCmdInserter(std::move(solveCmdInserter), createDenseHavocParams(), 23);
+
+  EXPECT_THAT(toFuzzTrace(expected.begin(), expected.end()), Eq(readAll(*underTest)));
+}
+
+TEST(InterspersionSchedulersTests, LazyInsertersReadCommandsOnDemand)
+{
+  std::size_t numReadCmds = 0;
+  auto underTest = createHavocCmdInserter(
+      createSolveCmdInserter(std::make_unique<CountingClauseSource>(1000, numReadCmds),
+                             createDenseSolveParams(),
+                             1001,
+                             5),
+      createDenseHavocParams(),
+      7);
+
+  FuzzCmd cmd;
+  for (std::size_t numProducedCmds = 1; numProducedCmds <= 100; ++numProducedCmds) {
+    ASSERT_TRUE(underTest->readNext(cmd));
+    EXPECT_THAT(numReadCmds, Le(numProducedCmds));
+  }
+
+  FuzzTrace const rest = readAll(*underTest);
+  EXPECT_THAT(numReadCmds, Eq(1000));
+  ASSERT_FALSE(rest.empty());
+  EXPECT_TRUE(std::holds_alternative<SolveCmd>(rest.back()));
+}
+
+TEST(InterspersionSchedulersTests, WhenSourceIsEmpty_LazyInsertersProduceOnlyMandatoryCmds)
+{
+  auto underTest = createHavocCmdInserter(
+      createSolveCmdInserter(createFuzzCmdSource(FuzzTrace{}), createDenseSolveParams(), 1, 5),
+      createDenseHavocParams(),
+      7);
+
+  FuzzTrace const result = readAll(*underTest);
+  ASSERT_THAT(result.size(), Eq(2));
+  ASSERT_TRUE(std::holds_alternative<HavocCmd>(result[0]));
+  EXPECT_TRUE(std::get<HavocCmd>(result[0]).beforeInit);
+  EXPECT_TRUE(std::holds_alternative<SolveCmd>(result[1]));
+}
+}
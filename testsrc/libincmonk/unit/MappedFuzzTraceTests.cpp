@@ -0,0 +1,220 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/MappedFuzzTrace.h>
+
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/FuzzTracePrinters.h>
+
+#include "FileUtils.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using ::testing::Eq;
+
+namespace incmonk {
+
+namespace {
+constexpr uint32_t magicCookie = 0xF2950001;
+
+auto mapStoredTrace(FuzzTrace const& trace, TraceFormat format = TraceFormat::V1)
+    -> std::pair<PathWithDeleter, MappedFuzzTrace>
+{
+  PathWithDeleter tempFile = createTempFile();
+  storeTrace(trace.begin(), trace.end(), tempFile.getPath(), format);
+  MappedFuzzTrace mappedTrace{tempFile.getPath()};
+  return {std::move(tempFile), std::move(mappedTrace)};
+}
+}
+
+class MappedFuzzTraceTests_storedTraces : public ::testing::TestWithParam<FuzzTrace> {
+public:
+  virtual ~MappedFuzzTraceTests_storedTraces() = default;
+};
+
+TEST_P(MappedFuzzTraceTests_storedTraces, TestSuite_decodesStoredTrace)
+{
+  FuzzTrace const& input = GetParam();
+  auto [tempFile, underTest] = mapStoredTrace(input);
+
+  EXPECT_THAT(toFuzzTrace(underTest.begin(), underTest.end()), Eq(input));
+}
+
+TEST_P(MappedFuzzTraceTests_storedTraces, TestSuite_decodesStoredTraceInFormatV2)
+{
+  FuzzTrace const& input = GetParam();
+  auto [tempFile, underTest] = mapStoredTrace(input, TraceFormat::V2);
+
+  EXPECT_THAT(toFuzzTrace(underTest.begin(), underTest.end()), Eq(input));
+  EXPECT_THAT(std::distance(underTest.begin(), underTest.end()), Eq(input.size()));
+}
+
+TEST_P(MappedFuzzTraceTests_storedTraces, TestSuite_iteratorsAreIndependent)
+{
+  FuzzTrace const& input = GetParam();
+  auto [tempFile, underTest] = mapStoredTrace(input);
+
+  MappedFuzzTrace::const_iterator first = underTest.begin();
+  for (MappedFuzzTrace::const_iterator it = underTest.begin(); it != underTest.end(); ++it) {
+  }
+
+  EXPECT_THAT(toFuzzTrace(first, underTest.end()), Eq(input));
+}
+
+TEST_P(MappedFuzzTraceTests_storedTraces, TestSuite_printsSameICNFAsFuzzTrace)
+{
+  FuzzTrace const& input = GetParam();
+  auto [tempFile, underTest] = mapStoredTrace(input);
+
+  std::stringstream expected;
+  std::stringstream result;
+  toICNF(input.begin(), input.end(), expected);
+  toICNF(underTest.begin(), underTest.end(), result);
+
+  EXPECT_THAT(result.str(), Eq(expected.str()));
+}
+
+TEST_P(MappedFuzzTraceTests_storedTraces, TestSuite_printsSameCxxAsFuzzTrace)
+{
+  FuzzTrace const& input = GetParam();
+  auto [tempFile, underTest] = mapStoredTrace(input);
+
+  std::stringstream result;
+  toCxxFunctionBody(underTest.begin(), underTest.end(), "solver", result);
+
+  EXPECT_THAT(result.str(), Eq(toCxxFunctionBody(input.begin(), input.end(), "solver")));
+}
+
+// clang-format off
+INSTANTIATE_TEST_SUITE_P(, MappedFuzzTraceTests_storedTraces,
+  ::testing::Values(
+    FuzzTrace{},
+    FuzzTrace{AddClauseCmd{}},
+    FuzzTrace{AddClauseCmd{{1, -2, -3}}},
+    FuzzTrace{AssumeCmd{{1, -2, -3}}},
+    FuzzTrace{SolveCmd{}},
+    FuzzTrace{SolveCmd{false}},
+    FuzzTrace{SolveCmd{true}},
+    FuzzTrace{HavocCmd{(uint64_t{2} << 32) + 16, true}},
+    FuzzTrace{
+      HavocCmd{15, true},
+      AddClauseCmd{{1, -2}},
+      AddClauseCmd{{-2, 4}},
+      AssumeCmd{{1}},
+      SolveCmd{true},
+      HavocCmd{16, false},
+      AddClauseCmd{},
+      AssumeCmd{{-4, 2}},
+      SolveCmd{}
+    },
+    FuzzTrace{
+      HavocCmd{15, true},
+      HavocCmd{16, true},
+      AddClauseCmd{{1, -2}},
+      SolveCmd{true},
+      SolveCmd{true},
+      SolveCmd{true},
+      AssumeCmd{{1}},
+      SolveCmd{false}
+    }
+  )
+);
+// clang-format on
+
+TEST(MappedFuzzTraceTests, ThrowsForMissingFileInStrictMode)
+{
+  PathWithDeleter tempDir = createTempDir();
+  EXPECT_THROW(MappedFuzzTrace{tempDir.getPath() / "missing.mtr"}, IOException);
+}
+
+TEST(MappedFuzzTraceTests, ThrowsForBadCookieInStrictMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), BinaryTrace{uint32_t{0xF2950003}, uint8_t{2}});
+  EXPECT_THROW(MappedFuzzTrace{tempFile.getPath()}, IOException);
+}
+
+TEST(MappedFuzzTraceTests, ThrowsForEmptyFileInStrictMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), BinaryTrace{});
+  EXPECT_THROW(MappedFuzzTrace{tempFile.getPath()}, IOException);
+}
+
+TEST(MappedFuzzTraceTests, IgnoresBadCookieInPermissiveMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(), BinaryTrace{uint32_t{0xF2950003}, uint8_t{9}});
+
+  MappedFuzzTrace underTest{tempFile.getPath(), LoaderStrictness::PERMISSIVE};
+  EXPECT_THAT(toFuzzTrace(underTest.begin(), underTest.end()), Eq(FuzzTrace{SolveCmd{}}));
+}
+
+TEST(MappedFuzzTraceTests, ThrowsAtTruncatedCommandInStrictMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(),
+                   BinaryTrace{magicCookie, uint8_t{2}, uint8_t{0}, uint32_t{2}, uint32_t{5}});
+
+  MappedFuzzTrace underTest{tempFile.getPath()};
+  MappedFuzzTrace::const_iterator it = underTest.begin();
+  EXPECT_THAT((*it).getKind(), Eq(FlatFuzzTrace::CmdKind::SOLVE));
+  EXPECT_THROW(++it, IOException);
+}
+
+TEST(MappedFuzzTraceTests, StopsAtTruncatedCommandInPermissiveMode)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(),
+                   BinaryTrace{magicCookie, uint8_t{2}, uint8_t{0}, uint32_t{2}, uint32_t{5}});
+
+  MappedFuzzTrace underTest{tempFile.getPath(), LoaderStrictness::PERMISSIVE};
+  EXPECT_THAT(toFuzzTrace(underTest.begin(), underTest.end()), Eq(FuzzTrace{SolveCmd{}}));
+}
+
+TEST(MappedFuzzTraceTests, LoadTraceLoadsRegularFilesLikeStreams)
+{
+  PathWithDeleter tempFile = createTempFile();
+  writeBinaryTrace(tempFile.getPath(),
+                   BinaryTrace{magicCookie, uint8_t{7}, uint32_t{2}, uint32_t{0}, uint8_t{2}});
+
+  FILE* input = fopen(tempFile.getPath().string().c_str(), "r");
+  ASSERT_THAT(input, ::testing::NotNull());
+  FuzzTrace expected = loadTrace(*input, LoaderStrictness::PERMISSIVE);
+  fclose(input);
+
+  EXPECT_THAT(loadTrace(tempFile.getPath(), LoaderStrictness::PERMISSIVE), Eq(expected));
+  EXPECT_THAT(expected, Eq(FuzzTrace{AddClauseCmd{{1}}, SolveCmd{}}));
+  EXPECT_THROW(loadTrace(tempFile.getPath()), IOException);
+}
+}
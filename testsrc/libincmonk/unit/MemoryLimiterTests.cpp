@@ -0,0 +1,182 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/Fork.h>
+#include <libincmonk/MemoryLimiter.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <signal.h>
+
+namespace incmonk {
+
+namespace {
+// The fork()ed processes need to return EXIT_FAILURE to ensure that
+// no further tests are executed in the test suite.
+int const childProcessRetVal = EXIT_FAILURE;
+
+constexpr uint64_t memoryLimit = 64 * 1024 * 1024;
+constexpr std::size_t chunkSize = 4 * 1024 * 1024;
+}
+
+TEST(MemoryLimiterTests, WhenMemoryIsNotExhausted_NoExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto result = syncExecInFork(
+      [&underTest]() -> uint64_t {
+        underTest.enforce();
+        underTest.beginTrace(0);
+        auto chunk = std::make_unique<char[]>(chunkSize);
+        chunk[chunkSize - 1] = 1;
+        return 7;
+      },
+      childProcessRetVal,
+      std::chrono::seconds{10});
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_THAT(*result, ::testing::Eq(7u));
+  EXPECT_FALSE(underTest.getExhaustingTraceIdx().has_value());
+}
+
+TEST(MemoryLimiterTests, WhenNewFailsDueToLimit_ExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    underTest.enforce();
+    underTest.beginTrace(3);
+    std::vector<std::unique_ptr<char[]>> chunks;
+    for (uint64_t allocated = 0; allocated <= 2 * memoryLimit; allocated += chunkSize) {
+      chunks.push_back(std::make_unique<char[]>(chunkSize));
+    }
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+
+  std::optional<std::size_t> exhaustingTraceIdx = underTest.getExhaustingTraceIdx();
+  ASSERT_TRUE(exhaustingTraceIdx.has_value());
+  EXPECT_THAT(*exhaustingTraceIdx, ::testing::Eq(3u));
+
+  underTest.reset();
+  EXPECT_FALSE(underTest.getExhaustingTraceIdx().has_value());
+}
+
+TEST(MemoryLimiterTests, WhenProcessCrashesAfterMallocFailure_ExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    underTest.enforce();
+    underTest.beginTrace(1);
+    // Allocate until the limit is reached, without involving `new`:
+    std::array<void* volatile, 2 * memoryLimit / chunkSize> chunks;
+    for (void* volatile& chunk : chunks) {
+      chunk = malloc(chunkSize);
+    }
+    raise(SIGSEGV);
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+
+  std::optional<std::size_t> exhaustingTraceIdx = underTest.getExhaustingTraceIdx();
+  ASSERT_TRUE(exhaustingTraceIdx.has_value());
+  EXPECT_THAT(*exhaustingTraceIdx, ::testing::Eq(1u));
+}
+
+TEST(MemoryLimiterTests, WhenProcessCrashesWithoutMemoryShortage_NoExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    underTest.enforce();
+    underTest.beginTrace(1);
+    raise(SIGSEGV);
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+  EXPECT_FALSE(underTest.getExhaustingTraceIdx().has_value());
+}
+
+TEST(MemoryLimiterTests, WhenCrashingCloseToLimitWithoutAllocationFailure_NoExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    underTest.enforce();
+    underTest.beginTrace(1);
+    // Get close to the limit, with all allocations succeeding:
+    std::array<void* volatile, memoryLimit / chunkSize - 2> chunks;
+    for (void* volatile& chunk : chunks) {
+      chunk = malloc(chunkSize);
+      if (chunk == nullptr) {
+        return 1;
+      }
+    }
+    raise(SIGSEGV);
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+  EXPECT_FALSE(underTest.getExhaustingTraceIdx().has_value());
+}
+
+TEST(MemoryLimiterTests, WhenCrashingFarFromLimitAfterHandledMallocFailure_NoExhaustionIsReported)
+{
+  MemoryLimiter underTest{memoryLimit};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    underTest.enforce();
+    underTest.beginTrace(1);
+    // A failing allocation exceeding the limit by far, setting errno to ENOMEM:
+    void* volatile chunk = malloc(2 * memoryLimit);
+    if (chunk != nullptr) {
+      return 1;
+    }
+    raise(SIGSEGV);
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+  EXPECT_FALSE(underTest.getExhaustingTraceIdx().has_value());
+}
+}
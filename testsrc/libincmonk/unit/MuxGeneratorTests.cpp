@@ -31,6 +31,8 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include <unordered_map>
 
 namespace incmonk {
@@ -145,4 +147,85 @@ INSTANTIATE_TEST_SUITE_P(, MuxGeneratorTests,
 );
 // clang-format on
 
-}
\ No newline at end of file
+TEST(MuxGeneratorTests_getLastGeneratorIndex, IndexOfGeneratorProducingLastTraceIsReturned)
+{
+  std::vector<MuxGeneratorSpec> generators;
+  for (size_t idx = 0; idx < 3; ++idx) {
+    generators.emplace_back(1.0, std::make_unique<FakeTraceGenerator>(idx));
+  }
+  auto underTest = createMuxGenerator(std::move(generators), 100ull);
+
+  for (size_t i = 0; i < 100; ++i) {
+    FuzzTrace result = underTest->generate();
+    EXPECT_THAT(underTest->getLastGeneratorIndex(), ::testing::Eq(result.size()));
+  }
+}
+
+namespace {
+using ExecutionTimeFn = std::function<std::chrono::duration<double>(size_t generatorIdx)>;
+using FailureFn = std::function<bool(size_t generatorIdx, size_t numExecutions)>;
+
+/// Runs `rounds` rounds of Thompson sampling, returning the number of times
+/// each generator was selected in the second half of the rounds.
+auto runThompsonSampling(std::vector<double> const& weights,
+                         ExecutionTimeFn const& getExecutionTime,
+                         FailureFn const& isFailure,
+                         size_t rounds) -> std::vector<size_t>
+{
+  std::vector<MuxGeneratorSpec> generators;
+  for (size_t idx = 0; idx < weights.size(); ++idx) {
+    generators.emplace_back(weights[idx], std::make_unique<FakeTraceGenerator>(idx));
+  }
+  auto underTest =
+      createMuxGenerator(std::move(generators), 100ull, MuxSelectionPolicy::THOMPSON_SAMPLING);
+
+  std::vector<size_t> numExecutions(weights.size(), 0);
+  std::vector<size_t> result(weights.size(), 0);
+  for (size_t i = 0; i < rounds; ++i) {
+    FuzzTrace trace = underTest->generate();
+    size_t const idx = underTest->getLastGeneratorIndex();
+    EXPECT_THAT(trace.size(), ::testing::Eq(idx));
+
+    underTest->reportExecution(idx, isFailure(idx, numExecutions[idx]), getExecutionTime(idx));
+    ++numExecutions[idx];
+    if (i >= rounds / 2) {
+      ++result[idx];
+    }
+  }
+  return result;
+}
+}
+
+TEST(MuxGeneratorTests_ThompsonSampling, GeneratorRevealingFailuresIsFavored)
+{
+  std::vector<size_t> selections = runThompsonSampling(
+      {1.0, 1.0, 1.0},
+      [](size_t) { return std::chrono::milliseconds{1}; },
+      [](size_t generatorIdx, size_t) { return generatorIdx == 1; },
+      2000);
+
+  EXPECT_THAT(selections[1], ::testing::Gt(900u));
+}
+
+TEST(MuxGeneratorTests_ThompsonSampling, FasterGeneratorIsFavoredAtEqualFailureRates)
+{
+  std::vector<size_t> selections = runThompsonSampling(
+      {1.0, 1.0},
+      [](size_t generatorIdx) { return std::chrono::milliseconds{generatorIdx == 0 ? 10 : 1}; },
+      [](size_t, size_t numExecutions) { return numExecutions % 5 == 0; },
+      2000);
+
+  EXPECT_THAT(selections[1], ::testing::Gt(800u));
+}
+
+TEST(MuxGeneratorTests_ThompsonSampling, GeneratorsWithZeroWeightAreNotSelected)
+{
+  std::vector<size_t> selections = runThompsonSampling(
+      {1.0, 0.0},
+      [](size_t) { return std::chrono::milliseconds{1}; },
+      [](size_t generatorIdx, size_t) { return generatorIdx == 1; },
+      200);
+
+  EXPECT_THAT(selections[1], ::testing::Eq(0u));
+}
+}
@@ -26,6 +26,7 @@
 
 #include <libincmonk/Oracle.h>
 
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 
 #include <gmock/gmock.h>
@@ -75,6 +76,21 @@ TEST_P(OracleTests_resolveSolveCmds, solveWithMultipleInvocations)
   EXPECT_THAT(toComplete, Eq(expectedResult));
 }
 
+TEST_P(OracleTests_resolveSolveCmds, solveFlatTraceWithMultipleInvocations)
+{
+  FuzzTrace const& input = std::get<0>(GetParam());
+  FuzzTrace expectedResult = std::get<1>(GetParam());
+
+  FlatFuzzTrace toComplete = toFlatFuzzTrace(input.begin(), input.end());
+  FlatFuzzTrace::size_type middleIdx = toComplete.size() / 2;
+
+  std::unique_ptr<Oracle> underTest = createOracle();
+  underTest->solve(toComplete, 0, middleIdx);
+  underTest->solve(toComplete, middleIdx, toComplete.size());
+
+  EXPECT_THAT(toFuzzTrace(toComplete.begin(), toComplete.end()), Eq(expectedResult));
+}
+
 // clang-format off
 INSTANTIATE_TEST_SUITE_P(, OracleTests_resolveSolveCmds,
   ::testing::Values (
@@ -0,0 +1,171 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/Profiling.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::HasSubstr;
+using ::testing::Le;
+using ::testing::Not;
+
+namespace incmonk {
+
+TEST(LatencyHistogramTests, SmallLatenciesAreRecordedExactly)
+{
+  for (int64_t nanos = 0; nanos < 16; ++nanos) {
+    std::size_t const bucketIdx = LatencyHistogram::getBucketIdx(std::chrono::nanoseconds{nanos});
+    EXPECT_THAT(LatencyHistogram::getBucketUpperBound(bucketIdx).count(), Eq(nanos));
+  }
+}
+
+TEST(LatencyHistogramTests, BucketUpperBoundsDeviateByLessThanOneEighth)
+{
+  for (int64_t nanos = 16; nanos < (int64_t{1} << 40); nanos = nanos * 3 + 1) {
+    std::size_t const bucketIdx = LatencyHistogram::getBucketIdx(std::chrono::nanoseconds{nanos});
+    ASSERT_THAT(bucketIdx, Le(LatencyHistogram::numBuckets - 1));
+
+    int64_t const upperBound = LatencyHistogram::getBucketUpperBound(bucketIdx).count();
+    EXPECT_THAT(upperBound, Ge(nanos));
+    EXPECT_THAT(upperBound - nanos, Le(nanos / 8));
+  }
+}
+
+TEST(LatencyHistogramTests, LargestLatencyHasValidBucket)
+{
+  std::chrono::nanoseconds const largest = std::chrono::nanoseconds::max();
+  EXPECT_THAT(LatencyHistogram::getBucketIdx(largest), Le(LatencyHistogram::numBuckets - 1));
+}
+
+TEST(LatencyHistogramTests, QuantilesOfEmptyHistogramAreZero)
+{
+  LatencyHistogram const underTest;
+  EXPECT_THAT(underTest.getCount(), Eq(0));
+  EXPECT_THAT(underTest.getQuantile(0.5).count(), Eq(0));
+}
+
+TEST(LatencyHistogramTests, QuantilesAreUpperBoundsOfBuckets)
+{
+  LatencyHistogram underTest;
+  underTest.add(std::chrono::nanoseconds{5}, 90);
+  underTest.add(std::chrono::nanoseconds{1000}, 9);
+  underTest.add(std::chrono::nanoseconds{100000}, 1);
+
+  EXPECT_THAT(underTest.getCount(), Eq(100));
+  EXPECT_THAT(underTest.getQuantile(0.5).count(), Eq(5));
+  EXPECT_THAT(underTest.getQuantile(0.9).count(), Eq(5));
+
+  int64_t const p99 = underTest.getQuantile(0.99).count();
+  EXPECT_THAT(p99, Ge(1000));
+  EXPECT_THAT(p99, Le(1125));
+
+  int64_t const max = underTest.getQuantile(1.0).count();
+  EXPECT_THAT(max, Ge(100000));
+  EXPECT_THAT(max, Le(112500));
+}
+
+TEST(ProfileTests, RecordedLatenciesAreAccumulatedPerPhase)
+{
+  Profile underTest;
+  underTest.record(ProfilePhase::SUT_SOLVE, std::chrono::nanoseconds{3});
+  underTest.record(ProfilePhase::SUT_SOLVE, std::chrono::nanoseconds{4});
+  underTest.record(ProfilePhase::ORACLE_SOLVE, std::chrono::nanoseconds{10});
+
+  PhaseProfile const sutSolve = underTest.getPhaseProfile(ProfilePhase::SUT_SOLVE);
+  EXPECT_THAT(sutSolve.count, Eq(2));
+  EXPECT_THAT(sutSolve.totalTime.count(), Eq(7));
+  EXPECT_THAT(sutSolve.latencies.getCount(), Eq(2));
+  EXPECT_THAT(sutSolve.latencies.getQuantile(1.0).count(), Eq(4));
+
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::ORACLE_SOLVE).count, Eq(1));
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::GENERATE).count, Eq(0));
+}
+
+TEST(ProfileTests, WhenMerged_MeasurementsAreAdded)
+{
+  Profile underTest;
+  underTest.record(ProfilePhase::SUT_ADD, std::chrono::nanoseconds{2});
+
+  Profile other;
+  other.record(ProfilePhase::SUT_ADD, std::chrono::nanoseconds{6});
+  other.record(ProfilePhase::TRACE_DUMP, std::chrono::nanoseconds{1});
+
+  underTest.merge(other);
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::SUT_ADD).count, Eq(2));
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::SUT_ADD).totalTime.count(), Eq(8));
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::TRACE_DUMP).count, Eq(1));
+}
+
+TEST(ProfileTests, WhenReset_MeasurementsAreRemoved)
+{
+  Profile underTest;
+  underTest.record(ProfilePhase::SUT_ADD, std::chrono::nanoseconds{2});
+  underTest.reset();
+
+  PhaseProfile const sutAdd = underTest.getPhaseProfile(ProfilePhase::SUT_ADD);
+  EXPECT_THAT(sutAdd.count, Eq(0));
+  EXPECT_THAT(sutAdd.totalTime.count(), Eq(0));
+  EXPECT_THAT(sutAdd.latencies.getCount(), Eq(0));
+}
+
+TEST(ProfileTests, ProfileScopeRecordsOnlyWhenThreadProfileIsSet)
+{
+  Profile underTest;
+  {
+    ProfileScope scope{ProfilePhase::GENERATE};
+  }
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::GENERATE).count, Eq(0));
+
+  setThreadProfile(&underTest);
+  {
+    ProfileScope scope{ProfilePhase::GENERATE};
+  }
+  setThreadProfile(nullptr);
+  {
+    ProfileScope scope{ProfilePhase::GENERATE};
+  }
+  EXPECT_THAT(underTest.getPhaseProfile(ProfilePhase::GENERATE).count, Eq(1));
+}
+
+TEST(ProfileTests, FormattedProfileContainsMeasuredPhasesOnly)
+{
+  Profile underTest;
+  underTest.record(ProfilePhase::ORACLE_PROBE, std::chrono::milliseconds{3});
+
+  std::string const table = formatProfile(underTest);
+  EXPECT_THAT(table, HasSubstr("oracle_probe"));
+  EXPECT_THAT(table, Not(HasSubstr("sut_solve")));
+
+  EXPECT_THAT(formatProfileSummary(underTest), Eq("total ms: oracle_probe=3.0"));
+}
+}
@@ -0,0 +1,125 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#pragma once
+
+#include <libincmonk/CNF.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/IPASIRSolver.h>
+
+#include <gsl/span>
+
+#include <cassert>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace incmonk {
+
+/**
+ * \brief IPASIRSolver implementation recording the calls as a FuzzTrace
+ *
+ * The results of solve() are taken from the vector passed to the constructor, in order.
+ */
+class RecordingIPASIRSolver : public IPASIRSolver {
+public:
+  RecordingIPASIRSolver(std::vector<IPASIRSolver::Result> const& solveResults)
+  {
+    m_solveResults.assign(solveResults.rbegin(), solveResults.rend());
+  }
+
+  void addClause(gsl::span<CNFLit const> clause) override
+  {
+    m_recordedTrace.push_back(AddClauseCmd{{clause.begin(), clause.end()}});
+  }
+
+  void assume(gsl::span<CNFLit const> assumptions) override
+  {
+    m_recordedTrace.push_back(AssumeCmd{{assumptions.begin(), assumptions.end()}});
+  }
+
+  void reinitializeWithHavoc(uint64_t seed) noexcept override
+  {
+    m_recordedTrace.push_back(HavocCmd{seed, true});
+  }
+
+  void havoc(uint64_t seed) noexcept override { m_recordedTrace.push_back(HavocCmd{seed, false}); }
+
+  auto solve() -> IPASIRSolver::Result override
+  {
+    assert(!m_solveResults.empty());
+    IPASIRSolver::Result const result = m_solveResults.back();
+    m_solveResults.pop_back();
+
+    std::optional<bool> traceResult;
+    if (result == IPASIRSolver::Result::SAT || result == IPASIRSolver::Result::UNSAT) {
+      traceResult = (result == IPASIRSolver::Result::SAT);
+    }
+
+    m_recordedTrace.push_back(SolveCmd{traceResult});
+    m_lastResult = result;
+    return result;
+  }
+
+  auto getLastSolveResult() const noexcept -> IPASIRSolver::Result override { return m_lastResult; }
+
+  virtual void configure(uint64_t) override { m_calledConfigure = true; }
+
+  auto getTrace() const noexcept -> FuzzTrace const& { return m_recordedTrace; }
+
+  auto hasConfigureBeenCalled() const noexcept -> bool { return m_calledConfigure; }
+
+  auto getValue(CNFLit) const noexcept -> TBool override { return t_indet; }
+
+  auto isFailed(CNFLit) const noexcept -> bool override { return false; }
+
+private:
+  std::vector<IPASIRSolver::Result> m_solveResults;
+  FuzzTrace m_recordedTrace;
+  bool m_calledConfigure = false;
+  Result m_lastResult = Result::UNKNOWN;
+};
+
+/**
+ * \brief Returns the solve results matching the expected results of the solve commands in `trace`
+ */
+inline auto getSolveResults(FuzzTrace const& trace) -> std::vector<IPASIRSolver::Result>
+{
+  std::vector<IPASIRSolver::Result> result;
+  for (FuzzCmd const& cmd : trace) {
+    if (SolveCmd const* solveCmd = std::get_if<SolveCmd>(&cmd); solveCmd != nullptr) {
+      if (solveCmd->expectedResult.has_value()) {
+        result.push_back(*(solveCmd->expectedResult) ? IPASIRSolver::Result::SAT
+                                                     : IPASIRSolver::Result::UNSAT);
+      }
+      else {
+        result.push_back(IPASIRSolver::Result::UNKNOWN);
+      }
+    }
+  }
+  return result;
+}
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/SPSCQueue.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace incmonk {
+
+TEST(SPSCQueueTests, CapacityIsRoundedUpToPowerOf2)
+{
+  EXPECT_THAT(SPSCQueue<int>{1}.capacity(), ::testing::Eq(1));
+  EXPECT_THAT(SPSCQueue<int>{5}.capacity(), ::testing::Eq(8));
+  EXPECT_THAT(SPSCQueue<int>{16}.capacity(), ::testing::Eq(16));
+}
+
+TEST(SPSCQueueTests, WhenQueueIsEmpty_NothingIsPopped)
+{
+  SPSCQueue<int> underTest{4};
+  EXPECT_THAT(underTest.size(), ::testing::Eq(0));
+  EXPECT_THAT(underTest.tryPop(), ::testing::Eq(std::nullopt));
+}
+
+TEST(SPSCQueueTests, ElementsArePoppedInFIFOOrder)
+{
+  SPSCQueue<int> underTest{4};
+  EXPECT_TRUE(underTest.tryPush(1));
+  EXPECT_TRUE(underTest.tryPush(2));
+  EXPECT_TRUE(underTest.tryPush(3));
+  EXPECT_THAT(underTest.size(), ::testing::Eq(3));
+
+  EXPECT_THAT(underTest.tryPop(), ::testing::Optional(1));
+  EXPECT_THAT(underTest.tryPop(), ::testing::Optional(2));
+  EXPECT_TRUE(underTest.tryPush(4));
+  EXPECT_THAT(underTest.tryPop(), ::testing::Optional(3));
+  EXPECT_THAT(underTest.tryPop(), ::testing::Optional(4));
+  EXPECT_THAT(underTest.tryPop(), ::testing::Eq(std::nullopt));
+}
+
+TEST(SPSCQueueTests, WhenQueueIsFull_NothingIsPushed)
+{
+  SPSCQueue<std::unique_ptr<int>> underTest{2};
+  EXPECT_TRUE(underTest.tryPush(std::make_unique<int>(1)));
+  EXPECT_TRUE(underTest.tryPush(std::make_unique<int>(2)));
+
+  auto rejected = std::make_unique<int>(3);
+  EXPECT_FALSE(underTest.tryPush(std::move(rejected)));
+  ASSERT_THAT(rejected, ::testing::NotNull());
+  EXPECT_THAT(*rejected, ::testing::Eq(3));
+
+  auto popped = underTest.tryPop();
+  ASSERT_TRUE(popped.has_value());
+  EXPECT_THAT(**popped, ::testing::Eq(1));
+  EXPECT_TRUE(underTest.tryPush(std::move(rejected)));
+}
+
+TEST(SPSCQueueTests, WhenUsedConcurrently_AllElementsArePoppedInFIFOOrder)
+{
+  SPSCQueue<uint64_t> underTest{8};
+  uint64_t const numElements = 100000;
+
+  std::thread producer{[&underTest]() {
+    for (uint64_t i = 0; i < numElements; ++i) {
+      while (!underTest.tryPush(uint64_t{i})) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  uint64_t expected = 0;
+  bool inOrder = true;
+  while (expected < numElements) {
+    std::optional<uint64_t> popped = underTest.tryPop();
+    if (!popped.has_value()) {
+      std::this_thread::yield();
+      continue;
+    }
+    inOrder = inOrder && (*popped == expected);
+    ++expected;
+  }
+
+  producer.join();
+  EXPECT_TRUE(inOrder);
+  EXPECT_THAT(underTest.size(), ::testing::Eq(0));
+}
+}
@@ -0,0 +1,63 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/SharedObject.h>
+
+#include <libincmonk/Fork.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include <stdlib.h>
+
+namespace incmonk {
+
+TEST(SharedObjectTests, WhenObjectIsCreated_ItIsValueInitialized)
+{
+  SharedObject<uint64_t> underTest;
+  EXPECT_THAT(underTest.get(), ::testing::Eq(0));
+}
+
+TEST(SharedObjectTests, WhenChildProcessModifiesObject_ModificationIsVisibleInParentProcess)
+{
+  SharedObject<std::atomic<uint64_t>> underTest;
+  underTest.get().store(1);
+
+  std::optional<uint64_t> result = syncExecInFork(
+      [&underTest]() -> uint64_t {
+        uint64_t const previousValue = underTest.get().load();
+        underTest.get().store(42);
+        return previousValue;
+      },
+      EXIT_FAILURE);
+
+  EXPECT_THAT(result, ::testing::Optional(1));
+  EXPECT_THAT(underTest.get().load(), ::testing::Eq(42));
+}
+}
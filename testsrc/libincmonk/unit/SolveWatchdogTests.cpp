@@ -0,0 +1,137 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include "RecordingIPASIRSolver.h"
+
+#include <libincmonk/Fork.h>
+#include <libincmonk/SolveWatchdog.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <optional>
+#include <vector>
+
+namespace incmonk {
+
+namespace {
+// The fork()ed processes need to return EXIT_FAILURE to ensure that
+// no further tests are executed in the test suite.
+int const childProcessRetVal = EXIT_FAILURE;
+
+auto getProcessCPUTime() -> std::chrono::nanoseconds
+{
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+}
+
+/**
+ * RecordingIPASIRSolver consuming the given amounts of CPU time in its solve calls,
+ * in order. `std::nullopt` denotes solve calls that do not terminate.
+ */
+class SpinningIPASIRSolver : public RecordingIPASIRSolver {
+public:
+  SpinningIPASIRSolver(std::vector<std::optional<std::chrono::milliseconds>> const& solveTimes)
+    : RecordingIPASIRSolver{std::vector<Result>(solveTimes.size(), Result::SAT)}
+    , m_solveTimes{solveTimes}
+  {
+  }
+
+  auto solve() -> Result override
+  {
+    std::optional<std::chrono::milliseconds> const solveTime = m_solveTimes[m_numSolveCalls++];
+    auto const start = getProcessCPUTime();
+    while (!solveTime.has_value() || getProcessCPUTime() - start < *solveTime) {
+      // Spin
+    }
+    return RecordingIPASIRSolver::solve();
+  }
+
+private:
+  std::vector<std::optional<std::chrono::milliseconds>> m_solveTimes;
+  std::size_t m_numSolveCalls = 0;
+};
+}
+
+TEST(SolveWatchdogTests, WhenNoSolveCallExceedsLimit_NoTimeoutIsReported)
+{
+  SolveWatchdog underTest{std::chrono::milliseconds{1000}};
+  underTest.reset();
+
+  auto result = syncExecInFork(
+      [&underTest]() -> uint64_t {
+        using namespace std::chrono_literals;
+        SpinningIPASIRSolver solver{{1ms, 0ms, 5ms}};
+        WatchedIPASIRSolver<SpinningIPASIRSolver> watchedSolver{solver, underTest};
+
+        underTest.beginTrace(0);
+        for (int i = 0; i < 3; ++i) {
+          watchedSolver.solve();
+        }
+        return 7;
+      },
+      childProcessRetVal,
+      std::chrono::seconds{10});
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_THAT(*result, ::testing::Eq(7u));
+  EXPECT_FALSE(underTest.getTimeout().has_value());
+}
+
+TEST(SolveWatchdogTests, WhenSolveCallExceedsLimit_ChildIsTerminatedAndSolveCallIsReported)
+{
+  SolveWatchdog underTest{std::chrono::milliseconds{50}};
+  underTest.reset();
+
+  auto childFn = [&underTest]() -> uint64_t {
+    using namespace std::chrono_literals;
+    SpinningIPASIRSolver solver{{0ms, 10ms, std::nullopt, 0ms}};
+    WatchedIPASIRSolver<SpinningIPASIRSolver> watchedSolver{solver, underTest};
+
+    underTest.beginTrace(4);
+    for (int i = 0; i < 4; ++i) {
+      watchedSolver.solve();
+    }
+    return 7;
+  };
+  EXPECT_THROW(syncExecInFork(childFn, childProcessRetVal, std::chrono::seconds{10}),
+               ChildExecutionFailure);
+
+  std::optional<SolveTimeout> timeout = underTest.getTimeout();
+  ASSERT_TRUE(timeout.has_value());
+  EXPECT_THAT(timeout->traceIdx, ::testing::Eq(4u));
+  EXPECT_THAT(timeout->solveCallIdx, ::testing::Eq(2u));
+  ASSERT_THAT(timeout->previousSolveTimes.size(), ::testing::Eq(2u));
+  EXPECT_THAT(timeout->previousSolveTimes[1], ::testing::Ge(std::chrono::milliseconds{10}));
+
+  underTest.reset();
+  EXPECT_FALSE(underTest.getTimeout().has_value());
+}
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/TraceDumpWriter.h>
+
+#include <libincmonk/FuzzTrace.h>
+
+#include "FileUtils.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <vector>
+
+using ::testing::Eq;
+
+namespace incmonk {
+
+namespace {
+auto encode(FuzzTrace const& trace) -> std::vector<std::byte>
+{
+  std::vector<std::byte> result;
+  encodeTrace(trace.begin(), trace.end(), result);
+  return result;
+}
+}
+
+TEST(TraceDumpWriterTests, WhenFlushed_AllScheduledTracesAreWritten)
+{
+  PathWithDeleter tempDir = createTempDir();
+  std::vector<FuzzTrace> const traces{
+      FuzzTrace{},
+      FuzzTrace{AddClauseCmd{{1, -2}}, SolveCmd{true}},
+      FuzzTrace{HavocCmd{7, true}, AssumeCmd{{3}}, SolveCmd{false}}};
+
+  std::unique_ptr<TraceDumpWriter> underTest = createTraceDumpWriter(FsyncPolicy::NEVER);
+  for (std::size_t idx = 0; idx < traces.size(); ++idx) {
+    underTest->write(tempDir.getPath() / std::to_string(idx), encode(traces[idx]));
+  }
+  underTest->flush();
+
+  for (std::size_t idx = 0; idx < traces.size(); ++idx) {
+    EXPECT_THAT(loadTrace(tempDir.getPath() / std::to_string(idx)), Eq(traces[idx]));
+  }
+}
+
+TEST(TraceDumpWriterTests, WhenDestroyed_ScheduledTracesAreWritten)
+{
+  PathWithDeleter tempDir = createTempDir();
+  FuzzTrace const trace{AddClauseCmd{{1, 2, 3}}, SolveCmd{}};
+
+  {
+    std::unique_ptr<TraceDumpWriter> underTest = createTraceDumpWriter(FsyncPolicy::EACH_TRACE);
+    underTest->write(tempDir.getPath() / "trace.mtr", encode(trace));
+  }
+
+  EXPECT_THAT(loadTrace(tempDir.getPath() / "trace.mtr"), Eq(trace));
+}
+
+TEST(TraceDumpWriterTests, WhenWriteFails_FlushThrowsOnce)
+{
+  PathWithDeleter tempDir = createTempDir();
+  FuzzTrace const trace{SolveCmd{}};
+
+  std::unique_ptr<TraceDumpWriter> underTest = createTraceDumpWriter(FsyncPolicy::NEVER);
+  underTest->write(tempDir.getPath() / "nonexistent" / "trace.mtr", encode(trace));
+  underTest->write(tempDir.getPath() / "trace.mtr", encode(trace));
+
+  EXPECT_THROW(underTest->flush(), IOException);
+  EXPECT_NO_THROW(underTest->flush());
+  EXPECT_THAT(loadTrace(tempDir.getPath() / "trace.mtr"), Eq(trace));
+}
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include <libincmonk/TraceShrinker.h>
+
+#include <libincmonk/FuzzTrace.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <variant>
+
+using ::testing::Eq;
+
+namespace incmonk {
+
+namespace {
+auto contains(std::vector<CNFLit> const& lits, CNFLit lit) -> bool
+{
+  return std::find(lits.begin(), lits.end(), lit) != lits.end();
+}
+
+/// Failure predicate: a clause containing `lit` is added before some solve command
+auto isFailingIfClauseWithLitIsSolved(CNFLit lit) -> ShrinkPredicate
+{
+  return [lit](FuzzTrace const& trace) {
+    bool clauseAdded = false;
+    for (FuzzCmd const& cmd : trace) {
+      if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&cmd);
+          addClause != nullptr && contains(addClause->clauseToAdd, lit)) {
+        clauseAdded = true;
+      }
+      if (clauseAdded && std::holds_alternative<SolveCmd>(cmd)) {
+        return true;
+      }
+    }
+    return false;
+  };
+}
+
+auto createTraceWithManyClauses() -> FuzzTrace
+{
+  FuzzTrace result;
+  for (CNFLit lit = 1; lit < 100; ++lit) {
+    result.push_back(AddClauseCmd{{lit, -(lit + 1), lit + 2}});
+    if (lit % 10 == 0) {
+      result.push_back(AssumeCmd{{lit, lit + 1}});
+      result.push_back(SolveCmd{});
+      result.push_back(HavocCmd{static_cast<uint64_t>(lit), false});
+    }
+  }
+  return result;
+}
+}
+
+TEST(TraceShrinkerTests, WhenSingleClauseIsRelevant_IrrelevantCommandsAndLiteralsAreRemoved)
+{
+  FuzzTrace const input = createTraceWithManyClauses();
+  FuzzTrace const result = shrinkTrace(input, isFailingIfClauseWithLitIsSolved(55), 1);
+
+  FuzzTrace const expected{AddClauseCmd{{55}}, SolveCmd{}};
+  EXPECT_THAT(result, Eq(expected));
+}
+
+TEST(TraceShrinkerTests, WhenLiteralsAreRemoved_OrderOfRemainingLiteralsIsKept)
+{
+  FuzzTrace const input{AddClauseCmd{{1, 2, 3, 4, 5}}, AssumeCmd{{6, 7}}, SolveCmd{}};
+  ShrinkPredicate const isFailing = [](FuzzTrace const& trace) {
+    return trace.size() == 3 && std::holds_alternative<AddClauseCmd>(trace[0]) &&
+           contains(std::get<AddClauseCmd>(trace[0]).clauseToAdd, 4) &&
+           contains(std::get<AddClauseCmd>(trace[0]).clauseToAdd, 2);
+  };
+
+  FuzzTrace const result = shrinkTrace(input, isFailing, 1);
+
+  FuzzTrace const expected{AddClauseCmd{{2, 4}}, AssumeCmd{{7}}, SolveCmd{}};
+  EXPECT_THAT(result, Eq(expected));
+}
+
+TEST(TraceShrinkerTests, WhenTraceIsMinimal_TraceIsNotChanged)
+{
+  FuzzTrace const input{AddClauseCmd{{1}}, SolveCmd{}};
+  FuzzTrace const result = shrinkTrace(input, isFailingIfClauseWithLitIsSolved(1), 1);
+  EXPECT_THAT(result, Eq(input));
+}
+
+TEST(TraceShrinkerTests, ResultDoesNotDependOnNumberOfThreads)
+{
+  FuzzTrace const input = createTraceWithManyClauses();
+  ShrinkPredicate const isFailing = [](FuzzTrace const& trace) {
+    // At least two solve commands after a clause containing 23
+    int numSolveCmds = 0;
+    bool clauseAdded = false;
+    for (FuzzCmd const& cmd : trace) {
+      if (AddClauseCmd const* addClause = std::get_if<AddClauseCmd>(&cmd);
+          addClause != nullptr && contains(addClause->clauseToAdd, 23)) {
+        clauseAdded = true;
+      }
+      if (clauseAdded && std::holds_alternative<SolveCmd>(cmd)) {
+        ++numSolveCmds;
+      }
+    }
+    return numSolveCmds >= 2;
+  };
+
+  std::atomic<uint64_t> numChecks = 0;
+  ShrinkPredicate const countingIsFailing = [&isFailing, &numChecks](FuzzTrace const& trace) {
+    ++numChecks;
+    return isFailing(trace);
+  };
+
+  FuzzTrace const sequentialResult = shrinkTrace(input, isFailing, 1);
+  FuzzTrace const parallelResult = shrinkTrace(input, countingIsFailing, 8);
+
+  EXPECT_THAT(parallelResult, Eq(sequentialResult));
+  EXPECT_THAT(sequentialResult.size(), Eq(3));
+  EXPECT_THAT(numChecks.load(), ::testing::Gt(0));
+}
+}
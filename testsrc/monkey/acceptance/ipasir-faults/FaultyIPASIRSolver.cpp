@@ -28,7 +28,10 @@
 #include <cryptominisat5/cryptominisat.h>
 #include <ipasir.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <random>
 #include <vector>
@@ -128,6 +131,24 @@ public:
       return 0;
     }
 
+#if defined(INJECT_CPU_HOG)
+    if (++m_numSolveCalls == 3) {
+      volatile uint64_t counter = 0;
+      while (true) {
+        counter = counter + 1;
+      }
+    }
+#endif
+
+#if defined(INJECT_MEMORY_HOG)
+    if (++m_numSolveCalls == 3) {
+      std::vector<std::unique_ptr<char[]>> hog;
+      while (true) {
+        hog.emplace_back(new char[64 * 1024 * 1024]);
+      }
+    }
+#endif
+
     try {
       CMSat::lbool result = m_solver.solve(&m_assumptionBuf);
       m_assumptionBuf.clear();
@@ -151,6 +172,21 @@ public:
 
   int failed(int lit) noexcept { return m_conflict.find(lit) != m_conflict.end() ? 1 : 0; }
 
+  void model(int32_t maxVar, int8_t* values) noexcept
+  {
+    for (int32_t var = 1; var <= maxVar; ++var) {
+      int const value = val(var);
+      values[var - 1] = (value == 0 ? 0 : (value == var ? 1 : -1));
+    }
+  }
+
+  void failed(int32_t const* lits, size_t numLits, int8_t* result) noexcept
+  {
+    for (size_t idx = 0; idx < numLits; ++idx) {
+      result[idx] = failed(lits[idx]);
+    }
+  }
+
 private:
   void ensureSolverHasEnoughVars(int toAdd)
   {
@@ -166,6 +202,7 @@ private:
   std::vector<CMSat::Lit> m_assumptionBuf;
   std::vector<CMSat::Lit> m_clauseBuf;
   int m_numVars = 0;
+  int m_numSolveCalls = 0;
 
   std::unordered_map<int, int> m_model; // ipasirLit -> {ipasirLit, -ipasirLit, 0}
   std::unordered_set<int> m_conflict;
@@ -258,4 +295,16 @@ IPASIR_API void incmonk_havoc(void* solver, uint64_t seed)
   }
 }
 #endif
+
+#if defined(ENABLE_BULK_INTERFACE)
+IPASIR_API void incmonk_model(void* solver, int32_t maxVar, int8_t* values)
+{
+  reinterpret_cast<Solver*>(solver)->model(maxVar, values);
+}
+
+IPASIR_API void incmonk_failed(void* solver, int32_t const* lits, size_t numLits, int8_t* result)
+{
+  reinterpret_cast<Solver*>(solver)->failed(lits, numLits, result);
+}
+#endif
 }
\ No newline at end of file
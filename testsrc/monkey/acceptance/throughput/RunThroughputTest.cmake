@@ -0,0 +1,199 @@
+# Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Except as contained in this notice, the name(s) of the above copyright holders
+# shall not be used in advertising or otherwise to promote the sale, use or
+# other dealings in this Software without prior written authorization.
+
+# Runs `monkey fuzz` with a fixed seed and compares its throughput to a baseline.
+#
+# Usage: cmake -DMONKEY=<monkey executable> -DSOLVER=<IPASIR library> -DCONFIG=<config file>
+#              -DMONKEY_ARGS=<additional space-separated fuzz arguments>
+#              -DWORK_DIR=<directory> -DBASELINE_FILE=<file> -DTOLERANCE=<percent>
+#              -P RunThroughputTest.cmake
+#
+# Measured values:
+#  - rounds per second
+#  - time spent per round for generating traces, computing the expected
+#    results and executing the solver under test
+#  - the peak RSS of the fuzzer process
+#
+# The test fails if a value is worse than its baseline value by more than TOLERANCE
+# percent. Phase times are only considered regressions if they also exceed the baseline
+# value by at least 0.1 ms per round, to keep short phases from being flagged due to
+# timer noise.
+#
+# If BASELINE_FILE does not exist, or if the environment variable
+# IM_UPDATE_THROUGHPUT_BASELINES is set, the measured values are stored as the new
+# baseline instead, and the script fails with a message matching the test's
+# SKIP_REGULAR_EXPRESSION, so that the test is reported as skipped rather than passed.
+
+foreach(var MONKEY SOLVER CONFIG WORK_DIR BASELINE_FILE TOLERANCE)
+  if (NOT DEFINED ${var})
+    message(FATAL_ERROR "Missing argument: ${var}")
+  endif()
+endforeach()
+
+set(min_phase_regression_usec 100)
+
+
+# Converts a non-negative decimal number to an integer number of thousandths
+function(to_milli VALUE OUT_VAR)
+  if (NOT VALUE MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+    message(FATAL_ERROR "Not a number: ${VALUE}")
+  endif()
+  set(integral "${CMAKE_MATCH_1}")
+  set(fractional "${CMAKE_MATCH_3}000")
+  string(SUBSTRING "${fractional}" 0 3 fractional)
+  string(REGEX REPLACE "^0+([0-9])" "\\1" result "${integral}${fractional}")
+  set(${OUT_VAR} "${result}" PARENT_SCOPE)
+endfunction()
+
+# Formats an integer number of thousandths as a decimal number
+function(format_milli VALUE OUT_VAR)
+  math(EXPR integral "${VALUE} / 1000")
+  math(EXPR fractional "${VALUE} % 1000 + 1000")
+  string(SUBSTRING "${fractional}" 1 3 fractional)
+  set(${OUT_VAR} "${integral}.${fractional}" PARENT_SCOPE)
+endfunction()
+
+# Reads a sample from Prometheus-formatted statistics
+function(read_sample STATS NAME LABEL_REGEX OUT_VAR)
+  if (NOT STATS MATCHES "incmonk_${NAME}{[^}]*${LABEL_REGEX}[^}]*} ([0-9.]+)")
+    message(FATAL_ERROR "Sample ${NAME} not found in the statistics file")
+  endif()
+  set(${OUT_VAR} "${CMAKE_MATCH_1}" PARENT_SCOPE)
+endfunction()
+
+
+### Run the fuzzer
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(stats_file "${WORK_DIR}/stats.prom")
+
+separate_arguments(monkey_args UNIX_COMMAND "${MONKEY_ARGS}")
+execute_process(
+  COMMAND "${MONKEY}" fuzz ${monkey_args} --profile
+          --stats-file "${stats_file}" --stats-format prometheus
+          --config "${CONFIG}" "${SOLVER}"
+  WORKING_DIRECTORY "${WORK_DIR}"
+  RESULT_VARIABLE monkey_result
+  OUTPUT_VARIABLE monkey_output
+  ERROR_VARIABLE monkey_output
+)
+message("${monkey_output}")
+
+if (NOT monkey_result EQUAL 0)
+  message(FATAL_ERROR "monkey fuzz failed with exit code ${monkey_result}")
+endif()
+if (NOT monkey_output MATCHES "Generated error traces: 0")
+  message(FATAL_ERROR "monkey fuzz generated error traces")
+endif()
+
+
+### Collect the measured values
+
+file(READ "${stats_file}" stats)
+
+read_sample("${stats}" rounds_total "" rounds)
+if (rounds EQUAL 0)
+  message(FATAL_ERROR "monkey fuzz did not execute any rounds")
+endif()
+
+read_sample("${stats}" execs_per_second "" rounds_per_second)
+to_milli("${rounds_per_second}" measured_rounds_per_second_milli)
+
+set(phases generator oracle sut)
+foreach(phase IN LISTS phases)
+  read_sample("${stats}" time_seconds_total "phase=\"${phase}\"" phase_seconds)
+  to_milli("${phase_seconds}" phase_msec)
+  math(EXPR measured_${phase}_usec_per_round "${phase_msec} * 1000 / ${rounds}")
+endforeach()
+
+read_sample("${stats}" peak_rss_bytes "" peak_rss_bytes)
+math(EXPR measured_peak_rss_kib "${peak_rss_bytes} / 1024")
+
+set(measured_values rounds_per_second_milli peak_rss_kib)
+foreach(phase IN LISTS phases)
+  list(APPEND measured_values ${phase}_usec_per_round)
+endforeach()
+
+
+### Store the baseline
+
+if (NOT EXISTS "${BASELINE_FILE}" OR DEFINED ENV{IM_UPDATE_THROUGHPUT_BASELINES})
+  set(baseline_content "# Throughput baseline, recorded by RunThroughputTest.cmake\n")
+  foreach(value IN LISTS measured_values)
+    string(APPEND baseline_content "set(baseline_${value} ${measured_${value}})\n")
+  endforeach()
+  file(WRITE "${BASELINE_FILE}" "${baseline_content}")
+  message(FATAL_ERROR "Throughput comparison skipped: stored the measured values as the "
+                      "baseline in ${BASELINE_FILE}")
+endif()
+
+
+### Compare to the baseline
+
+include("${BASELINE_FILE}")
+foreach(value IN LISTS measured_values)
+  if (NOT DEFINED baseline_${value})
+    message(FATAL_ERROR "${BASELINE_FILE} lacks ${value}. Re-record the baseline by "
+                        "running the test with IM_UPDATE_THROUGHPUT_BASELINES set.")
+  endif()
+endforeach()
+
+set(regressions "")
+
+math(EXPR min_rounds_per_second_milli
+     "${baseline_rounds_per_second_milli} * (100 - ${TOLERANCE}) / 100")
+format_milli(${measured_rounds_per_second_milli} measured)
+format_milli(${baseline_rounds_per_second_milli} baseline)
+message(STATUS "Rounds per second: ${measured} (baseline: ${baseline})")
+if (measured_rounds_per_second_milli LESS min_rounds_per_second_milli)
+  list(APPEND regressions "rounds per second")
+endif()
+
+foreach(phase IN LISTS phases)
+  math(EXPR max_usec_per_round "${baseline_${phase}_usec_per_round} * (100 + ${TOLERANCE}) / 100")
+  math(EXPR min_max_usec_per_round
+       "${baseline_${phase}_usec_per_round} + ${min_phase_regression_usec}")
+  if (max_usec_per_round LESS min_max_usec_per_round)
+    set(max_usec_per_round ${min_max_usec_per_round})
+  endif()
+
+  format_milli(${measured_${phase}_usec_per_round} measured)
+  format_milli(${baseline_${phase}_usec_per_round} baseline)
+  message(STATUS "Time per round, ${phase}: ${measured} ms (baseline: ${baseline} ms)")
+  if (measured_${phase}_usec_per_round GREATER max_usec_per_round)
+    list(APPEND regressions "${phase} time per round")
+  endif()
+endforeach()
+
+math(EXPR max_peak_rss_kib "${baseline_peak_rss_kib} * (100 + ${TOLERANCE}) / 100")
+message(STATUS "Peak RSS: ${measured_peak_rss_kib} KiB (baseline: ${baseline_peak_rss_kib} KiB)")
+if (measured_peak_rss_kib GREATER max_peak_rss_kib)
+  list(APPEND regressions "peak RSS")
+endif()
+
+if (regressions)
+  string(REPLACE ";" ", " regressions "${regressions}")
+  message(FATAL_ERROR "Throughput regression (tolerance: ${TOLERANCE}%): ${regressions}")
+endif()
@@ -26,24 +26,52 @@
 
 #include "Fuzz.h"
 
+#include "LinkedIPASIR.h"
+
+#include <libincmonk/BoundIPASIRSolver.h>
 #include <libincmonk/Config.h>
 #include <libincmonk/Fork.h>
+#include <libincmonk/FuzzStats.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/FuzzTraceExec.h>
 #include <libincmonk/IPASIRSolver.h>
 #include <libincmonk/InterspersionSchedulers.h>
+#include <libincmonk/MemoryLimiter.h>
+#include <libincmonk/Oracle.h>
+#include <libincmonk/Profiling.h>
+#include <libincmonk/SPSCQueue.h>
+#include <libincmonk/SharedObject.h>
+#include <libincmonk/SolveWatchdog.h>
 #include <libincmonk/Stopwatch.h>
+#include <libincmonk/TraceDumpWriter.h>
 
 #include <libincmonk/generators/CommunityAttachmentGenerator.h>
+#include <libincmonk/generators/FuzzTraceGenerator.h>
 #include <libincmonk/generators/MuxGenerator.h>
 #include <libincmonk/generators/SimplifiersParadiseGenerator.h>
 
+#include <gsl/span>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace incmonk {
 
@@ -62,61 +90,508 @@ auto createFuzzerID() -> std::string
 
 class Report {
 public:
-  void onBeginRound()
+  /**
+   * \param profile  The profile included in the periodic reports, or nullptr
+   */
+  explicit Report(Profile const* profile) : m_profile{profile} {}
+
+  void onBeginRound(FuzzTrace const& trace,
+                    std::chrono::duration<double> generatorTime,
+                    std::chrono::duration<double> oracleTime)
   {
-    if (m_step > 0 && m_step % 100 == 0) {
+    uint64_t const numSolveCalls = std::count_if(trace.begin(), trace.end(), [](auto const& cmd) {
+      return std::holds_alternative<SolveCmd>(cmd);
+    });
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stats.numTraceCommands += trace.size();
+    m_stats.numSolveCalls += numSolveCalls;
+    m_stats.generatorTime += generatorTime;
+    m_stats.oracleTime += oracleTime;
+
+    if (m_stats.numRounds > 0 && m_stats.numRounds % reportInterval == 0) {
       auto elapsedTime = m_stopwatch.getElapsedTime<std::chrono::milliseconds>();
-      std::cout << "Running at " << 100000.0 / static_cast<double>(elapsedTime.count()) << " x/s ";
-      std::cout << "failures: " << m_failures << " crashes: " << m_crashes;
-      std::cout << " timeouts: " << m_timeouts << "\n";
+      double const elapsedSeconds = static_cast<double>(elapsedTime.count()) / 1000.0;
+      std::cout << "Running at " << static_cast<double>(reportInterval) / elapsedSeconds << " x/s ";
+      std::cout << "failures: " << m_stats.getNumCorrectnessFailures()
+                << " crashes: " << m_stats.numCrashes;
+      std::cout << " timeouts: " << (m_stats.numTimeouts + m_stats.numSolveTimeouts);
+      if (m_queueDepthSamples > 0) {
+        std::cout << " queue depth: "
+                  << static_cast<double>(m_queueDepthSum) /
+                         static_cast<double>(m_queueDepthSamples);
+        std::cout << " producer stalls: " << m_producerStalls;
+      }
+      std::cout << std::endl;
+      if (m_profile != nullptr) {
+        std::cout << "Profile: " << formatProfileSummary(*m_profile) << std::endl;
+      }
       m_stopwatch = Stopwatch{};
+      m_queueDepthSum = 0;
+      m_queueDepthSamples = 0;
+    }
+    ++m_stats.numRounds;
+  }
+
+  void onQueueDepthSampled(std::size_t queueDepth)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_queueDepthSum += queueDepth;
+    ++m_queueDepthSamples;
+  }
+
+  void onProducerStalled()
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_producerStalls;
+  }
+
+  void onExecuted(std::chrono::duration<double> sutTime)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stats.sutTime += sutTime;
+  }
+
+  void onCrashed()
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_stats.numCrashes;
+  }
+
+  auto getNumCrashes() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.numCrashes;
+  }
+
+  void onFailed(TraceExecutionFailure::Reason reason)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    switch (reason) {
+    case TraceExecutionFailure::Reason::INCORRECT_RESULT:
+      ++m_stats.numIncorrectResults;
+      break;
+    case TraceExecutionFailure::Reason::INVALID_MODEL:
+      ++m_stats.numInvalidModels;
+      break;
+    case TraceExecutionFailure::Reason::INVALID_FAILED:
+      ++m_stats.numInvalidFailed;
+      break;
+    default:
+      ++m_stats.numInvalidResults;
+    }
+  }
+
+  auto getNumFailures() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.getNumCorrectnessFailures();
+  }
+
+  void onTimeout()
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_stats.numTimeouts;
+  }
+
+  void onSolveTimeout(uint64_t runID,
+                      SolveTimeout const& timeout,
+                      std::chrono::milliseconds cpuTimeLimit)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_stats.numSolveTimeouts;
+
+    std::cout << "Run " << std::setfill('0') << std::setw(6) << runID << std::setfill(' ')
+              << ": solve call #" << (timeout.solveCallIdx + 1)
+              << " exceeded the CPU time limit of " << cpuTimeLimit.count() << " ms.";
+    if (timeout.solveCallIdx == 0) {
+      std::cout << " It is the first solve call of the trace.\n";
+      return;
+    }
+
+    std::cout << " CPU times of the preceding solve calls (ms):";
+    for (std::chrono::microseconds solveTime : timeout.previousSolveTimes) {
+      std::cout << " " << static_cast<double>(solveTime.count()) / 1000.0;
+    }
+    if (timeout.previousSolveTimes.size() < timeout.solveCallIdx) {
+      std::cout << " ...";
     }
-    ++m_step;
+    std::cout << "\n";
   }
 
-  void onCrashed() { ++m_crashes; }
+  auto getNumTimeouts() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.numTimeouts + m_stats.numSolveTimeouts;
+  }
 
-  auto getNumCrashes() const noexcept -> uint64_t { return m_crashes; }
+  void onMemout()
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_stats.numMemouts;
+  }
 
-  void onFailed() { ++m_failures; }
+  auto getNumMemouts() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.numMemouts;
+  }
 
-  auto getNumFailures() const noexcept -> uint64_t { return m_failures; }
+  auto getNumSolveTimeouts() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.numSolveTimeouts;
+  }
 
-  void onTimeout() { ++m_timeouts; }
+  auto getNumRounds() const -> uint64_t
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats.numRounds;
+  }
 
-  auto getNumTimeouts() const noexcept -> uint64_t { return m_timeouts; }
+  auto getStats() const -> FuzzStats
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    FuzzStats result = m_stats;
+    result.elapsedTime = m_totalStopwatch.getElapsedTime<std::chrono::duration<double>>();
+    result.peakRSS = getPeakRSS();
+    return result;
+  }
 
 private:
-  uint64_t m_step = 0;
+  static constexpr uint64_t reportInterval = 100;
+
+  mutable std::mutex m_mutex;
+
+  Profile const* m_profile = nullptr;
+  FuzzStats m_stats;
+  Stopwatch m_totalStopwatch;
   Stopwatch m_stopwatch;
 
-  uint64_t m_crashes = 0;
-  uint64_t m_failures = 0;
-  uint64_t m_timeouts = 0;
+  uint64_t m_queueDepthSum = 0;
+  uint64_t m_queueDepthSamples = 0;
+  uint64_t m_producerStalls = 0;
 };
 
-void storeCrashTrace(FuzzTrace const& trace, std::string const& fuzzerID, uint32_t runID)
+void storeTrace(FuzzTrace::const_iterator first,
+                FuzzTrace::const_iterator last,
+                std::string const& fuzzerID,
+                uint64_t runID,
+                char const* kind,
+                TraceFormat format,
+                TraceDumpWriter& dumpWriter)
 {
+  ProfileScope profileScope{ProfilePhase::TRACE_DUMP};
   std::stringstream formatter;
-  formatter << fuzzerID << "-" << std::setfill('0') << std::setw(6) << runID << "-crashed.mtr";
-  storeTrace(trace.begin(), trace.end(), formatter.str());
+  formatter << fuzzerID << "-" << std::setfill('0') << std::setw(6) << runID << "-" << kind
+            << ".mtr";
+
+  std::vector<std::byte> encodedTrace;
+  encodeTrace(first, last, encodedTrace, format);
+  dumpWriter.write(formatter.str(), std::move(encodedTrace));
+}
+
+void storeCrashTrace(FuzzTrace const& trace,
+                     std::string const& fuzzerID,
+                     uint64_t runID,
+                     TraceFormat format,
+                     TraceDumpWriter& dumpWriter)
+{
+  storeTrace(trace.begin(), trace.end(), fuzzerID, runID, "crashed", format, dumpWriter);
+}
+
+void storeMemoutTrace(FuzzTrace const& trace,
+                      std::string const& fuzzerID,
+                      uint64_t runID,
+                      TraceFormat format,
+                      TraceDumpWriter& dumpWriter)
+{
+  storeTrace(trace.begin(), trace.end(), fuzzerID, runID, "memout", format, dumpWriter);
+}
+
+/**
+ * Stores the prefix of `trace` ending with its solve command with index `solveCallIdx`.
+ */
+void storeTimeoutTrace(FuzzTrace const& trace,
+                       std::size_t solveCallIdx,
+                       std::string const& fuzzerID,
+                       uint64_t runID,
+                       TraceFormat format,
+                       TraceDumpWriter& dumpWriter)
+{
+  FuzzTrace::const_iterator last = trace.begin();
+  std::size_t numSolveCmds = 0;
+  while (last != trace.end()) {
+    bool const isSolveCmd = std::holds_alternative<SolveCmd>(*last);
+    ++last;
+    if (isSolveCmd && numSolveCmds++ == solveCallIdx) {
+      break;
+    }
+  }
+
+  storeTrace(trace.begin(), last, fuzzerID, runID, "timeout", format, dumpWriter);
+}
+
+/**
+ * A generated trace, together with the generator which produced it.
+ */
+struct GeneratedTrace {
+  FuzzTrace trace;
+  MuxGenerator* generator = nullptr;
+  std::size_t generatorIdx = 0;
+
+  /// Time spent generating the trace resp. computing its expected results
+  std::chrono::duration<double> generatorTime{0};
+  std::chrono::duration<double> oracleTime{0};
+};
+
+/**
+ * A generated trace, together with its run ID. The generator fields are not
+ * passed to the child processes.
+ */
+struct FuzzRun {
+  uint64_t runID = 0;
+  FuzzTrace trace;
+  MuxGenerator* generator = nullptr;
+  std::size_t generatorIdx = 0;
+};
+
+using FuzzRunBatch = std::vector<FuzzRun>;
+
+/**
+ * The maximum size of trace batches. The execution results of batches are
+ * passed back from the child process as bitsets of type uint64_t.
+ */
+constexpr uint32_t maxBatchSize = 64;
+
+template <typename T>
+void appendToRequest(T value, std::vector<std::byte>& request)
+{
+  std::byte const* valueBytes = reinterpret_cast<std::byte const*>(&value);
+  request.insert(request.end(), valueBytes, valueBytes + sizeof(T));
+}
+
+template <typename T>
+auto readFromRequest(std::vector<std::byte> const& request, std::size_t& offset) -> T
+{
+  if (request.size() - offset < sizeof(T)) {
+    throw std::runtime_error{"Malformed trace execution request"};
+  }
+  T result;
+  memcpy(&result, request.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return result;
+}
+
+void appendEncodedTrace(FuzzTrace const& trace, std::vector<std::byte>& request)
+{
+  std::size_t const sizeOffset = request.size();
+  appendToRequest<uint64_t>(0, request);
+
+  encodeTrace(trace.begin(), trace.end(), request);
+
+  uint64_t const encodedSize = request.size() - sizeOffset - sizeof(uint64_t);
+  std::memcpy(request.data() + sizeOffset, &encodedSize, sizeof(encodedSize));
+}
+
+auto readEncodedTrace(std::vector<std::byte> const& request, std::size_t& offset) -> FuzzTrace
+{
+  uint64_t const traceSize = readFromRequest<uint64_t>(request, offset);
+  if (request.size() - offset < traceSize) {
+    throw std::runtime_error{"Malformed trace execution request"};
+  }
+
+  gsl::span<std::byte const> const encodedTrace{request.data() + offset, traceSize};
+  offset += traceSize;
+  return loadTrace(encodedTrace);
+}
+
+/**
+ * Encodes a trace execution request for the fork server: the number of runs,
+ * followed by the run ID, the encoded size and the .mtr encoding of each trace.
+ */
+auto encodeExecRequest(FuzzRunBatch const& batch) -> std::vector<std::byte>
+{
+  std::vector<std::byte> result;
+  appendToRequest<uint64_t>(batch.size(), result);
+  for (FuzzRun const& run : batch) {
+    appendToRequest<uint64_t>(run.runID, result);
+    appendEncodedTrace(run.trace, result);
+  }
+  return result;
+}
+
+auto decodeExecRequest(std::vector<std::byte> const& request) -> FuzzRunBatch
+{
+  std::size_t offset = 0;
+  uint64_t const numRuns = readFromRequest<uint64_t>(request, offset);
+
+  FuzzRunBatch result;
+  for (uint64_t i = 0; i < numRuns; ++i) {
+    FuzzRun run;
+    run.runID = readFromRequest<uint64_t>(request, offset);
+    run.trace = readEncodedTrace(request, offset);
+    result.push_back(std::move(run));
+  }
+  return result;
+}
+
+/**
+ * The results of the traces of a batch, passed from the child process to the
+ * fuzzer worker via shared memory: the reasons of the correctness failures, and
+ * which traces have been executed completely, along with their execution times.
+ * The latter are used for not repeating the execution of traces preceding a
+ * trace which caused the child process to terminate.
+ */
+class TraceResults {
+public:
+  /// Marks all traces as not completed. Called before each child process execution.
+  void reset() noexcept
+  {
+    for (Entry& entry : m_entries.get()) {
+      entry.completed.store(0);
+    }
+  }
+
+  void setCompleted(std::size_t traceIdx,
+                    std::optional<TraceExecutionFailure::Reason> failure,
+                    std::chrono::nanoseconds executionTime) noexcept
+  {
+    Entry& entry = m_entries.get()[traceIdx];
+    entry.failed.store(failure.has_value() ? 1 : 0);
+    entry.failureReason.store(static_cast<uint8_t>(failure.value_or(TraceExecutionFailure::Reason{})));
+    entry.executionTimeNanos.store(executionTime.count());
+    entry.completed.store(1);
+  }
+
+  auto isCompleted(std::size_t traceIdx) const noexcept -> bool
+  {
+    return m_entries.get()[traceIdx].completed.load() != 0;
+  }
+
+  /// Returns the failure of the completed trace with index `traceIdx`, if any
+  auto getFailure(std::size_t traceIdx) const noexcept -> std::optional<TraceExecutionFailure::Reason>
+  {
+    Entry const& entry = m_entries.get()[traceIdx];
+    if (entry.failed.load() == 0) {
+      return std::nullopt;
+    }
+    return static_cast<TraceExecutionFailure::Reason>(entry.failureReason.load());
+  }
+
+  auto getExecutionTime(std::size_t traceIdx) const noexcept -> std::chrono::nanoseconds
+  {
+    return std::chrono::nanoseconds{m_entries.get()[traceIdx].executionTimeNanos.load()};
+  }
+
+private:
+  struct Entry {
+    std::atomic<uint8_t> completed{0};
+    std::atomic<uint8_t> failed{0};
+    std::atomic<uint8_t> failureReason{0};
+    std::atomic<int64_t> executionTimeNanos{0};
+  };
+
+  SharedObject<std::array<Entry, maxBatchSize>> m_entries;
+};
+
+/**
+ * State shared with the child processes executing traces: the resource limits
+ * and the profile of the child processes, which are nullptr if not used, and
+ * the channel for passing back the results of the traces.
+ */
+struct ChildContext {
+  SolveWatchdog* watchdog = nullptr;
+  MemoryLimiter* memoryLimiter = nullptr;
+  TraceResults* traceResults = nullptr;
+  Profile* profile = nullptr;
+};
+
+/**
+ * Executes the given batch of traces in the child process, each on a fresh
+ * solver instance using the IPASIR functions of `binding`, enforcing the
+ * given context.
+ *
+ * \returns A bitset having the i'th bit set iff the execution of the i'th
+ *   trace revealed a correctness failure.
+ */
+template <typename Binding>
+auto executeBatchInChild(FuzzRunBatch& batch,
+                         Binding const& binding,
+                         std::string const& fuzzerID,
+                         TraceDumpOptions const& dumpOptions,
+                         ChildContext const& context) -> uint64_t
+{
+  assert(batch.size() <= maxBatchSize);
+
+  SolveWatchdog* watchdog = context.watchdog;
+  if (context.memoryLimiter != nullptr) {
+    context.memoryLimiter->enforce();
+  }
+
+  uint64_t failures = 0;
+  for (std::size_t idx = 0; idx < batch.size(); ++idx) {
+    FuzzRun& run = batch[idx];
+    if (context.memoryLimiter != nullptr) {
+      context.memoryLimiter->beginTrace(idx);
+    }
+
+    Stopwatch stopwatch;
+    std::optional<TraceExecutionFailure> failure;
+    {
+      BoundIPASIRSolver<Binding> ipasir{binding};
+      if (watchdog != nullptr) {
+        watchdog->beginTrace(idx);
+        WatchedIPASIRSolver<BoundIPASIRSolver<Binding>> watchedIpasir{ipasir, *watchdog};
+        failure = executeTraceWithDump(
+            run.trace.begin(), run.trace.end(), watchedIpasir, fuzzerID, run.runID, dumpOptions);
+      }
+      else {
+        failure = executeTraceWithDump(
+            run.trace.begin(), run.trace.end(), ipasir, fuzzerID, run.runID, dumpOptions);
+      }
+    }
+
+    std::optional<TraceExecutionFailure::Reason> failureReason;
+    if (failure.has_value()) {
+      failureReason = failure->reason;
+      failures |= (uint64_t{1} << idx);
+    }
+    context.traceResults->setCompleted(
+        idx, failureReason, stopwatch.getElapsedTime<std::chrono::nanoseconds>());
+  }
+  return failures;
 }
 
 auto supportsHavocing(IPASIRSolverDSO const& dso)
 {
   return dso.havocFn != nullptr && dso.havocInitFn != nullptr;
 }
-}
 
-auto getConfig(FuzzerParams const& params, IPASIRSolverDSO const& ipasirDSO) -> Config
+
+/**
+ * Computes the random seed of the trace generator with the given index.
+ * Generator 0 uses the user-specified seed, so that runs with a single
+ * generator are reproducible with the seeds of previous versions. For all
+ * other generators, the seeds are scrambled via the SplitMix64 finalizer.
+ */
+auto getGeneratorSeed(uint64_t seed, uint32_t generatorIdx) -> uint64_t
 {
-  Config cfg = getDefaultConfig(params.seed);
-  if (!params.disableHavoc && supportsHavocing(ipasirDSO)) {
-    std::cout << "Havoc: enabled\n";
+  if (generatorIdx == 0) {
+    return seed;
   }
-  else {
+
+  uint64_t result = seed + generatorIdx * 0x9E3779B97F4A7C15ull;
+  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ull;
+  result = (result ^ (result >> 27)) * 0x94D049BB133111EBull;
+  return result ^ (result >> 31);
+}
+
+auto getConfig(FuzzerParams const& params, bool havocEnabled, uint64_t seed) -> Config
+{
+  Config cfg = getDefaultConfig(seed);
+  if (!havocEnabled) {
     cfg.communityAttachmentModelParams.havocSchedule = std::nullopt;
-    std::cout << "Havoc: disabled\n";
   }
 
   if (params.configFile.has_value()) {
@@ -131,6 +606,522 @@ auto getConfig(FuzzerParams const& params, IPASIRSolverDSO const& ipasirDSO) ->
   }
 }
 
+auto getTraceDumpOptions(FuzzerParams const& params) -> TraceDumpOptions
+{
+  return TraceDumpOptions{params.traceFormat,
+                          params.syncTraceFiles ? FsyncPolicy::EACH_TRACE : FsyncPolicy::NEVER};
+}
+
+/**
+ * State shared by all fuzzer workers.
+ */
+struct FuzzerState {
+  FuzzerState(FuzzerParams const& params_, IPASIRSolverDSO const& ipasirDSO_, std::string fuzzerID_)
+    : params{params_}
+    , ipasirDSO{ipasirDSO_}
+    , fuzzerID{std::move(fuzzerID_)}
+    , dumpOptions{getTraceDumpOptions(params_)}
+    , dumpWriter{createTraceDumpWriter(dumpOptions.fsyncPolicy)}
+    , profile{params_.profile ? std::make_unique<Profile>() : nullptr}
+    , report{profile.get()}
+  {
+  }
+
+  FuzzerParams const& params;
+  IPASIRSolverDSO const& ipasirDSO;
+  std::string fuzzerID;
+  bool havocEnabled = false;
+
+  TraceDumpOptions dumpOptions;
+
+  /// Writes the traces of crashed runs without blocking the workers
+  std::unique_ptr<TraceDumpWriter> dumpWriter;
+
+  /// The profile of all threads and child processes, or nullptr if profiling is disabled
+  std::unique_ptr<Profile> profile;
+
+  Report report;
+
+  /// The next unused run ID. Run IDs are unique across all workers.
+  std::atomic<uint64_t> nextRunID = 0;
+
+  /// Set when a worker failed, causing all other workers to stop
+  std::atomic<bool> stopRequested = false;
+};
+
+auto createTraceGenerator(Config&& cfg) -> std::unique_ptr<MuxGenerator>
+{
+  GeneratorSelectionParams const& selection = cfg.generatorSelectionParams;
+
+  // clang-format off
+  std::vector<MuxGeneratorSpec> generators;
+  generators.emplace_back(selection.communityAttachmentWeight, createCommunityAttachmentGen(std::move(cfg.communityAttachmentModelParams)));
+  generators.emplace_back(selection.simplifiersParadiseWeight, createSimplifiersParadiseGen(std::move(cfg.simplifiersParadiseParams)));
+  // clang-format on
+  return createMuxGenerator(std::move(generators), cfg.seed + 100, selection.policy);
+}
+
+/**
+ * Generates a trace and fills in the expected results of its solve commands,
+ * so that the oracle does not need to solve the problems in the child processes.
+ */
+auto generateAnnotatedTrace(MuxGenerator& generator) -> GeneratedTrace
+{
+  GeneratedTrace result;
+  Stopwatch generatorStopwatch;
+  {
+    ProfileScope profileScope{ProfilePhase::GENERATE};
+    result.trace = generator.generate();
+  }
+  result.generator = &generator;
+  result.generatorIdx = generator.getLastGeneratorIndex();
+  result.generatorTime =
+      generatorStopwatch.getElapsedTime<std::chrono::duration<double>>();
+
+  Stopwatch oracleStopwatch;
+  createOracle()->solve(result.trace.begin(), result.trace.end());
+  result.oracleTime = oracleStopwatch.getElapsedTime<std::chrono::duration<double>>();
+  return result;
+}
+
+void backOff(uint32_t& numRetries)
+{
+  if (numRetries < 64) {
+    std::this_thread::yield();
+  }
+  else {
+    std::this_thread::sleep_for(std::chrono::microseconds{50});
+  }
+  ++numRetries;
+}
+
+/**
+ * A background thread generating traces, passing them to the consuming
+ * fuzzer worker via a lock-free queue.
+ */
+class TraceProducer {
+public:
+  TraceProducer(Config&& cfg, Report& report, Profile* profile)
+    : m_generator{createTraceGenerator(std::move(cfg))}
+    , m_queue{queueCapacity}
+    , m_report{report}
+    , m_profile{profile}
+    , m_thread{[this]() { run(); }}
+  {
+  }
+
+  /**
+   * Returns the next generated trace. If no trace is available, this method
+   * blocks until one is available or `stopRequested` is set.
+   */
+  auto pop(std::atomic<bool> const& stopRequested) -> std::optional<GeneratedTrace>
+  {
+    uint32_t numRetries = 0;
+    while (!stopRequested) {
+      std::optional<GeneratedTrace> result = m_queue.tryPop();
+      if (result.has_value()) {
+        return result;
+      }
+      backOff(numRetries);
+    }
+    return std::nullopt;
+  }
+
+  auto getQueueDepth() const noexcept -> std::size_t { return m_queue.size(); }
+
+  ~TraceProducer()
+  {
+    m_stopRequested = true;
+    m_thread.join();
+  }
+
+  TraceProducer(TraceProducer const&) = delete;
+  auto operator=(TraceProducer const&) -> TraceProducer& = delete;
+
+private:
+  void run()
+  {
+    setThreadProfile(m_profile);
+    while (!m_stopRequested) {
+      GeneratedTrace trace = generateAnnotatedTrace(*m_generator);
+
+      uint32_t numRetries = 0;
+      while (!m_queue.tryPush(std::move(trace))) {
+        if (m_stopRequested) {
+          return;
+        }
+        if (numRetries == 0) {
+          m_report.onProducerStalled();
+        }
+        backOff(numRetries);
+      }
+    }
+  }
+
+  static constexpr std::size_t queueCapacity = 32;
+
+  std::unique_ptr<MuxGenerator> m_generator;
+  SPSCQueue<GeneratedTrace> m_queue;
+  Report& m_report;
+  Profile* m_profile;
+  std::atomic<bool> m_stopRequested = false;
+  std::thread m_thread;
+};
+
+/**
+ * Source of traces for a fuzzer worker. The traces are taken from the
+ * trace producers in round-robin order, or generated in the fuzzer worker's
+ * thread if no producers are used.
+ */
+class TraceSource {
+public:
+  TraceSource(std::vector<Config>&& cfgs,
+              bool useProducerThreads,
+              Report& report,
+              Profile* profile)
+    : m_report{report}
+  {
+    if (useProducerThreads) {
+      for (Config& cfg : cfgs) {
+        m_producers.push_back(std::make_unique<TraceProducer>(std::move(cfg), report, profile));
+      }
+    }
+    else {
+      assert(cfgs.size() == 1);
+      m_inlineGenerator = createTraceGenerator(std::move(cfgs[0]));
+    }
+  }
+
+  auto next(std::atomic<bool> const& stopRequested) -> std::optional<GeneratedTrace>
+  {
+    if (m_producers.empty()) {
+      return generateAnnotatedTrace(*m_inlineGenerator);
+    }
+
+    TraceProducer& producer = *m_producers[m_nextProducer];
+    m_nextProducer = (m_nextProducer + 1) % m_producers.size();
+    m_report.onQueueDepthSampled(producer.getQueueDepth());
+    return producer.pop(stopRequested);
+  }
+
+private:
+  Report& m_report;
+  std::unique_ptr<MuxGenerator> m_inlineGenerator;
+  std::vector<std::unique_ptr<TraceProducer>> m_producers;
+  std::size_t m_nextProducer = 0;
+};
+
+/**
+ * Reports the result of a run to the generator which produced its trace,
+ * for adapting the generator selection. Only crashes and correctness failures
+ * count as found failures: solve timeouts and memory exhaustions are triaged
+ * separately, and rewarding them would steer the generator selection towards
+ * resource-hungry traces.
+ */
+void reportToGenerator(FuzzRun const& run,
+                       bool foundFailure,
+                       std::chrono::duration<double> executionTime)
+{
+  if (run.generator != nullptr) {
+    run.generator->reportExecution(run.generatorIdx, foundFailure, executionTime);
+  }
+}
+
+void executeBatch(FuzzRunBatch& batch,
+                  ForkServer& forkServer,
+                  FuzzerState& state,
+                  ChildContext const& context);
+
+auto getRemainingTime(std::chrono::duration<double> total, std::chrono::duration<double> used)
+    -> std::chrono::duration<double>
+{
+  return std::max(total - used, std::chrono::duration<double>{0});
+}
+
+/**
+ * Reports the results of the runs of `batch` preceding the run with index `runIdx`
+ * which the child process completed before the run with index `runIdx` caused it
+ * to terminate.
+ *
+ * 
+eturns the total execution time of the completed runs.
+ */
+auto reportCompletedRuns(FuzzRunBatch const& batch,
+                         std::size_t runIdx,
+                         Report& report,
+                         TraceResults const& traceResults) -> std::chrono::duration<double>
+{
+  std::chrono::duration<double> result{0};
+  for (std::size_t idx = 0; idx < runIdx; ++idx) {
+    if (!traceResults.isCompleted(idx)) {
+      continue;
+    }
+    std::optional<TraceExecutionFailure::Reason> const failure = traceResults.getFailure(idx);
+    if (failure.has_value()) {
+      report.onFailed(*failure);
+      // Child process has written trace
+    }
+    std::chrono::duration<double> const executionTime = traceResults.getExecutionTime(idx);
+    reportToGenerator(batch[idx], failure.has_value(), executionTime);
+    result += executionTime;
+  }
+  return result;
+}
+
+/**
+ * Executes the runs of `batch` which remain after the run with index `runIdx`
+ * terminated the child process, and its result has been handled along with the
+ * results of the completed runs (see reportCompletedRuns()).
+ */
+void executeRemainingRuns(FuzzRunBatch& batch,
+                          std::size_t runIdx,
+                          ForkServer& forkServer,
+                          FuzzerState& state,
+                          ChildContext const& context)
+{
+  FuzzRunBatch remainingRuns;
+  for (std::size_t idx = 0; idx < batch.size(); ++idx) {
+    bool const handled = idx == runIdx ||
+                         (idx < runIdx && context.traceResults->isCompleted(idx));
+    if (!handled) {
+      remainingRuns.push_back(std::move(batch[idx]));
+    }
+  }
+
+  if (!remainingRuns.empty()) {
+    executeBatch(remainingRuns, forkServer, state, context);
+  }
+}
+
+/**
+ * Executes the given batch of traces in a single child process. If the
+ * child process crashes or times out, the traces are re-executed one by one
+ * to find the culprits. If a trace exceeds the solve call CPU time limit or
+ * the memory limit, the offending trace is reported directly, the results
+ * of the traces completed before are taken from the child process, and
+ * only the subsequent traces are re-executed.
+ */
+void executeBatch(FuzzRunBatch& batch,
+                  ForkServer& forkServer,
+                  FuzzerState& state,
+                  ChildContext const& context)
+{
+  Report& report = state.report;
+
+  std::optional<std::chrono::milliseconds> timeout = state.params.timeout;
+  if (timeout.has_value()) {
+    *timeout *= batch.size();
+  }
+
+  if (context.watchdog != nullptr) {
+    context.watchdog->reset();
+  }
+  if (context.memoryLimiter != nullptr) {
+    context.memoryLimiter->reset();
+  }
+  if (context.profile != nullptr) {
+    context.profile->reset();
+  }
+  context.traceResults->reset();
+
+  bool crashed = false;
+  std::optional<uint64_t> result;
+  Stopwatch stopwatch;
+  try {
+    ProfileScope profileScope{ProfilePhase::FORK_EXEC};
+    result = forkServer.execute(encodeExecRequest(batch), timeout);
+  }
+  catch (ChildExecutionFailure const&) {
+    crashed = true;
+  }
+  auto const executionTime = stopwatch.getElapsedTime<std::chrono::duration<double>>();
+  report.onExecuted(executionTime);
+  if (context.profile != nullptr) {
+    state.profile->merge(*context.profile);
+  }
+
+  std::optional<SolveTimeout> solveTimeout;
+  std::optional<std::size_t> memoutIdx;
+  if (crashed && context.watchdog != nullptr) {
+    solveTimeout = context.watchdog->getTimeout();
+  }
+  if (crashed && context.memoryLimiter != nullptr) {
+    memoutIdx = context.memoryLimiter->getExhaustingTraceIdx();
+  }
+
+  if (solveTimeout.has_value() && solveTimeout->traceIdx < batch.size()) {
+    auto const completedRunsTime =
+        reportCompletedRuns(batch, solveTimeout->traceIdx, report, *context.traceResults);
+    FuzzRun const& timedOutRun = batch[solveTimeout->traceIdx];
+    reportToGenerator(timedOutRun, false, getRemainingTime(executionTime, completedRunsTime));
+    report.onSolveTimeout(timedOutRun.runID, *solveTimeout, context.watchdog->getCPUTimeLimit());
+    storeTimeoutTrace(timedOutRun.trace,
+                      solveTimeout->solveCallIdx,
+                      state.fuzzerID,
+                      timedOutRun.runID,
+                      state.dumpOptions.format,
+                      *state.dumpWriter);
+    executeRemainingRuns(batch, solveTimeout->traceIdx, forkServer, state, context);
+    return;
+  }
+
+  if (memoutIdx.has_value() && *memoutIdx < batch.size()) {
+    auto const completedRunsTime =
+        reportCompletedRuns(batch, *memoutIdx, report, *context.traceResults);
+    FuzzRun const& memoutRun = batch[*memoutIdx];
+    reportToGenerator(memoutRun, false, getRemainingTime(executionTime, completedRunsTime));
+    report.onMemout();
+    storeMemoutTrace(memoutRun.trace,
+                     state.fuzzerID,
+                     memoutRun.runID,
+                     state.dumpOptions.format,
+                     *state.dumpWriter);
+    executeRemainingRuns(batch, *memoutIdx, forkServer, state, context);
+    return;
+  }
+
+  if (!crashed && result.has_value()) {
+    for (std::size_t idx = 0; idx < batch.size(); ++idx) {
+      bool const failed = (*result & (uint64_t{1} << idx)) != 0;
+      if (failed) {
+        std::optional<TraceExecutionFailure::Reason> const failure =
+            context.traceResults->getFailure(idx);
+        assert(failure.has_value());
+        report.onFailed(*failure);
+        // Child process has written trace
+      }
+      reportToGenerator(batch[idx], failed, executionTime / batch.size());
+    }
+    return;
+  }
+
+  if (batch.size() == 1) {
+    reportToGenerator(batch[0], crashed, executionTime);
+    if (crashed) {
+      report.onCrashed();
+      storeCrashTrace(batch[0].trace,
+                      state.fuzzerID,
+                      batch[0].runID,
+                      state.dumpOptions.format,
+                      *state.dumpWriter);
+    }
+    else {
+      report.onTimeout();
+    }
+    return;
+  }
+
+  for (FuzzRun& run : batch) {
+    FuzzRunBatch singleRunBatch;
+    singleRunBatch.push_back(std::move(run));
+    executeBatch(singleRunBatch, forkServer, state, context);
+  }
+}
+
+/**
+ * The fork server of a fuzzer worker, together with the shared memory of the
+ * child context, which needs to be inherited by the zygote process.
+ */
+struct WorkerForkServer {
+  TraceResults traceResults;
+  std::unique_ptr<SharedObject<Profile>> childProfile;
+  std::unique_ptr<SolveWatchdog> watchdog;
+  std::unique_ptr<MemoryLimiter> memoryLimiter;
+  ChildContext context;
+  std::unique_ptr<ForkServer> forkServer;
+};
+
+/**
+ * Creates the fork server of a fuzzer worker. Fork servers are created before
+ * any other threads are started and before traces are generated, so that the
+ * zygote processes are small and don't depend on the timing of other threads.
+ * The zygote process only uses the given objects, which must outlive it.
+ */
+auto createWorkerForkServer(FuzzerParams const& params,
+                            IPASIRSolverDSO const& ipasirDSO,
+                            std::string const& fuzzerID,
+                            TraceDumpOptions const& dumpOptions)
+    -> std::unique_ptr<WorkerForkServer>
+{
+  auto result = std::make_unique<WorkerForkServer>();
+  if (params.profile) {
+    result->childProfile = std::make_unique<SharedObject<Profile>>();
+  }
+  if (params.solveCPUTimeLimit.has_value()) {
+    result->watchdog = std::make_unique<SolveWatchdog>(*params.solveCPUTimeLimit);
+  }
+  if (params.memoryLimit.has_value()) {
+    result->memoryLimiter = std::make_unique<MemoryLimiter>(*params.memoryLimit);
+  }
+  result->context = ChildContext{result->watchdog.get(),
+                                 result->memoryLimiter.get(),
+                                 &result->traceResults,
+                                 result->childProfile != nullptr ? &result->childProfile->get()
+                                                                 : nullptr};
+
+  ChildContext const& context = result->context;
+  result->forkServer = createForkServer(
+      [&params, &ipasirDSO, &fuzzerID, &dumpOptions, &context](
+          std::vector<std::byte> const& request) -> uint64_t {
+        setThreadProfile(context.profile);
+        FuzzRunBatch batch;
+        {
+          ProfileScope profileScope{ProfilePhase::CHILD_DECODE};
+          batch = decodeExecRequest(request);
+        }
+        return withIPASIRBinding(
+            params.fuzzedLibrary,
+            ipasirDSO,
+            [&batch, &fuzzerID, &dumpOptions, &context](auto const& binding) {
+              return executeBatchInChild(batch, binding, fuzzerID, dumpOptions, context);
+            });
+      },
+      EXIT_SUCCESS);
+  return result;
+}
+
+void fuzzerWorkerMain(FuzzerState& state,
+                      WorkerForkServer& workerForkServer,
+                      std::vector<Config>&& generatorCfgs)
+{
+  setThreadProfile(state.profile.get());
+  ChildContext const& context = workerForkServer.context;
+  ForkServer& forkServer = *workerForkServer.forkServer;
+
+  bool const useProducerThreads = state.params.numGeneratorThreads > 0;
+  TraceSource traceSource{
+      std::move(generatorCfgs), useProducerThreads, state.report, state.profile.get()};
+
+  std::optional<uint64_t> const& roundsLimit = state.params.roundsLimit;
+  uint64_t const batchSize = std::clamp(state.params.batchSize, uint32_t{1}, maxBatchSize);
+
+  FuzzRunBatch batch;
+  while (!state.stopRequested) {
+    uint64_t const firstRunID = state.nextRunID.fetch_add(batchSize);
+    uint64_t lastRunID = firstRunID + batchSize;
+    if (roundsLimit.has_value()) {
+      lastRunID = std::min(lastRunID, *roundsLimit);
+    }
+    if (firstRunID >= lastRunID) {
+      break;
+    }
+
+    batch.clear();
+    for (uint64_t runID = firstRunID; runID < lastRunID; ++runID) {
+      std::optional<GeneratedTrace> trace = traceSource.next(state.stopRequested);
+      if (!trace.has_value()) {
+        return;
+      }
+      state.report.onBeginRound(trace->trace, trace->generatorTime, trace->oracleTime);
+      batch.push_back(
+          FuzzRun{runID, std::move(trace->trace), trace->generator, trace->generatorIdx});
+    }
+
+    executeBatch(batch, forkServer, state, context);
+  }
+}
+}
+
 auto fuzzerMain(FuzzerParams const& params) -> int
 {
   using namespace incmonk;
@@ -140,80 +1131,133 @@ auto fuzzerMain(FuzzerParams const& params) -> int
   std::cout << "Random seed: " << params.seed << "\n";
 
   IPASIRSolverDSO ipasirDSO{params.fuzzedLibrary};
-  std::unique_ptr<IPASIRSolver> ipasir;
 
   try {
-    ipasir = createIPASIRSolver(ipasirDSO);
+    // Check early that the solver can be instantiated:
+    createIPASIRSolver(ipasirDSO);
   }
   catch (DSOLoadError const& error) {
     std::cerr << "Error: " << error.what() << "\n";
     return EXIT_FAILURE;
   }
 
-  std::unique_ptr<Config> cfg;
+  bool const havocEnabled = !params.disableHavoc && supportsHavocing(ipasirDSO);
+  std::cout << "Havoc: " << (havocEnabled ? "enabled" : "disabled") << "\n";
+
+  uint32_t const numJobs = std::max(params.numJobs, uint32_t{1});
+  if (numJobs > 1) {
+    std::cout << "Jobs: " << numJobs << "\n";
+  }
+
+  // Each worker has at least one trace generator, even when traces are not
+  // generated in background threads:
+  uint32_t const generatorsPerWorker = std::max(params.numGeneratorThreads, uint32_t{1});
+
+  std::vector<std::vector<Config>> generatorConfigs(numJobs);
   try {
-    cfg = std::make_unique<Config>(getConfig(params, ipasirDSO));
+    for (uint32_t workerIdx = 0; workerIdx < numJobs; ++workerIdx) {
+      for (uint32_t i = 0; i < generatorsPerWorker; ++i) {
+        uint64_t const seed = getGeneratorSeed(params.seed, workerIdx * generatorsPerWorker + i);
+        generatorConfigs[workerIdx].push_back(getConfig(params, havocEnabled, seed));
+      }
+    }
   }
   catch (std::runtime_error const& error) {
     std::cerr << "Failed loading the configuration: " << error.what() << "\n";
     return EXIT_FAILURE;
   }
 
-  // clang-format off
-  std::vector<MuxGeneratorSpec> generators;
-  generators.emplace_back(1.0, createCommunityAttachmentGen(std::move(cfg->communityAttachmentModelParams)));
-  generators.emplace_back(1.0, createSimplifiersParadiseGen(std::move(cfg->simplifiersParadiseParams)));
-  // clang-format on
-  auto randomTraceGen = createMuxGenerator(std::move(generators), params.seed + 100);
-
-
-  Report report;
+  // Make sure that buffered output is not duplicated in the child processes
+  std::cout.flush();
 
-  uint64_t runID = 0;
-  while (true) {
-    report.onBeginRound();
+  // The zygote processes are forked while this process is still single-threaded
+  TraceDumpOptions const dumpOptions = getTraceDumpOptions(params);
+  std::vector<std::unique_ptr<WorkerForkServer>> forkServers;
+  for (uint32_t workerIdx = 0; workerIdx < numJobs; ++workerIdx) {
+    forkServers.push_back(createWorkerForkServer(params, ipasirDSO, fuzzerID, dumpOptions));
+  }
 
-    FuzzTrace trace = randomTraceGen->generate();
+  FuzzerState state{params, ipasirDSO, fuzzerID};
+  state.havocEnabled = havocEnabled;
 
-    bool crashed = false;
-    std::optional<uint64_t> result = 0;
+  std::unique_ptr<StatsExporter> statsExporter;
+  if (params.statsFile.has_value()) {
+    statsExporter = createStatsExporter(*params.statsFile,
+                                        params.statsFormat,
+                                        fuzzerID,
+                                        params.statsInterval,
+                                        [&state]() { return state.report.getStats(); });
     try {
-      result = syncExecInFork(
-          [&ipasir, &trace, &runID, &fuzzerID]() {
-            auto failure =
-                executeTraceWithDump(trace.begin(), trace.end(), *ipasir, fuzzerID, runID);
-            return failure.has_value() ? 1 : 2;
-          },
-          EXIT_SUCCESS,
-          params.timeout);
-    }
-    catch (ChildExecutionFailure const&) {
-      report.onCrashed();
-      storeCrashTrace(trace, fuzzerID, runID);
-      crashed = true;
+      statsExporter->flush();
     }
-
-    if (!result.has_value()) {
-      report.onTimeout();
+    catch (IOException const& error) {
+      std::cerr << "Error: could not write the statistics file: " << error.what() << "\n";
+      return EXIT_FAILURE;
     }
-    else if (!crashed && *result != 2) {
-      report.onFailed();
-      // Child process has written trace
+  }
+
+  std::vector<std::thread> workers;
+  std::vector<std::exception_ptr> workerErrors(numJobs);
+  for (uint32_t workerIdx = 0; workerIdx < numJobs; ++workerIdx) {
+    workers.emplace_back([&state, &forkServers, &generatorConfigs, &workerErrors, workerIdx]() {
+      try {
+        fuzzerWorkerMain(
+            state, *forkServers[workerIdx], std::move(generatorConfigs[workerIdx]));
+      }
+      catch (...) {
+        workerErrors[workerIdx] = std::current_exception();
+        state.stopRequested = true;
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  for (std::exception_ptr& error : workerErrors) {
+    if (error) {
+      std::rethrow_exception(error);
     }
+  }
 
-    ++runID;
-    if (params.roundsLimit.has_value() && runID >= *params.roundsLimit) {
-      break;
+  try {
+    state.dumpWriter->flush();
+  }
+  catch (IOException const& error) {
+    std::cerr << "Error: could not write a crash trace: " << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (statsExporter != nullptr) {
+    try {
+      statsExporter->flush();
+    }
+    catch (IOException const& error) {
+      std::cerr << "Error: could not write the statistics file: " << error.what() << "\n";
+      return EXIT_FAILURE;
     }
   }
 
+  Report const& report = state.report;
   std::cout << "Finished fuzzing.";
-  std::cout << "\nExecuted rounds: " << runID;
+  std::cout << "\nExecuted rounds: " << report.getNumRounds();
   std::cout << "\nTimeouts: " << report.getNumTimeouts();
+  if (params.solveCPUTimeLimit.has_value()) {
+    std::cout << " (solve call CPU time limit exceeded: " << report.getNumSolveTimeouts() << ")";
+  }
   std::cout << "\nDetected correctness failures: " << report.getNumFailures();
   std::cout << "\nDetected crashes: " << report.getNumCrashes();
-  std::cout << "\nGenerated error traces: " << (report.getNumCrashes() + report.getNumFailures())
+  if (params.memoryLimit.has_value()) {
+    std::cout << "\nDetected memory exhaustions: " << report.getNumMemouts();
+  }
+  std::cout << "\nGenerated error traces: "
+            << (report.getNumCrashes() + report.getNumFailures() + report.getNumSolveTimeouts() +
+                report.getNumMemouts())
             << "\n";
+  if (state.profile != nullptr) {
+    std::cout << "\nProfile:\n" << formatProfile(*state.profile);
+  }
   return EXIT_SUCCESS;
 }
 }
@@ -32,7 +32,11 @@
 
 #pragma once
 
+#include <libincmonk/FuzzStats.h>
+#include <libincmonk/FuzzTrace.h>
+
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -43,9 +47,27 @@ struct FuzzerParams {
   std::optional<std::filesystem::path> configFile;
   std::optional<uint64_t> roundsLimit;
   std::optional<std::chrono::milliseconds> timeout;
+  std::optional<std::chrono::milliseconds> solveCPUTimeLimit;
+
+  /// Address space limit of the solver's child processes in bytes, in addition to the
+  /// memory inherited from the fuzzer
+  std::optional<uint64_t> memoryLimit;
   std::string fuzzerId;
   uint64_t seed = 10;
   bool disableHavoc = false;
+  uint32_t numJobs = 1;
+  uint32_t batchSize = 1;
+  uint32_t numGeneratorThreads = 1;
+  bool syncTraceFiles = false;
+  TraceFormat traceFormat = TraceFormat::V1;
+
+  /// File to which the fuzzing statistics are written periodically (default: none)
+  std::optional<std::filesystem::path> statsFile;
+  StatsFormat statsFormat = StatsFormat::JSON;
+  std::chrono::milliseconds statsInterval{5000};
+
+  /// If true, the time spent in the phases of fuzzing rounds is measured and reported
+  bool profile = false;
 };
 
 auto fuzzerMain(FuzzerParams const& params) -> int;
@@ -82,7 +82,7 @@ auto genTraceMain(GenTraceParams const& params) -> int
   FuzzTrace const toDump = generator->generate();
 
   try {
-    storeTrace(toDump.begin(), toDump.end(), params.outputFile);
+    storeTrace(toDump.begin(), toDump.end(), params.outputFile, params.traceFormat);
   }
   catch (IOException const& e) {
     std::cerr << "Writing the trace failed: " << e.what();
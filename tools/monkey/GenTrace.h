@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <libincmonk/FuzzTrace.h>
+
 #include <filesystem>
 #include <istream>
 #include <optional>
@@ -45,6 +47,7 @@ struct GenTraceParams {
 
   std::string generator;
   std::filesystem::path outputFile;
+  TraceFormat traceFormat = TraceFormat::V1;
 };
 
 auto genTraceMain(GenTraceParams const& params) -> int;
@@ -37,6 +37,7 @@
 #include "PrintCPP.h"
 #include "PrintICNF.h"
 #include "Replay.h"
+#include "Shrink.h"
 #include "Utils.h"
 
 #include <libincmonk/Config.h>
@@ -56,6 +57,22 @@ auto rootSeed() -> uint64_t
   return u64Dist(rng);
 }
 
+auto toTraceFormat(std::string const& formatName) -> incmonk::TraceFormat
+{
+  return formatName == "v2" ? incmonk::TraceFormat::V2 : incmonk::TraceFormat::V1;
+}
+
+auto addTraceFormatOption(CLI::App& app, std::string& formatName) -> CLI::Option*
+{
+  return app
+      .add_option("--trace-format",
+                  formatName,
+                  "Format of written trace files. v2 traces are several times smaller, "
+                  "but cannot be read by older versions of monkey. Default: v1")
+      ->transform(CLI::IsMember({"v1", "v2"}))
+      ->default_val("v1");
+}
+
 
 class MonkeyCommand {
 public:
@@ -89,9 +106,67 @@ public:
         "--rounds", m_fuzzMaxRounds, "Number of rounds to be executed (default: no limit)");
     m_fuzzTimeoutMillisOpt = m_subApp->add_option(
         "--timeout", m_fuzzTimeoutMillis, "Timeout for solver runs (default: no limit)");
+    m_fuzzSolveCPULimitMillisOpt =
+        m_subApp
+            ->add_option("--solve-cpu-limit",
+                         m_fuzzSolveCPULimitMillis,
+                         "CPU time limit for individual solve calls, in milliseconds. The trace "
+                         "up to the first solve call exceeding it is written to a -timeout.mtr "
+                         "file (default: no limit)")
+            ->check(CLI::PositiveNumber);
+    m_fuzzMemoryLimitMiBOpt =
+        m_subApp
+            ->add_option("--memory-limit",
+                         m_fuzzMemoryLimitMiB,
+                         "Limit of the memory allocated by the solver's child processes, in MiB. "
+                         "Traces exhausting it are written to -memout.mtr files "
+                         "(default: no limit)")
+            ->check(CLI::PositiveNumber);
     m_subApp->add_flag("--no-havoc", m_fuzzerParams.disableHavoc, "Disable havoc commands");
     m_subApp->add_option(
         "--seed", m_fuzzerParams.seed, "Random number generator seed for problem generators");
+    m_subApp
+        ->add_option("--jobs",
+                     m_fuzzerParams.numJobs,
+                     "Number of fuzzing jobs executed in parallel (default: 1)")
+        ->check(CLI::PositiveNumber);
+    m_subApp
+        ->add_option("--batch-size",
+                     m_fuzzerParams.batchSize,
+                     "Number of traces executed per child process. If a child process crashes "
+                     "or times out, its traces are re-executed one by one (default: 1)")
+        ->check(CLI::Range(1, 64));
+    m_subApp
+        ->add_option("--gen-threads",
+                     m_fuzzerParams.numGeneratorThreads,
+                     "Number of background trace generator threads per job. If 0 is passed, "
+                     "traces are generated by the job itself (default: 1)")
+        ->check(CLI::Range(0, 64));
+    m_subApp->add_flag("--sync-traces",
+                       m_fuzzerParams.syncTraceFiles,
+                       "Sync each error trace file with the storage device after writing it");
+    addTraceFormatOption(*m_subApp, m_traceFormat);
+    m_fuzzStatsFileOpt = m_subApp->add_option(
+        "--stats-file",
+        m_fuzzStatsFile,
+        "File to which fuzzing statistics are written periodically. The file is replaced "
+        "atomically (default: none)");
+    m_subApp
+        ->add_option("--stats-format",
+                     m_fuzzStatsFormat,
+                     "Format of the statistics file: json, or prometheus for the Prometheus "
+                     "text exposition format. Default: json")
+        ->transform(CLI::IsMember({"json", "prometheus"}))
+        ->default_val("json");
+    m_subApp
+        ->add_option("--stats-interval",
+                     m_fuzzStatsIntervalMillis,
+                     "Interval for writing the statistics file, in milliseconds (default: 5000)")
+        ->check(CLI::PositiveNumber);
+    m_subApp->add_flag("--profile",
+                       m_fuzzerParams.profile,
+                       "Measure the time spent in the phases of fuzzing rounds, e.g. trace "
+                       "generation, oracle and solver calls, and print a breakdown");
     m_fuzzCfgFileOpt =
         m_subApp->add_option("--config",
                              m_fuzzConfigFile,
@@ -114,9 +189,23 @@ public:
       if (!m_fuzzTimeoutMillisOpt->empty()) {
         m_fuzzerParams.timeout = std::chrono::milliseconds{m_fuzzTimeoutMillis};
       }
+      if (!m_fuzzSolveCPULimitMillisOpt->empty()) {
+        m_fuzzerParams.solveCPUTimeLimit = std::chrono::milliseconds{m_fuzzSolveCPULimitMillis};
+      }
+      if (!m_fuzzMemoryLimitMiBOpt->empty()) {
+        m_fuzzerParams.memoryLimit = m_fuzzMemoryLimitMiB * 1024 * 1024;
+      }
       if (!m_fuzzCfgFileOpt->empty()) {
         m_fuzzerParams.configFile = m_fuzzConfigFile;
       }
+      if (!m_fuzzStatsFileOpt->empty()) {
+        m_fuzzerParams.statsFile = m_fuzzStatsFile;
+      }
+      m_fuzzerParams.statsFormat = m_fuzzStatsFormat == "prometheus"
+                                       ? incmonk::StatsFormat::PROMETHEUS
+                                       : incmonk::StatsFormat::JSON;
+      m_fuzzerParams.statsInterval = std::chrono::milliseconds{m_fuzzStatsIntervalMillis};
+      m_fuzzerParams.traceFormat = toTraceFormat(m_traceFormat);
       return incmonk::fuzzerMain(m_fuzzerParams);
     }
     else {
@@ -130,12 +219,21 @@ private:
   CLI::App* m_subApp = nullptr;
   CLI::Option* m_fuzzMaxRoundsOpt = nullptr;
   CLI::Option* m_fuzzTimeoutMillisOpt = nullptr;
+  CLI::Option* m_fuzzSolveCPULimitMillisOpt = nullptr;
+  CLI::Option* m_fuzzMemoryLimitMiBOpt = nullptr;
+  CLI::Option* m_fuzzStatsFileOpt = nullptr;
   CLI::Option* m_fuzzCfgFileOpt = nullptr;
 
   incmonk::FuzzerParams m_fuzzerParams;
   uint64_t m_fuzzMaxRounds = 0;
   uint64_t m_fuzzTimeoutMillis = 0;
+  uint64_t m_fuzzSolveCPULimitMillis = 0;
+  uint64_t m_fuzzMemoryLimitMiB = 0;
+  uint64_t m_fuzzStatsIntervalMillis = 5000;
+  std::filesystem::path m_fuzzStatsFile;
+  std::string m_fuzzStatsFormat;
   std::filesystem::path m_fuzzConfigFile;
+  std::string m_traceFormat;
 };
 
 
@@ -148,6 +246,12 @@ public:
     m_subApp->add_flag("--crash-on-failure",
                        m_replayParams.abortOnFailure,
                        "Terminate abnormally (via abort()) on failure");
+    m_subApp->add_option(
+        "--persistent",
+        m_replayParams.persistentIterations,
+        "Replay inputs in a loop within one process (AFL++ __AFL_LOOP rsp. honggfuzz HF_ITER "
+        "persistent mode), reusing the loaded IPASIR library. The argument is the number of "
+        "inputs after which AFL++ restarts the process. TRACE must be -");
     m_subApp
         ->add_option("LIB",
                      m_replayParams.solverLibrary,
@@ -180,6 +284,76 @@ private:
 };
 
 
+class MonkeyShrinkCommand : public MonkeyCommand {
+public:
+  MonkeyShrinkCommand(CLI::App& app)
+  {
+    m_subApp = app.add_subcommand("shrink", "Minimize failure traces");
+    m_subApp->add_flag("--parse-permissive",
+                       m_shrinkParams.parsePermissive,
+                       "Accept any byte sequence as input trace, wrapping command numbers and "
+                       "clamping variables to 2^24-1");
+    m_outputFileOpt = m_subApp->add_option(
+        "--output",
+        m_outputFile,
+        "Filename of the minimized trace (default: <TRACE without extension>-shrunk.mtr). "
+        "A C++ regression test is written to the same path, with the extension .cpp");
+    m_timeoutMillisOpt = m_subApp->add_option(
+        "--timeout", m_timeoutMillis, "Timeout for solver runs (default: no limit)");
+    m_subApp
+        ->add_option("--jobs",
+                     m_shrinkParams.numJobs,
+                     "Number of candidate traces executed in parallel (default: 1)")
+        ->check(CLI::PositiveNumber);
+    m_subApp->add_option("--function-name",
+                         m_shrinkParams.funcName,
+                         "Function name of the regression test (default: regressionTest)");
+    addTraceFormatOption(*m_subApp, m_traceFormat);
+    m_subApp
+        ->add_option("LIB",
+                     m_shrinkParams.solverLibrary,
+                     "Shared library file of the IPASIR solver. If \"preloaded\" is passed, "
+                     "symbols are looked up within the monkey process and no extra DSO is loaded")
+        ->required();
+    m_subApp
+        ->add_option("TRACE",
+                     m_shrinkParams.traceFile,
+                     ".mtr file to minimize. If - is specified, the trace is read from the "
+                     "standard input instead.")
+        ->required();
+  }
+
+  virtual auto tryExecute() -> std::optional<int> override
+  {
+    if (m_subApp->parsed()) {
+      if (!m_outputFileOpt->empty()) {
+        m_shrinkParams.outputFile = m_outputFile;
+      }
+      if (!m_timeoutMillisOpt->empty()) {
+        m_shrinkParams.timeout = std::chrono::milliseconds{m_timeoutMillis};
+      }
+      m_shrinkParams.traceFormat = toTraceFormat(m_traceFormat);
+      return incmonk::shrinkMain(m_shrinkParams);
+    }
+    else {
+      return std::nullopt;
+    }
+  }
+
+  virtual ~MonkeyShrinkCommand() = default;
+
+private:
+  CLI::App* m_subApp = nullptr;
+  CLI::Option* m_outputFileOpt = nullptr;
+  CLI::Option* m_timeoutMillisOpt = nullptr;
+
+  incmonk::ShrinkParams m_shrinkParams;
+  std::filesystem::path m_outputFile;
+  uint64_t m_timeoutMillis = 0;
+  std::string m_traceFormat;
+};
+
+
 class MonkeyPrintCppCommand : public MonkeyCommand {
 public:
   MonkeyPrintCppCommand(CLI::App& app)
@@ -297,6 +471,7 @@ public:
         ->add_option("--generator", m_genTraceParams.generator, "Select generator. Default: cam")
         ->transform(CLI::IsMember({"cam", "simp-para"}))
         ->default_val("cam");
+    addTraceFormatOption(*m_subApp, m_traceFormat);
   }
 
   virtual auto tryExecute() -> std::optional<int> override
@@ -305,6 +480,7 @@ public:
       if (!m_genTraceCfgFileOpt->empty()) {
         m_genTraceParams.configFile = m_fuzzConfigFile;
       }
+      m_genTraceParams.traceFormat = toTraceFormat(m_traceFormat);
       return incmonk::genTraceMain(m_genTraceParams);
     }
     else {
@@ -320,6 +496,7 @@ private:
 
   incmonk::GenTraceParams m_genTraceParams;
   std::filesystem::path m_fuzzConfigFile;
+  std::string m_traceFormat;
 };
 }
 
@@ -337,6 +514,7 @@ auto main(int argc, char** argv) -> int
   commands.emplace_back(std::make_unique<MonkeyPrintDefaultCfgCommand>(app));
   commands.emplace_back(std::make_unique<MonkeyPrintIcnfCommand>(app));
   commands.emplace_back(std::make_unique<MonkeyReplayCommand>(app));
+  commands.emplace_back(std::make_unique<MonkeyShrinkCommand>(app));
 
   app.require_subcommand(1);
   CLI11_PARSE(app, argc, argv);
@@ -0,0 +1,106 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief Access to the IPASIR library linked to monkey at build time (see IM_IPASIR_LIB)
+ */
+
+#pragma once
+
+#include <libincmonk/BoundIPASIRSolver.h>
+#include <libincmonk/IPASIRSolver.h>
+
+#include <cstdint>
+#include <filesystem>
+
+#if defined(IM_LINKTIME_IPASIR)
+extern "C" {
+void* ipasir_init();
+void ipasir_release(void* solver);
+void ipasir_add(void* solver, int lit_or_zero);
+void ipasir_assume(void* solver, int lit);
+int ipasir_solve(void* solver);
+int ipasir_val(void* solver, int lit);
+int ipasir_failed(void* solver, int lit);
+
+// Optional extensions, resolving to nullptr if not defined by the IPASIR library
+__attribute__((weak)) void incmonk_havoc_init(uint64_t seed);
+__attribute__((weak)) void incmonk_havoc(void* solver, uint64_t seed);
+__attribute__((weak)) void incmonk_model(void* solver, int32_t maxVar, int8_t* values);
+__attribute__((weak)) void
+incmonk_failed(void* solver, int32_t const* lits, size_t numLits, int8_t* result);
+}
+#endif
+
+namespace incmonk {
+
+#if defined(IM_LINKTIME_IPASIR)
+/**
+ * \brief BoundIPASIRSolver binding for the IPASIR library linked to monkey.
+ *
+ * The IPASIR functions are bound at compile time, so the compiler can inline
+ * them when the IPASIR library is linked statically and LTO is enabled.
+ */
+struct LinkedIPASIRBinding {
+  static constexpr IPASIRInitFn initFn = &ipasir_init;
+  static constexpr IPASIRReleaseFn releaseFn = &ipasir_release;
+  static constexpr IPASIRAddFn addFn = &ipasir_add;
+  static constexpr IPASIRAssumeFn assumeFn = &ipasir_assume;
+  static constexpr IPASIRSolveFn solveFn = &ipasir_solve;
+  static constexpr IPASIRValFn valFn = &ipasir_val;
+  static constexpr IPASIRFailedFn failedFn = &ipasir_failed;
+
+  static inline IncMonkIPASIRHavocInitFn const havocInitFn = &incmonk_havoc_init;
+  static inline IncMonkIPASIRHavocFn const havocFn = &incmonk_havoc;
+  static inline IncMonkIPASIRModelFn const modelFn = &incmonk_model;
+  static inline IncMonkIPASIRFailedFn const failedBulkFn = &incmonk_failed;
+};
+#endif
+
+/**
+ * \brief Calls `fn` with the BoundIPASIRSolver binding to be used for the IPASIR
+ *   library `path`.
+ *
+ * If an IPASIR library is linked to monkey and `path` is "preloaded", `fn` is called
+ * with a LinkedIPASIRBinding object. Otherwise, `fn` is called with `dso`.
+ *
+ * \returns the value returned by `fn`
+ */
+template <typename Fn>
+auto withIPASIRBinding(std::filesystem::path const& path, IPASIRSolverDSO const& dso, Fn&& fn)
+{
+#if defined(IM_LINKTIME_IPASIR)
+  if (path == std::filesystem::path{"preloaded"}) {
+    return fn(LinkedIPASIRBinding{});
+  }
+#else
+  static_cast<void>(path);
+#endif
+  return fn(dso);
+}
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+/**
+ * \file
+ *
+ * \brief libFuzzer entry point, executing the fuzzer inputs as traces on the IPASIR
+ *   library linked to the fuzzer (see IM_BUILD_LIBFUZZER_TARGET)
+ */
+
+#include "LinkedIPASIR.h"
+#include "Utils.h"
+
+#include <libincmonk/BoundIPASIRSolver.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/FuzzTraceExec.h>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#if !defined(IM_LINKTIME_IPASIR)
+#error "monkey-libfuzzer requires an IPASIR library linked at build time (see IM_IPASIR_LIB)"
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+  using namespace incmonk;
+
+  gsl::span<std::byte const> const input{reinterpret_cast<std::byte const*>(data), size};
+  FuzzTrace trace = loadTrace(input, LoaderStrictness::PERMISSIVE);
+
+  // Prepare the trace like `monkey replay --parse-permissive` does: the inputs can
+  // contain arbitrary variables and expected results.
+  wrapTraceVarsAt16M(trace);
+  clearExpectedResults(trace.begin(), trace.end());
+
+  BoundIPASIRSolver<LinkedIPASIRBinding> ipasir{LinkedIPASIRBinding{}};
+  if (executeTrace(trace.begin(), trace.end(), ipasir).has_value()) {
+    // Report the failure to libFuzzer, which stores the input as a crash artifact
+    abort();
+  }
+  return 0;
+}
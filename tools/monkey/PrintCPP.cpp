@@ -34,23 +34,40 @@
 #include <iostream>
 
 namespace incmonk {
-auto printCPPMain(PrintCPPParams const& params) -> int
+namespace {
+template <typename TraceIt>
+void printCPPImpl(TraceIt first, TraceIt last, PrintCPPParams const& params, std::ostream& target)
 {
-  try {
-    FuzzTrace trace = loadTraceFromFileOrStdin(params.traceFile, params.parsePermissive);
+  if (!params.funcName.empty()) {
+    target << "#include <ipasir.h>\n#include <initializer_list>\n#include <cassert>\n\n";
+    target << "void " << params.funcName << "() {\n";
+    target << "void* " << params.solverVarName << " = ipasir_init();\n";
+    target << "if (" << params.solverVarName << " == nullptr) {\n  return;\n}\n";
+  }
 
-    if (!params.funcName.empty()) {
-      std::cout << "#include <ipasir.h>\n#include <initializer_list>\n#include <cassert>\n\n";
-      std::cout << "void " << params.funcName << "() {\n";
-      std::cout << "void* " << params.solverVarName << " = ipasir_init();\n";
-      std::cout << "if (" << params.solverVarName << " == nullptr) {\n  return;\n}\n";
-    }
+  toCxxFunctionBody(first, last, params.solverVarName, target);
 
-    std::cout << toCxxFunctionBody(trace.begin(), trace.end(), params.solverVarName);
+  if (!params.funcName.empty()) {
+    target << "\nipasir_release(" << params.solverVarName << ");\n}\n";
+  }
+}
+}
 
-    if (!params.funcName.empty()) {
-      std::cout << "\nipasir_release(" << params.solverVarName << ");\n}\n";
-    }
+void printCPP(FuzzTrace::const_iterator first,
+              FuzzTrace::const_iterator last,
+              PrintCPPParams const& params,
+              std::ostream& target)
+{
+  printCPPImpl(first, last, params, target);
+}
+
+auto printCPPMain(PrintCPPParams const& params) -> int
+{
+  try {
+    withTraceFromFileOrStdin(
+        params.traceFile, params.parsePermissive, [&params](auto first, auto last) {
+          printCPPImpl(first, last, params, std::cout);
+        });
   }
   catch (IOException const& error) {
     std::cerr << error.what() << "\n";
@@ -59,4 +76,4 @@ auto printCPPMain(PrintCPPParams const& params) -> int
 
   return EXIT_SUCCESS;
 }
-}
\ No newline at end of file
+}
@@ -32,8 +32,11 @@
 
 #pragma once
 
+#include <libincmonk/FuzzTrace.h>
+
 #include <filesystem>
 #include <optional>
+#include <ostream>
 #include <string>
 
 namespace incmonk {
@@ -45,4 +48,13 @@ struct PrintCPPParams {
 };
 
 auto printCPPMain(PrintCPPParams const& params) -> int;
+
+/**
+ * Prints the trace [first, last) as C++11 code like `monkey print-cpp`, using the
+ * function and solver variable names given in `params`
+ */
+void printCPP(FuzzTrace::const_iterator first,
+              FuzzTrace::const_iterator last,
+              PrintCPPParams const& params,
+              std::ostream& target);
 }
\ No newline at end of file
@@ -38,8 +38,9 @@ namespace incmonk {
 auto printICNFMain(PrintICNFParams const& params) -> int
 {
   try {
-    FuzzTrace trace = loadTraceFromFileOrStdin(params.traceFile, params.parsePermissive);
-    toICNF(trace.begin(), trace.end(), std::cout);
+    withTraceFromFileOrStdin(params.traceFile, params.parsePermissive, [](auto first, auto last) {
+      toICNF(first, last, std::cout);
+    });
   }
   catch (IOException const& error) {
     std::cerr << error.what() << "\n";
@@ -26,15 +26,32 @@
 
 #include "Replay.h"
 
+#include "LinkedIPASIR.h"
 #include "Utils.h"
 
+#include <libincmonk/BoundIPASIRSolver.h>
+#include <libincmonk/FlatFuzzTrace.h>
 #include <libincmonk/FuzzTrace.h>
 #include <libincmonk/FuzzTraceExec.h>
 #include <libincmonk/IPASIRSolver.h>
 
+#include <gsl/span>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <filesystem>
 #include <iostream>
 #include <stdlib.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#if !defined(__APPLE__)
+// Defined by libhfuzz when monkey is linked for honggfuzz's persistent mode
+extern "C" __attribute__((weak)) void HF_ITER(uint8_t const** buf, size_t* len);
+#endif
 
 namespace incmonk {
 
@@ -48,18 +65,277 @@ auto failureExitCodeOrAbort(bool doAbort)
     abort();
   }
 }
+
+/**
+ * Phase source for executeTraceFromStream(), preparing the phases like
+ * loadTraceFromFileOrStdin() and replayFromFile() prepare loaded traces
+ */
+class ReplayPhaseReader {
+public:
+  ReplayPhaseReader(FILE& stream, bool parsePermissive)
+    : m_reader{stream, getLoaderStrictness(parsePermissive)}, m_wrapVars{parsePermissive}
+  {
+  }
+
+  auto readNextPhase(FlatFuzzTrace& target) -> bool
+  {
+    target.clear();
+    if (!m_reader.readNextPhase(m_phaseBuffer)) {
+      return false;
+    }
+
+    for (FlatFuzzTrace::CmdView cmd : m_phaseBuffer) {
+      switch (cmd.getKind()) {
+      case FlatFuzzTrace::CmdKind::ADD_CLAUSE:
+        target.addClause(prepareLits(cmd.getLits()));
+        break;
+      case FlatFuzzTrace::CmdKind::ASSUME:
+        target.assume(prepareLits(cmd.getLits()));
+        break;
+      case FlatFuzzTrace::CmdKind::SOLVE:
+        // Expected results stored in the trace are not trusted (see replayFromFile())
+        target.solve();
+        break;
+      default:
+        target.push_back(cmd);
+        break;
+      }
+    }
+    return true;
+  }
+
+private:
+  auto prepareLits(gsl::span<CNFLit const> lits) -> gsl::span<CNFLit const>
+  {
+    if (!m_wrapVars) {
+      return lits;
+    }
+    m_litBuffer.assign(lits.begin(), lits.end());
+    wrapVarsAt16M(m_litBuffer);
+    return m_litBuffer;
+  }
+
+  FlatFuzzTraceReader m_reader;
+  bool m_wrapVars;
+  FlatFuzzTrace m_phaseBuffer;
+  std::vector<CNFLit> m_litBuffer;
+};
+
+/**
+ * Executes the trace while reading it from stdin, so that the solver is called before
+ * the whole trace has been read and large traces need not be held in memory.
+ *
+ * \returns true iff the test oracle accepted the solver's results
+ */
+auto replayFromStdin(ReplayParams const& params, IPASIRSolverDSO const& ipasirDSO) -> bool
+{
+  ReplayPhaseReader reader{*stdin, params.parsePermissive};
+  auto failure =
+      withIPASIRBinding(params.solverLibrary, ipasirDSO, [&reader](auto const& binding) {
+        BoundIPASIRSolver<std::decay_t<decltype(binding)>> ipasir{binding};
+        return executeTraceFromStream(reader, ipasir);
+      });
+  return !failure.has_value();
+}
+
+/**
+ * Source of the inputs replayed in persistent mode.
+ *
+ * When monkey is linked to libhfuzz, inputs are obtained via honggfuzz's HF_ITER().
+ * Otherwise, each input is read from stdin: once per __AFL_LOOP() iteration if monkey
+ * has been compiled with AFL++'s afl-clang-fast, and exactly once if not.
+ */
+class PersistentInputSource {
+public:
+  explicit PersistentInputSource(unsigned int maxIterations) : m_maxIterations{maxIterations}
+  {
+  }
+
+  /**
+   * Obtains the next input, which is valid until the next call to `next()`.
+   *
+   * \returns false iff there are no further inputs
+   *
+   * \throw IOException on I/O failures
+   */
+  auto next() -> bool
+  {
+#if !defined(__APPLE__)
+    if (HF_ITER != nullptr) {
+      uint8_t const* buf = nullptr;
+      size_t len = 0;
+      HF_ITER(&buf, &len);
+      m_input = gsl::span<std::byte const>{reinterpret_cast<std::byte const*>(buf), len};
+      return true;
+    }
+#endif
+
+#if defined(__AFL_HAVE_MANUAL_CONTROL)
+    if (!__AFL_LOOP(m_maxIterations)) {
+      return false;
+    }
+#else
+    if (m_numIterations > 0) {
+      return false;
+    }
+#endif
+    ++m_numIterations;
+    readStdin();
+    m_input = m_stdinBuffer;
+    return true;
+  }
+
+  auto get() const noexcept -> gsl::span<std::byte const> { return m_input; }
+
+private:
+  void readStdin()
+  {
+    // Reading the file descriptor directly rather than via the stdin FILE object,
+    // since AFL rewinds the input file between iterations without notice
+    constexpr size_t chunkSize = 64 * 1024;
+    m_stdinBuffer.clear();
+    while (true) {
+      size_t const oldSize = m_stdinBuffer.size();
+      m_stdinBuffer.resize(oldSize + chunkSize);
+      ssize_t const numRead = read(STDIN_FILENO, m_stdinBuffer.data() + oldSize, chunkSize);
+      if (numRead < 0 && errno == EINTR) {
+        m_stdinBuffer.resize(oldSize);
+        continue;
+      }
+      if (numRead < 0) {
+        throw IOException{"Could not read the input from stdin"};
+      }
+      m_stdinBuffer.resize(oldSize + static_cast<size_t>(numRead));
+      if (numRead == 0) {
+        return;
+      }
+    }
+  }
+
+  [[maybe_unused]] unsigned int m_maxIterations;
+  unsigned int m_numIterations = 0;
+  std::vector<std::byte> m_stdinBuffer;
+  gsl::span<std::byte const> m_input;
+};
+
+/**
+ * Executes the trace encoded in `input` while decoding it.
+ *
+ * \returns true iff the test oracle accepted the solver's results
+ *
+ * \throw IOException on trace format errors
+ */
+template <typename SolverT>
+auto replayInput(gsl::span<std::byte const> input, bool parsePermissive, SolverT& ipasir) -> bool
+{
+  if (input.empty()) {
+    // Nothing to execute, and fmemopen() might not accept an empty buffer
+    return true;
+  }
+
+  void* inputData = const_cast<std::byte*>(input.data());
+  FILE* stream = fmemopen(inputData, input.size(), "r");
+  if (stream == nullptr) {
+    throw IOException{"Could not read the input buffer"};
+  }
+
+  try {
+    ReplayPhaseReader reader{*stream, parsePermissive};
+    bool const passed = !executeTraceFromStream(reader, ipasir).has_value();
+    fclose(stream);
+    return passed;
+  }
+  catch (...) {
+    fclose(stream);
+    throw;
+  }
+}
+
+/**
+ * Replays fuzzer inputs in a loop within this process (see PersistentInputSource). The
+ * IPASIR library is loaded and bound only once, while a new solver and a new test oracle
+ * are created for each input.
+ *
+ * \returns true iff the test oracle accepted the solver's results for all inputs
+ */
+auto replayPersistent(ReplayParams const& params, IPASIRSolverDSO const& ipasirDSO) -> bool
+{
+#if defined(__AFL_HAVE_MANUAL_CONTROL)
+  // Start AFL's fork server only after the IPASIR library has been loaded
+  __AFL_INIT();
+#endif
+
+  return withIPASIRBinding(params.solverLibrary, ipasirDSO, [&params](auto const& binding) {
+    PersistentInputSource inputs{params.persistentIterations};
+    uint64_t numInputs = 0;
+    uint64_t numFailures = 0;
+
+    while (inputs.next()) {
+      ++numInputs;
+      bool passed = false;
+      try {
+        BoundIPASIRSolver<std::decay_t<decltype(binding)>> ipasir{binding};
+        passed = replayInput(inputs.get(), params.parsePermissive, ipasir);
+        if (!passed) {
+          std::cout << "Failed: test oracle did not accept result\n";
+        }
+      }
+      catch (IOException const& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+      }
+
+      if (!passed) {
+        if (params.abortOnFailure) {
+          abort();
+        }
+        ++numFailures;
+      }
+    }
+
+    std::cout << "Replayed " << numInputs << " inputs, " << numFailures << " failed\n";
+    return numFailures == 0;
+  });
+}
+
+/**
+ * \returns true iff the test oracle accepted the solver's results
+ */
+auto replayFromFile(ReplayParams const& params, IPASIRSolverDSO const& ipasirDSO) -> bool
+{
+  FuzzTrace toReplay = loadTraceFromFileOrStdin(params.traceFile, params.parsePermissive);
+
+  // Expected results stored in the trace are not trusted, since the trace might
+  // have been modified e.g. by another fuzzer. executeTrace() recomputes them.
+  clearExpectedResults(toReplay.begin(), toReplay.end());
+
+  auto failure =
+      withIPASIRBinding(params.solverLibrary, ipasirDSO, [&toReplay](auto const& binding) {
+        BoundIPASIRSolver<std::decay_t<decltype(binding)>> ipasir{binding};
+        return executeTrace(toReplay.begin(), toReplay.end(), ipasir);
+      });
+  return !failure.has_value();
+}
 }
 
 auto replayMain(ReplayParams const& params) -> int
 {
   try {
+    bool const readsStdin = (params.traceFile == std::filesystem::path{"-"});
+    if (params.persistentIterations > 0 && !readsStdin) {
+      std::cerr << "Error: persistent mode requires reading the traces from stdin (TRACE: -)\n";
+      return EXIT_FAILURE;
+    }
+
     IPASIRSolverDSO ipasirDSO{params.solverLibrary};
-    auto ipasir = createIPASIRSolver(ipasirDSO);
-    FuzzTrace toReplay = loadTraceFromFileOrStdin(params.traceFile, params.parsePermissive);
 
-    auto failure = executeTrace(toReplay.begin(), toReplay.end(), *ipasir);
+    if (params.persistentIterations > 0) {
+      return replayPersistent(params, ipasirDSO) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    bool const passed =
+        readsStdin ? replayFromStdin(params, ipasirDSO) : replayFromFile(params, ipasirDSO);
 
-    if (failure.has_value()) {
+    if (!passed) {
       std::cout << "Failed: test oracle did not accept result\n";
       return failureExitCodeOrAbort(params.abortOnFailure);
     }
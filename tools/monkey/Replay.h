@@ -40,6 +40,10 @@ struct ReplayParams {
   std::filesystem::path solverLibrary;
   bool parsePermissive = false;
   bool abortOnFailure = false;
+
+  /// If nonzero, inputs are replayed in a loop within the process (persistent mode),
+  /// restarting the process after this many inputs when running under AFL++
+  unsigned int persistentIterations = 0;
 };
 
 auto replayMain(ReplayParams const& params) -> int;
@@ -0,0 +1,182 @@
+/* Copyright (c) 2020 Felix Kutzner (github.com/fkutzner)
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+
+ Except as contained in this notice, the name(s) of the above copyright holders
+ shall not be used in advertising or otherwise to promote the sale, use or
+ other dealings in this Software without prior written authorization.
+
+*/
+
+#include "Shrink.h"
+
+#include "LinkedIPASIR.h"
+#include "PrintCPP.h"
+#include "Utils.h"
+
+#include <libincmonk/BoundIPASIRSolver.h>
+#include <libincmonk/Fork.h>
+#include <libincmonk/FuzzTrace.h>
+#include <libincmonk/FuzzTraceExec.h>
+#include <libincmonk/IPASIRSolver.h>
+#include <libincmonk/Oracle.h>
+#include <libincmonk/TraceShrinker.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace incmonk {
+namespace {
+/// Outcome of a trace execution: passed, crashed, or failed with a TraceExecutionFailure::Reason
+using ExecOutcome = uint64_t;
+constexpr ExecOutcome passedOutcome = 0;
+constexpr ExecOutcome crashedOutcome = std::numeric_limits<uint64_t>::max();
+
+auto toOutcome(TraceExecutionFailure::Reason reason) -> ExecOutcome
+{
+  return static_cast<ExecOutcome>(reason) + 1;
+}
+
+auto describe(ExecOutcome outcome) -> std::string
+{
+  if (outcome == crashedOutcome) {
+    return "crash";
+  }
+
+  switch (static_cast<TraceExecutionFailure::Reason>(outcome - 1)) {
+  case TraceExecutionFailure::Reason::INVALID_RESULT:
+    return "invalid result";
+  case TraceExecutionFailure::Reason::INCORRECT_RESULT:
+    return "SAT/UNSAT flip";
+  case TraceExecutionFailure::Reason::INVALID_MODEL:
+    return "invalid model";
+  case TraceExecutionFailure::Reason::INVALID_FAILED:
+    return "invalid failed assumptions";
+  case TraceExecutionFailure::Reason::TIMEOUT:
+    return "timeout";
+  }
+  return "unknown";
+}
+
+/**
+ * Executes the trace in a child process. Expected results must have been removed
+ * from the trace, since they are not valid anymore after removing commands.
+ */
+auto executeInFork(FuzzTrace const& trace,
+                   ShrinkParams const& params,
+                   IPASIRSolverDSO const& ipasirDSO) -> ExecOutcome
+{
+  auto execute = [&trace, &params, &ipasirDSO]() -> uint64_t {
+    FuzzTrace toExecute = trace;
+    return withIPASIRBinding(
+        params.solverLibrary, ipasirDSO, [&toExecute](auto const& binding) -> uint64_t {
+          BoundIPASIRSolver<std::decay_t<decltype(binding)>> ipasir{binding};
+          auto failure = executeTrace(toExecute.begin(), toExecute.end(), ipasir);
+          return failure.has_value() ? toOutcome(failure->reason) : passedOutcome;
+        });
+  };
+
+  try {
+    std::optional<uint64_t> result = syncExecInFork(execute, EXIT_SUCCESS, params.timeout);
+    return result.has_value() ? *result : toOutcome(TraceExecutionFailure::Reason::TIMEOUT);
+  }
+  catch (ChildExecutionFailure const&) {
+    return crashedOutcome;
+  }
+}
+
+auto getOutputFile(ShrinkParams const& params) -> std::filesystem::path
+{
+  if (params.outputFile.has_value()) {
+    return *params.outputFile;
+  }
+
+  std::filesystem::path result = params.traceFile.filename();
+  result.replace_extension();
+  result += "-shrunk.mtr";
+  return result;
+}
+
+void writeRegressionTest(FuzzTrace const& trace,
+                         ShrinkParams const& params,
+                         std::filesystem::path const& path)
+{
+  std::ofstream output{path};
+  PrintCPPParams printParams;
+  printParams.funcName = params.funcName;
+  printCPP(trace.begin(), trace.end(), printParams, output);
+  if (!output) {
+    throw IOException{"Could not write " + path.string()};
+  }
+}
+}
+
+auto shrinkMain(ShrinkParams const& params) -> int
+{
+  try {
+    IPASIRSolverDSO ipasirDSO{params.solverLibrary};
+
+    FuzzTrace trace = loadTraceFromFileOrStdin(params.traceFile, params.parsePermissive);
+    // The expected results are invalidated by removing commands. The test oracle
+    // recomputes them during execution.
+    clearExpectedResults(trace.begin(), trace.end());
+
+    ExecOutcome const expectedOutcome = executeInFork(trace, params, ipasirDSO);
+    if (expectedOutcome == passedOutcome) {
+      std::cerr << "Error: the trace does not induce a failure\n";
+      return EXIT_FAILURE;
+    }
+    // Flushing the output, since it would be printed again by the child processes otherwise
+    std::cout << "Shrinking a trace of " << trace.size()
+              << " commands, reproducing failure: " << describe(expectedOutcome) << std::endl;
+
+    FuzzTrace result = shrinkTrace(
+        trace,
+        [&params, &ipasirDSO, expectedOutcome](FuzzTrace const& candidate) {
+          return executeInFork(candidate, params, ipasirDSO) == expectedOutcome;
+        },
+        params.numJobs);
+
+    // Adding the expected results for print-cpp's assertions:
+    createOracle()->solve(result.begin(), result.end());
+
+    std::filesystem::path const outputFile = getOutputFile(params);
+    std::filesystem::path regressionTestFile = outputFile;
+    regressionTestFile.replace_extension(".cpp");
+
+    storeTrace(result.begin(), result.end(), outputFile, params.traceFormat);
+    writeRegressionTest(result, params, regressionTestFile);
+
+    std::cout << "Shrunk the trace to " << result.size() << " commands. Wrote "
+              << outputFile.string() << " and " << regressionTestFile.string() << "\n";
+  }
+  catch (std::runtime_error const& error) {
+    // I/O errors, DSO loading errors and child process creation failures
+    std::cerr << "Error: " << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+}
@@ -38,7 +38,6 @@ extern void ipasir_signature();
 #endif
 
 namespace incmonk {
-namespace {
 void wrapVarsAt16M(std::vector<CNFLit>& lits)
 {
   constexpr CNFLit maxAbsLit = (1 << 24) - 1;
@@ -47,7 +46,7 @@ void wrapVarsAt16M(std::vector<CNFLit>& lits)
   }
 }
 
-void wrapVarsAt16M(FuzzTrace& trace)
+void wrapTraceVarsAt16M(FuzzTrace& trace)
 {
   for (FuzzCmd& traceElement : trace) {
     std::visit(
@@ -63,12 +62,15 @@ void wrapVarsAt16M(FuzzTrace& trace)
         traceElement);
   }
 }
+
+auto getLoaderStrictness(bool parsePermissive) -> LoaderStrictness
+{
+  return parsePermissive ? LoaderStrictness::PERMISSIVE : LoaderStrictness::PERMISSIVE;
 }
 
 auto loadTraceFromFileOrStdin(std::filesystem::path const& path, bool parsePermissive) -> FuzzTrace
 {
-  LoaderStrictness const strictness =
-      parsePermissive ? LoaderStrictness::PERMISSIVE : LoaderStrictness::PERMISSIVE;
+  LoaderStrictness const strictness = getLoaderStrictness(parsePermissive);
 
   FuzzTrace result;
   if (path == std::filesystem::path{"-"}) {
@@ -79,7 +81,7 @@ auto loadTraceFromFileOrStdin(std::filesystem::path const& path, bool parsePermi
   }
 
   if (parsePermissive) {
-    wrapVarsAt16M(result);
+    wrapTraceVarsAt16M(result);
   }
 
   return result;
@@ -27,15 +27,51 @@
 #pragma once
 
 #include <libincmonk/FuzzTrace.h>
+#include <libincmonk/MappedFuzzTrace.h>
 
 #include <filesystem>
+#include <vector>
 
 namespace incmonk {
+/**
+ * Returns the loader strictness used by the trace-reading commands
+ */
+auto getLoaderStrictness(bool parsePermissive) -> LoaderStrictness;
+
+/**
+ * Clamps the variables of the given literals to 2^24-1, which is done for traces
+ * loaded with `parsePermissive` set to true
+ */
+void wrapVarsAt16M(std::vector<CNFLit>& lits);
+
+/**
+ * Applies wrapVarsAt16M() to the literals of all clauses and assumptions in `trace`
+ */
+void wrapTraceVarsAt16M(FuzzTrace& trace);
+
 /**
  * Wrapper for loadTrace() that reads from stdin if the path is equal to "-"
  */
 auto loadTraceFromFileOrStdin(std::filesystem::path const& path, bool parsePermissive) -> FuzzTrace;
 
+/**
+ * Calls `fn(first, last)` with iterators over the trace loaded as by loadTraceFromFileOrStdin().
+ * Trace files are mapped into memory and decoded while `fn` iterates over them, unless
+ * variables need to be wrapped (`parsePermissive` is true) or the trace is read from stdin.
+ */
+template <typename Fn>
+auto withTraceFromFileOrStdin(std::filesystem::path const& path, bool parsePermissive, Fn&& fn)
+{
+  if (path != std::filesystem::path{"-"} && !parsePermissive &&
+      std::filesystem::is_regular_file(path)) {
+    MappedFuzzTrace trace{path, getLoaderStrictness(parsePermissive)};
+    return fn(trace.begin(), trace.end());
+  }
+
+  FuzzTrace const trace = loadTraceFromFileOrStdin(path, parsePermissive);
+  return fn(trace.begin(), trace.end());
+}
+
 /**
  * Uses an IPASIR symbol if an IPASIR library is linked at to the monkey binary
  * 